@@ -0,0 +1,717 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * bstr_bench - measures ns/op and GB/s of the public bitstring functions.
+ *
+ * Usage: bstr_bench [--json] [--min-time SECONDS] [--max-bytes BYTES]
+ *                   [--filter SUBSTRING] [--backend NAME]
+ *
+ * Every function of bitstring.h and bitstring_static.h is run against
+ * bitstrings from one word up to --max-bytes, growing by a factor of eight.
+ * Functions whose runtime depends on the content are additionally run for
+ * several densities of set bits. GB/s is the bitstring size divided by the
+ * time per call and is only reported for functions that walk the whole
+ * bitstring in the worst case. --backend forces one of the runtime dispatched
+ * scan backends of bitstring_dispatch.h (scalar, popcnt, avx2, avx512),
+ * default is the best one this CPU supports.
+ */
+
+#include "bitstring.h"
+#include "bitstring_dispatch.h"
+#include "bitstring_static.h"
+#include "time.h"
+
+#ifndef BSTR_BENCH_VERSION
+#define BSTR_BENCH_VERSION "unknown"
+#endif
+
+/*
+ * Bit indexes are unsigned int and most results are int. 128 MiB is the
+ * largest power of two where every result still fits.
+ */
+#define BENCH_MAX_BYTES (128U * 1024U * 1024U)
+#define BENCH_NUM_INDEXES 4096U
+#define BENCH_TO_STRING_MAX_WORDS 512U
+
+static const double bench_densities[] = {0.0, 0.01, 0.5, 0.99, 1.0};
+#define BENCH_NUM_DENSITIES (sizeof(bench_densities) / sizeof(double))
+
+typedef struct bench_ctx_t {
+  bstr_bitstr_t *bstr;
+  /** Copy of bstr, second operand of the predicates. */
+  bstr_bitstr_t *other;
+  void *sbstr;
+  void *sother;
+  unsigned int words;
+  unsigned int bits;
+  unsigned int idx[BENCH_NUM_INDEXES];
+  char *str;
+} bench_ctx_t;
+
+typedef struct bench_t {
+  const char *name;
+  uint64_t (*run)(bench_ctx_t *ctx, uint64_t reps);
+  /** Content dependent runtime, run once per density. */
+  bool density_sensitive;
+  /** Walks the whole bitstring in the worst case, report GB/s. */
+  bool scan;
+  /** Largest size in words this function is run for, 0 for no limit. */
+  unsigned int max_words;
+} bench_t;
+
+static volatile uint64_t bench_sink;
+static uint64_t bench_rng_state = 0x9E3779B97F4A7C15ULL;
+
+static inline uint64_t bench_rand(void) {
+  uint64_t x = bench_rng_state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  bench_rng_state = x;
+  return x;
+}
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void bench_fill(bench_ctx_t *ctx, double density) {
+  unsigned int *bits = ctx->bstr->_bits;
+  if (density == 0.5) {
+    for (unsigned int i = 0; i < ctx->words; i++)
+      bits[i] = (unsigned int)bench_rand();
+    return;
+  }
+  bool on = density > 0.5;
+  bstr_set_all(ctx->bstr, on);
+  double flip = on ? 1.0 - density : density;
+  uint64_t n = (uint64_t)(flip * ctx->bits);
+  for (uint64_t i = 0; i < n; i++) {
+    unsigned int bit = (unsigned int)bench_rand() & (ctx->bits - 1);
+    if (on)
+      bstr_clr(ctx->bstr, bit);
+    else
+      bstr_set(ctx->bstr, bit);
+  }
+}
+
+/* Dynamic sized bitstrings */
+
+static uint64_t run_create_delete(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++) {
+    bstr_bitstr_t *b = bstr_create_bitstr(ctx->words);
+    sum += b->_capacity;
+    bstr_delete_bitstr(b);
+  }
+  return sum;
+}
+
+static uint64_t run_resize(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++) {
+    unsigned int capacity = (i & 1) ? ctx->words : ctx->words * 2;
+    sum += bstr_resize(ctx->bstr, capacity) == BSTR_NO_ERROR;
+  }
+  if (bstr_resize(ctx->bstr, ctx->words) != BSTR_NO_ERROR)
+    abort();
+  return sum;
+}
+
+static uint64_t run_get_capacity(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += bstr_get_capacity(ctx->bstr);
+  return sum;
+}
+
+static uint64_t run_get_bit_capacity(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += bstr_get_bit_capacity(ctx->bstr);
+  return sum;
+}
+
+static uint64_t run_to_string_size(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += bstr_to_string_size(ctx->bstr);
+  return sum;
+}
+
+static uint64_t run_to_string(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++) {
+    ctx->str[0] = '\0';
+    bstr_to_string(ctx->bstr, ctx->str);
+    sum += (unsigned char)ctx->str[i % ctx->bits];
+  }
+  return sum;
+}
+
+static uint64_t run_bindump(bench_ctx_t *ctx, uint64_t reps) {
+  char line[BSTR_BINDUMP_SIZE];
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++) {
+    line[0] = '\0';
+    bstr_bindump(ctx->bstr, line, (unsigned int)i & (ctx->words - 1));
+    sum += (unsigned char)line[BSTR_BINDUMP_SIZE / 2];
+  }
+  return sum;
+}
+
+static uint64_t run_set(bench_ctx_t *ctx, uint64_t reps) {
+  for (uint64_t i = 0; i < reps; i++)
+    bstr_set(ctx->bstr, ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);
+  return ctx->bstr->_bits[0];
+}
+
+static uint64_t run_set_all(bench_ctx_t *ctx, uint64_t reps) {
+  for (uint64_t i = 0; i < reps; i++)
+    bstr_set_all(ctx->bstr, i & 1);
+  return ctx->bstr->_bits[0];
+}
+
+static uint64_t run_clr(bench_ctx_t *ctx, uint64_t reps) {
+  for (uint64_t i = 0; i < reps; i++)
+    bstr_clr(ctx->bstr, ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);
+  return ctx->bstr->_bits[0];
+}
+
+static uint64_t run_get(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += bstr_get(ctx->bstr, ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);
+  return sum;
+}
+
+/* Each index depends on the bit read before, so the loads do not overlap and
+ * every one pays its cache and TLB misses. Built with BITSTRING_HUGE_PAGES the
+ * large sizes show the TLB misses that huge pages save. */
+static uint64_t run_get_random(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  uint64_t x = bench_rand();
+  for (uint64_t i = 0; i < reps; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL + sum;
+    sum += bstr_get(ctx->bstr, (unsigned int)(x >> 32) & (ctx->bits - 1));
+  }
+  return sum;
+}
+
+/* 12 bit fields at random bit offsets, some of them straddle two words. */
+static uint64_t run_get_field(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += bstr_get_field(ctx->bstr, ctx->idx[i & (BENCH_NUM_INDEXES - 1)] / 2,
+                          12);
+  return sum;
+}
+
+static uint64_t run_set_field(bench_ctx_t *ctx, uint64_t reps) {
+  for (uint64_t i = 0; i < reps; i++)
+    bstr_set_field(ctx->bstr, ctx->idx[i & (BENCH_NUM_INDEXES - 1)] / 2, 12,
+                   i);
+  return ctx->bstr->_bits[0];
+}
+
+#define BENCH_DEFINE_SCAN(fn)                                                  \
+  static uint64_t run_##fn(bench_ctx_t *ctx, uint64_t reps) {                  \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      sum += (unsigned int)bstr_##fn(ctx->bstr);                               \
+    return sum;                                                                \
+  }
+
+BENCH_DEFINE_SCAN(ffs)
+BENCH_DEFINE_SCAN(ffus)
+BENCH_DEFINE_SCAN(ctz)
+BENCH_DEFINE_SCAN(clz)
+BENCH_DEFINE_SCAN(popcnt)
+
+/* Half of the bitstring from a random offset in the first half. */
+static uint64_t run_popcnt_range(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += (unsigned int)bstr_popcnt_range(
+        ctx->bstr, ctx->idx[i & (BENCH_NUM_INDEXES - 1)] / 2, ctx->bits / 2);
+  return sum;
+}
+
+#define BENCH_DEFINE_NEXT(fn)                                                  \
+  static uint64_t run_##fn(bench_ctx_t *ctx, uint64_t reps) {                  \
+    uint64_t sum = 0;                                                          \
+    unsigned int cursor = 0;                                                   \
+    for (uint64_t i = 0; i < reps; i++) {                                      \
+      int r = bstr_##fn(ctx->bstr, cursor);                                    \
+      cursor = (r < 0 || (unsigned int)r + 1 >= ctx->bits) ? 0 : r + 1;       \
+      sum += cursor;                                                           \
+    }                                                                          \
+    return sum;                                                                \
+  }
+
+BENCH_DEFINE_NEXT(next_set_bit)
+BENCH_DEFINE_NEXT(next_unset_bit)
+
+BENCH_DEFINE_SCAN(is_empty)
+BENCH_DEFINE_SCAN(hash)
+
+/* The operands are equal, which is the worst case for all but intersects. */
+#define BENCH_DEFINE_PAIR(fn)                                                  \
+  static uint64_t run_##fn(bench_ctx_t *ctx, uint64_t reps) {                  \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      sum += (unsigned int)bstr_##fn(ctx->bstr, ctx->other);                   \
+    return sum;                                                                \
+  }
+
+BENCH_DEFINE_PAIR(equals)
+BENCH_DEFINE_PAIR(intersects)
+BENCH_DEFINE_PAIR(is_subset)
+BENCH_DEFINE_PAIR(compare)
+
+/* A 48 bit sync word, practically never found in random data. */
+static unsigned int bench_pattern[2] = {0x1ACFFC1DU, 0xB5E3U};
+#define BENCH_PATTERN_BITS 48U
+
+static uint64_t run_find_pattern(bench_ctx_t *ctx, uint64_t reps) {
+  const bstr_bitstr_t pattern = bstr_wrap(bench_pattern, 2);
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += (unsigned int)bstr_find_pattern(ctx->bstr, &pattern,
+                                           BENCH_PATTERN_BITS, 0);
+  return sum;
+}
+
+#define BENCH_RUN_BITS 16U
+
+static uint64_t run_find_zero_run(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++)
+    sum += (unsigned int)bstr_find_zero_run(
+        ctx->bstr, BENCH_RUN_BITS, 0, ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);
+  return sum;
+}
+
+/* Freeing right away keeps the fill level, and with it the cost, steady. */
+static uint64_t run_alloc_free_range(bench_ctx_t *ctx, uint64_t reps) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < reps; i++) {
+    const int start = bstr_alloc_range(ctx->bstr, BENCH_RUN_BITS, 0,
+                                       ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);
+    if (start >= 0)
+      bstr_free_range(ctx->bstr, (unsigned int)start, BENCH_RUN_BITS);
+    sum += (unsigned int)start;
+  }
+  return sum;
+}
+
+static const bench_t dynamic_benches[] = {
+    {"bstr_create_bitstr+bstr_delete_bitstr", run_create_delete, false, false,
+     0},
+    {"bstr_resize", run_resize, false, false, 0},
+    {"bstr_get_capacity", run_get_capacity, false, false, 0},
+    {"bstr_get_bit_capacity", run_get_bit_capacity, false, false, 0},
+    {"bstr_to_string_size", run_to_string_size, false, false, 0},
+    {"bstr_to_string", run_to_string, false, true, BENCH_TO_STRING_MAX_WORDS},
+    {"bstr_bindump", run_bindump, false, false, 0},
+    {"bstr_set", run_set, false, false, 0},
+    {"bstr_set_all", run_set_all, false, true, 0},
+    {"bstr_clr", run_clr, false, false, 0},
+    {"bstr_get", run_get, true, false, 0},
+    {"bstr_get_random", run_get_random, false, false, 0},
+    {"bstr_get_field", run_get_field, true, false, 0},
+    {"bstr_set_field", run_set_field, false, false, 0},
+    {"bstr_ffs", run_ffs, true, true, 0},
+    {"bstr_ffus", run_ffus, true, true, 0},
+    {"bstr_ctz", run_ctz, true, true, 0},
+    {"bstr_clz", run_clz, true, true, 0},
+    {"bstr_popcnt", run_popcnt, true, true, 0},
+    {"bstr_popcnt_range", run_popcnt_range, true, true, 0},
+    {"bstr_next_set_bit", run_next_set_bit, true, true, 0},
+    {"bstr_next_unset_bit", run_next_unset_bit, true, true, 0},
+    {"bstr_is_empty", run_is_empty, true, true, 0},
+    {"bstr_equals", run_equals, true, true, 0},
+    {"bstr_intersects", run_intersects, true, true, 0},
+    {"bstr_is_subset", run_is_subset, true, true, 0},
+    {"bstr_compare", run_compare, true, true, 0},
+    {"bstr_hash", run_hash, false, true, 0},
+    {"bstr_find_pattern", run_find_pattern, true, true, 0},
+    {"bstr_find_zero_run", run_find_zero_run, true, true, 0},
+    {"bstr_alloc_range+bstr_free_range", run_alloc_free_range, true, true, 0},
+};
+
+/* Static sized bitstrings */
+
+#define BENCH_STATIC_SUITE(size)                                               \
+  BSTR_STATIC_DECLARE_ALL(size)                                                \
+  static uint64_t run_s##size##_to_string(bench_ctx_t *ctx, uint64_t reps) {   \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++) {                                      \
+      ctx->str[0] = '\0';                                                      \
+      bstrs_to_string(size, (bstr_static_t(size) *)ctx->sbstr, ctx->str);      \
+      sum += (unsigned char)ctx->str[i % ctx->bits];                           \
+    }                                                                          \
+    return sum;                                                                \
+  }                                                                            \
+  static uint64_t run_s##size##_bindump(bench_ctx_t *ctx, uint64_t reps) {     \
+    char line[BSTR_BINDUMP_SIZE];                                              \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++) {                                      \
+      line[0] = '\0';                                                          \
+      bstrs_bindump(size, (bstr_static_t(size) *)ctx->sbstr, line,             \
+                    (unsigned int)i & (size - 1));                             \
+      sum += (unsigned char)line[BSTR_BINDUMP_SIZE / 2];                       \
+    }                                                                          \
+    return sum;                                                                \
+  }                                                                            \
+  static uint64_t run_s##size##_set(bench_ctx_t *ctx, uint64_t reps) {         \
+    bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sbstr;                \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      bstrs_set(size, b, ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);               \
+    return b->_bits[0];                                                        \
+  }                                                                            \
+  static uint64_t run_s##size##_set_all(bench_ctx_t *ctx, uint64_t reps) {     \
+    bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sbstr;                \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      bstrs_set_all(size, b, i & 1);                                           \
+    return b->_bits[0];                                                        \
+  }                                                                            \
+  static uint64_t run_s##size##_clr(bench_ctx_t *ctx, uint64_t reps) {         \
+    bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sbstr;                \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      bstrs_clr(size, b, ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);               \
+    return b->_bits[0];                                                        \
+  }                                                                            \
+  static uint64_t run_s##size##_get(bench_ctx_t *ctx, uint64_t reps) {         \
+    const bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sbstr;          \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      sum += bstrs_get(size, b, ctx->idx[i & (BENCH_NUM_INDEXES - 1)]);        \
+    return sum;                                                                \
+  }                                                                            \
+  BENCH_STATIC_DEFINE_SCAN(size, ffs)                                          \
+  BENCH_STATIC_DEFINE_SCAN(size, ffus)                                         \
+  BENCH_STATIC_DEFINE_SCAN(size, ctz)                                          \
+  BENCH_STATIC_DEFINE_SCAN(size, clz)                                          \
+  BENCH_STATIC_DEFINE_SCAN(size, popcnt)                                       \
+  BENCH_STATIC_DEFINE_NEXT(size, next_set_bit)                                 \
+  BENCH_STATIC_DEFINE_NEXT(size, next_unset_bit)                               \
+  BENCH_STATIC_DEFINE_SCAN(size, is_empty)                                     \
+  BENCH_STATIC_DEFINE_SCAN(size, hash)                                         \
+  static uint64_t run_s##size##_find_pattern(bench_ctx_t *ctx,                 \
+                                             uint64_t reps) {                  \
+    const bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sbstr;          \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      sum += (unsigned int)bstrs_find_pattern(size, b, bench_pattern,          \
+                                              BENCH_PATTERN_BITS, 0);          \
+    return sum;                                                                \
+  }                                                                            \
+  BENCH_STATIC_DEFINE_PAIR(size, equals)                                       \
+  BENCH_STATIC_DEFINE_PAIR(size, intersects)                                   \
+  BENCH_STATIC_DEFINE_PAIR(size, is_subset)                                    \
+  BENCH_STATIC_DEFINE_PAIR(size, compare)                                      \
+  static const bench_t static_benches_##size[] = {                             \
+      {"bstrs_to_string", run_s##size##_to_string, false, true,                \
+       BENCH_TO_STRING_MAX_WORDS},                                             \
+      {"bstrs_bindump", run_s##size##_bindump, false, false, 0},               \
+      {"bstrs_set", run_s##size##_set, false, false, 0},                       \
+      {"bstrs_set_all", run_s##size##_set_all, false, true, 0},                \
+      {"bstrs_clr", run_s##size##_clr, false, false, 0},                       \
+      {"bstrs_get", run_s##size##_get, true, false, 0},                        \
+      {"bstrs_ffs", run_s##size##_ffs, true, true, 0},                         \
+      {"bstrs_ffus", run_s##size##_ffus, true, true, 0},                       \
+      {"bstrs_ctz", run_s##size##_ctz, true, true, 0},                         \
+      {"bstrs_clz", run_s##size##_clz, true, true, 0},                         \
+      {"bstrs_popcnt", run_s##size##_popcnt, true, true, 0},                   \
+      {"bstrs_next_set_bit", run_s##size##_next_set_bit, true, true, 0},       \
+      {"bstrs_next_unset_bit", run_s##size##_next_unset_bit, true, true, 0},   \
+      {"bstrs_is_empty", run_s##size##_is_empty, true, true, 0},               \
+      {"bstrs_equals", run_s##size##_equals, true, true, 0},                   \
+      {"bstrs_intersects", run_s##size##_intersects, true, true, 0},           \
+      {"bstrs_is_subset", run_s##size##_is_subset, true, true, 0},             \
+      {"bstrs_compare", run_s##size##_compare, true, true, 0},                 \
+      {"bstrs_hash", run_s##size##_hash, false, true, 0},                      \
+      {"bstrs_find_pattern", run_s##size##_find_pattern, true, true, 0},       \
+  };
+
+#define BENCH_STATIC_DEFINE_SCAN(size, fn)                                     \
+  static uint64_t run_s##size##_##fn(bench_ctx_t *ctx, uint64_t reps) {        \
+    const bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sbstr;          \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      sum += (unsigned int)bstrs_##fn(size, b);                                \
+    return sum;                                                                \
+  }
+
+#define BENCH_STATIC_DEFINE_NEXT(size, fn)                                     \
+  static uint64_t run_s##size##_##fn(bench_ctx_t *ctx, uint64_t reps) {        \
+    const bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sbstr;          \
+    uint64_t sum = 0;                                                          \
+    unsigned int cursor = 0;                                                   \
+    for (uint64_t i = 0; i < reps; i++) {                                      \
+      int r = bstrs_##fn(size, b, cursor);                                     \
+      cursor = (r < 0 || (unsigned int)r + 1 >= ctx->bits) ? 0 : r + 1;       \
+      sum += cursor;                                                           \
+    }                                                                          \
+    return sum;                                                                \
+  }
+
+#define BENCH_STATIC_DEFINE_PAIR(size, fn)                                     \
+  static uint64_t run_s##size##_##fn(bench_ctx_t *ctx, uint64_t reps) {        \
+    const bstr_static_t(size) *a = (bstr_static_t(size) *)ctx->sbstr;          \
+    const bstr_static_t(size) *b = (bstr_static_t(size) *)ctx->sother;         \
+    uint64_t sum = 0;                                                          \
+    for (uint64_t i = 0; i < reps; i++)                                        \
+      sum += (unsigned int)bstrs_##fn(size, a, b);                             \
+    return sum;                                                                \
+  }
+
+BENCH_STATIC_SUITE(1)
+BENCH_STATIC_SUITE(8)
+BENCH_STATIC_SUITE(64)
+BENCH_STATIC_SUITE(512)
+BENCH_STATIC_SUITE(4096)
+BENCH_STATIC_SUITE(32768)
+
+typedef struct static_suite_t {
+  unsigned int words;
+  const bench_t *benches;
+  size_t num_benches;
+} static_suite_t;
+
+#define BENCH_STATIC_SUITE_ENTRY(size)                                         \
+  {size, static_benches_##size,                                                \
+   sizeof(static_benches_##size) / sizeof(bench_t)}
+
+static const static_suite_t static_suites[] = {
+    BENCH_STATIC_SUITE_ENTRY(1),    BENCH_STATIC_SUITE_ENTRY(8),
+    BENCH_STATIC_SUITE_ENTRY(64),   BENCH_STATIC_SUITE_ENTRY(512),
+    BENCH_STATIC_SUITE_ENTRY(4096), BENCH_STATIC_SUITE_ENTRY(32768),
+};
+
+/* Runner */
+
+typedef struct bench_opts_t {
+  bool json;
+  double min_time;
+  unsigned int max_bytes;
+  const char *filter;
+} bench_opts_t;
+
+static unsigned int bench_results;
+
+static void bench_report(const bench_opts_t *opts, const char *api,
+                         const bench_t *bench, const bench_ctx_t *ctx,
+                         double density, uint64_t reps, double elapsed) {
+  double ns_per_op = elapsed * 1e9 / (double)reps;
+  double bytes = (double)ctx->words * sizeof(unsigned int);
+  double gb_per_s = bench->scan ? bytes / ns_per_op : 0.0;
+  if (opts->json) {
+    printf("%s\n    {\"api\": \"%s\", \"function\": \"%s\", \"words\": %u, "
+           "\"bytes\": %.0f, ",
+           bench_results ? "," : "", api, bench->name, ctx->words, bytes);
+    if (bench->density_sensitive)
+      printf("\"density\": %g, ", density);
+    else
+      printf("\"density\": null, ");
+    printf("\"iterations\": %llu, \"ns_per_op\": %.3f, ",
+           (unsigned long long)reps, ns_per_op);
+    if (bench->scan)
+      printf("\"gb_per_s\": %.3f}", gb_per_s);
+    else
+      printf("\"gb_per_s\": null}");
+  } else {
+    char dens[16] = "-";
+    char gbs[16] = "-";
+    if (bench->density_sensitive)
+      snprintf(dens, sizeof(dens), "%g", density);
+    if (bench->scan)
+      snprintf(gbs, sizeof(gbs), "%.3f", gb_per_s);
+    printf("%-7s %-38s %10u %8s %14.3f %10s\n", api, bench->name, ctx->words,
+           dens, ns_per_op, gbs);
+  }
+  bench_results++;
+}
+
+static void bench_run(const bench_opts_t *opts, const char *api,
+                      const bench_t *bench, bench_ctx_t *ctx,
+                      void (*prepare)(bench_ctx_t *ctx, double density)) {
+  if (opts->filter != NULL && strstr(bench->name, opts->filter) == NULL)
+    return;
+  if (bench->max_words != 0 && ctx->words > bench->max_words)
+    return;
+  for (size_t d = 0; d < BENCH_NUM_DENSITIES; d++) {
+    double density = bench->density_sensitive ? bench_densities[d] : 0.0;
+    prepare(ctx, density);
+    uint64_t reps = 1;
+    double elapsed = 0.0;
+    for (;;) {
+      double start = bench_now();
+      bench_sink += bench->run(ctx, reps);
+      elapsed = bench_now() - start;
+      if (elapsed >= opts->min_time || reps >= (1ULL << 40))
+        break;
+      reps *= 2;
+    }
+    bench_report(opts, api, bench, ctx, density, reps, elapsed);
+    if (!bench->density_sensitive)
+      break;
+  }
+}
+
+static void bench_prepare_dynamic(bench_ctx_t *ctx, double density) {
+  bench_fill(ctx, density);
+  memcpy(ctx->other->_bits, ctx->bstr->_bits,
+         ctx->words * sizeof(unsigned int));
+}
+
+static void bench_prepare_static(bench_ctx_t *ctx, double density) {
+  bench_fill(ctx, density);
+  memcpy(ctx->sbstr, ctx->bstr->_bits, ctx->words * sizeof(unsigned int));
+  memcpy(ctx->sother, ctx->bstr->_bits, ctx->words * sizeof(unsigned int));
+}
+
+static void bench_usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [--json] [--min-time SECONDS] [--max-bytes BYTES] "
+          "[--filter SUBSTRING] [--backend NAME]\n",
+          prog);
+}
+
+int main(int argc, char **argv) {
+  bench_opts_t opts = {false, 0.2, BENCH_MAX_BYTES, NULL};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      opts.json = true;
+    } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      opts.min_time = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--max-bytes") == 0 && i + 1 < argc) {
+      unsigned long long max = strtoull(argv[++i], NULL, 0);
+      if (max < sizeof(unsigned int) || max > BENCH_MAX_BYTES) {
+        fprintf(stderr, "--max-bytes has to be in [%zu, %u]\n",
+                sizeof(unsigned int), BENCH_MAX_BYTES);
+        return EXIT_FAILURE;
+      }
+      opts.max_bytes = (unsigned int)max;
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      opts.filter = argv[++i];
+    } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+      const char *name = argv[++i];
+      bstr_backend_t backend = BSTR_BACKEND_AUTO;
+      while (bstr_backend_name(backend) != NULL &&
+             strcmp(bstr_backend_name(backend), name) != 0)
+        backend = (bstr_backend_t)(backend + 1);
+      if (bstr_backend_name(backend) == NULL) {
+        fprintf(stderr, "unknown backend %s\n", name);
+        return EXIT_FAILURE;
+      }
+      if (bstr_set_backend(backend) != BSTR_NO_ERROR) {
+        fprintf(stderr, "backend %s is not supported by this CPU\n", name);
+        return EXIT_FAILURE;
+      }
+    } else {
+      bench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  bench_ctx_t *ctx = (bench_ctx_t *)calloc(1, sizeof(bench_ctx_t));
+  if (ctx == NULL)
+    return EXIT_FAILURE;
+
+  if (opts.json) {
+    printf("{\n  \"library\": \"bitstring\",\n  \"version\": \"%s\",\n"
+           "  \"backend\": \"%s\",\n  \"min_time\": %g,\n"
+           "  \"bound_checks\": %s,\n  \"results\": [",
+           BSTR_BENCH_VERSION, bstr_backend_name(bstr_get_backend()),
+           opts.min_time,
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+           "true"
+#else
+           "false"
+#endif
+    );
+  } else {
+    printf("backend: %s\n", bstr_backend_name(bstr_get_backend()));
+    printf("%-7s %-38s %10s %8s %14s %10s\n", "api", "function", "words",
+           "density", "ns/op", "GB/s");
+  }
+
+  /* Single bit benchmarks mask their random indexes, keep sizes powers of 2 */
+  unsigned int max_words = 1;
+  while (max_words * 2 <= opts.max_bytes / sizeof(unsigned int))
+    max_words *= 2;
+  for (unsigned int words = 1;; words = words * 8 < max_words ? words * 8
+                                                              : max_words) {
+    ctx->words = words;
+    ctx->bits = words * sizeof(unsigned int) * CHAR_BIT;
+    ctx->bstr = bstr_create_bitstr(words);
+    ctx->other = bstr_create_bitstr(words);
+    ctx->str = NULL;
+    if (ctx->bstr == NULL || ctx->other == NULL) {
+      fprintf(stderr, "bstr_create_bitstr(%u) failed\n", words);
+      return EXIT_FAILURE;
+    }
+    if (words <= BENCH_TO_STRING_MAX_WORDS)
+      ctx->str = (char *)malloc(bstr_to_string_size(ctx->bstr));
+    for (unsigned int i = 0; i < BENCH_NUM_INDEXES; i++)
+      ctx->idx[i] = (unsigned int)bench_rand() & (ctx->bits - 1);
+
+    for (size_t b = 0; b < sizeof(dynamic_benches) / sizeof(bench_t); b++)
+      bench_run(&opts, "dynamic", &dynamic_benches[b], ctx,
+                bench_prepare_dynamic);
+
+    for (size_t s = 0; s < sizeof(static_suites) / sizeof(static_suite_t);
+         s++) {
+      if (static_suites[s].words != words)
+        continue;
+      ctx->sbstr = malloc(words * sizeof(unsigned int));
+      ctx->sother = malloc(words * sizeof(unsigned int));
+      if (ctx->sbstr == NULL || ctx->sother == NULL)
+        return EXIT_FAILURE;
+      for (size_t b = 0; b < static_suites[s].num_benches; b++)
+        bench_run(&opts, "static", &static_suites[s].benches[b], ctx,
+                  bench_prepare_static);
+      free(ctx->sbstr);
+      free(ctx->sother);
+      ctx->sbstr = NULL;
+      ctx->sother = NULL;
+    }
+
+    free(ctx->str);
+    bstr_delete_bitstr(ctx->bstr);
+    bstr_delete_bitstr(ctx->other);
+    if (words == max_words)
+      break;
+  }
+
+  if (opts.json)
+    printf("\n  ]\n}\n");
+  free(ctx);
+  return EXIT_SUCCESS;
+}
@@ -26,6 +26,7 @@ SOFTWARE.
 #define BSTR_BITSTRING_H
 
 #include "bitstring_common.h"
+#include "bitstring_kernel.h"
 #include "limits.h"
 #include "stdbool.h"
 #include "stddef.h"
@@ -42,23 +43,6 @@ SOFTWARE.
 extern "C" {
 #endif
 
-/**
- * @brief A descriptive error type for all operation which could fail.
- *
- */
-typedef enum bstr_err_t {
-  /**
-   * @brief No error occured
-   *
-   */
-  BSTR_NO_ERROR = 0,
-  /**
-   * @brief Memory allocation failed
-   *
-   */
-  BSTR_MALLOC_FAILED = -1,
-} bstr_err_t;
-
 /**
  * @brief This is the main bit string object. Create it with
  * bstr_create_bitstr() to ensure correct initialization.
@@ -80,8 +64,153 @@ typedef struct bstr_bitstr_t {
    *
    */
   unsigned int *_bits;
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  /**
+   * @brief Set bits per block, NULL unless bstr_popcnt_cache_enable() was
+   * called. Note: This field is private.
+   *
+   */
+  struct _bstr_popcnt_cache_t *_popcnt_cache;
+#endif
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  /**
+   * @brief One bit per chunk that was written, NULL unless
+   * bstr_dirty_enable() was called. Note: This field is private.
+   *
+   */
+  struct bstr_bitstr_t *_dirty;
+#endif
 } bstr_bitstr_t;
 
+/**
+ * @brief Number of unsigned ints per block of the popcount cache.
+ *
+ */
+#define BSTR_POPCNT_CACHE_BLOCK_WORDS 16U
+
+/**
+ * @brief Number of unsigned ints per chunk of the dirty tracking.
+ *
+ */
+#ifndef BSTR_DIRTY_CHUNK_WORDS
+#define BSTR_DIRTY_CHUNK_WORDS 1024U
+#endif
+
+#define BSTR_DIRTY_CHUNK_BITS (BSTR_DIRTY_CHUNK_WORDS * BSTR_BITS_PER_INT)
+
+/**
+ * @brief Size and alignment of the huge pages bitstrings are mapped in with
+ * CONFIG_BITSTRING_HUGE_PAGES.
+ *
+ */
+#ifndef BSTR_HUGE_PAGE_SIZE
+#define BSTR_HUGE_PAGE_SIZE (2U * 1024U * 1024U)
+#endif
+
+/**
+ * @brief With CONFIG_BITSTRING_HUGE_PAGES the words of bitstrings of at least
+ * this many bytes are mapped in huge pages, smaller ones are malloc()ed.
+ *
+ */
+#ifndef BSTR_HUGE_PAGE_MIN_BYTES
+#define BSTR_HUGE_PAGE_MIN_BYTES BSTR_HUGE_PAGE_SIZE
+#endif
+
+/**
+ * @brief 1 to try reserved hugetlb pages (MAP_HUGETLB) before transparent huge
+ * pages.
+ *
+ */
+#ifndef BSTR_HUGE_PAGE_HUGETLB
+#define BSTR_HUGE_PAGE_HUGETLB 0
+#endif
+
+/**
+ * @brief 1 to fault in the huge pages of a bitstring when it is created or
+ * grown, instead of at the first access to each of them.
+ *
+ */
+#ifndef BSTR_HUGE_PAGE_PREFAULT
+#define BSTR_HUGE_PAGE_PREFAULT 0
+#endif
+
+/**
+ * @brief A run of bstr_diff() goes on over this many equal words. Starting a
+ * new run costs as much.
+ *
+ */
+#define BSTR_PATCH_MERGE_WORDS 2U
+
+/**
+ * @brief Kernel view of a bitstring. Private, used by the front end functions.
+ *
+ */
+static inline bstr_view_t _bstr_view(const bstr_bitstr_t *const bstr) {
+  return bstr_kernel_view(bstr->_bits, bstr->_capacity);
+}
+
+/**
+ * @brief Initializes a bitstring object over words that someone else owns.
+ * Private, used by the modules that embed bitstring objects.
+ *
+ */
+static inline void _bstr_wrap(bstr_bitstr_t *const bstr, unsigned int *words,
+                              unsigned int capacity) {
+  bstr->_capacity = capacity;
+  bstr->_bits = words;
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  bstr->_popcnt_cache = NULL;
+#endif
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  bstr->_dirty = NULL;
+#endif
+}
+
+/**
+ * @brief A bitstring object over capacity unsigned ints at words, without
+ * allocating or copying them. It works with every function but bstr_resize()
+ * and bstr_delete_bitstr(), and words has to outlive it. For bit ranges that
+ * do not start on a word see bitstring_slice.h.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param capacity Number of unsigned ints.
+ * @return bstr_bitstr_t The bitstring object, e.g. for bstr_popcnt(&bstr).
+ */
+static inline bstr_bitstr_t bstr_wrap(unsigned int *words,
+                                      unsigned int capacity) {
+  bstr_bitstr_t bstr;
+  _bstr_wrap(&bstr, words, capacity);
+  return bstr;
+}
+
+/**
+ * @brief Like bstr_wrap(), for words that must not be written, e.g. a pattern
+ * in read only memory. Store the result in a const bstr_bitstr_t and pass it
+ * only to functions taking a const bstr_bitstr_t *.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param capacity Number of unsigned ints.
+ * @return bstr_bitstr_t The bitstring object.
+ */
+static inline bstr_bitstr_t bstr_wrap_const(const unsigned int *words,
+                                            unsigned int capacity) {
+  return bstr_wrap((unsigned int *)words, capacity);
+}
+
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+/**
+ * @brief Marks the chunks of n > 0 bits from bit start dirty. Private.
+ *
+ */
+static inline void _bstr_dirty_mark(const bstr_bitstr_t *const bstr,
+                                    unsigned int start, unsigned int n) {
+  const unsigned int first = start / BSTR_DIRTY_CHUNK_BITS;
+  bstr_kernel_fill_range(_bstr_view(bstr->_dirty), first,
+                         (start + n - 1U) / BSTR_DIRTY_CHUNK_BITS - first + 1U,
+                         true);
+}
+#endif
+
 /**
  * @brief Method to create and initialize a bitstring object. Returns NULL when
  * there is no memory left.
@@ -119,8 +248,10 @@ bstr_err_t bstr_resize(bstr_bitstr_t *const bstr, unsigned int capacity)
  * @param bstr Pointer to bitstring object.
  * @return unsigned int
  */
+#ifndef CONFIG_BITSTRING_INLINE
 unsigned int bstr_get_capacity(const bstr_bitstr_t *const bstr)
     __attribute__((nonnull(1)));
+#endif
 
 /**
  * @brief Returns the number of bits that are stored here
@@ -128,8 +259,10 @@ unsigned int bstr_get_capacity(const bstr_bitstr_t *const bstr)
  * @param bstr Pointer to bitstring object
  * @return unsigned int
  */
+#ifndef CONFIG_BITSTRING_INLINE
 unsigned int bstr_get_bit_capacity(const bstr_bitstr_t *const bstr)
     __attribute__((nonnull(1)));
+#endif
 
 /**
  * @brief Returns the size of a formatted string which would print the complete
@@ -176,8 +309,10 @@ void bstr_bindump(const bstr_bitstr_t *const bstr, char *const str,
  * @param bit Number of the bit which will be set. Will panic when a out of
  * bounds access happens. Bits are zero indexed.
  */
+#ifndef CONFIG_BITSTRING_INLINE
 void bstr_set(bstr_bitstr_t *const bstr, unsigned int bit)
     __attribute__((nonnull(1)));
+#endif
 
 /**
  * @brief Set all bits to the value of @param on.
@@ -196,8 +331,10 @@ void bstr_set_all(bstr_bitstr_t *const bstr, bool on)
  * bounds access happens. Bits are zero indexed.
  *
  */
+#ifndef CONFIG_BITSTRING_INLINE
 void bstr_clr(bstr_bitstr_t *const bstr, unsigned int bit)
     __attribute__((nonnull(1)));
+#endif
 
 /**
  * @brief Check if a bit is set.
@@ -209,8 +346,65 @@ void bstr_clr(bstr_bitstr_t *const bstr, unsigned int bit)
  * @return - true   when set
  *         - false  when not set
  */
+#ifndef CONFIG_BITSTRING_INLINE
 bool bstr_get(const bstr_bitstr_t *const bstr, unsigned int bit)
     __attribute__((nonnull(1)));
+#endif
+
+/**
+ * @brief Read a packed unsigned field of width bits at any bit offset. A
+ * field may straddle word boundaries.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset Index of the least significant bit of the field.
+ * @param width Width of the field in bits, 1 to 64. offset + width has to be
+ * <= get_bit_capacity().
+ * @return uint64_t The field, bit offset is bit 0.
+ */
+#ifndef CONFIG_BITSTRING_INLINE
+uint64_t bstr_get_field(const bstr_bitstr_t *const bstr, unsigned int offset,
+                        unsigned int width) __attribute__((nonnull(1)));
+#endif
+
+/**
+ * @brief Write a packed unsigned field of width bits at any bit offset. A
+ * field may straddle word boundaries.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset Index of the least significant bit of the field.
+ * @param width Width of the field in bits, 1 to 64. offset + width has to be
+ * <= get_bit_capacity().
+ * @param value Its low width bits are written, the others are ignored.
+ */
+#ifndef CONFIG_BITSTRING_INLINE
+void bstr_set_field(bstr_bitstr_t *const bstr, unsigned int offset,
+                    unsigned int width, uint64_t value)
+    __attribute__((nonnull(1)));
+#endif
+
+/**
+ * @brief Copy nwords unsigned ints into the bitstring, starting at word
+ * first. Unlike a memcpy to the words this keeps the popcount cache and the
+ * dirty tracking up to date.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param first Index of the first unsigned int to overwrite.
+ * @param words The new contents.
+ * @param nwords How many unsigned ints. first + nwords has to be <=
+ * get_capacity().
+ */
+void bstr_set_words(bstr_bitstr_t *const bstr, unsigned int first,
+                    const unsigned int *words, unsigned int nwords)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Private. Modules that write the words of a caller's bitstring through
+ * the kernels call it afterwards, so the popcount cache and the dirty chunks
+ * see the nwords unsigned ints from first.
+ *
+ */
+void _bstr_written_words(bstr_bitstr_t *const bstr, unsigned int first,
+                         unsigned int nwords) __attribute__((nonnull(1)));
 
 /**
  * @brief Find the first set bit.
@@ -252,6 +446,189 @@ int bstr_clz(const bstr_bitstr_t *const bstr) __attribute__((nonnull(1)));
  */
 int bstr_popcnt(const bstr_bitstr_t *const bstr) __attribute__((nonnull(1)));
 
+/**
+ * @brief Count how many of n bits starting at bit start are set.
+ * bstr_popcnt_range(bstr, 0, i) is the rank of bit i.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param start Index of the first bit.
+ * @param n Number of bits. start + n has to be <= get_bit_capacity().
+ * @return int How many of the bits are set.
+ */
+int bstr_popcnt_range(const bstr_bitstr_t *const bstr, unsigned int start,
+                      unsigned int n) __attribute__((nonnull(1)));
+
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+/**
+ * @brief Keep the number of set bits per block of
+ * BSTR_POPCNT_CACHE_BLOCK_WORDS unsigned ints and in total. bstr_set(),
+ * bstr_clr() and bstr_set_field() then update the counts of bits that flip,
+ * bstr_popcnt() is O(1) and bstr_popcnt_range() O(blocks). Range operations
+ * recount the blocks they touch, operations on the whole bitstring mark the
+ * cache stale and the next count rebuilds it.
+ *
+ * Writes to the words that bypass the library, e.g. through bstr_wrap() of
+ * the same words, are not seen. Call bstr_popcnt_cache_enable() again after
+ * them.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @return bstr_err_t BSTR_MALLOC_FAILED when there was no memory for the
+ * cache, the bitstring is unchanged then.
+ */
+bstr_err_t bstr_popcnt_cache_enable(bstr_bitstr_t *const bstr)
+    __attribute__((nonnull(1), warn_unused_result));
+
+/**
+ * @brief Drop the popcount cache. Does nothing when it is not enabled.
+ *
+ * @param bstr Pointer to bitstring object.
+ */
+void bstr_popcnt_cache_disable(bstr_bitstr_t *const bstr)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief bstr_set() and bstr_clr() with the popcount cache enabled. Private.
+ *
+ */
+void _bstr_popcnt_cache_put(bstr_bitstr_t *const bstr, unsigned int bit,
+                            bool on) __attribute__((nonnull(1)));
+
+/**
+ * @brief bstr_set_field() with the popcount cache enabled. Private.
+ *
+ */
+void _bstr_popcnt_cache_put_field(bstr_bitstr_t *const bstr,
+                                  unsigned int offset, unsigned int width,
+                                  uint64_t value) __attribute__((nonnull(1)));
+#endif
+
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+/**
+ * @brief Remember which chunks of BSTR_DIRTY_CHUNK_WORDS unsigned ints are
+ * written from now on, e.g. to checkpoint only those, see
+ * bitstring_checkpoint.h. All writing functions of bitstring.h mark the
+ * chunks they touch. All chunks start out dirty.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @return bstr_err_t BSTR_MALLOC_FAILED when there was no memory for the
+ * summary, the bitstring is unchanged then.
+ */
+bstr_err_t bstr_dirty_enable(bstr_bitstr_t *const bstr)
+    __attribute__((nonnull(1), warn_unused_result));
+
+/**
+ * @brief Stop the dirty tracking. Does nothing when it is not enabled.
+ *
+ * @param bstr Pointer to bitstring object.
+ */
+void bstr_dirty_disable(bstr_bitstr_t *const bstr) __attribute__((nonnull(1)));
+
+/**
+ * @brief Whether the dirty tracking is enabled.
+ *
+ * @param bstr Pointer to bitstring object.
+ */
+bool bstr_dirty_enabled(const bstr_bitstr_t *const bstr)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Number of chunks, the last one may be shorter.
+ *
+ * @param bstr Pointer to bitstring object.
+ */
+unsigned int bstr_dirty_chunks(const bstr_bitstr_t *const bstr)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Find the next dirty chunk. Iterate with
+ * for (int c = bstr_dirty_next(bstr, 0); c >= 0;
+ *      c = bstr_dirty_next(bstr, c + 1))
+ *
+ * @param bstr Pointer to bitstring object with dirty tracking enabled.
+ * @param chunk Index of the first chunk to look at.
+ * @return int Index of the first dirty chunk >= chunk or -1.
+ */
+int bstr_dirty_next(const bstr_bitstr_t *const bstr, unsigned int chunk)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Mark one chunk clean, e.g. after it was written out.
+ *
+ * @param bstr Pointer to bitstring object with dirty tracking enabled.
+ * @param chunk Index of the chunk.
+ */
+void bstr_dirty_clr(bstr_bitstr_t *const bstr, unsigned int chunk)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Mark all chunks clean.
+ *
+ * @param bstr Pointer to bitstring object with dirty tracking enabled.
+ */
+void bstr_dirty_clr_all(bstr_bitstr_t *const bstr) __attribute__((nonnull(1)));
+#endif
+
+/**
+ * @brief Count for every bit position in how many of n bitstrings it is set.
+ * All bitstrings need the same capacity.
+ *
+ * @param bstrs The bitstrings.
+ * @param n How many bitstrings there are, > 0.
+ * @param counts Receives get_bit_capacity() counts, counts[i] for bit i.
+ */
+void bstr_positional_popcnt(const bstr_bitstr_t *const *bstrs, unsigned int n,
+                            uint32_t *counts) __attribute__((nonnull(1, 3)));
+
+/**
+ * @brief Like bstr_positional_popcnt(), but adds to counts. Feeding the
+ * bitstrings in batches as they arrive gives the same counts as one call.
+ *
+ * @param bstrs The bitstrings.
+ * @param n How many bitstrings there are, may be 0.
+ * @param counts get_bit_capacity() counts, counts[i] for bit i.
+ */
+void bstr_positional_popcnt_add(const bstr_bitstr_t *const *bstrs,
+                                unsigned int n, uint32_t *counts)
+    __attribute__((nonnull(3)));
+
+/**
+ * @brief dst = union of n bitstrings. The inputs are read tile by tile, a
+ * tile stops reading inputs as soon as all its bits are set.
+ *
+ * @param dst Pointer to bitstring object, may be one of srcs.
+ * @param srcs The bitstrings, all with the capacity of dst.
+ * @param n How many bitstrings there are. 0 clears dst.
+ */
+void bstr_union_many(bstr_bitstr_t *const dst,
+                     const bstr_bitstr_t *const *srcs, unsigned int n)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief dst = intersection of n bitstrings. The inputs are read tile by tile,
+ * a tile stops reading inputs as soon as all its bits are clear.
+ *
+ * @param dst Pointer to bitstring object, may be one of srcs.
+ * @param srcs The bitstrings, all with the capacity of dst.
+ * @param n How many bitstrings there are. 0 sets all bits of dst.
+ */
+void bstr_intersect_many(bstr_bitstr_t *const dst,
+                         const bstr_bitstr_t *const *srcs, unsigned int n)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief dst = the bits that are set in at least k of n bitstrings. Every
+ * input is read once, tile by tile, and added to bit sliced counters.
+ *
+ * @param dst Pointer to bitstring object, may be one of srcs.
+ * @param srcs The bitstrings, all with the capacity of dst.
+ * @param n How many bitstrings there are.
+ * @param k The threshold. 1 is the union, n the intersection, 0 sets all bits
+ * and more than n clears them.
+ */
+void bstr_threshold_many(bstr_bitstr_t *const dst,
+                         const bstr_bitstr_t *const *srcs, unsigned int n,
+                         unsigned int k) __attribute__((nonnull(1)));
+
 /**
  * @brief Get the index of the next set bit based upon the offset.
  *
@@ -270,6 +647,306 @@ int bstr_next_set_bit(const bstr_bitstr_t *const bstr, unsigned int offset)
 int bstr_next_unset_bit(const bstr_bitstr_t *const bstr, unsigned int offset)
     __attribute((nonnull(1)));
 
+/**
+ * @brief Set n bits starting at start.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param start Index of the first bit.
+ * @param n How many bits. start + n has to be <= get_bit_capacity().
+ */
+void bstr_set_range(bstr_bitstr_t *const bstr, unsigned int start,
+                    unsigned int n) __attribute__((nonnull(1)));
+
+/**
+ * @brief Clear n bits starting at start.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param start Index of the first bit.
+ * @param n How many bits. start + n has to be <= get_bit_capacity().
+ */
+void bstr_clr_range(bstr_bitstr_t *const bstr, unsigned int start,
+                    unsigned int n) __attribute__((nonnull(1)));
+
+/**
+ * @brief Find the first run of at least n unset bits. The search begins at
+ * hint and wraps around to 0, so the run found first is the one at or after
+ * hint when there is one.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param n Length of the run, > 0.
+ * @param align The run starts at a multiple of align, which has to be a power
+ * of two. 0 and 1 mean no alignment.
+ * @param hint Where to begin the search.
+ * @return int Index of the first bit of the run or -1.
+ */
+int bstr_find_zero_run(const bstr_bitstr_t *const bstr, unsigned int n,
+                       unsigned int align, unsigned int hint)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Find the first run of at least n set bits. Works like
+ * bstr_find_zero_run().
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param n Length of the run, > 0.
+ * @param align Power of two the run starts at a multiple of, 0 and 1 mean no
+ * alignment.
+ * @param hint Where to begin the search.
+ * @return int Index of the first bit of the run or -1.
+ */
+int bstr_find_one_run(const bstr_bitstr_t *const bstr, unsigned int n,
+                      unsigned int align, unsigned int hint)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Allocate n contiguous bits for a bitmap allocator: find a run of n
+ * unset bits like bstr_find_zero_run() and set them.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param n Length of the range, > 0.
+ * @param align Power of two the range starts at a multiple of, 0 and 1 mean no
+ * alignment.
+ * @param hint Where to begin the search, e.g. the end of the last allocation.
+ * @return int Index of the first bit of the range or -1 when there is no
+ * such run.
+ */
+int bstr_alloc_range(bstr_bitstr_t *const bstr, unsigned int n,
+                     unsigned int align, unsigned int hint)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Free a range returned by bstr_alloc_range().
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param start The value bstr_alloc_range() returned.
+ * @param n The length passed to bstr_alloc_range().
+ */
+void bstr_free_range(bstr_bitstr_t *const bstr, unsigned int start,
+                     unsigned int n) __attribute__((nonnull(1)));
+
+/**
+ * @brief Check whether no bit is set. Stops at the first set bit.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @return bool True when all bits are unset.
+ */
+bool bstr_is_empty(const bstr_bitstr_t *const bstr) __attribute__((nonnull(1)));
+
+/**
+ * @brief Check whether two bitstrings have the same capacity and the same
+ * bits. Stops at the first difference.
+ *
+ * @param a Pointer to bitstring object.
+ * @param b Pointer to bitstring object.
+ * @return bool True when a and b are equal.
+ */
+bool bstr_equals(const bstr_bitstr_t *const a, const bstr_bitstr_t *const b)
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief Check whether two bitstrings have at least one set bit in common.
+ * Stops at the first common bit.
+ *
+ * @param a Pointer to bitstring object.
+ * @param b Pointer to bitstring object.
+ * @return bool True when a & b is not empty.
+ */
+bool bstr_intersects(const bstr_bitstr_t *const a,
+                     const bstr_bitstr_t *const b)
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief Check whether every set bit of a is also set in b. Bits of a beyond
+ * the capacity of b have to be unset. Stops at the first bit missing in b.
+ *
+ * @param a Pointer to bitstring object.
+ * @param b Pointer to bitstring object.
+ * @return bool True when a is a subset of b.
+ */
+bool bstr_is_subset(const bstr_bitstr_t *const a,
+                    const bstr_bitstr_t *const b)
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief Lexicographic three way compare for sorting. The bits are compared
+ * starting at index 0, the first differing bit decides and the bitstring with
+ * that bit set is greater. When one bitstring is a prefix of the other, the
+ * shorter one is smaller. This is the order strcmp() gives for the output of
+ * bstr_to_string().
+ *
+ * @param a Pointer to bitstring object.
+ * @param b Pointer to bitstring object.
+ * @return int < 0, 0 or > 0 when a is smaller, equal or greater than b.
+ */
+int bstr_compare(const bstr_bitstr_t *const a, const bstr_bitstr_t *const b)
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief Encode the changes that turn from into to as a patch for
+ * bstr_apply(). Equal words are skipped with the dispatched compare, so the
+ * patch and the time to build it grow with the number of changed words.
+ *
+ * The patch is an array of unsigned ints: the capacity of from, the capacity
+ * of to and then runs of changed words. A run is its first word index, its
+ * length and from ^ to for each of its words, words past the capacity of from
+ * count as 0. Runs merge across up to BSTR_PATCH_MERGE_WORDS equal words.
+ *
+ * @param from Pointer to bitstring object, the version the receiver has.
+ * @param to Pointer to bitstring object, the version to send.
+ * @param nwords Receives the number of unsigned ints in the patch.
+ * @return unsigned int* The patch, release it with free(). NULL when there is
+ * no memory left.
+ */
+unsigned int *bstr_diff(const bstr_bitstr_t *const from,
+                        const bstr_bitstr_t *const to, unsigned int *nwords)
+    __attribute__((nonnull(1, 2, 3), warn_unused_result));
+
+/**
+ * @brief Apply a patch of bstr_diff(), turning from into to. The patch is
+ * checked as a whole before anything is written.
+ *
+ * @param bstr Pointer to bitstring object, equal to from of bstr_diff().
+ * @param patch The patch.
+ * @param nwords Number of unsigned ints in the patch.
+ * @return bstr_err_t BSTR_BAD_FORMAT when the patch is broken or made for a
+ * different capacity, BSTR_MALLOC_FAILED when resizing failed.
+ */
+bstr_err_t bstr_apply(bstr_bitstr_t *const bstr, const unsigned int *patch,
+                      unsigned int nwords)
+    __attribute__((nonnull(1, 2), warn_unused_result));
+
+/**
+ * @brief 64 bit hash of the bits and the capacity. The value is stable across
+ * runs and CPUs and equals bstrs_hash() of a static bitstring with the same
+ * capacity and bits. Not suited against adversarial input.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @return uint64_t The hash.
+ */
+uint64_t bstr_hash(const bstr_bitstr_t *const bstr) __attribute__((nonnull(1)));
+
+/**
+ * @brief 128 bit version of bstr_hash(). hash[0] is equal to bstr_hash().
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param hash Receives the hash.
+ */
+void bstr_hash128(const bstr_bitstr_t *const bstr, uint64_t hash[2])
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief Find the first occurrence of a bit pattern at or after offset. The
+ * pattern may start at any bit, e.g. to find a sync word in a captured stream.
+ *
+ * @param bstr Pointer to bitstring object to search in.
+ * @param pattern Pointer to bitstring object holding the pattern in its first
+ * pattern_bits bits.
+ * @param pattern_bits Length of the pattern, 1 up to
+ * bstr_get_bit_capacity(pattern).
+ * @param offset Where to begin the search.
+ * @return int Bit index of the first bit of the occurrence or -1.
+ */
+int bstr_find_pattern(const bstr_bitstr_t *const bstr,
+                      const bstr_bitstr_t *const pattern,
+                      unsigned int pattern_bits, unsigned int offset)
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief Find all occurrences of a bit pattern, overlapping ones included.
+ *
+ * @param bstr Pointer to bitstring object to search in.
+ * @param pattern Pointer to bitstring object holding the pattern in its first
+ * pattern_bits bits.
+ * @param pattern_bits Length of the pattern, 1 up to
+ * bstr_get_bit_capacity(pattern).
+ * @param matches Receives the bit indexes in ascending order. May be NULL when
+ * max_matches is 0.
+ * @param max_matches Size of matches.
+ * @return unsigned int Number of occurrences. Only the first max_matches of
+ * them are written when there are more.
+ */
+unsigned int bstr_find_all_pattern(const bstr_bitstr_t *const bstr,
+                                   const bstr_bitstr_t *const pattern,
+                                   unsigned int pattern_bits,
+                                   unsigned int *matches,
+                                   unsigned int max_matches)
+    __attribute__((nonnull(1, 2)));
+
+#ifdef CONFIG_BITSTRING_INLINE
+/*
+ * With CONFIG_BITSTRING_INLINE the single bit and field accessors and the
+ * capacity getters are defined here instead of in bitstring.c. Every call
+ * compiles to a few shift and mask instructions in the caller.
+ */
+
+static inline __attribute__((nonnull(1))) unsigned int
+bstr_get_capacity(const bstr_bitstr_t *const bstr) {
+  return bstr->_capacity;
+}
+
+static inline __attribute__((nonnull(1))) unsigned int
+bstr_get_bit_capacity(const bstr_bitstr_t *const bstr) {
+  return bstr->_capacity << BSTR_BITS_PER_INT_SHIFT;
+}
+
+static inline __attribute__((nonnull(1))) void
+bstr_set(bstr_bitstr_t *const bstr, unsigned int bit) {
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    _bstr_dirty_mark(bstr, bit, 1U);
+#endif
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL) {
+    _bstr_popcnt_cache_put(bstr, bit, true);
+    return;
+  }
+#endif
+  bstr_kernel_set(_bstr_view(bstr), bit);
+}
+
+static inline __attribute__((nonnull(1))) void
+bstr_clr(bstr_bitstr_t *const bstr, unsigned int bit) {
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    _bstr_dirty_mark(bstr, bit, 1U);
+#endif
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL) {
+    _bstr_popcnt_cache_put(bstr, bit, false);
+    return;
+  }
+#endif
+  bstr_kernel_clr(_bstr_view(bstr), bit);
+}
+
+static inline __attribute__((nonnull(1))) bool
+bstr_get(const bstr_bitstr_t *const bstr, unsigned int bit) {
+  return bstr_kernel_get(_bstr_view(bstr), bit);
+}
+
+static inline __attribute__((nonnull(1))) uint64_t
+bstr_get_field(const bstr_bitstr_t *const bstr, unsigned int offset,
+               unsigned int width) {
+  return bstr_kernel_get_field(_bstr_view(bstr), offset, width);
+}
+
+static inline __attribute__((nonnull(1))) void
+bstr_set_field(bstr_bitstr_t *const bstr, unsigned int offset,
+               unsigned int width, uint64_t value) {
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    _bstr_dirty_mark(bstr, offset, width);
+#endif
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL) {
+    _bstr_popcnt_cache_put_field(bstr, offset, width, value);
+    return;
+  }
+#endif
+  bstr_kernel_set_field(_bstr_view(bstr), offset, width, value);
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,810 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef BSTR_BITSTRING_HPP
+#define BSTR_BITSTRING_HPP
+
+#if __cplusplus < 201703L
+#error "bitstring.hpp needs C++17 or newer"
+#endif
+
+#include "bitstring.h"
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bstr {
+
+/**
+ * @brief How many bits are stored in one unsigned int.
+ *
+ */
+inline constexpr unsigned int bits_per_int = BSTR_BITS_PER_INT;
+
+/**
+ * @brief Up to this many unsigned ints the fixed size kernels of
+ * static_bitstring are unrolled completely. Bigger sizes use a loop with a
+ * compile time trip count and leave unrolling to the compiler.
+ *
+ */
+#ifndef BSTR_CXX_UNROLL_LIMIT
+#define BSTR_CXX_UNROLL_LIMIT 16
+#endif
+
+namespace detail {
+
+constexpr int popcount(unsigned int word) { return __builtin_popcount(word); }
+
+constexpr int ctz(unsigned int word) { return __builtin_ctz(word); }
+
+constexpr int clz(unsigned int word) { return __builtin_clz(word); }
+
+template <std::size_t... I>
+constexpr int popcount_unrolled(const unsigned int *words,
+                                std::index_sequence<I...>) {
+  return (0 + ... + popcount(words[I]));
+}
+
+template <std::size_t... I>
+constexpr void fill_unrolled(unsigned int *words, unsigned int value,
+                             std::index_sequence<I...>) {
+  ((words[I] = value), ...);
+}
+
+template <unsigned int N> constexpr int popcount_words(const unsigned int *w) {
+  if constexpr (N <= BSTR_CXX_UNROLL_LIMIT) {
+    return popcount_unrolled(w, std::make_index_sequence<N>{});
+  } else {
+    int result = 0;
+    for (unsigned int i = 0; i < N; i++)
+      result += popcount(w[i]);
+    return result;
+  }
+}
+
+template <unsigned int N>
+constexpr void fill_words(unsigned int *w, unsigned int value) {
+  if constexpr (N <= BSTR_CXX_UNROLL_LIMIT) {
+    fill_unrolled(w, value, std::make_index_sequence<N>{});
+  } else {
+    for (unsigned int i = 0; i < N; i++)
+      w[i] = value;
+  }
+}
+
+/**
+ * @brief Index of the first bit at or after offset which is set in
+ * (words[i] ^ invert), -1 when there is none.
+ */
+constexpr int next_bit(const unsigned int *words, unsigned int nwords,
+                       unsigned int offset, unsigned int invert) {
+  unsigned int i = offset >> BSTR_BITS_PER_INT_SHIFT;
+  if (i >= nwords)
+    return -1;
+  unsigned int word = (words[i] ^ invert) &
+                      (~0U << (offset & BSTR_BITS_PER_INT_MASK));
+  for (;;) {
+    if (word != 0)
+      return (int)((i << BSTR_BITS_PER_INT_SHIFT) + ctz(word));
+    if (++i == nwords)
+      return -1;
+    word = words[i] ^ invert;
+  }
+}
+
+constexpr int clz_words(const unsigned int *words, unsigned int nwords) {
+  int result = 0;
+  for (unsigned int i = nwords; i > 0; i--) {
+    if (words[i - 1] != 0)
+      return result + clz(words[i - 1]);
+    result += bits_per_int;
+  }
+  return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief Forward iterator over the indexes of all set bits. Produced by
+ * begin()/end() of static_bitstring and bitstring, so
+ *     for (unsigned int bit : bits) { ... }
+ * visits every set bit in ascending order.
+ *
+ */
+class set_bit_iterator {
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = unsigned int;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const unsigned int *;
+  using reference = unsigned int;
+
+  constexpr set_bit_iterator() = default;
+  constexpr set_bit_iterator(const unsigned int *words, unsigned int nwords)
+      : _words(words), _nwords(nwords) {
+    while (_index < _nwords && _words[_index] == 0)
+      _index++;
+    if (_index < _nwords)
+      _word = _words[_index];
+  }
+
+  constexpr unsigned int operator*() const {
+    return (_index << BSTR_BITS_PER_INT_SHIFT) + detail::ctz(_word);
+  }
+
+  constexpr set_bit_iterator &operator++() {
+    _word &= _word - 1;
+    while (_word == 0 && ++_index < _nwords)
+      _word = _words[_index];
+    return *this;
+  }
+
+  constexpr set_bit_iterator operator++(int) {
+    set_bit_iterator old = *this;
+    ++*this;
+    return old;
+  }
+
+  /* Exhausted iterators compare equal, independent of their position. */
+  constexpr bool operator==(const set_bit_iterator &other) const {
+    return at_end() == other.at_end() &&
+           (at_end() || (_index == other._index && _word == other._word));
+  }
+
+  constexpr bool operator!=(const set_bit_iterator &other) const {
+    return !(*this == other);
+  }
+
+private:
+  constexpr bool at_end() const { return _index >= _nwords; }
+
+  const unsigned int *_words = nullptr;
+  unsigned int _nwords = 0;
+  unsigned int _index = 0;
+  unsigned int _word = 0;
+};
+
+/**
+ * @brief Fixed size bitstring with the same layout as bstr_static_t(N). All
+ * members are header only and constexpr, so the compiler can specialize every
+ * operation on N. Unlike BSTR_STATIC_DECLARE_ALL() this can be used from any
+ * number of translation units.
+ *
+ * @tparam N How many unsigned ints this bitstring contains.
+ */
+template <unsigned int N> class static_bitstring {
+  static_assert(N > 0, "static_bitstring needs at least one unsigned int");
+
+public:
+  /**
+   * @brief Storage. Public so the type stays an aggregate with the layout of
+   * bstr_static_t(N). Treat it as private like bstr_bitstr_t::_bits.
+   *
+   */
+  unsigned int _bits[N];
+
+  /**
+   * @brief Returns the number of unsigned ints that are stored.
+   */
+  static constexpr unsigned int capacity() { return N; }
+
+  /**
+   * @brief Returns the number of bits that are stored.
+   */
+  static constexpr unsigned int bit_capacity() { return N * bits_per_int; }
+
+  /**
+   * @brief Set a bit. Bits are zero indexed.
+   */
+  constexpr void set(unsigned int bit) {
+    check(bit);
+    _bits[bit >> BSTR_BITS_PER_INT_SHIFT] |= 1U
+                                            << (bit & BSTR_BITS_PER_INT_MASK);
+  }
+
+  /**
+   * @brief Set all bits to the value of on.
+   */
+  constexpr void set_all(bool on) {
+    detail::fill_words<N>(_bits, on ? ~0U : 0U);
+  }
+
+  /**
+   * @brief Clear a bit. Bits are zero indexed.
+   */
+  constexpr void clr(unsigned int bit) {
+    check(bit);
+    _bits[bit >> BSTR_BITS_PER_INT_SHIFT] &=
+        ~(1U << (bit & BSTR_BITS_PER_INT_MASK));
+  }
+
+  /**
+   * @brief Check if a bit is set. Bits are zero indexed.
+   */
+  constexpr bool get(unsigned int bit) const {
+    check(bit);
+    return (_bits[bit >> BSTR_BITS_PER_INT_SHIFT] >>
+            (bit & BSTR_BITS_PER_INT_MASK)) &
+           1U;
+  }
+
+  /**
+   * @brief Index of the first set bit or -1 when there was none.
+   */
+  constexpr int ffs() const { return detail::next_bit(_bits, N, 0, 0U); }
+
+  /**
+   * @brief Index of the first unset bit or -1 when there was none.
+   */
+  constexpr int ffus() const { return detail::next_bit(_bits, N, 0, ~0U); }
+
+  /**
+   * @brief Count trailing zeros. Starts at the least significant bit position.
+   */
+  constexpr int ctz() const {
+    int result = ffs();
+    return result < 0 ? (int)bit_capacity() : result;
+  }
+
+  /**
+   * @brief Count leading zeros. Starts at the most significant bit position.
+   */
+  constexpr int clz() const { return detail::clz_words(_bits, N); }
+
+  /**
+   * @brief Count how many bits are set.
+   */
+  constexpr int popcnt() const { return detail::popcount_words<N>(_bits); }
+
+  /**
+   * @brief Index of the next set bit at or after offset, -1 when there is none.
+   */
+  constexpr int next_set_bit(unsigned int offset) const {
+    return detail::next_bit(_bits, N, offset, 0U);
+  }
+
+  /**
+   * @brief Index of the next unset bit at or after offset, -1 when there is
+   * none.
+   */
+  constexpr int next_unset_bit(unsigned int offset) const {
+    return detail::next_bit(_bits, N, offset, ~0U);
+  }
+
+  constexpr set_bit_iterator begin() const { return {_bits, N}; }
+  constexpr set_bit_iterator end() const { return {}; }
+
+  constexpr static_bitstring &operator&=(const static_bitstring &other) {
+    for (unsigned int i = 0; i < N; i++)
+      _bits[i] &= other._bits[i];
+    return *this;
+  }
+
+  constexpr static_bitstring &operator|=(const static_bitstring &other) {
+    for (unsigned int i = 0; i < N; i++)
+      _bits[i] |= other._bits[i];
+    return *this;
+  }
+
+  constexpr static_bitstring &operator^=(const static_bitstring &other) {
+    for (unsigned int i = 0; i < N; i++)
+      _bits[i] ^= other._bits[i];
+    return *this;
+  }
+
+  constexpr static_bitstring operator~() const {
+    static_bitstring result{};
+    for (unsigned int i = 0; i < N; i++)
+      result._bits[i] = ~_bits[i];
+    return result;
+  }
+
+  friend constexpr bool operator==(const static_bitstring &a,
+                                   const static_bitstring &b) {
+    for (unsigned int i = 0; i < N; i++) {
+      if (a._bits[i] != b._bits[i])
+        return false;
+    }
+    return true;
+  }
+
+  friend constexpr bool operator!=(const static_bitstring &a,
+                                   const static_bitstring &b) {
+    return !(a == b);
+  }
+
+  /**
+   * @brief A non owning bstr_bitstr_t over this storage. Pass its address to
+   * any function of bitstring.h, except bstr_resize() and
+   * bstr_delete_bitstr(). It must not outlive this object.
+   */
+  bstr_bitstr_t c_bitstr() { return bstr_wrap(_bits, N); }
+
+  /**
+   * @brief Same as c_bitstr(), only for functions taking a const
+   * bstr_bitstr_t *.
+   */
+  const bstr_bitstr_t c_bitstr() const {
+    return bstr_wrap(const_cast<unsigned int *>(_bits), N);
+  }
+
+  /**
+   * @brief Reinterpret a C static bitstring declared with
+   * BSTR_STATIC_DECLARE_SIZED_BITSTRING_STRUCT(N) as static_bitstring<N>.
+   */
+  template <class CStatic> static static_bitstring &from_c(CStatic &c) {
+    static_assert(sizeof(CStatic) == sizeof(static_bitstring),
+                  "size of the C static bitstring does not match N");
+    return *reinterpret_cast<static_bitstring *>(&c);
+  }
+
+  template <class CStatic>
+  static const static_bitstring &from_c(const CStatic &c) {
+    static_assert(sizeof(CStatic) == sizeof(static_bitstring),
+                  "size of the C static bitstring does not match N");
+    return *reinterpret_cast<const static_bitstring *>(&c);
+  }
+
+private:
+  constexpr void check([[maybe_unused]] unsigned int bit) const {
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+    assert(bit < bit_capacity());
+#endif
+  }
+};
+
+template <unsigned int N>
+constexpr static_bitstring<N> operator&(static_bitstring<N> a,
+                                        const static_bitstring<N> &b) {
+  return a &= b;
+}
+
+template <unsigned int N>
+constexpr static_bitstring<N> operator|(static_bitstring<N> a,
+                                        const static_bitstring<N> &b) {
+  return a |= b;
+}
+
+template <unsigned int N>
+constexpr static_bitstring<N> operator^(static_bitstring<N> a,
+                                        const static_bitstring<N> &b) {
+  return a ^= b;
+}
+
+/**
+ * @brief Lazy bitwise expressions over bitstrings.
+ *
+ * a & b, a | b, a ^ b and ~a on bstr::bitstring do not compute anything. They
+ * build a small expression tree which is evaluated word by word in a single
+ * pass when it is assigned to a bitstring or handed to one of the sinks
+ * bstr::popcount(), bstr::any() and bstr::for_each_set(). No temporary
+ * bitstring is materialized, so (a & b) | (c & ~d) reads every operand exactly
+ * once.
+ *
+ * Expressions store pointers to their operands. All operands need the same
+ * capacity and have to outlive the expression.
+ */
+namespace expr {
+
+/**
+ * @brief Number of unsigned ints evaluated into a stack buffer at once by the
+ * reducing sinks. 256 words are 1 KiB and stay in L1.
+ *
+ */
+inline constexpr unsigned int block_words = 256;
+
+/**
+ * @brief Leaf of an expression: the words of a bitstring.
+ */
+class ref {
+public:
+  constexpr ref(const unsigned int *words, unsigned int nwords)
+      : _words(words), _nwords(nwords) {}
+
+  constexpr unsigned int nwords() const { return _nwords; }
+  constexpr unsigned int word(unsigned int i) const { return _words[i]; }
+
+private:
+  const unsigned int *_words;
+  unsigned int _nwords;
+};
+
+struct and_op {
+  static constexpr unsigned int apply(unsigned int a, unsigned int b) {
+    return a & b;
+  }
+};
+
+struct or_op {
+  static constexpr unsigned int apply(unsigned int a, unsigned int b) {
+    return a | b;
+  }
+};
+
+struct xor_op {
+  static constexpr unsigned int apply(unsigned int a, unsigned int b) {
+    return a ^ b;
+  }
+};
+
+template <class Op, class L, class R> class binary {
+public:
+  constexpr binary(const L &l, const R &r) : _l(l), _r(r) {
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+    assert(l.nwords() == r.nwords());
+#endif
+  }
+
+  constexpr unsigned int nwords() const { return _l.nwords(); }
+  constexpr unsigned int word(unsigned int i) const {
+    return Op::apply(_l.word(i), _r.word(i));
+  }
+
+private:
+  L _l;
+  R _r;
+};
+
+template <class E> class inverted {
+public:
+  constexpr explicit inverted(const E &e) : _e(e) {}
+
+  constexpr unsigned int nwords() const { return _e.nwords(); }
+  constexpr unsigned int word(unsigned int i) const { return ~_e.word(i); }
+
+private:
+  E _e;
+};
+
+template <class T> struct is_expr : std::false_type {};
+template <> struct is_expr<ref> : std::true_type {};
+template <class Op, class L, class R>
+struct is_expr<binary<Op, L, R>> : std::true_type {};
+template <class E> struct is_expr<inverted<E>> : std::true_type {};
+
+template <class T>
+inline constexpr bool is_expr_v = is_expr<std::decay_t<T>>::value;
+
+/**
+ * @brief Evaluate e into dst, which has room for e.nwords() words. dst may be
+ * one of the operands of e.
+ */
+template <class E> void eval_into(unsigned int *dst, const E &e) {
+  const unsigned int n = e.nwords();
+  for (unsigned int i = 0; i < n; i++)
+    dst[i] = e.word(i);
+}
+
+/**
+ * @brief Evaluate e one block at a time and hand every block to f(words, n).
+ * Stops early as soon as f returns false.
+ */
+template <class E, class F> bool eval_blocks(const E &e, F &&f) {
+  unsigned int block[block_words];
+  const unsigned int n = e.nwords();
+  for (unsigned int base = 0; base < n; base += block_words) {
+    const unsigned int len = n - base < block_words ? n - base : block_words;
+    for (unsigned int i = 0; i < len; i++)
+      block[i] = e.word(base + i);
+    if (!f(block, len))
+      return false;
+  }
+  return true;
+}
+
+} // namespace expr
+
+/**
+ * @brief Owning RAII wrapper around a heap allocated bstr_bitstr_t. The single
+ * bit accessors are inline, scans call into bitstring.c. Allocation failures
+ * throw std::bad_alloc.
+ *
+ */
+class bitstring {
+public:
+  /**
+   * @brief Create a bitstring with capacity unsigned ints, all bits unset.
+   */
+  explicit bitstring(unsigned int capacity)
+      : _bstr(bstr_create_bitstr(capacity)) {
+    if (_bstr == nullptr)
+      throw std::bad_alloc();
+  }
+
+  /**
+   * @brief Take ownership of a bitstring created with bstr_create_bitstr().
+   */
+  static bitstring adopt(bstr_bitstr_t *bstr) { return bitstring(bstr); }
+
+  /**
+   * @brief Create a bitstring holding the result of a lazy expression.
+   */
+  template <class E, std::enable_if_t<expr::is_expr_v<E>, int> = 0>
+  bitstring(const E &e) : bitstring(e.nwords()) {
+    expr::eval_into(_bstr->_bits, e);
+    _bstr_written_words(_bstr, 0, e.nwords());
+  }
+
+  /**
+   * @brief Evaluate a lazy expression into this bitstring in a single pass.
+   * The bitstring is resized to the capacity of the expression.
+   */
+  template <class E, std::enable_if_t<expr::is_expr_v<E>, int> = 0>
+  bitstring &operator=(const E &e) {
+    if (capacity() != e.nwords())
+      resize(e.nwords());
+    expr::eval_into(_bstr->_bits, e);
+    _bstr_written_words(_bstr, 0, e.nwords());
+    return *this;
+  }
+
+  bitstring(const bitstring &other) : bitstring(other.capacity()) {
+    memcpy(_bstr->_bits, other._bstr->_bits,
+           other.capacity() * sizeof(unsigned int));
+  }
+
+  bitstring(bitstring &&other) noexcept : _bstr(other._bstr) {
+    other._bstr = nullptr;
+  }
+
+  bitstring &operator=(const bitstring &other) {
+    if (this != &other) {
+      bitstring copy(other);
+      std::swap(_bstr, copy._bstr);
+    }
+    return *this;
+  }
+
+  bitstring &operator=(bitstring &&other) noexcept {
+    std::swap(_bstr, other._bstr);
+    return *this;
+  }
+
+  ~bitstring() {
+    if (_bstr != nullptr)
+      bstr_delete_bitstr(_bstr);
+  }
+
+  /**
+   * @brief The wrapped C object. Ownership stays with this wrapper.
+   */
+  bstr_bitstr_t *native() { return _bstr; }
+  const bstr_bitstr_t *native() const { return _bstr; }
+
+  /**
+   * @brief Give up ownership. Free the result with bstr_delete_bitstr().
+   */
+  bstr_bitstr_t *release() {
+    bstr_bitstr_t *bstr = _bstr;
+    _bstr = nullptr;
+    return bstr;
+  }
+
+  void resize(unsigned int capacity) {
+    if (bstr_resize(_bstr, capacity) != BSTR_NO_ERROR)
+      throw std::bad_alloc();
+  }
+
+  unsigned int capacity() const { return _bstr->_capacity; }
+
+  unsigned int bit_capacity() const {
+    return _bstr->_capacity << BSTR_BITS_PER_INT_SHIFT;
+  }
+
+  /* With the popcount cache or dirty tracking the writes go through
+   * bitstring.h, which keeps both current. */
+  void set(unsigned int bit) {
+    check(bit);
+#if defined(CONFIG_BITSTRING_POPCNT_CACHE) ||                                  \
+    defined(CONFIG_BITSTRING_DIRTY_TRACKING)
+    bstr_set(_bstr, bit);
+#else
+    _bstr->_bits[bit >> BSTR_BITS_PER_INT_SHIFT] |=
+        1U << (bit & BSTR_BITS_PER_INT_MASK);
+#endif
+  }
+
+  void clr(unsigned int bit) {
+    check(bit);
+#if defined(CONFIG_BITSTRING_POPCNT_CACHE) ||                                  \
+    defined(CONFIG_BITSTRING_DIRTY_TRACKING)
+    bstr_clr(_bstr, bit);
+#else
+    _bstr->_bits[bit >> BSTR_BITS_PER_INT_SHIFT] &=
+        ~(1U << (bit & BSTR_BITS_PER_INT_MASK));
+#endif
+  }
+
+  bool get(unsigned int bit) const {
+    check(bit);
+    return (_bstr->_bits[bit >> BSTR_BITS_PER_INT_SHIFT] >>
+            (bit & BSTR_BITS_PER_INT_MASK)) &
+           1U;
+  }
+
+  void set_all(bool on) { bstr_set_all(_bstr, on); }
+  int ffs() const { return bstr_ffs(_bstr); }
+  int ffus() const { return bstr_ffus(_bstr); }
+  int ctz() const { return bstr_ctz(_bstr); }
+  int clz() const { return bstr_clz(_bstr); }
+  int popcnt() const { return bstr_popcnt(_bstr); }
+
+  int next_set_bit(unsigned int offset) const {
+    return bstr_next_set_bit(_bstr, offset);
+  }
+
+  int next_unset_bit(unsigned int offset) const {
+    return bstr_next_unset_bit(_bstr, offset);
+  }
+
+  set_bit_iterator begin() const { return {_bstr->_bits, _bstr->_capacity}; }
+  set_bit_iterator end() const { return {}; }
+
+private:
+  explicit bitstring(bstr_bitstr_t *bstr) : _bstr(bstr) {}
+
+  void check([[maybe_unused]] unsigned int bit) const {
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+    assert(bit < bit_capacity());
+#endif
+  }
+
+  bstr_bitstr_t *_bstr;
+};
+
+namespace expr {
+
+inline ref as_expr(const bitstring &b) {
+  return ref(b.native()->_bits, b.capacity());
+}
+
+/* Temporaries would be gone before the expression is evaluated. */
+ref as_expr(const bitstring &&b) = delete;
+
+template <class E, std::enable_if_t<is_expr_v<E>, int> = 0>
+constexpr const E &as_expr(const E &e) {
+  return e;
+}
+
+template <class T>
+using expr_t = std::decay_t<decltype(as_expr(std::declval<T>()))>;
+
+template <class T>
+inline constexpr bool is_operand_v =
+    is_expr_v<T> || std::is_same_v<std::decay_t<T>, bitstring>;
+
+} // namespace expr
+
+/**
+ * @brief Expression leaf for a C bitstring. It has to outlive the expression.
+ */
+inline expr::ref ref(const bstr_bitstr_t *bstr) {
+  return expr::ref(bstr->_bits, bstr->_capacity);
+}
+
+namespace expr {
+
+/*
+ * The operators live in bstr::expr so argument dependent lookup finds them for
+ * expression operands. The using declarations below make them visible for
+ * bstr::bitstring operands as well.
+ */
+
+template <class A, class B,
+          std::enable_if_t<is_operand_v<A> && is_operand_v<B>, int> = 0>
+binary<and_op, expr_t<A>, expr_t<B>> operator&(A &&a, B &&b) {
+  return {as_expr(std::forward<A>(a)), as_expr(std::forward<B>(b))};
+}
+
+template <class A, class B,
+          std::enable_if_t<is_operand_v<A> && is_operand_v<B>, int> = 0>
+binary<or_op, expr_t<A>, expr_t<B>> operator|(A &&a, B &&b) {
+  return {as_expr(std::forward<A>(a)), as_expr(std::forward<B>(b))};
+}
+
+template <class A, class B,
+          std::enable_if_t<is_operand_v<A> && is_operand_v<B>, int> = 0>
+binary<xor_op, expr_t<A>, expr_t<B>> operator^(A &&a, B &&b) {
+  return {as_expr(std::forward<A>(a)), as_expr(std::forward<B>(b))};
+}
+
+template <class A, std::enable_if_t<is_operand_v<A>, int> = 0>
+inverted<expr_t<A>> operator~(A &&a) {
+  return inverted<expr_t<A>>(as_expr(std::forward<A>(a)));
+}
+
+} // namespace expr
+
+using expr::operator&;
+using expr::operator|;
+using expr::operator^;
+using expr::operator~;
+
+/**
+ * @brief Evaluate an expression into a C bitstring in a single pass. dst needs
+ * the same capacity as the expression and may be one of its operands.
+ */
+template <class A, std::enable_if_t<expr::is_operand_v<A>, int> = 0>
+void assign(bstr_bitstr_t *dst, const A &a) {
+  const auto &e = expr::as_expr(a);
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+  assert(dst->_capacity == e.nwords());
+#endif
+  expr::eval_into(dst->_bits, e);
+  _bstr_written_words(dst, 0, e.nwords());
+}
+
+/**
+ * @brief Number of set bits in the result of an expression, without
+ * materializing it. Each block is counted by the runtime dispatched kernel.
+ */
+template <class A, std::enable_if_t<expr::is_operand_v<A>, int> = 0>
+int popcount(const A &a) {
+  int result = 0;
+  expr::eval_blocks(expr::as_expr(a), [&](const unsigned int *w,
+                                          unsigned int n) {
+    result += static_cast<int>(bstr_dispatch_popcnt(w, n));
+    return true;
+  });
+  return result;
+}
+
+/**
+ * @brief Whether any bit of the result of an expression is set. Stops after
+ * the first block containing a set bit.
+ */
+template <class A, std::enable_if_t<expr::is_operand_v<A>, int> = 0>
+bool any(const A &a) {
+  return !expr::eval_blocks(expr::as_expr(a), [](const unsigned int *w,
+                                                 unsigned int n) {
+    unsigned int acc = 0;
+    for (unsigned int i = 0; i < n; i++)
+      acc |= w[i];
+    return acc == 0;
+  });
+}
+
+/**
+ * @brief Call f(bit) for every set bit of the result of an expression in
+ * ascending order.
+ */
+template <class A, class F, std::enable_if_t<expr::is_operand_v<A>, int> = 0>
+void for_each_set(const A &a, F &&f) {
+  const auto &e = expr::as_expr(a);
+  const unsigned int n = e.nwords();
+  for (unsigned int i = 0; i < n; i++) {
+    unsigned int w = e.word(i);
+    while (w != 0) {
+      f((i << BSTR_BITS_PER_INT_SHIFT) + detail::ctz(w));
+      w &= w - 1;
+    }
+  }
+}
+
+} // namespace bstr
+
+#endif
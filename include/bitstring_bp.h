@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Block codec for arrays of uint32_t, e.g. posting lists or column chunks.
+ * Values are cut into blocks of BSTR_BP_BLOCK. Every block is stored with the
+ * smallest width b that makes it short, with values that need more than b
+ * bits stored as patched exceptions (PFor). Blocks start on an unsigned int,
+ * so they can be decoded with the dispatched unpack kernel of
+ * include/bitstring_dispatch.h.
+ *
+ * A block is laid out as
+ *
+ *   header    32 bits: b, exception count, block length - 1 and the flags
+ *   base      32 bits, only with BSTR_BP_FOR
+ *   payload   the low b bits of every value
+ *   positions 7 bits per exception, the index within the block
+ *   highs     32 - b bits per exception, the value >> b
+ *
+ * with the payload and the exceptions each padded to an unsigned int.
+ */
+
+#ifndef BSTR_BITSTRING_BP_H
+#define BSTR_BITSTRING_BP_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How many values a block holds. The last block of a call may hold
+ * fewer.
+ *
+ */
+#define BSTR_BP_BLOCK 128U
+
+/**
+ * @brief Store the difference to the previous value (wrapping) instead of
+ * the value. Shrinks sorted input such as document ids.
+ *
+ */
+#define BSTR_BP_DELTA 0x1U
+
+/**
+ * @brief Frame of reference: subtract the smallest value of every block
+ * before packing. Shrinks clustered input with a large offset.
+ *
+ */
+#define BSTR_BP_FOR 0x2U
+
+/**
+ * @brief How many unsigned ints the encoding of n values takes at most.
+ *
+ * @param n Number of values.
+ */
+unsigned int bstr_bp_max_words(unsigned int n);
+
+/**
+ * @brief Encodes n values into a bitstring. The written unsigned ints are
+ * marked dirty and recounted by the popcount cache like a range operation.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset Index of the unsigned int where the first block starts.
+ * bstr_get_capacity() - offset has to be >= bstr_bp_max_words(n).
+ * @param in The values.
+ * @param n How many values there are, may be 0.
+ * @param flags 0 or any of BSTR_BP_DELTA and BSTR_BP_FOR.
+ * @return unsigned int How many unsigned ints were written. The next call can
+ * continue at offset plus that.
+ */
+unsigned int bstr_bp_encode(bstr_bitstr_t *const bstr, unsigned int offset,
+                            const uint32_t *in, unsigned int n,
+                            unsigned int flags) __attribute__((nonnull(1)));
+
+/**
+ * @brief Decodes n values written by one call of bstr_bp_encode(). The flags
+ * are stored in the blocks.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset Index of the unsigned int where the first block starts.
+ * @param out Receives the values.
+ * @param n How many values were encoded.
+ * @return unsigned int How many unsigned ints were read.
+ */
+unsigned int bstr_bp_decode(const bstr_bitstr_t *const bstr,
+                            unsigned int offset, uint32_t *out,
+                            unsigned int n) __attribute__((nonnull(1)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
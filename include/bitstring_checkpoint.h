@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Append only checkpoint files. Every bstr_checkpoint_write() appends one
+ * record with the chunks of BSTR_DIRTY_CHUNK_WORDS unsigned ints that were
+ * written since the last checkpoint, or all chunks when the dirty tracking of
+ * CONFIG_BITSTRING_DIRTY_TRACKING is not enabled for the bitstring.
+ * bstr_checkpoint_replay() applies the records of a file in order.
+ *
+ * A record is a header of five uint32_t (BSTR_CHECKPOINT_MAGIC,
+ * sizeof(unsigned int), the capacity, the chunk size in unsigned ints and the
+ * number of chunks) followed by every chunk as its uint32_t index and its
+ * unsigned ints. All of it in the byte order of the host.
+ */
+
+#ifndef BSTR_BITSTRING_CHECKPOINT_H
+#define BSTR_BITSTRING_CHECKPOINT_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BSTR_CHECKPOINT_MAGIC 0x4B435342U
+
+/**
+ * @brief Append a record with the dirty chunks to out and mark all chunks
+ * clean. Without dirty tracking all chunks are written.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param out The checkpoint file, opened for appending.
+ * @return bstr_err_t BSTR_IO_ERROR when writing failed. The chunks stay dirty
+ * then and out should be cut back to its old length.
+ */
+bstr_err_t bstr_checkpoint_write(bstr_bitstr_t *const bstr, FILE *out)
+    __attribute__((nonnull(1, 2), warn_unused_result));
+
+/**
+ * @brief Apply all records from in to bstr, resizing it to the capacity of
+ * each record. Replaying every record of a file from the first one, which
+ * holds all chunks, restores the state of the last checkpoint.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param in The checkpoint file, read up to its end.
+ * @return bstr_err_t BSTR_BAD_FORMAT when a record is broken or cut off, the
+ * records before it and the chunks of it that were read are applied then.
+ * BSTR_IO_ERROR when reading failed and BSTR_MALLOC_FAILED when bstr could
+ * not be resized.
+ */
+bstr_err_t bstr_checkpoint_replay(bstr_bitstr_t *const bstr, FILE *in)
+    __attribute__((nonnull(1, 2), warn_unused_result));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -25,10 +25,44 @@ SOFTWARE.
 #ifndef BSTR_BITSTRING_COMMON_H
 #define BSTR_BITSTRING_COMMON_H
 
+#include "limits.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief A descriptive error type for all operation which could fail.
+ *
+ */
+typedef enum bstr_err_t {
+  /**
+   * @brief No error occured
+   *
+   */
+  BSTR_NO_ERROR = 0,
+  /**
+   * @brief Memory allocation failed
+   *
+   */
+  BSTR_MALLOC_FAILED = -1,
+  /**
+   * @brief The requested feature is not available on this CPU or platform
+   *
+   */
+  BSTR_UNSUPPORTED = -2,
+  /**
+   * @brief Reading or writing a file failed
+   *
+   */
+  BSTR_IO_ERROR = -3,
+  /**
+   * @brief The data read is not in the expected format or was cut off
+   *
+   */
+  BSTR_BAD_FORMAT = -4,
+} bstr_err_t;
+
 /**
  * @brief How much space you have to allocate for one line of bindump.
  *
@@ -37,6 +71,34 @@ extern "C" {
   (((sizeof(char *) * 2) + 2) + 2 + (sizeof(unsigned int) * CHAR_BIT) +        \
    sizeof(unsigned int) + 2)
 
+/**
+ * @brief How many bits are stored in one unsigned int of a bitstring.
+ *
+ */
+#define BSTR_BITS_PER_INT (sizeof(unsigned int) * CHAR_BIT)
+
+/**
+ * @brief log2(BSTR_BITS_PER_INT). Bit indexes are split into the index of the
+ * unsigned int (bit >> BSTR_BITS_PER_INT_SHIFT) and the bit inside of it
+ * (bit & BSTR_BITS_PER_INT_MASK).
+ *
+ */
+#if UINT_MAX == 0xFFFFU
+#define BSTR_BITS_PER_INT_SHIFT 4U
+#elif UINT_MAX == 0xFFFFFFFFU
+#define BSTR_BITS_PER_INT_SHIFT 5U
+#elif UINT_MAX == 0xFFFFFFFFFFFFFFFFU
+#define BSTR_BITS_PER_INT_SHIFT 6U
+#else
+#error "Unsupported size of unsigned int"
+#endif
+
+/**
+ * @brief Mask to get the index of a bit inside of its unsigned int.
+ *
+ */
+#define BSTR_BITS_PER_INT_MASK (BSTR_BITS_PER_INT - 1U)
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,290 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Runtime CPU dispatch for the scan kernels. The first call detects the CPU
+ * and picks the fastest implementation it supports. All binaries built from
+ * the same source run everywhere, only the speed differs. On everything but
+ * x86 there is only the scalar backend.
+ */
+
+#ifndef BSTR_BITSTRING_DISPATCH_H
+#define BSTR_BITSTRING_DISPATCH_H
+
+#include "bitstring_common.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Implementations of the scan kernels.
+ *
+ */
+typedef enum bstr_backend_t {
+  /**
+   * @brief Pick the best backend this CPU supports. Only valid for
+   * bstr_set_backend().
+   *
+   */
+  BSTR_BACKEND_AUTO = 0,
+  /**
+   * @brief Portable C, available everywhere.
+   *
+   */
+  BSTR_BACKEND_SCALAR = 1,
+  /**
+   * @brief x86 POPCNT on 64 bit words.
+   *
+   */
+  BSTR_BACKEND_POPCNT = 2,
+  /**
+   * @brief x86 AVX2, Harley-Seal popcount and 256 bit scans.
+   *
+   */
+  BSTR_BACKEND_AVX2 = 3,
+  /**
+   * @brief x86 AVX-512 VPOPCNTDQ and 512 bit scans.
+   *
+   */
+  BSTR_BACKEND_AVX512 = 4,
+} bstr_backend_t;
+
+/**
+ * @brief How bstr_dispatch_find_pair() combines two words.
+ *
+ */
+typedef enum bstr_pair_op_t {
+  /**
+   * @brief a & b, finds a common bit.
+   *
+   */
+  BSTR_PAIR_AND = 0,
+  /**
+   * @brief a & ~b, finds a bit of a which is missing in b.
+   *
+   */
+  BSTR_PAIR_ANDNOT = 1,
+  /**
+   * @brief a ^ b, finds a difference.
+   *
+   */
+  BSTR_PAIR_XOR = 2,
+} bstr_pair_op_t;
+
+/**
+ * @brief Returns the backend which is used for the scan kernels. Detects the
+ * CPU on the first call.
+ *
+ * @return bstr_backend_t Never BSTR_BACKEND_AUTO.
+ */
+bstr_backend_t bstr_get_backend(void);
+
+/**
+ * @brief Force a backend, e.g. to benchmark them against each other.
+ *
+ * @param backend The backend to use or BSTR_BACKEND_AUTO for the best one.
+ * @return bstr_err_t BSTR_UNSUPPORTED when this CPU can't run backend.
+ */
+bstr_err_t bstr_set_backend(bstr_backend_t backend)
+    __attribute__((warn_unused_result));
+
+/**
+ * @brief Check whether this CPU can run a backend.
+ *
+ * @param backend The backend to check.
+ */
+bool bstr_backend_is_supported(bstr_backend_t backend);
+
+/**
+ * @brief Human readable name of a backend, e.g. "avx2".
+ *
+ * @param backend The backend.
+ * @return const char* The name or NULL for an unknown value.
+ */
+const char *bstr_backend_name(bstr_backend_t backend);
+
+/**
+ * @brief Number of set bits in nwords unsigned ints.
+ *
+ * @param words Pointer to the first unsigned int. Needs no special alignment.
+ * @param nwords Number of unsigned ints.
+ */
+uint64_t bstr_dispatch_popcnt(const unsigned int *words, size_t nwords);
+
+/**
+ * @brief Index of the first word for which (word ^ invert) != 0.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param nwords Number of unsigned ints.
+ * @param invert 0 to find a word with a set bit, ~0U to find a word with an
+ * unset bit.
+ * @return size_t The index or nwords when there is none.
+ */
+size_t bstr_dispatch_find(const unsigned int *words, size_t nwords,
+                          unsigned int invert);
+
+/**
+ * @brief One past the index of the last word which is not 0.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param nwords Number of unsigned ints.
+ * @return size_t The index + 1 or 0 when all words are 0.
+ */
+size_t bstr_dispatch_rfind(const unsigned int *words, size_t nwords);
+
+/**
+ * @brief Index of the first word for which (a[i] op b[i]) != 0. Stops at the
+ * first vector that decides.
+ *
+ * @param a Pointer to the first unsigned int of the left operand.
+ * @param b Pointer to the first unsigned int of the right operand.
+ * @param nwords Number of unsigned ints in both operands.
+ * @param op How the words are combined.
+ * @return size_t The index or nwords when there is none.
+ */
+size_t bstr_dispatch_find_pair(const unsigned int *a, const unsigned int *b,
+                               size_t nwords, bstr_pair_op_t op);
+
+/**
+ * @brief Index of the first word in which a 16 bit window matching prefix
+ * starts, at any of the bit offsets of that word. Windows which start in the
+ * last word run into words[nwords], so it has to be readable.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param nwords Number of unsigned ints in which windows start.
+ * @param prefix The 16 bits to look for in its least significant bits.
+ * @return size_t The index or nwords when there is none.
+ */
+size_t bstr_dispatch_find_prefix16(const unsigned int *words, size_t nwords,
+                                   unsigned int prefix);
+
+/**
+ * @brief Unpack n fields of width bits which are stored back to back, field i
+ * at bit i * width, into one uint32_t each. Runs 8 (AVX2) or 16 (AVX-512)
+ * fields per gather. The word after the one holding the last bit of the last
+ * field is read, so it has to be readable.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param width Width of the fields, 1 to 32.
+ * @param first Index of the first field to unpack.
+ * @param n How many fields to unpack.
+ * @param out Receives n values.
+ */
+void bstr_dispatch_unpack(const unsigned int *words, unsigned int width,
+                          size_t first, size_t n, uint32_t *out);
+
+/**
+ * @brief Positional popcount: adds to counts[i] how many of the rows have bit
+ * i set. Every 16 rows go through a carry save adder tree in bit slices,
+ * which is expanded into the per bit counts once per 16 rows.
+ *
+ * @param rows Pointers to the first unsigned int of every row.
+ * @param nrows Number of rows.
+ * @param nwords Number of unsigned ints in every row.
+ * @param counts nwords * BSTR_BITS_PER_INT counters which get added to.
+ */
+void bstr_dispatch_positional_popcnt(const unsigned int *const *rows,
+                                     size_t nrows, size_t nwords,
+                                     uint32_t *counts);
+
+/**
+ * @brief Hamming distances of one query to nrows rows that are stored back to
+ * back. The query stays in registers or L1 while the rows stream past it.
+ *
+ * @param query Pointer to the first unsigned int of the query.
+ * @param rows Pointer to the first unsigned int of the first row. Row r
+ * starts at rows + r * nwords.
+ * @param nrows Number of rows.
+ * @param nwords Number of unsigned ints in the query and every row.
+ * @param out Receives nrows distances.
+ */
+void bstr_dispatch_hamming(const unsigned int *query,
+                           const unsigned int *rows, size_t nrows,
+                           size_t nwords, uint32_t *out);
+
+/**
+ * @brief 128 bit content hash of nwords unsigned ints. The result only depends
+ * on nwords and the bits, never on the backend, the CPU or the process, so it
+ * may be stored.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param nwords Number of unsigned ints, mixed into the hash.
+ * @param hash Receives the hash. hash[0] alone is the 64 bit hash.
+ */
+void bstr_dispatch_hash128(const unsigned int *words, size_t nwords,
+                           uint64_t hash[2]);
+
+/**
+ * @brief Words bstr_dispatch_hash128_update() takes per call but the last, any
+ * multiple of it works too.
+ *
+ */
+#define BSTR_DISPATCH_HASH_BLOCK_WORDS 64U
+
+/**
+ * @brief State of a bstr_dispatch_hash128() over words that are not back to
+ * back in memory, e.g. shifted into a buffer block by block.
+ *
+ */
+typedef struct bstr_hash_state_t {
+  uint64_t acc[4];
+  size_t nwords;
+} bstr_hash_state_t;
+
+/**
+ * @brief Start a hash over no words.
+ *
+ * @param state The state to initialize.
+ */
+void bstr_dispatch_hash128_init(bstr_hash_state_t *state);
+
+/**
+ * @brief Hash the next nwords unsigned ints.
+ *
+ * @param state The state.
+ * @param words Pointer to the first unsigned int.
+ * @param nwords Number of unsigned ints, a multiple of
+ * BSTR_DISPATCH_HASH_BLOCK_WORDS in every call but the last.
+ */
+void bstr_dispatch_hash128_update(bstr_hash_state_t *state,
+                                  const unsigned int *words, size_t nwords);
+
+/**
+ * @brief The hash of all words passed so far, the same bstr_dispatch_hash128()
+ * gives for them back to back.
+ *
+ * @param state The state.
+ * @param hash Receives the hash. hash[0] alone is the 64 bit hash.
+ */
+void bstr_dispatch_hash128_final(const bstr_hash_state_t *state,
+                                 uint64_t hash[2]);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
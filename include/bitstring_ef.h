@@ -0,0 +1,163 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Elias-Fano coding of non-decreasing sequences of unsigned ints, e.g.
+ * posting lists. Every value is split into low_bits low bits, stored packed,
+ * and the rest. The rest is stored in unary in a bstr_bitstr_t: value i sets
+ * bit (value >> low_bits) + i. low_bits is chosen such that the whole list
+ * takes about 2 + log2(universe / n) bits per value.
+ *
+ * Sampled positions of every BSTR_EF_SAMPLE-th one and zero of the upper bits
+ * make bstr_ef_get() and bstr_ef_next_geq() scan at most a few words.
+ *
+ * A list is immutable once it is built.
+ */
+
+#ifndef BSTR_BITSTRING_EF_H
+#define BSTR_BITSTRING_EF_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How many ones (and zeros) of the upper bits lie between two samples.
+ * A power of two.
+ *
+ */
+#define BSTR_EF_SAMPLE 256U
+
+/**
+ * @brief An Elias-Fano coded list. Create it with bstr_ef_create() and
+ * delete it with bstr_ef_delete().
+ *
+ */
+typedef struct bstr_ef_t bstr_ef_t;
+
+/**
+ * @brief Iterator over a bstr_ef_t. Set it up with bstr_ef_iter_init().
+ *
+ */
+typedef struct bstr_ef_iter_t {
+  /**
+   * @brief Note: The fields are private.
+   *
+   */
+  const bstr_ef_t *_ef;
+  unsigned int _index;
+  unsigned int _pos;
+} bstr_ef_iter_t;
+
+/**
+ * @brief Encodes n values.
+ *
+ * @param values The values in non-decreasing order.
+ * @param n How many values there are, may be 0.
+ * @return bstr_ef_t* The list or NULL when malloc failed.
+ */
+bstr_ef_t *bstr_ef_create(const unsigned int *values, unsigned int n)
+    __attribute__((warn_unused_result));
+
+/**
+ * @brief Encodes the indexes of the set bits of a bitstring.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @return bstr_ef_t* The list or NULL when malloc failed.
+ */
+bstr_ef_t *bstr_ef_create_from_bitstr(const bstr_bitstr_t *const bstr)
+    __attribute__((nonnull(1), warn_unused_result));
+
+/**
+ * @brief Deletes a list.
+ *
+ * @param ef Pointer to the list.
+ */
+void bstr_ef_delete(bstr_ef_t *ef) __attribute__((nonnull(1)));
+
+/**
+ * @brief How many values the list holds.
+ *
+ * @param ef Pointer to the list.
+ */
+unsigned int bstr_ef_count(const bstr_ef_t *const ef)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief How many bits the list takes, samples included.
+ *
+ * @param ef Pointer to the list.
+ */
+size_t bstr_ef_size_in_bits(const bstr_ef_t *const ef)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief The value at index.
+ *
+ * @param ef Pointer to the list.
+ * @param index Has to be < bstr_ef_count().
+ */
+unsigned int bstr_ef_get(const bstr_ef_t *const ef, unsigned int index)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Finds the first value >= x.
+ *
+ * @param ef Pointer to the list.
+ * @param x The value to look for.
+ * @param value Receives the value found, may be NULL.
+ * @return int The index of the value or -1 when every value is < x.
+ */
+int bstr_ef_next_geq(const bstr_ef_t *const ef, unsigned int x,
+                     unsigned int *value) __attribute__((nonnull(1)));
+
+/**
+ * @brief Sets an iterator up to start at index.
+ *
+ * @param ef Pointer to the list. It has to outlive the iterator.
+ * @param index Where to start, e.g. a result of bstr_ef_next_geq(). Anything
+ * >= bstr_ef_count() gives an exhausted iterator.
+ * @param it Pointer to the iterator.
+ */
+void bstr_ef_iter_init(const bstr_ef_t *const ef, unsigned int index,
+                       bstr_ef_iter_t *it) __attribute__((nonnull(1, 3)));
+
+/**
+ * @brief Moves the iterator on by one value. Decoding a value costs a scan to
+ * the next set bit of the upper bits and one read of the lower bits.
+ *
+ * @param it Pointer to the iterator.
+ * @param value Receives the value.
+ * @return true A value was written to value.
+ * @return false The iterator is exhausted.
+ */
+bool bstr_ef_iter_next(bstr_ef_iter_t *it, unsigned int *value)
+    __attribute__((nonnull(1, 2)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
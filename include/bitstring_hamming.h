@@ -0,0 +1,197 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Nearest neighbour search by Hamming distance, e.g. over binary embeddings.
+ * A set stores rows of the same number of unsigned ints back to back, so a
+ * scan streams through one array instead of chasing a pointer per bitstring.
+ *
+ * bstr_hamming_topk() answers a batch of queries at once. The rows are read
+ * in tiles that stay in the cache while every query of the batch is compared
+ * against them with bstr_dispatch_hamming(), and each query keeps its k best
+ * rows in a heap.
+ *
+ * Searching never writes to the set, so threads can search it at the same
+ * time. To split one search across threads, give each of them a range of the
+ * rows and combine their results with bstr_hamming_topk_merge().
+ */
+
+#ifndef BSTR_BITSTRING_HAMMING_H
+#define BSTR_BITSTRING_HAMMING_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bytes of rows compared against all queries of a batch before the next
+ * rows are read.
+ *
+ */
+#ifndef BSTR_HAMMING_TILE_BYTES
+#define BSTR_HAMMING_TILE_BYTES (128U * 1024U)
+#endif
+
+/**
+ * @brief A set of rows. Create it with bstr_hamming_create() and delete it
+ * with bstr_hamming_delete().
+ *
+ */
+typedef struct bstr_hamming_set_t bstr_hamming_set_t;
+
+/**
+ * @brief A row found by bstr_hamming_topk().
+ *
+ */
+typedef struct bstr_hamming_hit_t {
+  /**
+   * @brief Index of the row in the set.
+   *
+   */
+  unsigned int index;
+  /**
+   * @brief Number of bits in which the row differs from the query.
+   *
+   */
+  unsigned int distance;
+} bstr_hamming_hit_t;
+
+/**
+ * @brief Creates an empty set.
+ *
+ * @param nwords Number of unsigned ints of every row, > 0.
+ * @param capacity How many rows to make room for, > 0. The set grows past it.
+ * @return bstr_hamming_set_t* The set or NULL when malloc failed.
+ */
+bstr_hamming_set_t *bstr_hamming_create(unsigned int nwords,
+                                        unsigned int capacity)
+    __attribute__((warn_unused_result));
+
+/**
+ * @brief Deletes a set.
+ *
+ * @param set Pointer to the set.
+ */
+void bstr_hamming_delete(bstr_hamming_set_t *set) __attribute__((nonnull(1)));
+
+/**
+ * @brief Number of rows in the set.
+ *
+ * @param set Pointer to the set.
+ */
+unsigned int bstr_hamming_count(const bstr_hamming_set_t *const set)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Number of unsigned ints of every row.
+ *
+ * @param set Pointer to the set.
+ */
+unsigned int bstr_hamming_words(const bstr_hamming_set_t *const set)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Appends a copy of a bitstring as the next row.
+ *
+ * @param set Pointer to the set.
+ * @param row Pointer to a bitstring with bstr_hamming_words() unsigned ints.
+ * @return bstr_err_t BSTR_MALLOC_FAILED when the set could not grow.
+ */
+bstr_err_t bstr_hamming_add(bstr_hamming_set_t *const set,
+                            const bstr_bitstr_t *const row)
+    __attribute__((nonnull(1, 2), warn_unused_result));
+
+/**
+ * @brief A bitstring object over one row, see bstr_wrap(). Writes through it
+ * change the row. It is valid until the next bstr_hamming_add().
+ *
+ * @param set Pointer to the set.
+ * @param index Has to be < bstr_hamming_count().
+ */
+bstr_bitstr_t bstr_hamming_row(bstr_hamming_set_t *const set,
+                               unsigned int index) __attribute__((nonnull(1)));
+
+/**
+ * @brief Hamming distances of a query to n rows.
+ *
+ * @param set Pointer to the set.
+ * @param query Pointer to a bitstring with bstr_hamming_words() unsigned ints.
+ * @param first Index of the first row. first + n has to be <=
+ * bstr_hamming_count().
+ * @param n How many rows to compare.
+ * @param out Receives n distances.
+ */
+void bstr_hamming_distances(const bstr_hamming_set_t *const set,
+                            const bstr_bitstr_t *const query,
+                            unsigned int first, unsigned int n, uint32_t *out)
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief Finds the k rows closest to each of nqueries queries among n rows.
+ * Ties go to the row with the lower index, so the result does not depend on
+ * how a search is split.
+ *
+ * @param set Pointer to the set.
+ * @param queries The queries, bitstrings with bstr_hamming_words() unsigned
+ * ints each.
+ * @param nqueries How many queries there are.
+ * @param first Index of the first row to search. first + n has to be <=
+ * bstr_hamming_count().
+ * @param n How many rows to search.
+ * @param k How many rows to find per query, > 0.
+ * @param hits nqueries * k hits. Those of query q start at hits + q * k,
+ * closest first.
+ * @return unsigned int How many hits each query got, the lower of k and n.
+ */
+unsigned int bstr_hamming_topk(const bstr_hamming_set_t *const set,
+                               const bstr_bitstr_t *const *queries,
+                               unsigned int nqueries, unsigned int first,
+                               unsigned int n, unsigned int k,
+                               bstr_hamming_hit_t *hits)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Combines the hits of one query from two searches of different rows,
+ * e.g. from two threads.
+ *
+ * @param hits Hits of the first search, closest first, with room for k.
+ * Receives the combined hits.
+ * @param nhits How many hits there are.
+ * @param other Hits of the second search, closest first.
+ * @param nother How many of them there are.
+ * @param k How many hits to keep.
+ * @return unsigned int How many hits there are now.
+ */
+unsigned int bstr_hamming_topk_merge(bstr_hamming_hit_t *hits,
+                                     unsigned int nhits,
+                                     const bstr_hamming_hit_t *other,
+                                     unsigned int nother, unsigned int k)
+    __attribute__((nonnull(1)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Interning of dynamic sized bitstrings. An intern table keeps exactly one
+ * immutable, reference counted copy of every distinct bitstring handed to it.
+ * Two interned bitstrings of the same table are equal if and only if their
+ * pointers are equal.
+ *
+ * The table is not thread safe.
+ */
+
+#ifndef BSTR_BITSTRING_INTERN_H
+#define BSTR_BITSTRING_INTERN_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief An intern table. Create it with bstr_intern_create_table() and delete
+ * it with bstr_intern_delete_table().
+ *
+ */
+typedef struct bstr_intern_table_t bstr_intern_table_t;
+
+/**
+ * @brief Creates an empty intern table.
+ *
+ * @param expected How many distinct bitstrings are expected, may be 0. The
+ * table grows on demand.
+ * @return bstr_intern_table_t* The table or NULL when malloc failed.
+ */
+bstr_intern_table_t *bstr_intern_create_table(unsigned int expected);
+
+/**
+ * @brief Deletes the table and every bitstring interned in it, no matter how
+ * many references are left.
+ *
+ * @param table Pointer to the intern table.
+ */
+void bstr_intern_delete_table(bstr_intern_table_t *table)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Returns the shared instance equal to bstr and takes a reference on
+ * it. A copy of bstr is made when no equal bitstring is interned yet. bstr
+ * itself is neither kept nor modified.
+ *
+ * @param table Pointer to the intern table.
+ * @param bstr Pointer to the bitstring to intern.
+ * @return const bstr_bitstr_t* The shared instance or NULL when malloc failed.
+ * Never write to it and never pass it to bstr_delete_bitstr() or
+ * bstr_resize(), release it with bstr_intern_release().
+ */
+const bstr_bitstr_t *bstr_intern(bstr_intern_table_t *table,
+                                 const bstr_bitstr_t *const bstr)
+    __attribute__((nonnull(1, 2), warn_unused_result));
+
+/**
+ * @brief Takes another reference on an interned bitstring.
+ *
+ * @param interned A pointer returned by bstr_intern().
+ * @return const bstr_bitstr_t* interned.
+ */
+const bstr_bitstr_t *bstr_intern_retain(const bstr_bitstr_t *const interned)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Drops a reference. The bitstring is removed from the table and freed
+ * when the last reference is gone.
+ *
+ * @param table Pointer to the intern table interned belongs to.
+ * @param interned A pointer returned by bstr_intern().
+ */
+void bstr_intern_release(bstr_intern_table_t *table,
+                         const bstr_bitstr_t *const interned)
+    __attribute__((nonnull(1, 2)));
+
+/**
+ * @brief How many references are held on an interned bitstring.
+ *
+ * @param interned A pointer returned by bstr_intern().
+ */
+unsigned int bstr_intern_refcount(const bstr_bitstr_t *const interned)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief How many distinct bitstrings are interned.
+ *
+ * @param table Pointer to the intern table.
+ */
+unsigned int bstr_intern_count(const bstr_intern_table_t *const table)
+    __attribute__((nonnull(1)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
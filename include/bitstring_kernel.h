@@ -0,0 +1,721 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * The kernel layer. Every algorithm of the library is implemented exactly once
+ * in here, on a plain array of unsigned ints. bitstring.c (dynamic sized) and
+ * the macros of bitstring_static.h (static sized) are thin front ends which
+ * build a bstr_view_t and call into these functions. All kernels are static
+ * inline, so a static sized front end passes its size as a compile time
+ * constant and the compiler specializes the kernel on it.
+ */
+
+#ifndef BSTR_BITSTRING_KERNEL_H
+#define BSTR_BITSTRING_KERNEL_H
+
+#include "bitstring_common.h"
+#include "bitstring_dispatch.h"
+#include "limits.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+#include "assert.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The words of a bitstring as seen by the kernels.
+ *
+ */
+typedef struct bstr_view_t {
+  /**
+   * @brief Pointer to the first unsigned int.
+   *
+   */
+  unsigned int *words;
+  /**
+   * @brief Number of unsigned ints at words.
+   *
+   */
+  unsigned int nwords;
+} bstr_view_t;
+
+/**
+ * @brief Scans over at least this many unsigned ints go through the runtime
+ * dispatched kernels of bitstring_dispatch.h. Shorter ones stay inline, for a
+ * static sized bitstring the check folds away at compile time.
+ *
+ */
+#ifndef BSTR_KERNEL_DISPATCH_MIN_WORDS
+#define BSTR_KERNEL_DISPATCH_MIN_WORDS 32
+#endif
+
+/**
+ * @brief How many row pointers the positional popcount collects on the stack
+ * per call of bstr_dispatch_positional_popcnt(). A multiple of 16, so only
+ * the last batch ends in rows that don't fill a carry save adder tree.
+ *
+ */
+#define BSTR_KERNEL_ROWS_BATCH 256U
+
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+#define BSTR_KERNEL_BOUND_CHECK(view, word_index)                              \
+  assert((word_index) < (view).nwords);
+#else
+#define BSTR_KERNEL_BOUND_CHECK(view, word_index)
+#endif
+
+/**
+ * @brief Create a view. Read only kernels do not write through words, so it is
+ * fine to cast away the const of a const bitstring.
+ *
+ * @param words Pointer to the first unsigned int.
+ * @param nwords Number of unsigned ints.
+ */
+static inline bstr_view_t bstr_kernel_view(unsigned int *words,
+                                           unsigned int nwords) {
+  bstr_view_t view;
+  view.words = words;
+  view.nwords = nwords;
+  return view;
+}
+
+/**
+ * @brief Set a bit.
+ */
+static inline void bstr_kernel_set(const bstr_view_t v, unsigned int bit) {
+  BSTR_KERNEL_BOUND_CHECK(v, bit >> BSTR_BITS_PER_INT_SHIFT)
+  v.words[bit >> BSTR_BITS_PER_INT_SHIFT] |= 1U
+                                             << (bit & BSTR_BITS_PER_INT_MASK);
+}
+
+/**
+ * @brief Clear a bit.
+ */
+static inline void bstr_kernel_clr(const bstr_view_t v, unsigned int bit) {
+  BSTR_KERNEL_BOUND_CHECK(v, bit >> BSTR_BITS_PER_INT_SHIFT)
+  v.words[bit >> BSTR_BITS_PER_INT_SHIFT] &=
+      ~(1U << (bit & BSTR_BITS_PER_INT_MASK));
+}
+
+/**
+ * @brief Check if a bit is set. The bound check runs before the load.
+ */
+static inline bool bstr_kernel_get(const bstr_view_t v, unsigned int bit) {
+  BSTR_KERNEL_BOUND_CHECK(v, bit >> BSTR_BITS_PER_INT_SHIFT)
+  return (v.words[bit >> BSTR_BITS_PER_INT_SHIFT] >>
+          (bit & BSTR_BITS_PER_INT_MASK)) &
+         1U;
+}
+
+/**
+ * @brief Read width bits, 1 to 64, starting at bit offset. Bit offset ends up
+ * in bit 0 of the result. Touches only the words the field overlaps.
+ */
+static inline uint64_t bstr_kernel_get_field(const bstr_view_t v,
+                                             unsigned int offset,
+                                             unsigned int width) {
+  BSTR_KERNEL_BOUND_CHECK(v, (offset + width - 1) >> BSTR_BITS_PER_INT_SHIFT)
+  unsigned int i = offset >> BSTR_BITS_PER_INT_SHIFT;
+  const unsigned int shift = offset & BSTR_BITS_PER_INT_MASK;
+  uint64_t value = v.words[i] >> shift;
+  for (unsigned int got = BSTR_BITS_PER_INT - shift; got < width;
+       got += BSTR_BITS_PER_INT)
+    value |= (uint64_t)v.words[++i] << got;
+  return width < 64 ? value & ((UINT64_C(1) << width) - 1) : value;
+}
+
+/**
+ * @brief Write the low width bits, 1 to 64, of value starting at bit offset.
+ * The other bits of value are ignored.
+ */
+static inline void bstr_kernel_set_field(const bstr_view_t v,
+                                         unsigned int offset,
+                                         unsigned int width, uint64_t value) {
+  BSTR_KERNEL_BOUND_CHECK(v, (offset + width - 1) >> BSTR_BITS_PER_INT_SHIFT)
+  const uint64_t mask = width < 64 ? (UINT64_C(1) << width) - 1 : ~UINT64_C(0);
+  unsigned int i = offset >> BSTR_BITS_PER_INT_SHIFT;
+  const unsigned int shift = offset & BSTR_BITS_PER_INT_MASK;
+  value &= mask;
+  v.words[i] = (v.words[i] & ~(unsigned int)(mask << shift)) |
+               (unsigned int)(value << shift);
+  for (unsigned int got = BSTR_BITS_PER_INT - shift; got < width;
+       got += BSTR_BITS_PER_INT) {
+    i++;
+    v.words[i] = (v.words[i] & ~(unsigned int)(mask >> got)) |
+                 (unsigned int)(value >> got);
+  }
+}
+
+/**
+ * @brief Write n fields of width bits, 1 to 32, back to back starting at bit
+ * offset. Field i takes the low width bits of in[i]. Bits around the fields
+ * are kept.
+ */
+static inline void bstr_kernel_pack_fields(const bstr_view_t v,
+                                           unsigned int offset,
+                                           unsigned int width,
+                                           const uint32_t *in, size_t n) {
+  if (n == 0)
+    return;
+  BSTR_KERNEL_BOUND_CHECK(
+      v, (unsigned int)((offset + n * width - 1) >> BSTR_BITS_PER_INT_SHIFT))
+#if UINT_MAX == 0xFFFFFFFFU
+  /* Collect the bits in a 64 bit accumulator and store a word whenever 32 of
+   * them are complete. The accumulator starts with the bits below the first
+   * field, so the first word is merged for free. */
+  const uint64_t mask = width < 32 ? (UINT64_C(1) << width) - 1U : 0xFFFFFFFFU;
+  unsigned int *word = &v.words[offset >> BSTR_BITS_PER_INT_SHIFT];
+  unsigned int filled = offset & BSTR_BITS_PER_INT_MASK;
+  uint64_t acc = *word & ~(~0U << filled);
+  for (size_t i = 0; i < n; i++) {
+    acc |= (in[i] & mask) << filled;
+    filled += width;
+    if (filled >= BSTR_BITS_PER_INT) {
+      *word++ = (unsigned int)acc;
+      acc >>= BSTR_BITS_PER_INT;
+      filled -= BSTR_BITS_PER_INT;
+    }
+  }
+  if (filled > 0)
+    *word = (*word & (~0U << filled)) | (unsigned int)acc;
+#else
+  for (size_t i = 0; i < n; i++)
+    bstr_kernel_set_field(v, offset + (unsigned int)i * width, width, in[i]);
+#endif
+}
+
+/**
+ * @brief Set all bits to the value of on.
+ */
+static inline void bstr_kernel_set_all(const bstr_view_t v, bool on) {
+  memset(v.words, on ? UCHAR_MAX : 0, v.nwords * sizeof(unsigned int));
+}
+
+/**
+ * @brief Index of the first bit at or after offset that is set in
+ * (word ^ invert). invert is 0 to search set bits and ~0U to search unset
+ * bits.
+ *
+ * @return int The bit index or -1 when there is none.
+ */
+static inline int bstr_kernel_next(const bstr_view_t v, unsigned int offset,
+                                   unsigned int invert) {
+  unsigned int i = offset >> BSTR_BITS_PER_INT_SHIFT;
+  if (i >= v.nwords)
+    return -1;
+  unsigned int word =
+      (v.words[i] ^ invert) & (~0U << (offset & BSTR_BITS_PER_INT_MASK));
+  if (word == 0) {
+    if (++i == v.nwords)
+      return -1;
+    if (v.nwords - i >= BSTR_KERNEL_DISPATCH_MIN_WORDS) {
+      i += (unsigned int)bstr_dispatch_find(&v.words[i], v.nwords - i, invert);
+      if (i == v.nwords)
+        return -1;
+    }
+    word = v.words[i] ^ invert;
+  }
+  for (;;) {
+    if (word != 0)
+      return (int)((i << BSTR_BITS_PER_INT_SHIFT) + __builtin_ctz(word));
+    if (++i == v.nwords)
+      return -1;
+    word = v.words[i] ^ invert;
+  }
+}
+
+/**
+ * @brief Index of the first set bit or -1.
+ */
+static inline int bstr_kernel_ffs(const bstr_view_t v) {
+  return bstr_kernel_next(v, 0, 0U);
+}
+
+/**
+ * @brief Index of the first unset bit or -1.
+ */
+static inline int bstr_kernel_ffus(const bstr_view_t v) {
+  return bstr_kernel_next(v, 0, ~0U);
+}
+
+/**
+ * @brief Count trailing zeros, starting at the least significant bit.
+ */
+static inline int bstr_kernel_ctz(const bstr_view_t v) {
+  int first = bstr_kernel_next(v, 0, 0U);
+  return first < 0 ? (int)(v.nwords << BSTR_BITS_PER_INT_SHIFT) : first;
+}
+
+/**
+ * @brief Count leading zeros, starting at the most significant bit.
+ */
+static inline int bstr_kernel_clz(const bstr_view_t v) {
+  if (v.nwords >= BSTR_KERNEL_DISPATCH_MIN_WORDS) {
+    const unsigned int last =
+        (unsigned int)bstr_dispatch_rfind(v.words, v.nwords);
+    if (last == 0)
+      return (int)(v.nwords << BSTR_BITS_PER_INT_SHIFT);
+    return (int)((v.nwords - last) << BSTR_BITS_PER_INT_SHIFT) +
+           __builtin_clz(v.words[last - 1]);
+  }
+  int result = 0;
+  for (unsigned int i = v.nwords; i > 0; i--) {
+    if (v.words[i - 1] != 0)
+      return result + __builtin_clz(v.words[i - 1]);
+    result += BSTR_BITS_PER_INT;
+  }
+  return result;
+}
+
+/**
+ * @brief Count how many bits are set.
+ */
+static inline int bstr_kernel_popcnt(const bstr_view_t v) {
+  if (v.nwords >= BSTR_KERNEL_DISPATCH_MIN_WORDS)
+    return (int)bstr_dispatch_popcnt(v.words, v.nwords);
+  int popcnt = 0;
+  for (unsigned int i = 0; i < v.nwords; i++)
+    popcnt += __builtin_popcount(v.words[i]);
+  return popcnt;
+}
+
+/**
+ * @brief Index of the first of nwords words for which (a op b) != 0 or nwords.
+ */
+static inline unsigned int bstr_kernel_find_pair(const unsigned int *a,
+                                                 const unsigned int *b,
+                                                 unsigned int nwords,
+                                                 bstr_pair_op_t op) {
+  if (nwords >= BSTR_KERNEL_DISPATCH_MIN_WORDS)
+    return (unsigned int)bstr_dispatch_find_pair(a, b, nwords, op);
+  unsigned int i = 0;
+  for (; i < nwords; i++) {
+    const unsigned int word = op == BSTR_PAIR_AND      ? a[i] & b[i]
+                              : op == BSTR_PAIR_ANDNOT ? a[i] & ~b[i]
+                                                       : a[i] ^ b[i];
+    if (word != 0)
+      break;
+  }
+  return i;
+}
+
+/**
+ * @brief Whether no bit is set.
+ */
+static inline bool bstr_kernel_is_empty(const bstr_view_t v) {
+  if (v.nwords >= BSTR_KERNEL_DISPATCH_MIN_WORDS)
+    return bstr_dispatch_find(v.words, v.nwords, 0U) == v.nwords;
+  for (unsigned int i = 0; i < v.nwords; i++)
+    if (v.words[i] != 0)
+      return false;
+  return true;
+}
+
+static inline unsigned int _bstr_kernel_min_words(const bstr_view_t a,
+                                                  const bstr_view_t b) {
+  return a.nwords < b.nwords ? a.nwords : b.nwords;
+}
+
+/**
+ * @brief Whether a and b have the same capacity and the same bits.
+ */
+static inline bool bstr_kernel_equals(const bstr_view_t a,
+                                      const bstr_view_t b) {
+  return a.nwords == b.nwords &&
+         bstr_kernel_find_pair(a.words, b.words, a.nwords, BSTR_PAIR_XOR) ==
+             a.nwords;
+}
+
+/**
+ * @brief Whether a and b have a set bit in common.
+ */
+static inline bool bstr_kernel_intersects(const bstr_view_t a,
+                                          const bstr_view_t b) {
+  const unsigned int n = _bstr_kernel_min_words(a, b);
+  return bstr_kernel_find_pair(a.words, b.words, n, BSTR_PAIR_AND) < n;
+}
+
+/**
+ * @brief Whether every set bit of a is also set in b. Bits of a beyond the
+ * capacity of b have to be unset.
+ */
+static inline bool bstr_kernel_is_subset(const bstr_view_t a,
+                                         const bstr_view_t b) {
+  const unsigned int n = _bstr_kernel_min_words(a, b);
+  if (bstr_kernel_find_pair(a.words, b.words, n, BSTR_PAIR_ANDNOT) < n)
+    return false;
+  return bstr_kernel_is_empty(bstr_kernel_view(a.words + n, a.nwords - n));
+}
+
+/**
+ * @brief Lexicographic three way compare of the bit sequences, starting at bit
+ * 0. The first differing bit decides, the bitstring having it set is greater.
+ * When one is a prefix of the other the shorter one is smaller. This is the
+ * order strcmp() gives for the output of to_string.
+ *
+ * @return int < 0, 0 or > 0 when a is smaller, equal or greater than b.
+ */
+static inline int bstr_kernel_compare(const bstr_view_t a,
+                                      const bstr_view_t b) {
+  const unsigned int n = _bstr_kernel_min_words(a, b);
+  const unsigned int i =
+      bstr_kernel_find_pair(a.words, b.words, n, BSTR_PAIR_XOR);
+  if (i < n) {
+    const unsigned int diff = a.words[i] ^ b.words[i];
+    return (a.words[i] & (diff & (0U - diff))) ? 1 : -1;
+  }
+  return (a.nwords > b.nwords) - (a.nwords < b.nwords);
+}
+
+/**
+ * @brief Set (on) or clear n bits starting at bit start, a word at a time.
+ */
+static inline void bstr_kernel_fill_range(const bstr_view_t v,
+                                          unsigned int start, unsigned int n,
+                                          bool on) {
+  if (n == 0)
+    return;
+  const unsigned int end = start + n - 1;
+  const unsigned int first = start >> BSTR_BITS_PER_INT_SHIFT;
+  const unsigned int last = end >> BSTR_BITS_PER_INT_SHIFT;
+  BSTR_KERNEL_BOUND_CHECK(v, last)
+  const unsigned int head = ~0U << (start & BSTR_BITS_PER_INT_MASK);
+  const unsigned int tail =
+      ~0U >> (BSTR_BITS_PER_INT_MASK - (end & BSTR_BITS_PER_INT_MASK));
+  if (first == last) {
+    if (on)
+      v.words[first] |= head & tail;
+    else
+      v.words[first] &= ~(head & tail);
+    return;
+  }
+  if (on) {
+    v.words[first] |= head;
+    v.words[last] |= tail;
+  } else {
+    v.words[first] &= ~head;
+    v.words[last] &= ~tail;
+  }
+  memset(&v.words[first + 1], on ? UCHAR_MAX : 0,
+         (last - first - 1) * sizeof(unsigned int));
+}
+
+/**
+ * @brief Count the set bits among n bits starting at bit start.
+ */
+static inline int bstr_kernel_popcnt_range(const bstr_view_t v,
+                                           unsigned int start,
+                                           unsigned int n) {
+  if (n == 0)
+    return 0;
+  const unsigned int end = start + n - 1;
+  const unsigned int first = start >> BSTR_BITS_PER_INT_SHIFT;
+  const unsigned int last = end >> BSTR_BITS_PER_INT_SHIFT;
+  BSTR_KERNEL_BOUND_CHECK(v, last)
+  const unsigned int head = ~0U << (start & BSTR_BITS_PER_INT_MASK);
+  const unsigned int tail =
+      ~0U >> (BSTR_BITS_PER_INT_MASK - (end & BSTR_BITS_PER_INT_MASK));
+  if (first == last)
+    return __builtin_popcount(v.words[first] & head & tail);
+  return __builtin_popcount(v.words[first] & head) +
+         bstr_kernel_popcnt(
+             bstr_kernel_view(&v.words[first + 1], last - first - 1)) +
+         __builtin_popcount(v.words[last] & tail);
+}
+
+/**
+ * @brief Start positions inside word i at which the pattern of k bits matches.
+ * Bit s of the result stands for bit index i * BSTR_BITS_PER_INT + s. All
+ * candidates are tested at once, one pattern bit per step, so the loop ends as
+ * soon as no candidate is left. On random data that happens after a handful of
+ * steps no matter how long the pattern is.
+ *
+ * @param candidates Start positions worth testing. The caller masks out those
+ * for which the pattern would run past the end.
+ */
+static inline unsigned int
+_bstr_kernel_pattern_word(const bstr_view_t v, const unsigned int *pattern,
+                          unsigned int k, unsigned int i,
+                          unsigned int candidates) {
+  for (unsigned int j = 0; j < k && candidates != 0; j++) {
+    const unsigned int word = i + (j >> BSTR_BITS_PER_INT_SHIFT);
+    const unsigned int shift = j & BSTR_BITS_PER_INT_MASK;
+    unsigned int text = v.words[word] >> shift;
+    if (shift != 0 && word + 1 < v.nwords)
+      text |= v.words[word + 1] << (BSTR_BITS_PER_INT - shift);
+    const unsigned int want =
+        (pattern[j >> BSTR_BITS_PER_INT_SHIFT] >> shift) & 1U ? 0U : ~0U;
+    candidates &= text ^ want;
+  }
+  return candidates;
+}
+
+/**
+ * @brief Start positions inside word i which lie in [first, last].
+ */
+static inline unsigned int _bstr_kernel_pattern_range(unsigned int i,
+                                                      unsigned int first,
+                                                      unsigned int last) {
+  unsigned int range = ~0U;
+  if (i == first >> BSTR_BITS_PER_INT_SHIFT)
+    range &= ~0U << (first & BSTR_BITS_PER_INT_MASK);
+  if (i == last >> BSTR_BITS_PER_INT_SHIFT)
+    range &= ~0U >> (BSTR_BITS_PER_INT_MASK - (last & BSTR_BITS_PER_INT_MASK));
+  return range;
+}
+
+/**
+ * @brief Index of the first occurrence at or after offset of the first k bits
+ * of pattern, at any bit offset. Occurrences may overlap.
+ *
+ * @return int The bit index or -1 when there is none.
+ */
+static inline int bstr_kernel_find_pattern(const bstr_view_t v,
+                                           const unsigned int *pattern,
+                                           unsigned int k,
+                                           unsigned int offset) {
+  const unsigned int nbits = v.nwords << BSTR_BITS_PER_INT_SHIFT;
+  if (k == 0 || k > nbits || offset > nbits - k)
+    return -1;
+  const unsigned int last = nbits - k;
+  const unsigned int end = last >> BSTR_BITS_PER_INT_SHIFT;
+  for (unsigned int i = offset >> BSTR_BITS_PER_INT_SHIFT; i <= end; i++) {
+    /* Skip ahead to the next word in which the first 16 bits can start. */
+    if (k >= 16 && end - i >= BSTR_KERNEL_DISPATCH_MIN_WORDS)
+      i += (unsigned int)bstr_dispatch_find_prefix16(&v.words[i], end - i,
+                                                     pattern[0]);
+    const unsigned int found = _bstr_kernel_pattern_word(
+        v, pattern, k, i, _bstr_kernel_pattern_range(i, offset, last));
+    if (found != 0)
+      return (int)((i << BSTR_BITS_PER_INT_SHIFT) + __builtin_ctz(found));
+  }
+  return -1;
+}
+
+/**
+ * @brief Collect every occurrence of the first k bits of pattern, overlapping
+ * ones included, in ascending order. At most max_matches are written.
+ *
+ * @return unsigned int How many occurrences there are in total.
+ */
+static inline unsigned int
+bstr_kernel_find_all_pattern(const bstr_view_t v, const unsigned int *pattern,
+                             unsigned int k, unsigned int *matches,
+                             unsigned int max_matches) {
+  const unsigned int nbits = v.nwords << BSTR_BITS_PER_INT_SHIFT;
+  if (k == 0 || k > nbits)
+    return 0;
+  const unsigned int last = nbits - k;
+  const unsigned int end = last >> BSTR_BITS_PER_INT_SHIFT;
+  unsigned int count = 0;
+  for (unsigned int i = 0; i <= end; i++) {
+    if (k >= 16 && end - i >= BSTR_KERNEL_DISPATCH_MIN_WORDS)
+      i += (unsigned int)bstr_dispatch_find_prefix16(&v.words[i], end - i,
+                                                     pattern[0]);
+    unsigned int found = _bstr_kernel_pattern_word(
+        v, pattern, k, i, _bstr_kernel_pattern_range(i, 0, last));
+    for (; found != 0; found &= found - 1) {
+      if (count < max_matches)
+        matches[count] =
+            (i << BSTR_BITS_PER_INT_SHIFT) + (unsigned int)__builtin_ctz(found);
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Start positions inside the word lo at which n <= BSTR_BITS_PER_INT
+ * set bits begin, hi being the word after it. Each step doubles the length of
+ * the runs the bits stand for, so it takes log2(n) shifts.
+ */
+static inline unsigned int _bstr_kernel_run_starts(unsigned int lo,
+                                                   unsigned int hi,
+                                                   unsigned int n) {
+  unsigned int len = 1;
+  while (len * 2 <= n) {
+    lo &= (lo >> len) | (hi << (BSTR_BITS_PER_INT - len));
+    hi &= hi >> len;
+    len *= 2;
+  }
+  if (n > len) {
+    const unsigned int shift = n - len;
+    lo &= (lo >> shift) | (hi << (BSTR_BITS_PER_INT - shift));
+  }
+  return lo;
+}
+
+/**
+ * @brief How many bits from start on, at most n, are set in (word ^ invert).
+ * start + n has to be <= the bit capacity.
+ */
+static inline unsigned int _bstr_kernel_run_length(const bstr_view_t v,
+                                                   unsigned int start,
+                                                   unsigned int n,
+                                                   unsigned int invert) {
+  unsigned int len = 0;
+  while (len < n) {
+    const unsigned int pos = start + len;
+    const unsigned int off = pos & BSTR_BITS_PER_INT_MASK;
+    const unsigned int other =
+        ~(v.words[pos >> BSTR_BITS_PER_INT_SHIFT] ^ invert) >> off;
+    if (other != 0) {
+      len += (unsigned int)__builtin_ctz(other);
+      break;
+    }
+    len += BSTR_BITS_PER_INT - off;
+  }
+  return len < n ? len : n;
+}
+
+/**
+ * @brief First start in [from, limit), a multiple of align, of a run of n bits
+ * which are all set (invert is 0) or all unset (invert is ~0U). The run has to
+ * end inside the bitstring. Words without a single bit of the wanted kind are
+ * skipped with bstr_kernel_next(), so full or empty stretches go by a word (or
+ * a vector) at a time. Runs that fit into a word are found with shifts on two
+ * words at once, longer ones by hopping from run to run.
+ *
+ * @param align A power of two, 0 and 1 mean no alignment.
+ * @return int The start or -1 when there is none.
+ */
+static inline int bstr_kernel_find_run(const bstr_view_t v, unsigned int n,
+                                       unsigned int align, unsigned int from,
+                                       unsigned int limit,
+                                       unsigned int invert) {
+  const unsigned int nbits = v.nwords << BSTR_BITS_PER_INT_SHIFT;
+  const unsigned int mask = align > 1 ? align - 1 : 0;
+  if (n == 0 || n > nbits)
+    return -1;
+  if (limit > nbits - n + 1)
+    limit = nbits - n + 1;
+  if (from >= limit)
+    return -1;
+  if (n <= BSTR_BITS_PER_INT) {
+    /* Bit s of aligned is set when s is a multiple of align. */
+    unsigned int aligned = 1U;
+    for (unsigned int step = mask + 1; step < BSTR_BITS_PER_INT; step *= 2)
+      aligned |= aligned << step;
+    const unsigned int end = (limit - 1) >> BSTR_BITS_PER_INT_SHIFT;
+    for (unsigned int i = from >> BSTR_BITS_PER_INT_SHIFT; i <= end; i++) {
+      const unsigned int lo = v.words[i] ^ invert;
+      if (lo == 0) {
+        const int next =
+            bstr_kernel_next(v, (i + 1) << BSTR_BITS_PER_INT_SHIFT, invert);
+        if (next < 0)
+          return -1;
+        i = ((unsigned int)next >> BSTR_BITS_PER_INT_SHIFT) - 1;
+        continue;
+      }
+      if (((i << BSTR_BITS_PER_INT_SHIFT) & mask) != 0)
+        continue;
+      const unsigned int hi = i + 1 < v.nwords ? v.words[i + 1] ^ invert : 0U;
+      const unsigned int found = _bstr_kernel_run_starts(lo, hi, n) & aligned &
+                                 _bstr_kernel_pattern_range(i, from, limit - 1);
+      if (found != 0)
+        return (int)((i << BSTR_BITS_PER_INT_SHIFT) + __builtin_ctz(found));
+    }
+    return -1;
+  }
+  unsigned int start = from;
+  for (;;) {
+    /* Move to the next bit of the wanted kind, then up to the alignment. */
+    const int next = bstr_kernel_next(v, start, invert);
+    if (next < 0 || (unsigned int)next >= limit)
+      return -1;
+    start = ((unsigned int)next + mask) & ~mask;
+    if (start < (unsigned int)next || start >= limit)
+      return -1;
+    /* The first bit of the other kind ends the run. */
+    const unsigned int len = _bstr_kernel_run_length(v, start, n, invert);
+    if (len == n)
+      return (int)start;
+    start += len + 1;
+  }
+}
+
+/**
+ * @brief Like bstr_kernel_find_run(), but searches the whole bitstring,
+ * beginning at hint and wrapping around to 0.
+ */
+static inline int bstr_kernel_find_run_from(const bstr_view_t v,
+                                            unsigned int n, unsigned int align,
+                                            unsigned int hint,
+                                            unsigned int invert) {
+  const int found = bstr_kernel_find_run(v, n, align, hint, UINT_MAX, invert);
+  if (found >= 0 || hint == 0)
+    return found;
+  return bstr_kernel_find_run(v, n, align, 0, hint, invert);
+}
+
+/**
+ * @brief 128 bit content hash, see bstr_dispatch_hash128().
+ */
+static inline void bstr_kernel_hash128(const bstr_view_t v, uint64_t hash[2]) {
+  bstr_dispatch_hash128(v.words, v.nwords, hash);
+}
+
+/**
+ * @brief Append one character per bit to str. str needs room for
+ * strlen(str) + v.nwords * BSTR_BITS_PER_INT + 1 characters.
+ */
+static inline void bstr_kernel_to_string(const bstr_view_t v, char *str) {
+  str += strlen(str);
+  for (unsigned int i = 0; i < v.nwords; i++) {
+    const unsigned int word = v.words[i];
+    for (unsigned int bit = 0; bit < BSTR_BITS_PER_INT; bit++)
+      *str++ = ((word >> bit) & 1U) ? '1' : '0';
+  }
+  *str = '\0';
+}
+
+/**
+ * @brief Print the address and the bits of one unsigned int, most significant
+ * bit first and grouped by byte. str needs BSTR_BINDUMP_SIZE characters.
+ */
+static inline void bstr_kernel_bindump(const bstr_view_t v, char *str,
+                                       const unsigned int line) {
+  BSTR_KERNEL_BOUND_CHECK(v, line)
+  const unsigned int word = v.words[line];
+  int len = snprintf(str, BSTR_BINDUMP_SIZE, "%p:", (void *)&v.words[line]);
+  if (len < 0)
+    return;
+  char *out = str + len;
+  for (unsigned int bit = BSTR_BITS_PER_INT; bit > 0; bit--) {
+    if (bit % CHAR_BIT == 0)
+      *out++ = ' ';
+    *out++ = ((word >> (bit - 1)) & 1U) ? '1' : '0';
+  }
+  *out = '\0';
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
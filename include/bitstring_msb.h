@@ -0,0 +1,140 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * MSB first access for protocol parsing. These functions see the memory of a
+ * bitstring as a byte stream: bit 0 is the most significant bit of the first
+ * byte, bit 8 the most significant bit of the second byte and so on, on any
+ * host byte order. Fields read and write the first bit as their most
+ * significant one, the way network and radio protocols define them.
+ *
+ * Received bytes can be parsed in place, e.g. through bstr_wrap(), without a
+ * byte swap or bit reverse pass. Every bit maps to one bit of the native order
+ * of bitstring.h, so the writes go through bstr_set(), bstr_clr() and
+ * bstr_set_field() and the searches through the dispatched word scans.
+ */
+
+#ifndef BSTR_BITSTRING_MSB_H
+#define BSTR_BITSTRING_MSB_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Check if a bit is set.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param bit MSB first index of the bit, < get_bit_capacity().
+ */
+bool bstr_msb_get(const bstr_bitstr_t *const bstr, unsigned int bit)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Set a bit.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param bit MSB first index of the bit, < get_bit_capacity().
+ */
+void bstr_msb_set(bstr_bitstr_t *const bstr, unsigned int bit)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Clear a bit.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param bit MSB first index of the bit, < get_bit_capacity().
+ */
+void bstr_msb_clr(bstr_bitstr_t *const bstr, unsigned int bit)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Read an unsigned field of width bits. Bit offset is the most
+ * significant bit of the result.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset MSB first index of the first bit of the field.
+ * @param width Width of the field in bits, 1 to 64. offset + width has to be
+ * <= get_bit_capacity().
+ */
+uint64_t bstr_msb_get_field(const bstr_bitstr_t *const bstr,
+                            unsigned int offset, unsigned int width)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Write the low width bits of value, its most significant one at bit
+ * offset.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset MSB first index of the first bit of the field.
+ * @param width Width of the field in bits, 1 to 64. offset + width has to be
+ * <= get_bit_capacity().
+ * @param value The other bits of value are ignored.
+ */
+void bstr_msb_set_field(bstr_bitstr_t *const bstr, unsigned int offset,
+                        unsigned int width, uint64_t value)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Find the next set bit in MSB first order.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset MSB first index to start at.
+ * @return int MSB first index of the bit or -1 when there is none.
+ */
+int bstr_msb_next_set_bit(const bstr_bitstr_t *const bstr, unsigned int offset)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Find the next unset bit in MSB first order.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param offset MSB first index to start at.
+ * @return int MSB first index of the bit or -1 when there is none.
+ */
+int bstr_msb_next_unset_bit(const bstr_bitstr_t *const bstr,
+                            unsigned int offset) __attribute__((nonnull(1)));
+
+/**
+ * @brief Find the first occurrence of a bit pattern in MSB first order, e.g. a
+ * sync word of a frame.
+ *
+ * @param bstr Pointer to bitstring object to search in.
+ * @param pattern The pattern in its low width bits, the first one most
+ * significant like bstr_msb_get_field() returns it. Other bits are ignored.
+ * @param width Length of the pattern in bits, 1 to 64.
+ * @param offset MSB first index where the search starts.
+ * @return int MSB first index of the first bit of the first occurrence at or
+ * after offset or -1 when there is none.
+ */
+int bstr_msb_find_pattern(const bstr_bitstr_t *const bstr, uint64_t pattern,
+                          unsigned int width, unsigned int offset)
+    __attribute__((nonnull(1)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
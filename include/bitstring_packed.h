@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Arrays of fixed width unsigned integers, 1 to 32 bits each, packed back to
+ * back into a bitstring. Element i occupies bits i * width to
+ * (i + 1) * width - 1, so an array of 5 bit counters takes 5/8 of the memory
+ * of a byte array.
+ *
+ * Single elements are read and written with bstr_get_field() and
+ * bstr_set_field(). bstr_packed_unpack() converts whole ranges with the
+ * dispatched gather kernel of include/bitstring_dispatch.h.
+ */
+
+#ifndef BSTR_BITSTRING_PACKED_H
+#define BSTR_BITSTRING_PACKED_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A packed array. Create it with bstr_packed_create() and delete it
+ * with bstr_packed_delete().
+ *
+ */
+typedef struct bstr_packed_array_t bstr_packed_array_t;
+
+/**
+ * @brief Creates a packed array with all elements 0.
+ *
+ * @param count How many elements the array holds, > 0.
+ * @param width Width of an element in bits, 1 to 32.
+ * @return bstr_packed_array_t* The array or NULL when malloc failed.
+ */
+bstr_packed_array_t *bstr_packed_create(unsigned int count,
+                                        unsigned int width)
+    __attribute__((warn_unused_result));
+
+/**
+ * @brief Deletes a packed array.
+ *
+ * @param array Pointer to the packed array.
+ */
+void bstr_packed_delete(bstr_packed_array_t *array)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief How many elements the array holds.
+ *
+ * @param array Pointer to the packed array.
+ */
+unsigned int bstr_packed_count(const bstr_packed_array_t *const array)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Width of an element in bits.
+ *
+ * @param array Pointer to the packed array.
+ */
+unsigned int bstr_packed_width(const bstr_packed_array_t *const array)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief The bitstring the elements are packed into. Its bits past the last
+ * element stay 0.
+ *
+ * @param array Pointer to the packed array.
+ * @return const bstr_bitstr_t* Never resize or delete it.
+ */
+const bstr_bitstr_t *bstr_packed_bitstr(const bstr_packed_array_t *const array)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Reads one element.
+ *
+ * @param array Pointer to the packed array.
+ * @param index Has to be < bstr_packed_count().
+ */
+uint32_t bstr_packed_get(const bstr_packed_array_t *const array,
+                         unsigned int index) __attribute__((nonnull(1)));
+
+/**
+ * @brief Writes one element.
+ *
+ * @param array Pointer to the packed array.
+ * @param index Has to be < bstr_packed_count().
+ * @param value Its low width bits are written, the others are ignored.
+ */
+void bstr_packed_set(bstr_packed_array_t *const array, unsigned int index,
+                     uint32_t value) __attribute__((nonnull(1)));
+
+/**
+ * @brief Reads n elements starting at first into out.
+ *
+ * @param array Pointer to the packed array.
+ * @param first Index of the first element. first + n has to be <=
+ * bstr_packed_count().
+ * @param n How many elements to read.
+ * @param out Receives n values.
+ */
+void bstr_packed_unpack(const bstr_packed_array_t *const array,
+                        unsigned int first, unsigned int n, uint32_t *out)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Writes n elements starting at first from in. Whole words are
+ * written at once, only the first and the last word are merged.
+ *
+ * @param array Pointer to the packed array.
+ * @param first Index of the first element. first + n has to be <=
+ * bstr_packed_count().
+ * @param n How many elements to write.
+ * @param in The values. Their low width bits are written, the others are
+ * ignored.
+ */
+void bstr_packed_pack(bstr_packed_array_t *const array, unsigned int first,
+                      unsigned int n, const uint32_t *in)
+    __attribute__((nonnull(1)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
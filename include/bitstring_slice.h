@@ -0,0 +1,283 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Read only slices of bits in memory the caller owns, e.g. a bitmap inside a
+ * network or shared memory buffer. A slice is a word pointer, a bit offset and
+ * a length. Neither making a slice nor slicing it again allocates or copies.
+ *
+ * bstr_view_t of bitstring_kernel.h covers whole words, bstr_wrap() turns such
+ * words into a bitstring object for the full API. A slice may start and end
+ * inside a word. Its queries run on the kernels with the bit offset added,
+ * the words around the slice are read but ignored.
+ */
+
+#ifndef BSTR_BITSTRING_SLICE_H
+#define BSTR_BITSTRING_SLICE_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief nbits bits starting at bit offset of words. Make it with
+ * bstr_slice(), bstr_slice_of() or bstr_slice_sub(), offset is < the bits of
+ * an unsigned int then.
+ *
+ */
+typedef struct bstr_slice_t {
+  const unsigned int *words;
+  unsigned int offset;
+  unsigned int nbits;
+} bstr_slice_t;
+
+/**
+ * @brief A slice over memory the caller owns.
+ *
+ * @param words Pointer to an unsigned int. A byte buffer has to be aligned for
+ * unsigned int, put the bytes before its first whole word into offset.
+ * @param offset Index of the first bit of the slice, counted from bit 0 of
+ * words.
+ * @param nbits Number of bits.
+ */
+bstr_slice_t bstr_slice(const unsigned int *words, unsigned int offset,
+                        unsigned int nbits);
+
+/**
+ * @brief A slice of n bits of a bitstring, starting at bit start. It is valid
+ * as long as the bitstring is not resized or deleted.
+ *
+ * @param bstr Pointer to bitstring object.
+ * @param start Index of the first bit.
+ * @param n Number of bits. start + n has to be <= get_bit_capacity().
+ */
+bstr_slice_t bstr_slice_of(const bstr_bitstr_t *const bstr, unsigned int start,
+                           unsigned int n) __attribute__((nonnull(1)));
+
+/**
+ * @brief A slice of n bits of a slice, starting at its bit start.
+ *
+ * @param slice The slice.
+ * @param start Index of the first bit inside slice.
+ * @param n Number of bits. start + n has to be <= bstr_slice_bits(slice).
+ */
+bstr_slice_t bstr_slice_sub(bstr_slice_t slice, unsigned int start,
+                            unsigned int n);
+
+/**
+ * @brief Number of bits of a slice.
+ */
+unsigned int bstr_slice_bits(bstr_slice_t slice);
+
+/**
+ * @brief Check if a bit of a slice is set.
+ *
+ * @param slice The slice.
+ * @param bit Index of the bit inside slice.
+ */
+bool bstr_slice_get(bstr_slice_t slice, unsigned int bit);
+
+/**
+ * @brief Read a packed unsigned field of width bits, 1 to 64, like
+ * bstr_get_field().
+ *
+ * @param slice The slice.
+ * @param offset Index of the least significant bit of the field inside slice.
+ * @param width Width of the field in bits. offset + width has to be <=
+ * bstr_slice_bits(slice).
+ */
+uint64_t bstr_slice_get_field(bstr_slice_t slice, unsigned int offset,
+                              unsigned int width);
+
+/**
+ * @brief Count how many bits of a slice are set.
+ */
+int bstr_slice_popcnt(bstr_slice_t slice);
+
+/**
+ * @brief Find the first set bit of a slice.
+ *
+ * @return int Index inside slice or -1 when there was none.
+ */
+int bstr_slice_ffs(bstr_slice_t slice);
+
+/**
+ * @brief Find the first unset bit of a slice.
+ *
+ * @return int Index inside slice or -1 when there was none.
+ */
+int bstr_slice_ffus(bstr_slice_t slice);
+
+/**
+ * @brief Find the next set bit at or after offset.
+ *
+ * @return int Index inside slice or -1 when there was none.
+ */
+int bstr_slice_next_set_bit(bstr_slice_t slice, unsigned int offset);
+
+/**
+ * @brief Find the next unset bit at or after offset.
+ *
+ * @return int Index inside slice or -1 when there was none.
+ */
+int bstr_slice_next_unset_bit(bstr_slice_t slice, unsigned int offset);
+
+/**
+ * @brief Check whether no bit of a slice is set.
+ */
+bool bstr_slice_is_empty(bstr_slice_t slice);
+
+/**
+ * @brief Check whether two slices have the same length and bits. Their bit
+ * offsets may differ.
+ */
+bool bstr_slice_equals(bstr_slice_t a, bstr_slice_t b);
+
+/**
+ * @brief Count trailing zeros, starting at bit 0 of a slice.
+ *
+ * @return int Count of trailing zeros, bstr_slice_bits() when no bit is set.
+ */
+int bstr_slice_ctz(bstr_slice_t slice);
+
+/**
+ * @brief Count leading zeros, starting at the last bit of a slice.
+ *
+ * @return int Count of leading zeros, bstr_slice_bits() when no bit is set.
+ */
+int bstr_slice_clz(bstr_slice_t slice);
+
+/**
+ * @brief Count how many of n bits starting at bit start are set, like
+ * bstr_popcnt_range().
+ *
+ * @param slice The slice.
+ * @param start Index of the first bit inside slice.
+ * @param n Number of bits. start + n has to be <= bstr_slice_bits(slice).
+ */
+int bstr_slice_popcnt_range(bstr_slice_t slice, unsigned int start,
+                            unsigned int n);
+
+/**
+ * @brief Check whether two slices have at least one set bit in common. Stops
+ * at the first common bit.
+ */
+bool bstr_slice_intersects(bstr_slice_t a, bstr_slice_t b);
+
+/**
+ * @brief Check whether every set bit of a is also set in b. Bits of a beyond
+ * the length of b have to be unset.
+ */
+bool bstr_slice_is_subset(bstr_slice_t a, bstr_slice_t b);
+
+/**
+ * @brief Lexicographic three way compare, in the order of bstr_compare().
+ *
+ * @return int < 0, 0 or > 0 when a is smaller, equal or greater than b.
+ */
+int bstr_slice_compare(bstr_slice_t a, bstr_slice_t b);
+
+/**
+ * @brief 64 bit hash of the bits and the length of a slice. It is the
+ * bstr_hash() of a bitstring that holds the bits of the slice from bit 0 and
+ * no other set bit, so it does not depend on the bit offset.
+ */
+uint64_t bstr_slice_hash(bstr_slice_t slice);
+
+/**
+ * @brief 128 bit version of bstr_slice_hash(). hash[0] is equal to
+ * bstr_slice_hash().
+ *
+ * @param slice The slice.
+ * @param hash Receives the hash.
+ */
+void bstr_slice_hash128(bstr_slice_t slice, uint64_t hash[2])
+    __attribute__((nonnull(2)));
+
+/**
+ * @brief Find the first occurrence of a bit pattern at or after offset, like
+ * bstr_find_pattern(). The occurrence lies inside the slice.
+ *
+ * @param slice The slice to search in.
+ * @param pattern Pointer to bitstring object holding the pattern in its first
+ * pattern_bits bits, e.g. from bstr_wrap_const().
+ * @param pattern_bits Length of the pattern, 1 up to
+ * bstr_get_bit_capacity(pattern).
+ * @param offset Where to begin the search.
+ * @return int Index inside slice of the first bit of the occurrence or -1.
+ */
+int bstr_slice_find_pattern(bstr_slice_t slice,
+                            const bstr_bitstr_t *const pattern,
+                            unsigned int pattern_bits, unsigned int offset)
+    __attribute__((nonnull(2)));
+
+/**
+ * @brief Find the first run of at least n unset bits, like
+ * bstr_find_zero_run(). The search begins at hint and wraps around to 0.
+ *
+ * @param slice The slice.
+ * @param n Length of the run, > 0.
+ * @param align The run starts at a multiple of align counted from bit 0 of
+ * the slice, a power of two. 0 and 1 mean no alignment.
+ * @param hint Where to begin the search.
+ * @return int Index inside slice of the first bit of the run or -1.
+ */
+int bstr_slice_find_zero_run(bstr_slice_t slice, unsigned int n,
+                             unsigned int align, unsigned int hint);
+
+/**
+ * @brief Find the first run of at least n set bits. Works like
+ * bstr_slice_find_zero_run().
+ *
+ * @param slice The slice.
+ * @param n Length of the run, > 0.
+ * @param align Power of two the run starts at a multiple of, 0 and 1 mean no
+ * alignment.
+ * @param hint Where to begin the search.
+ * @return int Index inside slice of the first bit of the run or -1.
+ */
+int bstr_slice_find_one_run(bstr_slice_t slice, unsigned int n,
+                            unsigned int align, unsigned int hint);
+
+/**
+ * @brief Size of the string bstr_slice_to_string() writes, the \0 included.
+ */
+size_t bstr_slice_to_string_size(bstr_slice_t slice);
+
+/**
+ * @brief Write one character '0' or '1' per bit, bit 0 first, like
+ * bstr_to_string(), and a \0.
+ *
+ * @param slice The slice.
+ * @param str Pointer to at least bstr_slice_to_string_size() characters.
+ */
+void bstr_slice_to_string(bstr_slice_t slice, char *const str)
+    __attribute__((nonnull(2)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
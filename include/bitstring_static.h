@@ -26,37 +26,51 @@ SOFTWARE.
 #define BSTR_BITSTRING_STATIC_H
 
 #include "bitstring_common.h"
+#include "bitstring_kernel.h"
 #include "limits.h"
 #include "stdbool.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
 
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-#include "assert.h"
-#define BSTR_STATIC_BOUND_CHECK(size, bst, ptr)                                \
-  assert(!_bstr##size##_is_ptr_out_of_bounds(bst, ptr));
+/**
+ * @brief Macro to get the type name for a sized bitstring.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define bstr_static_t(size) bstr_bitstr##size##_t
+
+/**
+ * @brief Macro to get the kernel view of a sized bitstring. The size is a
+ * compile time constant, so every kernel gets specialized on it.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst Pointer to the bitstring object.
+ */
+#define BSTR_STATIC_VIEW(size, bst)                                            \
+  bstr_kernel_view((unsigned int *)(bst)->_bits, bstrs_get_capacity(size))
 
+/**
+ * @brief Macro to declare the out of bounds check for a sized bitstring. The
+ * kernels check bounds themselves, this is only kept for code calling
+ * _bstr<size>_is_ptr_out_of_bounds() directly.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
 #define BSTR_STATIC_DECLARE_BOUND_CHECK(size)                                  \
-  __attribute__((nonnull(1, 2))) bool _bstr##size##_is_ptr_out_of_bounds(      \
-      const bstr_bitstr##size##_t *const bstr,                                 \
-      const unsigned int *const ptr) {                                         \
-    if (bstr->_bits + bstr##size##_get_capacity <= ptr || bstr->_bits > ptr)   \
+  static inline __attribute__((nonnull(1, 2))) bool                            \
+      _bstr##size##_is_ptr_out_of_bounds(                                      \
+          const bstr_bitstr##size##_t *const bstr,                             \
+          const unsigned int *const ptr) {                                     \
+    if (bstr->_bits + bstrs_get_capacity(size) <= ptr || bstr->_bits > ptr)    \
       return true;                                                             \
     return false;                                                              \
   }
 #else
-#define BSTR_STATIC_BOUND_CHECK(size, bst, ptr)
 #define BSTR_STATIC_DECLARE_BOUND_CHECK(size)
 #endif
 
-/**
- * @brief Macro to get the type name for a sized bitstring.
- *
- * @param size How many unsigned ints this bitstring contains.
- */
-#define bstr_static_t(size) bstr_bitstr##size##_t
-
 /**
  * @brief Macro to declare the sized bitstring struct.
  *
@@ -73,16 +87,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_TO_STRING(size)                                    \
-  __attribute__((nonnull(1, 2))) void bstr##size##_to_string(                  \
+  static inline __attribute__((nonnull(1, 2))) void bstr##size##_to_string(    \
       const bstr_bitstr##size##_t *const bstr, char *const str) {              \
-    const unsigned int len = bstrs_get_bit_capacity(size);                     \
-    for (unsigned int i = 0; i != len; i++) {                                  \
-      if (bstr##size##_get(bstr, i)) {                                         \
-        strncat(str, "1", 2);                                                  \
-      } else {                                                                 \
-        strncat(str, "0", 2);                                                  \
-      }                                                                        \
-    }                                                                          \
+    bstr_kernel_to_string(BSTR_STATIC_VIEW(size, bstr), str);                  \
   }
 
 /**
@@ -91,34 +98,23 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_BINDUMP(size)                                      \
-  __attribute__((nonnull(1, 2))) void bstr##size##_bindump(                    \
+  static inline __attribute__((nonnull(1, 2))) void bstr##size##_bindump(      \
       const bstr_bitstr##size##_t *const bstr, char *const str,                \
       const unsigned int line) {                                               \
-    snprintf(str, BSTR_BINDUMP_SIZE, "%p:", &(bstr->_bits[line]));             \
-    const unsigned int num_bits = sizeof(unsigned int) * CHAR_BIT;             \
-    for (unsigned int bit = num_bits; bit > 0; bit--) {                        \
-      unsigned int bitval = (bstr->_bits[line] >> (bit - 1)) & 1U;             \
-      if (bit % CHAR_BIT == 0)                                                 \
-        strncat(str, " ", 2);                                                  \
-      if (bitval > 0) {                                                        \
-        strncat(str, "1", 2);                                                  \
-      } else {                                                                 \
-        strncat(str, "0", 2);                                                  \
-      }                                                                        \
-    }                                                                          \
+    bstr_kernel_bindump(BSTR_STATIC_VIEW(size, bstr), str, line);              \
   }
 
 /**
  * @brief Macro to declare a _get_int_for_bit_index function for a sized
- * bitstring.
+ * bitstring. Not needed by any other function anymore, only kept for code
+ * calling it directly.
  *
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE__GET_INT_FOR_BIT_INDEX(size)                       \
   static inline unsigned int *_bstr##size##_get_int_for_bit_index(             \
       const bstr_bitstr##size##_t *const bstr, unsigned int bit) {             \
-    return (unsigned int *)(bstr->_bits +                                      \
-                            (bit / (sizeof(unsigned int) * CHAR_BIT)));        \
+    return (unsigned int *)(bstr->_bits + (bit >> BSTR_BITS_PER_INT_SHIFT));   \
   }
 
 /**
@@ -127,12 +123,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_SET(size)                                          \
-  __attribute__((nonnull(1))) void bstr##size##_set(                           \
+  static inline __attribute__((nonnull(1))) void bstr##size##_set(             \
       bstr_bitstr##size##_t *const bstr, unsigned int bit) {                   \
-    unsigned int *target = _bstr##size##_get_int_for_bit_index(bstr, bit);     \
-    BSTR_STATIC_BOUND_CHECK(size, bstr, target)                                \
-    unsigned int bit_to_set = bit % ((sizeof(unsigned int)) * CHAR_BIT);       \
-    *target |= 1 << bit_to_set;                                                \
+    bstr_kernel_set(BSTR_STATIC_VIEW(size, bstr), bit);                        \
   }
 
 /**
@@ -141,13 +134,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_SET_ALL(size)                                      \
-  __attribute__((nonnull(1))) void bstr##size##_set_all(                       \
+  static inline __attribute__((nonnull(1))) void bstr##size##_set_all(         \
       bstr_bitstr##size##_t *const bstr, bool on) {                            \
-    unsigned char value = 0;                                                   \
-    if (on)                                                                    \
-      value = UCHAR_MAX;                                                       \
-    memset(bstr->_bits, value,                                                 \
-           bstrs_get_capacity(size) * sizeof(unsigned int));                   \
+    bstr_kernel_set_all(BSTR_STATIC_VIEW(size, bstr), on);                     \
   }
 
 /**
@@ -156,12 +145,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_CLR(size)                                          \
-  __attribute__((nonnull(1))) void bstr##size##_clr(                           \
+  static inline __attribute__((nonnull(1))) void bstr##size##_clr(             \
       bstr_bitstr##size##_t *const bstr, unsigned int bit) {                   \
-    unsigned int bit_to_clear = bit % (sizeof(unsigned int) * CHAR_BIT);       \
-    unsigned int *target = _bstr##size##_get_int_for_bit_index(bstr, bit);     \
-    BSTR_STATIC_BOUND_CHECK(size, bstr, target)                                \
-    *target &= ~(1 << bit_to_clear);                                           \
+    bstr_kernel_clr(BSTR_STATIC_VIEW(size, bstr), bit);                        \
   }
 
 /**
@@ -170,17 +156,27 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_GET(size)                                          \
-  __attribute__((nonnull(1))) bool bstr##size##_get(                           \
+  static inline __attribute__((nonnull(1))) bool bstr##size##_get(             \
       const bstr_bitstr##size##_t *const bstr, unsigned int bit) {             \
-    unsigned int *target = _bstr##size##_get_int_for_bit_index(bstr, bit);     \
-    unsigned int bit_to_get = bit % (sizeof(unsigned int) * CHAR_BIT);         \
-    unsigned int result = ((*target) >> bit_to_get) & 1U;                      \
-    BSTR_STATIC_BOUND_CHECK(size, bstr, target)                                \
-    if (result > 0) {                                                          \
-      return true;                                                             \
-    } else {                                                                   \
-      return false;                                                            \
-    }                                                                          \
+    return bstr_kernel_get(BSTR_STATIC_VIEW(size, bstr), bit);                 \
+  }
+
+/**
+ * @brief Macro to declare the _get_field and _set_field functions for a sized
+ * bitstring.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define BSTR_STATIC_DECLARE_FIELDS(size)                                       \
+  static inline __attribute__((nonnull(1))) uint64_t bstr##size##_get_field(   \
+      const bstr_bitstr##size##_t *const bstr, unsigned int offset,            \
+      unsigned int width) {                                                    \
+    return bstr_kernel_get_field(BSTR_STATIC_VIEW(size, bstr), offset, width); \
+  }                                                                            \
+  static inline __attribute__((nonnull(1))) void bstr##size##_set_field(       \
+      bstr_bitstr##size##_t *const bstr, unsigned int offset,                  \
+      unsigned int width, uint64_t value) {                                    \
+    bstr_kernel_set_field(BSTR_STATIC_VIEW(size, bstr), offset, width, value); \
   }
 
 /**
@@ -189,16 +185,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_FFS(size)                                          \
-  __attribute__((nonnull(1))) int bstr##size##_ffs(                            \
+  static inline __attribute__((nonnull(1))) int bstr##size##_ffs(              \
       const bstr_bitstr##size##_t *const bstr) {                               \
-    unsigned int offset = 0;                                                   \
-    for (unsigned int i = 0; i < bstrs_get_capacity(size); i++) {              \
-      int result = ffs(bstr->_bits[i]);                                        \
-      if (result > 0)                                                          \
-        return (offset * sizeof(unsigned int) * CHAR_BIT) + result - 1;        \
-      offset++;                                                                \
-    }                                                                          \
-    return -1;                                                                 \
+    return bstr_kernel_ffs(BSTR_STATIC_VIEW(size, bstr));                      \
   }
 
 /**
@@ -207,20 +196,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_FFUS(size)                                         \
-  __attribute__((nonnull(1))) int bstr##size##_ffus(                           \
+  static inline __attribute__((nonnull(1))) int bstr##size##_ffus(             \
       const bstr_bitstr##size##_t *const bstr) {                               \
-    int offset = 0;                                                            \
-    for (unsigned int i = 0; i < bstrs_get_capacity(size); i++) {              \
-      if (bstr->_bits[i] == UINT_MAX) {                                        \
-        offset += sizeof(unsigned int) * CHAR_BIT;                             \
-        continue;                                                              \
-      }                                                                        \
-      for (int bit = offset; bit != bstrs_get_bit_capacity(size); bit++) {     \
-        if (!bstr##size##_get(bstr, bit))                                      \
-          return bit;                                                          \
-      }                                                                        \
-    }                                                                          \
-    return -1;                                                                 \
+    return bstr_kernel_ffus(BSTR_STATIC_VIEW(size, bstr));                     \
   }
 
 /**
@@ -229,18 +207,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_CTZ(size)                                          \
-  __attribute__((nonnull(1))) int bstr##size##_ctz(                            \
+  static inline __attribute__((nonnull(1))) int bstr##size##_ctz(              \
       const bstr_bitstr##size##_t *const bstr) {                               \
-    int result = 0;                                                            \
-    for (unsigned int i = 0; i < bstrs_get_capacity(size); i++) {              \
-      if (bstr->_bits[i] == 0) {                                               \
-        result += sizeof(unsigned int) * CHAR_BIT;                             \
-        continue;                                                              \
-      }                                                                        \
-      result += __builtin_ctz(bstr->_bits[i]);                                 \
-      return result;                                                           \
-    }                                                                          \
-    return result;                                                             \
+    return bstr_kernel_ctz(BSTR_STATIC_VIEW(size, bstr));                      \
   }
 
 /**
@@ -249,20 +218,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_CLZ(size)                                          \
-  __attribute__((nonnull(1))) int bstr##size##_clz(                            \
+  static inline __attribute__((nonnull(1))) int bstr##size##_clz(              \
       const bstr_bitstr##size##_t *const bstr) {                               \
-    unsigned int *baseptr =                                                    \
-        (unsigned int *)bstr->_bits + bstrs_get_capacity(size) - 1;            \
-    int result = 0;                                                            \
-    for (unsigned int *i = baseptr; i >= bstr->_bits; i--) {                   \
-      if (*i == 0) {                                                           \
-        result += sizeof(unsigned int) * CHAR_BIT;                             \
-        continue;                                                              \
-      } else {                                                                 \
-        return result + __builtin_clz(*i);                                     \
-      }                                                                        \
-    }                                                                          \
-    return result;                                                             \
+    return bstr_kernel_clz(BSTR_STATIC_VIEW(size, bstr));                      \
   }
 
 /**
@@ -271,13 +229,37 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_POPCNT(size)                                       \
-  __attribute__((nonnull(1))) int bstr##size##_popcnt(                         \
+  static inline __attribute__((nonnull(1))) int bstr##size##_popcnt(           \
       const bstr_bitstr##size##_t *const bstr) {                               \
-    int popcnt = 0;                                                            \
-    for (unsigned int i = 0; i < bstrs_get_capacity(size); i++) {              \
-      popcnt += __builtin_popcount(bstr->_bits[i]);                            \
+    return bstr_kernel_popcnt(BSTR_STATIC_VIEW(size, bstr));                   \
+  }
+
+/**
+ * @brief Macro to declare the _positional_popcnt and _positional_popcnt_add
+ * functions for a sized bitstring.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define BSTR_STATIC_DECLARE_POSITIONAL_POPCNT(size)                            \
+  static inline __attribute__((nonnull(3))) void                               \
+      bstr##size##_positional_popcnt_add(                                      \
+          const bstr_bitstr##size##_t *const *bsts, unsigned int n,            \
+          uint32_t *counts) {                                                  \
+    const unsigned int *rows[BSTR_KERNEL_ROWS_BATCH];                          \
+    for (unsigned int i = 0; i < n; i += BSTR_KERNEL_ROWS_BATCH) {             \
+      const unsigned int batch =                                               \
+          n - i < BSTR_KERNEL_ROWS_BATCH ? n - i : BSTR_KERNEL_ROWS_BATCH;     \
+      for (unsigned int k = 0; k < batch; k++)                                 \
+        rows[k] = bsts[i + k]->_bits;                                          \
+      bstr_dispatch_positional_popcnt(rows, batch, bstrs_get_capacity(size),   \
+                                      counts);                                 \
     }                                                                          \
-    return popcnt;                                                             \
+  }                                                                            \
+  static inline __attribute__((nonnull(1, 3))) void                            \
+      bstr##size##_positional_popcnt(const bstr_bitstr##size##_t *const *bsts, \
+                                     unsigned int n, uint32_t *counts) {       \
+    memset(counts, 0, bstrs_get_bit_capacity(size) * sizeof(uint32_t));        \
+    bstr##size##_positional_popcnt_add(bsts, n, counts);                       \
   }
 
 /**
@@ -286,13 +268,9 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_NEXT_SET_BIT(size)                                 \
-  __attribute__((nonnull(1))) int bstr##size##_next_set_bit(                   \
+  static inline __attribute__((nonnull(1))) int bstr##size##_next_set_bit(     \
       const bstr_bitstr##size##_t *const bstr, unsigned int offset) {          \
-    for (unsigned int i = offset; i < bstrs_get_bit_capacity(size); i++) {     \
-      if (bstr##size##_get(bstr, i))                                           \
-        return i;                                                              \
-    }                                                                          \
-    return -1;                                                                 \
+    return bstr_kernel_next(BSTR_STATIC_VIEW(size, bstr), offset, 0U);         \
   }
 
 /**
@@ -301,28 +279,154 @@ SOFTWARE.
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_NEXT_UNSET_BIT(size)                               \
-  __attribute__((nonnull(1))) int bstr##size##_next_unset_bit(                 \
+  static inline __attribute__((nonnull(1))) int bstr##size##_next_unset_bit(   \
       const bstr_bitstr##size##_t *const bstr, unsigned int offset) {          \
-    for (unsigned int i = offset; i < bstrs_get_bit_capacity(size); i++) {     \
-      if (!bstr##size##_get(bstr, i))                                          \
-        return i;                                                              \
-    }                                                                          \
-    return -1;                                                                 \
+    return bstr_kernel_next(BSTR_STATIC_VIEW(size, bstr), offset, ~0U);        \
+  }
+
+/**
+ * @brief Macro to declare the range functions _set_range, _clr_range,
+ * _find_zero_run, _find_one_run, _alloc_range and _free_range for a sized
+ * bitstring. See bstr_alloc_range() and friends.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define BSTR_STATIC_DECLARE_RANGES(size)                                       \
+  static inline __attribute__((nonnull(1))) void bstr##size##_set_range(       \
+      bstr_bitstr##size##_t *const bstr, unsigned int start, unsigned int n) { \
+    bstr_kernel_fill_range(BSTR_STATIC_VIEW(size, bstr), start, n, true);      \
+  }                                                                            \
+  static inline __attribute__((nonnull(1))) void bstr##size##_clr_range(       \
+      bstr_bitstr##size##_t *const bstr, unsigned int start, unsigned int n) { \
+    bstr_kernel_fill_range(BSTR_STATIC_VIEW(size, bstr), start, n, false);     \
+  }                                                                            \
+  static inline __attribute__((nonnull(1))) int bstr##size##_find_zero_run(    \
+      const bstr_bitstr##size##_t *const bstr, unsigned int n,                 \
+      unsigned int align, unsigned int hint) {                                 \
+    return bstr_kernel_find_run_from(BSTR_STATIC_VIEW(size, bstr), n, align,   \
+                                     hint, ~0U);                               \
+  }                                                                            \
+  static inline __attribute__((nonnull(1))) int bstr##size##_find_one_run(     \
+      const bstr_bitstr##size##_t *const bstr, unsigned int n,                 \
+      unsigned int align, unsigned int hint) {                                 \
+    return bstr_kernel_find_run_from(BSTR_STATIC_VIEW(size, bstr), n, align,   \
+                                     hint, 0U);                                \
+  }                                                                            \
+  static inline __attribute__((nonnull(1))) int bstr##size##_alloc_range(      \
+      bstr_bitstr##size##_t *const bstr, unsigned int n, unsigned int align,   \
+      unsigned int hint) {                                                     \
+    const int start = bstr_kernel_find_run_from(BSTR_STATIC_VIEW(size, bstr),  \
+                                                n, align, hint, ~0U);          \
+    if (start >= 0)                                                            \
+      bstr_kernel_fill_range(BSTR_STATIC_VIEW(size, bstr),                     \
+                             (unsigned int)start, n, true);                    \
+    return start;                                                              \
+  }                                                                            \
+  static inline __attribute__((nonnull(1))) void bstr##size##_free_range(      \
+      bstr_bitstr##size##_t *const bstr, unsigned int start, unsigned int n) { \
+    bstr_kernel_fill_range(BSTR_STATIC_VIEW(size, bstr), start, n, false);     \
+  }
+
+/**
+ * @brief Macro to declare an _is_empty function for a sized bitstring.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define BSTR_STATIC_DECLARE_IS_EMPTY(size)                                     \
+  static inline __attribute__((nonnull(1))) bool bstr##size##_is_empty(        \
+      const bstr_bitstr##size##_t *const bstr) {                               \
+    return bstr_kernel_is_empty(BSTR_STATIC_VIEW(size, bstr));                 \
+  }
+
+/**
+ * @brief Macro to declare the set predicates _equals, _intersects,
+ * _is_subset and the three way _compare for a sized bitstring. Both operands
+ * have the same size.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define BSTR_STATIC_DECLARE_PREDICATES(size)                                   \
+  static inline __attribute__((nonnull(1, 2))) bool bstr##size##_equals(       \
+      const bstr_bitstr##size##_t *const a,                                    \
+      const bstr_bitstr##size##_t *const b) {                                  \
+    return bstr_kernel_equals(BSTR_STATIC_VIEW(size, a),                       \
+                              BSTR_STATIC_VIEW(size, b));                      \
+  }                                                                            \
+  static inline __attribute__((nonnull(1, 2))) bool bstr##size##_intersects(   \
+      const bstr_bitstr##size##_t *const a,                                    \
+      const bstr_bitstr##size##_t *const b) {                                  \
+    return bstr_kernel_intersects(BSTR_STATIC_VIEW(size, a),                   \
+                                  BSTR_STATIC_VIEW(size, b));                  \
+  }                                                                            \
+  static inline __attribute__((nonnull(1, 2))) bool bstr##size##_is_subset(    \
+      const bstr_bitstr##size##_t *const a,                                    \
+      const bstr_bitstr##size##_t *const b) {                                  \
+    return bstr_kernel_is_subset(BSTR_STATIC_VIEW(size, a),                    \
+                                 BSTR_STATIC_VIEW(size, b));                   \
+  }                                                                            \
+  static inline __attribute__((nonnull(1, 2))) int bstr##size##_compare(       \
+      const bstr_bitstr##size##_t *const a,                                    \
+      const bstr_bitstr##size##_t *const b) {                                  \
+    return bstr_kernel_compare(BSTR_STATIC_VIEW(size, a),                      \
+                               BSTR_STATIC_VIEW(size, b));                     \
+  }
+
+/**
+ * @brief Macro to declare the _hash and _hash128 functions for a sized
+ * bitstring. The hash equals bstr_hash() of a dynamic bitstring with the same
+ * capacity and bits.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define BSTR_STATIC_DECLARE_HASH(size)                                         \
+  static inline __attribute__((nonnull(1, 2))) void bstr##size##_hash128(      \
+      const bstr_bitstr##size##_t *const bstr, uint64_t hash[2]) {             \
+    bstr_kernel_hash128(BSTR_STATIC_VIEW(size, bstr), hash);                   \
+  }                                                                            \
+  static inline __attribute__((nonnull(1))) uint64_t bstr##size##_hash(        \
+      const bstr_bitstr##size##_t *const bstr) {                               \
+    uint64_t hash[2];                                                          \
+    bstr_kernel_hash128(BSTR_STATIC_VIEW(size, bstr), hash);                   \
+    return hash[0];                                                            \
+  }
+
+/**
+ * @brief Macro to declare the _find_pattern and _find_all_pattern functions
+ * for a sized bitstring. The pattern is given as its words, e.g. the _bits of
+ * a sized bitstring of any size.
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ */
+#define BSTR_STATIC_DECLARE_FIND_PATTERN(size)                                 \
+  static inline __attribute__((nonnull(1, 2))) int bstr##size##_find_pattern(  \
+      const bstr_bitstr##size##_t *const bstr,                                 \
+      const unsigned int *const pattern, unsigned int pattern_bits,            \
+      unsigned int offset) {                                                   \
+    return bstr_kernel_find_pattern(BSTR_STATIC_VIEW(size, bstr), pattern,     \
+                                    pattern_bits, offset);                     \
+  }                                                                            \
+  static inline __attribute__((nonnull(1, 2))) unsigned int                    \
+      bstr##size##_find_all_pattern(const bstr_bitstr##size##_t *const bstr,   \
+                                    const unsigned int *const pattern,         \
+                                    unsigned int pattern_bits,                 \
+                                    unsigned int *matches,                     \
+                                    unsigned int max_matches) {                \
+    return bstr_kernel_find_all_pattern(BSTR_STATIC_VIEW(size, bstr), pattern, \
+                                        pattern_bits, matches, max_matches);   \
   }
 
 /**
  * @brief A convinience macro to declare a complete sized bitstring
  * implemenation. This is the recommended way of creating a static sized
- * bitstring. If you want to use it at several different places you may
- * call this macro in a dedicated header file.
+ * bitstring. All functions are static inline, so you may call this macro in a
+ * dedicated header file and include it from as many places as you want.
  *
  * @param size How many unsigned ints this bitstring contains.
  */
 #define BSTR_STATIC_DECLARE_ALL(size)                                          \
   BSTR_STATIC_DECLARE_SIZED_BITSTRING_STRUCT(size);                            \
-  BSTR_STATIC_DECLARE_BOUND_CHECK(size);                                       \
-  BSTR_STATIC_DECLARE__GET_INT_FOR_BIT_INDEX(size);                            \
   BSTR_STATIC_DECLARE_GET(size);                                               \
+  BSTR_STATIC_DECLARE_FIELDS(size);                                            \
   BSTR_STATIC_DECLARE_TO_STRING(size);                                         \
   BSTR_STATIC_DECLARE_BINDUMP(size);                                           \
   BSTR_STATIC_DECLARE_SET(size);                                               \
@@ -333,8 +437,14 @@ SOFTWARE.
   BSTR_STATIC_DECLARE_CTZ(size);                                               \
   BSTR_STATIC_DECLARE_CLZ(size);                                               \
   BSTR_STATIC_DECLARE_POPCNT(size);                                            \
+  BSTR_STATIC_DECLARE_POSITIONAL_POPCNT(size);                                 \
   BSTR_STATIC_DECLARE_NEXT_SET_BIT(size);                                      \
-  BSTR_STATIC_DECLARE_NEXT_UNSET_BIT(size);
+  BSTR_STATIC_DECLARE_NEXT_UNSET_BIT(size);                                    \
+  BSTR_STATIC_DECLARE_RANGES(size);                                            \
+  BSTR_STATIC_DECLARE_IS_EMPTY(size);                                          \
+  BSTR_STATIC_DECLARE_PREDICATES(size);                                        \
+  BSTR_STATIC_DECLARE_HASH(size);                                              \
+  BSTR_STATIC_DECLARE_FIND_PATTERN(size);
 
 /**
  * @brief Macro that creates the rvalue for a sized bitstream initialization
@@ -430,6 +540,31 @@ SOFTWARE.
  */
 #define bstrs_get(size, bst, bit) bstr##size##_get(bst, bit)
 
+/**
+ * @brief Macro that creates a typesafe function call to _get_field
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ * @param offset unsigned int Index of the least significant bit of the field.
+ * @param width unsigned int Width of the field in bits, 1 to 64.
+ *
+ * @return uint64_t The field.
+ */
+#define bstrs_get_field(size, bst, offset, width)                              \
+  bstr##size##_get_field(bst, offset, width)
+
+/**
+ * @brief Macro that creates a typesafe function call to _set_field
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst *const Pointer to the bitstring object.
+ * @param offset unsigned int Index of the least significant bit of the field.
+ * @param width unsigned int Width of the field in bits, 1 to 64.
+ * @param value uint64_t Its low width bits are written.
+ */
+#define bstrs_set_field(size, bst, offset, width, value)                       \
+  bstr##size##_set_field(bst, offset, width, value)
+
 /**
  * @brief Macro that creates a typesafe function call to _ffs
  *
@@ -482,6 +617,29 @@ SOFTWARE.
  */
 #define bstrs_popcnt(size, bst) bstr##size##_popcnt(bst)
 
+/**
+ * @brief Macro that creates a typesafe function call to _positional_popcnt
+ *
+ * @param size How many unsigned ints the bitstrings contain.
+ * @param bsts const bst *const * The bitstrings.
+ * @param n How many bitstrings there are, > 0.
+ * @param counts uint32_t * Receives one count per bit.
+ */
+#define bstrs_positional_popcnt(size, bsts, n, counts)                         \
+  bstr##size##_positional_popcnt(bsts, n, counts)
+
+/**
+ * @brief Macro that creates a typesafe function call to
+ * _positional_popcnt_add
+ *
+ * @param size How many unsigned ints the bitstrings contain.
+ * @param bsts const bst *const * The bitstrings.
+ * @param n How many bitstrings there are, may be 0.
+ * @param counts uint32_t * One count per bit, added to.
+ */
+#define bstrs_positional_popcnt_add(size, bsts, n, counts)                     \
+  bstr##size##_positional_popcnt_add(bsts, n, counts)
+
 /**
  * @brief Macro that creates a typesafe functio call to _next_set_bit . Get the
  * index of the next set bit based upon the offset.
@@ -503,4 +661,184 @@ SOFTWARE.
  */
 #define bstrs_next_unset_bit(size, bst, offset)                                \
   bstr##size##_next_unset_bit(bst, offset)
+
+/**
+ * @brief Macro that creates a typesafe function call to _set_range
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst *const Pointer to the bitstring object.
+ * @param start unsigned int Index of the first bit.
+ * @param n unsigned int How many bits.
+ */
+#define bstrs_set_range(size, bst, start, n)                                  \
+  bstr##size##_set_range(bst, start, n)
+
+/**
+ * @brief Macro that creates a typesafe function call to _clr_range
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst *const Pointer to the bitstring object.
+ * @param start unsigned int Index of the first bit.
+ * @param n unsigned int How many bits.
+ */
+#define bstrs_clr_range(size, bst, start, n)                                  \
+  bstr##size##_clr_range(bst, start, n)
+
+/**
+ * @brief Macro that creates a typesafe function call to _find_zero_run
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ * @param n unsigned int Length of the run.
+ * @param align unsigned int Power of two the run starts at a multiple of.
+ * @param hint unsigned int Where to begin the search.
+ *
+ * @return int Index of the first bit of the run or -1.
+ */
+#define bstrs_find_zero_run(size, bst, n, align, hint)                         \
+  bstr##size##_find_zero_run(bst, n, align, hint)
+
+/**
+ * @brief Macro that creates a typesafe function call to _find_one_run
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ * @param n unsigned int Length of the run.
+ * @param align unsigned int Power of two the run starts at a multiple of.
+ * @param hint unsigned int Where to begin the search.
+ *
+ * @return int Index of the first bit of the run or -1.
+ */
+#define bstrs_find_one_run(size, bst, n, align, hint)                          \
+  bstr##size##_find_one_run(bst, n, align, hint)
+
+/**
+ * @brief Macro that creates a typesafe function call to _alloc_range
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst *const Pointer to the bitstring object.
+ * @param n unsigned int Length of the range.
+ * @param align unsigned int Power of two the range starts at a multiple of.
+ * @param hint unsigned int Where to begin the search.
+ *
+ * @return int Index of the first bit of the range or -1.
+ */
+#define bstrs_alloc_range(size, bst, n, align, hint)                           \
+  bstr##size##_alloc_range(bst, n, align, hint)
+
+/**
+ * @brief Macro that creates a typesafe function call to _free_range
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst *const Pointer to the bitstring object.
+ * @param start unsigned int The value _alloc_range returned.
+ * @param n unsigned int The length passed to _alloc_range.
+ */
+#define bstrs_free_range(size, bst, start, n)                                  \
+  bstr##size##_free_range(bst, start, n)
+
+/**
+ * @brief Macro that creates a typesafe function call to _is_empty
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ *
+ * @return bool True when no bit is set.
+ */
+#define bstrs_is_empty(size, bst) bstr##size##_is_empty(bst)
+
+/**
+ * @brief Macro that creates a typesafe function call to _equals
+ *
+ * @param size How many unsigned ints both bitstrings contain.
+ * @param a const bst *const Pointer to the bitstring object.
+ * @param b const bst *const Pointer to the bitstring object.
+ *
+ * @return bool True when a and b have the same bits.
+ */
+#define bstrs_equals(size, a, b) bstr##size##_equals(a, b)
+
+/**
+ * @brief Macro that creates a typesafe function call to _intersects
+ *
+ * @param size How many unsigned ints both bitstrings contain.
+ * @param a const bst *const Pointer to the bitstring object.
+ * @param b const bst *const Pointer to the bitstring object.
+ *
+ * @return bool True when a and b have a set bit in common.
+ */
+#define bstrs_intersects(size, a, b) bstr##size##_intersects(a, b)
+
+/**
+ * @brief Macro that creates a typesafe function call to _is_subset
+ *
+ * @param size How many unsigned ints both bitstrings contain.
+ * @param a const bst *const Pointer to the bitstring object.
+ * @param b const bst *const Pointer to the bitstring object.
+ *
+ * @return bool True when every set bit of a is set in b.
+ */
+#define bstrs_is_subset(size, a, b) bstr##size##_is_subset(a, b)
+
+/**
+ * @brief Macro that creates a typesafe function call to _compare. See
+ * bstr_compare() for the order.
+ *
+ * @param size How many unsigned ints both bitstrings contain.
+ * @param a const bst *const Pointer to the bitstring object.
+ * @param b const bst *const Pointer to the bitstring object.
+ *
+ * @return int < 0, 0 or > 0 when a is smaller, equal or greater than b.
+ */
+#define bstrs_compare(size, a, b) bstr##size##_compare(a, b)
+
+/**
+ * @brief Macro that creates a typesafe function call to _hash
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ *
+ * @return uint64_t 64 bit hash of the bits and the capacity.
+ */
+#define bstrs_hash(size, bst) bstr##size##_hash(bst)
+
+/**
+ * @brief Macro that creates a typesafe function call to _hash128
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ * @param hash uint64_t[2] Receives the 128 bit hash.
+ */
+#define bstrs_hash128(size, bst, hash) bstr##size##_hash128(bst, hash)
+
+/**
+ * @brief Macro that creates a typesafe function call to _find_pattern
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ * @param pattern const unsigned int * Words holding the pattern.
+ * @param pattern_bits unsigned int Length of the pattern in bits.
+ * @param offset unsigned int Where to begin the search.
+ *
+ * @return int Bit index of the first occurrence or -1.
+ */
+#define bstrs_find_pattern(size, bst, pattern, pattern_bits, offset)           \
+  bstr##size##_find_pattern(bst, pattern, pattern_bits, offset)
+
+/**
+ * @brief Macro that creates a typesafe function call to _find_all_pattern
+ *
+ * @param size How many unsigned ints this bitstring contains.
+ * @param bst const bst *const Pointer to the bitstring object.
+ * @param pattern const unsigned int * Words holding the pattern.
+ * @param pattern_bits unsigned int Length of the pattern in bits.
+ * @param matches unsigned int * Receives the bit indexes.
+ * @param max_matches unsigned int Size of matches.
+ *
+ * @return unsigned int Number of occurrences.
+ */
+#define bstrs_find_all_pattern(size, bst, pattern, pattern_bits, matches,      \
+                               max_matches)                                    \
+  bstr##size##_find_all_pattern(bst, pattern, pattern_bits, matches,           \
+                                max_matches)
 #endif
@@ -0,0 +1,162 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Sliding window over the last few ticks, e.g. for "seen in the last 60
+ * seconds" deduplication or per key rate limits. The window holds one slice
+ * of slice_capacity unsigned ints per tick. Bits are set in the slice of the
+ * current tick.
+ *
+ * All slices live in one ring. bstr_window_advance() clears the slice of the
+ * oldest tick and makes it the current one, so advancing costs one slice and
+ * nothing is ever shifted. The set bits of the whole window are counted as
+ * they come and go.
+ */
+
+#ifndef BSTR_BITSTRING_WINDOW_H
+#define BSTR_BITSTRING_WINDOW_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A sliding window. Create it with bstr_window_create() and delete it
+ * with bstr_window_delete().
+ *
+ */
+typedef struct bstr_window_t bstr_window_t;
+
+/**
+ * @brief Creates a window with all slices empty.
+ *
+ * @param ticks How many ticks the window covers, > 0.
+ * @param slice_capacity Number of unsigned ints per slice, > 0.
+ * @return bstr_window_t* The window or NULL when malloc failed.
+ */
+bstr_window_t *bstr_window_create(unsigned int ticks,
+                                  unsigned int slice_capacity)
+    __attribute__((warn_unused_result));
+
+/**
+ * @brief Deletes a window.
+ *
+ * @param win Pointer to the window.
+ */
+void bstr_window_delete(bstr_window_t *win) __attribute__((nonnull(1)));
+
+/**
+ * @brief How many ticks the window covers.
+ *
+ * @param win Pointer to the window.
+ */
+unsigned int bstr_window_ticks(const bstr_window_t *const win)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief The slice of a tick. It stays valid until the tick leaves the
+ * window, then it is reused for a new tick.
+ *
+ * @param win Pointer to the window.
+ * @param age 0 for the current tick, 1 for the one before and so on. Has to
+ * be < bstr_window_ticks().
+ */
+const bstr_bitstr_t *bstr_window_slice(const bstr_window_t *const win,
+                                       unsigned int age)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Set a bit in the slice of the current tick.
+ *
+ * @param win Pointer to the window.
+ * @param bit Index of the bit. Has to be < the bit capacity of a slice.
+ */
+void bstr_window_set(bstr_window_t *const win, unsigned int bit)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Check whether a bit is set in any tick of the window.
+ *
+ * @param win Pointer to the window.
+ * @param bit Index of the bit. Has to be < the bit capacity of a slice.
+ */
+bool bstr_window_get(const bstr_window_t *const win, unsigned int bit)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Set a bit in the slice of the current tick and tell whether it was
+ * set in any tick of the window before. This is the deduplication check.
+ *
+ * @param win Pointer to the window.
+ * @param bit Index of the bit. Has to be < the bit capacity of a slice.
+ * @return true The bit was seen within the window.
+ */
+bool bstr_window_test_and_set(bstr_window_t *const win, unsigned int bit)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief In how many ticks of the window a bit is set. This is the rate limit
+ * check.
+ *
+ * @param win Pointer to the window.
+ * @param bit Index of the bit. Has to be < the bit capacity of a slice.
+ */
+unsigned int bstr_window_count(const bstr_window_t *const win,
+                               unsigned int bit) __attribute__((nonnull(1)));
+
+/**
+ * @brief Number of set bits in all slices together. O(1), the count is kept
+ * up to date by bstr_window_set() and bstr_window_advance().
+ *
+ * @param win Pointer to the window.
+ */
+uint64_t bstr_window_popcnt(const bstr_window_t *const win)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief Start new ticks. The slices of the oldest ticks are cleared and
+ * become the slices of the new ones. Advancing by bstr_window_ticks() or
+ * more empties the window.
+ *
+ * @param win Pointer to the window.
+ * @param ticks How many ticks passed.
+ */
+void bstr_window_advance(bstr_window_t *const win, unsigned int ticks)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief dst = union of all slices, the bits seen anywhere in the window.
+ *
+ * @param win Pointer to the window.
+ * @param dst Pointer to bitstring object with the capacity of a slice.
+ */
+void bstr_window_union(const bstr_window_t *const win, bstr_bitstr_t *const dst)
+    __attribute__((nonnull(1, 2)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
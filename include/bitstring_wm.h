@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/*
+ * Wavelet matrix over a sequence of unsigned ints. One bitstring level per bit
+ * of the largest symbol answers access, rank, select and range quantile
+ * queries in O(levels) rank or select steps, using n bits per level instead of
+ * n bits per distinct symbol.
+ *
+ * Every level keeps the number of set bits before each block of
+ * BSTR_WM_BLOCK_WORDS unsigned ints. A rank costs one lookup and at most
+ * BSTR_WM_BLOCK_WORDS popcounts, a select a binary search over the blocks.
+ *
+ * A wavelet matrix is immutable once it is built.
+ */
+
+#ifndef BSTR_BITSTRING_WM_H
+#define BSTR_BITSTRING_WM_H
+
+#include "bitstring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief How many unsigned ints a rank block covers.
+ *
+ */
+#define BSTR_WM_BLOCK_WORDS 8U
+
+/**
+ * @brief A wavelet matrix. Create it with bstr_wm_create() and delete it with
+ * bstr_wm_delete().
+ *
+ */
+typedef struct bstr_wm_t bstr_wm_t;
+
+/**
+ * @brief Builds the wavelet matrix of a sequence.
+ *
+ * @param values The sequence.
+ * @param n How long the sequence is, may be 0.
+ * @return bstr_wm_t* The wavelet matrix or NULL when malloc failed.
+ */
+bstr_wm_t *bstr_wm_create(const unsigned int *values, unsigned int n)
+    __attribute__((warn_unused_result));
+
+/**
+ * @brief Deletes a wavelet matrix.
+ *
+ * @param wm Pointer to the wavelet matrix.
+ */
+void bstr_wm_delete(bstr_wm_t *wm) __attribute__((nonnull(1)));
+
+/**
+ * @brief How long the sequence is.
+ *
+ * @param wm Pointer to the wavelet matrix.
+ */
+unsigned int bstr_wm_count(const bstr_wm_t *const wm)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief How many bits the wavelet matrix takes, rank blocks included.
+ *
+ * @param wm Pointer to the wavelet matrix.
+ */
+size_t bstr_wm_size_in_bits(const bstr_wm_t *const wm)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief The symbol at index.
+ *
+ * @param wm Pointer to the wavelet matrix.
+ * @param index Has to be < bstr_wm_count().
+ */
+unsigned int bstr_wm_get(const bstr_wm_t *const wm, unsigned int index)
+    __attribute__((nonnull(1)));
+
+/**
+ * @brief How often symbol occurs before index.
+ *
+ * @param wm Pointer to the wavelet matrix.
+ * @param symbol The symbol to count.
+ * @param index End of the prefix, has to be <= bstr_wm_count().
+ */
+unsigned int bstr_wm_rank(const bstr_wm_t *const wm, unsigned int symbol,
+                          unsigned int index) __attribute__((nonnull(1)));
+
+/**
+ * @brief Where symbol occurs for the k-th time.
+ *
+ * @param wm Pointer to the wavelet matrix.
+ * @param symbol The symbol to look for.
+ * @param k Which occurrence, starting at 0.
+ * @return int The index or -1 when symbol occurs at most k times.
+ */
+int bstr_wm_select(const bstr_wm_t *const wm, unsigned int symbol,
+                   unsigned int k) __attribute__((nonnull(1)));
+
+/**
+ * @brief The k-th smallest symbol in [from, to). k = (to - from) / 2 gives
+ * the median.
+ *
+ * @param wm Pointer to the wavelet matrix.
+ * @param from Start of the range.
+ * @param to End of the range, from < to <= bstr_wm_count().
+ * @param k Starting at 0, has to be < to - from.
+ */
+unsigned int bstr_wm_quantile(const bstr_wm_t *const wm, unsigned int from,
+                              unsigned int to, unsigned int k)
+    __attribute__((nonnull(1)));
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -22,26 +22,204 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#if defined(CONFIG_BITSTRING_HUGE_PAGES) && defined(__linux__)
+/* For mremap(). */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
 #include "bitstring.h"
 
+#if defined(CONFIG_BITSTRING_HUGE_PAGES) && defined(__linux__)
+#include <sys/mman.h>
+#define _BSTR_HUGE_PAGES
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-static inline unsigned int *
-_bstr_get_int_for_bit_index(const bstr_bitstr_t *const bstr, unsigned int bit) {
-  return (bstr->_bits + (bit / (sizeof(unsigned int) * CHAR_BIT)));
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+#define BSTR_POPCNT_CACHE_BLOCK_BITS                                           \
+  (BSTR_POPCNT_CACHE_BLOCK_WORDS * BSTR_BITS_PER_INT)
+
+/* counts[i] is the number of set bits in block i. A stale cache is rebuilt by
+ * the next read, until then the writes do not update it. */
+struct _bstr_popcnt_cache_t {
+  uint64_t total;
+  bool stale;
+  uint16_t counts[];
+};
+
+static inline unsigned int _bstr_popcnt_cache_blocks(unsigned int capacity) {
+  return (capacity + BSTR_POPCNT_CACHE_BLOCK_WORDS - 1U) /
+         BSTR_POPCNT_CACHE_BLOCK_WORDS;
 }
+#endif
 
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-static inline bool _bstr_is_ptr_out_of_bounds(const bstr_bitstr_t *const bstr,
-                                              const unsigned int *const ptr) {
-  if (bstr->_bits + bstr->_capacity <= ptr || bstr->_bits > ptr)
-    return true;
-  return false;
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+static inline unsigned int _bstr_dirty_chunks(unsigned int capacity) {
+  return (capacity + BSTR_DIRTY_CHUNK_WORDS - 1U) / BSTR_DIRTY_CHUNK_WORDS;
 }
 #endif
 
+#ifdef _BSTR_HUGE_PAGES
+/* Words of bitstrings from BSTR_HUGE_PAGE_MIN_BYTES on are mmap()ed at a huge
+ * page boundary, in whole huge pages. Whether they are follows from the
+ * capacity, so bstr_bitstr_t has no field for it. */
+static inline bool _bstr_words_huge(unsigned int capacity) {
+  return (size_t)capacity * sizeof(unsigned int) >= BSTR_HUGE_PAGE_MIN_BYTES;
+}
+
+static inline size_t _bstr_words_huge_len(unsigned int capacity) {
+  return ((size_t)capacity * sizeof(unsigned int) + BSTR_HUGE_PAGE_SIZE - 1U) &
+         ~((size_t)BSTR_HUGE_PAGE_SIZE - 1U);
+}
+
+/* Faults in len bytes from addr. With transparent huge pages the first write
+ * to each huge page maps all of it. */
+static inline void _bstr_words_prefault(unsigned char *addr, size_t len) {
+#if BSTR_HUGE_PAGE_PREFAULT
+  for (size_t i = 0; i < len; i += 4096U)
+    ((volatile unsigned char *)addr)[i] = 0;
+#else
+  (void)addr;
+  (void)len;
+#endif
+}
+
+static void *_bstr_words_map(size_t len) {
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if BSTR_HUGE_PAGE_HUGETLB && defined(MAP_HUGETLB)
+#if BSTR_HUGE_PAGE_PREFAULT
+  const int hugetlb_flags = flags | MAP_HUGETLB | MAP_POPULATE;
+#else
+  const int hugetlb_flags = flags | MAP_HUGETLB;
+#endif
+  void *hugetlb =
+      mmap(NULL, len, PROT_READ | PROT_WRITE, hugetlb_flags, -1, 0);
+  if (hugetlb != MAP_FAILED)
+    return hugetlb;
+  /* No huge pages reserved, take transparent ones. */
+#endif
+  /* One huge page more, then the ends in front of and behind the first huge
+   * page boundary are given back. */
+  unsigned char *raw = (unsigned char *)mmap(
+      NULL, len + BSTR_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if ((void *)raw == MAP_FAILED)
+    return NULL;
+  const size_t head =
+      (BSTR_HUGE_PAGE_SIZE - ((uintptr_t)raw & (BSTR_HUGE_PAGE_SIZE - 1U))) &
+      (BSTR_HUGE_PAGE_SIZE - 1U);
+  unsigned char *addr = raw + head;
+  if (head != 0)
+    munmap(raw, head);
+  munmap(addr + len, BSTR_HUGE_PAGE_SIZE - head);
+#ifdef MADV_HUGEPAGE
+  madvise(addr, len, MADV_HUGEPAGE);
+#endif
+  _bstr_words_prefault(addr, len);
+  return addr;
+}
+
+/* Grows or shrinks a mapping of _bstr_words_map() without copying. mremap()
+ * first tries to stay in place, else the pages move into a new aligned
+ * mapping. Mappings that cannot be remapped, like hugetlb ones on older
+ * kernels, are copied. */
+static void *_bstr_words_remap(void *old, size_t old_len, size_t len) {
+  if (len == old_len)
+    return old;
+  void *result = mremap(old, old_len, len, 0);
+  if (result == MAP_FAILED) {
+    void *fresh = _bstr_words_map(len);
+    if (fresh == NULL)
+      return NULL;
+    result = mremap(old, old_len, len, MREMAP_MAYMOVE | MREMAP_FIXED, fresh);
+    if (result == MAP_FAILED) {
+      memcpy(fresh, old, old_len < len ? old_len : len);
+      munmap(old, old_len);
+      return fresh;
+    }
+  }
+  if (len > old_len)
+    _bstr_words_prefault((unsigned char *)result + old_len, len - old_len);
+  return result;
+}
+#endif
+
+static unsigned int *_bstr_words_alloc(unsigned int capacity) {
+#ifdef _BSTR_HUGE_PAGES
+  if (_bstr_words_huge(capacity))
+    return (unsigned int *)_bstr_words_map(_bstr_words_huge_len(capacity));
+#endif
+  unsigned int *words =
+      (unsigned int *)malloc((size_t)capacity * sizeof(unsigned int));
+  if (words != NULL)
+    memset(words, 0, (size_t)capacity * sizeof(unsigned int));
+  return words;
+}
+
+static void _bstr_words_free(unsigned int *words, unsigned int capacity) {
+#ifdef _BSTR_HUGE_PAGES
+  if (_bstr_words_huge(capacity)) {
+    munmap(words, _bstr_words_huge_len(capacity));
+    return;
+  }
+#else
+  (void)capacity;
+#endif
+  free(words);
+}
+
+/* Moves the words to capacity unsigned ints, like realloc(). The words from
+ * the old capacity on are not initialized. */
+static unsigned int *_bstr_words_realloc(unsigned int *words,
+                                         unsigned int old_capacity,
+                                         unsigned int capacity) {
+#ifdef _BSTR_HUGE_PAGES
+  const bool was_huge = _bstr_words_huge(old_capacity);
+  const bool huge = _bstr_words_huge(capacity);
+  if (was_huge && huge)
+    return (unsigned int *)_bstr_words_remap(
+        words, _bstr_words_huge_len(old_capacity),
+        _bstr_words_huge_len(capacity));
+  if (was_huge || huge) {
+    unsigned int *result = _bstr_words_alloc(capacity);
+    if (result == NULL)
+      return NULL;
+    memcpy(result, words,
+           (size_t)(old_capacity < capacity ? old_capacity : capacity) *
+               sizeof(unsigned int));
+    _bstr_words_free(words, old_capacity);
+    return result;
+  }
+#else
+  (void)old_capacity;
+#endif
+  return (unsigned int *)realloc(words,
+                                 (size_t)capacity * sizeof(unsigned int));
+}
+
+/* The first word of a grown _bstr_words_realloc() that is known to be zero,
+ * the new pages of a mapping are. */
+static inline unsigned int _bstr_words_zero_from(unsigned int old_capacity,
+                                                 unsigned int capacity) {
+#ifdef _BSTR_HUGE_PAGES
+  if (_bstr_words_huge(capacity)) {
+    if (!_bstr_words_huge(old_capacity))
+      return old_capacity;
+    /* The tail of the last huge page may hold words from before a shrink. */
+    const size_t mapped =
+        _bstr_words_huge_len(old_capacity) / sizeof(unsigned int);
+    return mapped < capacity ? (unsigned int)mapped : capacity;
+  }
+#else
+  (void)old_capacity;
+#endif
+  return capacity;
+}
+
 bstr_bitstr_t *bstr_create_bitstr(unsigned int capacity) {
 #ifdef DEBUG
   assert(capacity > 0);
@@ -49,9 +227,11 @@ bstr_bitstr_t *bstr_create_bitstr(unsigned int capacity) {
   bstr_bitstr_t *result = (bstr_bitstr_t *)malloc(sizeof(bstr_bitstr_t));
   if (result == NULL)
     return NULL;
-  result->_bits = (unsigned int *)malloc(capacity * sizeof(unsigned int));
-  result->_capacity = capacity;
-  memset(result->_bits, 0, result->_capacity * sizeof(unsigned int));
+  _bstr_wrap(result, _bstr_words_alloc(capacity), capacity);
+  if (result->_bits == NULL) {
+    free(result);
+    return NULL;
+  }
   return result;
 }
 
@@ -60,7 +240,14 @@ void bstr_delete_bitstr(bstr_bitstr_t *bstr) {
   assert(bstr != NULL);
   assert(bstr->_bits != NULL);
 #endif
-  free(bstr->_bits);
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  free(bstr->_popcnt_cache);
+#endif
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    bstr_delete_bitstr(bstr->_dirty);
+#endif
+  _bstr_words_free(bstr->_bits, bstr->_capacity);
   free(bstr);
 }
 
@@ -73,8 +260,36 @@ bstr_err_t bstr_resize(bstr_bitstr_t *const bstr, unsigned int capacity) {
   if (capacity == bstr->_capacity)
     return BSTR_NO_ERROR;
 
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL) {
+    /* Never shrunk, so it also fits the old capacity when realloc of the bits
+     * fails below. */
+    const unsigned int nblocks = _bstr_popcnt_cache_blocks(
+        capacity > bstr->_capacity ? capacity : bstr->_capacity);
+    struct _bstr_popcnt_cache_t *cache =
+        (struct _bstr_popcnt_cache_t *)realloc(
+            bstr->_popcnt_cache, sizeof(struct _bstr_popcnt_cache_t) +
+                                     nblocks * sizeof(uint16_t));
+    if (cache == NULL)
+      return BSTR_MALLOC_FAILED;
+    cache->stale = true;
+    bstr->_popcnt_cache = cache;
+  }
+#endif
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL) {
+    /* Grown only, like the popcount cache. */
+    const unsigned int nwords =
+        (_bstr_dirty_chunks(capacity) + BSTR_BITS_PER_INT - 1U) >>
+        BSTR_BITS_PER_INT_SHIFT;
+    if (nwords > bstr->_dirty->_capacity &&
+        bstr_resize(bstr->_dirty, nwords) != BSTR_NO_ERROR)
+      return BSTR_MALLOC_FAILED;
+  }
+#endif
+
   unsigned int *newMem =
-      (unsigned int *)realloc(bstr->_bits, capacity * sizeof(unsigned int));
+      _bstr_words_realloc(bstr->_bits, bstr->_capacity, capacity);
   if (newMem == NULL)
     return BSTR_MALLOC_FAILED;
 
@@ -84,16 +299,23 @@ bstr_err_t bstr_resize(bstr_bitstr_t *const bstr, unsigned int capacity) {
     return BSTR_NO_ERROR;
   } else {
     bstr->_bits = newMem;
-    for (int i = bstr->_capacity; i != capacity; i++) {
+    const unsigned int zero = _bstr_words_zero_from(bstr->_capacity, capacity);
+    for (unsigned int i = bstr->_capacity; i < zero; i++) {
       unsigned int *target = bstr->_bits + i;
       *target = 0;
     }
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+    if (bstr->_dirty != NULL)
+      _bstr_dirty_mark(bstr, bstr->_capacity << BSTR_BITS_PER_INT_SHIFT,
+                       (capacity - bstr->_capacity) << BSTR_BITS_PER_INT_SHIFT);
+#endif
     bstr->_capacity = capacity;
     return BSTR_NO_ERROR;
   }
   return BSTR_NO_ERROR;
 }
 
+#ifndef CONFIG_BITSTRING_INLINE
 unsigned int bstr_get_capacity(const bstr_bitstr_t *const bstr) {
 #ifdef DEBUG
   assert(bstr != NULL);
@@ -105,8 +327,9 @@ unsigned int bstr_get_bit_capacity(const bstr_bitstr_t *const bstr) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  return bstr->_capacity * sizeof(unsigned int) * CHAR_BIT;
+  return bstr->_capacity << BSTR_BITS_PER_INT_SHIFT;
 }
+#endif
 
 size_t bstr_to_string_size(const bstr_bitstr_t *const bstr) {
   //                                   bits per byte    trailing \0
@@ -114,14 +337,7 @@ size_t bstr_to_string_size(const bstr_bitstr_t *const bstr) {
 }
 
 void bstr_to_string(const bstr_bitstr_t *const bstr, char *const str) {
-  const unsigned int len = bstr_get_bit_capacity(bstr);
-  for (unsigned int i = 0; i != len; i++) {
-    if (bstr_get(bstr, i)) {
-      strncat(str, "1", 2);
-    } else {
-      strncat(str, "0", 2);
-    }
-  }
+  bstr_kernel_to_string(_bstr_view(bstr), str);
 }
 
 void bstr_bindump(const bstr_bitstr_t *const bstr, char *const str,
@@ -130,196 +346,864 @@ void bstr_bindump(const bstr_bitstr_t *const bstr, char *const str,
   assert(bstr != NULL);
   assert(str != NULL);
 #endif
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-  assert(line < bstr->_capacity);
+  bstr_kernel_bindump(_bstr_view(bstr), str, line);
+}
+
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+
+static inline uint16_t _bstr_popcnt_cache_count(const bstr_bitstr_t *const bstr,
+                                                unsigned int block) {
+  const unsigned int first = block * BSTR_POPCNT_CACHE_BLOCK_WORDS;
+  const unsigned int nwords =
+      bstr->_capacity - first < BSTR_POPCNT_CACHE_BLOCK_WORDS
+          ? bstr->_capacity - first
+          : BSTR_POPCNT_CACHE_BLOCK_WORDS;
+  return (uint16_t)bstr_kernel_popcnt(
+      bstr_kernel_view(&bstr->_bits[first], nwords));
+}
+
+/* The cache of bstr, rebuilt when it is stale. */
+static struct _bstr_popcnt_cache_t *
+_bstr_popcnt_cache_get(const bstr_bitstr_t *const bstr) {
+  struct _bstr_popcnt_cache_t *cache = bstr->_popcnt_cache;
+  if (cache->stale) {
+    const unsigned int nblocks = _bstr_popcnt_cache_blocks(bstr->_capacity);
+    cache->total = 0;
+    for (unsigned int b = 0; b < nblocks; b++) {
+      cache->counts[b] = _bstr_popcnt_cache_count(bstr, b);
+      cache->total += cache->counts[b];
+    }
+    cache->stale = false;
+  }
+  return cache;
+}
+
+bstr_err_t bstr_popcnt_cache_enable(bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
 #endif
-  unsigned int *target = bstr->_bits + line;
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-  assert(!_bstr_is_ptr_out_of_bounds(bstr, target));
-#endif
-  snprintf(str, BSTR_BINDUMP_SIZE, "%p:", target);
-  const unsigned int num_bits = sizeof(unsigned int) * CHAR_BIT;
-  for (unsigned int bit = num_bits; bit > 0; bit--) {
-    unsigned int bitval = ((*target) >> (bit - 1)) & 1U;
-    if (bit % CHAR_BIT == 0)
-      strncat(str, " ", 2);
-    if (bitval > 0) {
-      strncat(str, "1", 2);
-    } else {
-      strncat(str, "0", 2);
+  if (bstr->_popcnt_cache == NULL) {
+    struct _bstr_popcnt_cache_t *cache = (struct _bstr_popcnt_cache_t *)malloc(
+        sizeof(struct _bstr_popcnt_cache_t) +
+        _bstr_popcnt_cache_blocks(bstr->_capacity) * sizeof(uint16_t));
+    if (cache == NULL)
+      return BSTR_MALLOC_FAILED;
+    bstr->_popcnt_cache = cache;
+  }
+  bstr->_popcnt_cache->stale = true;
+  return BSTR_NO_ERROR;
+}
+
+void bstr_popcnt_cache_disable(bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  free(bstr->_popcnt_cache);
+  bstr->_popcnt_cache = NULL;
+}
+
+void _bstr_popcnt_cache_put(bstr_bitstr_t *const bstr, unsigned int bit,
+                            bool on) {
+  const bstr_view_t view = _bstr_view(bstr);
+  if (bstr_kernel_get(view, bit) == on)
+    return;
+  struct _bstr_popcnt_cache_t *cache = bstr->_popcnt_cache;
+  uint16_t *count = &cache->counts[bit / BSTR_POPCNT_CACHE_BLOCK_BITS];
+  if (on) {
+    bstr_kernel_set(view, bit);
+    *count = (uint16_t)(*count + 1U);
+    cache->total++;
+  } else {
+    bstr_kernel_clr(view, bit);
+    *count = (uint16_t)(*count - 1U);
+    cache->total--;
+  }
+}
+
+void _bstr_popcnt_cache_put_field(bstr_bitstr_t *const bstr,
+                                  unsigned int offset, unsigned int width,
+                                  uint64_t value) {
+  const bstr_view_t view = _bstr_view(bstr);
+  const uint64_t mask = width < 64 ? (UINT64_C(1) << width) - 1U : ~UINT64_C(0);
+  const uint64_t old = bstr_kernel_get_field(view, offset, width);
+  value &= mask;
+  bstr_kernel_set_field(view, offset, width, value);
+  struct _bstr_popcnt_cache_t *cache = bstr->_popcnt_cache;
+  if (cache->stale || old == value)
+    return;
+  /* A field spans at most two blocks, the low bits fall into the first. */
+  const unsigned int block = offset / BSTR_POPCNT_CACHE_BLOCK_BITS;
+  const unsigned int low =
+      BSTR_POPCNT_CACHE_BLOCK_BITS - offset % BSTR_POPCNT_CACHE_BLOCK_BITS;
+  const uint64_t low_mask =
+      low < width ? (UINT64_C(1) << low) - 1U : ~UINT64_C(0);
+  const int low_delta = __builtin_popcountll(value & low_mask) -
+                        __builtin_popcountll(old & low_mask);
+  const int high_delta = __builtin_popcountll(value & ~low_mask) -
+                         __builtin_popcountll(old & ~low_mask);
+  cache->counts[block] = (uint16_t)(cache->counts[block] + low_delta);
+  if (high_delta != 0)
+    cache->counts[block + 1U] =
+        (uint16_t)(cache->counts[block + 1U] + high_delta);
+  cache->total += (uint64_t)(int64_t)(low_delta + high_delta);
+}
+#endif
+
+/*
+ * Called after n bits from start were written by a range operation. Recounts
+ * the blocks of the popcount cache they touch and marks their chunks dirty.
+ */
+static inline void _bstr_written(const bstr_bitstr_t *const bstr,
+                                 unsigned int start, unsigned int n) {
+  if (n == 0)
+    return;
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  struct _bstr_popcnt_cache_t *cache = bstr->_popcnt_cache;
+  if (cache != NULL && !cache->stale) {
+    const unsigned int last = (start + n - 1U) / BSTR_POPCNT_CACHE_BLOCK_BITS;
+    for (unsigned int b = start / BSTR_POPCNT_CACHE_BLOCK_BITS; b <= last;
+         b++) {
+      const uint16_t count = _bstr_popcnt_cache_count(bstr, b);
+      cache->total = cache->total - cache->counts[b] + count;
+      cache->counts[b] = count;
     }
   }
+#endif
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    _bstr_dirty_mark(bstr, start, n);
+#endif
+  (void)bstr;
+  (void)start;
+}
+
+/*
+ * Called before bstr is rewritten as a whole. Marks the popcount cache stale
+ * and all chunks dirty.
+ */
+static inline void _bstr_written_all(const bstr_bitstr_t *const bstr) {
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL)
+    bstr->_popcnt_cache->stale = true;
+#endif
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    bstr_kernel_fill_range(_bstr_view(bstr->_dirty), 0,
+                           _bstr_dirty_chunks(bstr->_capacity), true);
+#endif
+  (void)bstr;
+}
+
+void _bstr_written_words(bstr_bitstr_t *const bstr, unsigned int first,
+                         unsigned int nwords) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(first <= bstr->_capacity && nwords <= bstr->_capacity - first);
+#endif
+  _bstr_written(bstr, first << BSTR_BITS_PER_INT_SHIFT,
+                nwords << BSTR_BITS_PER_INT_SHIFT);
+}
+
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+bstr_err_t bstr_dirty_enable(bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  if (bstr->_dirty == NULL) {
+    const unsigned int nchunks = _bstr_dirty_chunks(bstr->_capacity);
+    bstr->_dirty = bstr_create_bitstr(
+        (nchunks + BSTR_BITS_PER_INT - 1U) >> BSTR_BITS_PER_INT_SHIFT);
+    if (bstr->_dirty == NULL)
+      return BSTR_MALLOC_FAILED;
+  }
+  _bstr_written_all(bstr);
+  return BSTR_NO_ERROR;
+}
+
+void bstr_dirty_disable(bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  if (bstr->_dirty != NULL)
+    bstr_delete_bitstr(bstr->_dirty);
+  bstr->_dirty = NULL;
+}
+
+bool bstr_dirty_enabled(const bstr_bitstr_t *const bstr) {
+  return bstr->_dirty != NULL;
+}
+
+unsigned int bstr_dirty_chunks(const bstr_bitstr_t *const bstr) {
+  return _bstr_dirty_chunks(bstr->_capacity);
+}
+
+int bstr_dirty_next(const bstr_bitstr_t *const bstr, unsigned int chunk) {
+#ifdef DEBUG
+  assert(bstr->_dirty != NULL);
+#endif
+  const unsigned int nchunks = _bstr_dirty_chunks(bstr->_capacity);
+  if (chunk >= nchunks)
+    return -1;
+  /* Chunks past a shrink may still be marked. */
+  const int next = bstr_kernel_next(_bstr_view(bstr->_dirty), chunk, 0U);
+  return next >= 0 && (unsigned int)next < nchunks ? next : -1;
 }
 
+void bstr_dirty_clr(bstr_bitstr_t *const bstr, unsigned int chunk) {
+#ifdef DEBUG
+  assert(bstr->_dirty != NULL);
+#endif
+  bstr_kernel_clr(_bstr_view(bstr->_dirty), chunk);
+}
+
+void bstr_dirty_clr_all(bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr->_dirty != NULL);
+#endif
+  bstr_kernel_set_all(_bstr_view(bstr->_dirty), false);
+}
+#endif
+
+#ifndef CONFIG_BITSTRING_INLINE
 void bstr_set(bstr_bitstr_t *const bstr, unsigned int bit) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  unsigned int *target = _bstr_get_int_for_bit_index(bstr, bit);
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-  assert(!_bstr_is_ptr_out_of_bounds(bstr, target));
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    _bstr_dirty_mark(bstr, bit, 1U);
 #endif
-  unsigned int bit_to_set = bit % (sizeof(unsigned int) * CHAR_BIT);
-  *target |= 1 << bit_to_set;
-  return;
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL) {
+    _bstr_popcnt_cache_put(bstr, bit, true);
+    return;
+  }
+#endif
+  bstr_kernel_set(_bstr_view(bstr), bit);
 }
+#endif
 
 void bstr_set_all(bstr_bitstr_t *const bstr, bool on) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  unsigned char value = 0;
-  if (on)
-    value = UCHAR_MAX;
-  memset(bstr->_bits, value, bstr->_capacity * sizeof(unsigned int));
+  _bstr_written_all(bstr);
+  bstr_kernel_set_all(_bstr_view(bstr), on);
 }
 
+#ifndef CONFIG_BITSTRING_INLINE
 void bstr_clr(bstr_bitstr_t *const bstr, unsigned int bit) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  unsigned int *target = _bstr_get_int_for_bit_index(bstr, bit);
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-  assert(!_bstr_is_ptr_out_of_bounds(bstr, target));
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    _bstr_dirty_mark(bstr, bit, 1U);
+#endif
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL) {
+    _bstr_popcnt_cache_put(bstr, bit, false);
+    return;
+  }
 #endif
-  unsigned int bit_to_clear = bit % (sizeof(unsigned int) * CHAR_BIT);
-  *target &= ~(1 << bit_to_clear);
+  bstr_kernel_clr(_bstr_view(bstr), bit);
 }
 
 bool bstr_get(const bstr_bitstr_t *const bstr, unsigned int bit) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  unsigned int *target = _bstr_get_int_for_bit_index(bstr, bit);
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-  assert(!_bstr_is_ptr_out_of_bounds(bstr, target));
+  return bstr_kernel_get(_bstr_view(bstr), bit);
+}
+
+uint64_t bstr_get_field(const bstr_bitstr_t *const bstr, unsigned int offset,
+                        unsigned int width) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(width > 0 && width <= 64);
 #endif
-  unsigned int bit_to_get = bit % (sizeof(unsigned int) * CHAR_BIT);
-  unsigned int result = ((*target) >> bit_to_get) & 1U;
-  if (result > 0) {
-    return true;
-  } else {
-    return false;
-  }
+  return bstr_kernel_get_field(_bstr_view(bstr), offset, width);
 }
 
-int bstr_ffs(const bstr_bitstr_t *const bstr) {
+void bstr_set_field(bstr_bitstr_t *const bstr, unsigned int offset,
+                    unsigned int width, uint64_t value) {
 #ifdef DEBUG
   assert(bstr != NULL);
+  assert(width > 0 && width <= 64);
 #endif
-  unsigned int *targetptr = bstr->_bits + bstr->_capacity;
-  unsigned int offset = 0;
-  for (unsigned int *i = bstr->_bits; i < targetptr; i++) {
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-    assert(!_bstr_is_ptr_out_of_bounds(bstr, i));
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr->_dirty != NULL)
+    _bstr_dirty_mark(bstr, offset, width);
 #endif
-    int result = ffs(*i);
-    if (result > 0)
-      return (offset * sizeof(unsigned int) * CHAR_BIT) + result - 1;
-    offset++;
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL) {
+    _bstr_popcnt_cache_put_field(bstr, offset, width, value);
+    return;
   }
-  return -1;
+#endif
+  bstr_kernel_set_field(_bstr_view(bstr), offset, width, value);
+}
+#endif
+
+void bstr_set_words(bstr_bitstr_t *const bstr, unsigned int first,
+                    const unsigned int *words, unsigned int nwords) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(nwords == 0 || words != NULL);
+#endif
+  if (nwords == 0)
+    return;
+  BSTR_KERNEL_BOUND_CHECK(_bstr_view(bstr), first + nwords - 1U)
+  memcpy(&bstr->_bits[first], words, nwords * sizeof(unsigned int));
+  _bstr_written(bstr, first << BSTR_BITS_PER_INT_SHIFT,
+                nwords << BSTR_BITS_PER_INT_SHIFT);
+}
+
+int bstr_ffs(const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  return bstr_kernel_ffs(_bstr_view(bstr));
 }
 
 int bstr_ffus(const bstr_bitstr_t *const bstr) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  unsigned int *targetptr = bstr->_bits + bstr->_capacity;
-  int offset = 0;
-  for (unsigned int *i = bstr->_bits; i < targetptr; i++) {
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-    assert(!_bstr_is_ptr_out_of_bounds(bstr, i));
+  return bstr_kernel_ffus(_bstr_view(bstr));
+}
+
+int bstr_ctz(const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  return bstr_kernel_ctz(_bstr_view(bstr));
+}
+
+int bstr_clz(const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  return bstr_kernel_clz(_bstr_view(bstr));
+}
+
+int bstr_popcnt(const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL)
+    return (int)_bstr_popcnt_cache_get(bstr)->total;
+#endif
+  return bstr_kernel_popcnt(_bstr_view(bstr));
+}
+
+int bstr_popcnt_range(const bstr_bitstr_t *const bstr, unsigned int start,
+                      unsigned int n) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  const bstr_view_t view = _bstr_view(bstr);
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  if (bstr->_popcnt_cache != NULL && n >= 2U * BSTR_POPCNT_CACHE_BLOCK_BITS) {
+    const struct _bstr_popcnt_cache_t *cache = _bstr_popcnt_cache_get(bstr);
+    /* The partial blocks at both ends are counted, the ones between summed. */
+    const unsigned int first = (start + BSTR_POPCNT_CACHE_BLOCK_BITS - 1U) /
+                               BSTR_POPCNT_CACHE_BLOCK_BITS;
+    const unsigned int end = (start + n) / BSTR_POPCNT_CACHE_BLOCK_BITS;
+    int popcnt = bstr_kernel_popcnt_range(
+        view, start, first * BSTR_POPCNT_CACHE_BLOCK_BITS - start);
+    for (unsigned int b = first; b < end; b++)
+      popcnt += cache->counts[b];
+    return popcnt + bstr_kernel_popcnt_range(
+                        view, end * BSTR_POPCNT_CACHE_BLOCK_BITS,
+                        start + n - end * BSTR_POPCNT_CACHE_BLOCK_BITS);
+  }
+#endif
+  return bstr_kernel_popcnt_range(view, start, n);
+}
+
+void bstr_positional_popcnt(const bstr_bitstr_t *const *bstrs, unsigned int n,
+                            uint32_t *counts) {
+#ifdef DEBUG
+  assert(bstrs != NULL && counts != NULL);
+  assert(n > 0);
+#endif
+  memset(counts, 0,
+         (size_t)bstr_get_bit_capacity(bstrs[0]) * sizeof(uint32_t));
+  bstr_positional_popcnt_add(bstrs, n, counts);
+}
+
+void bstr_positional_popcnt_add(const bstr_bitstr_t *const *bstrs,
+                                unsigned int n, uint32_t *counts) {
+#ifdef DEBUG
+  assert(n == 0 || bstrs != NULL);
+  assert(counts != NULL);
 #endif
-    if (*i == UINT_MAX) {
-      offset += sizeof(unsigned int) * CHAR_BIT;
-      continue;
+  const unsigned int *rows[BSTR_KERNEL_ROWS_BATCH];
+  for (unsigned int i = 0; i < n; i += BSTR_KERNEL_ROWS_BATCH) {
+    const unsigned int batch =
+        n - i < BSTR_KERNEL_ROWS_BATCH ? n - i : BSTR_KERNEL_ROWS_BATCH;
+    for (unsigned int k = 0; k < batch; k++) {
+#ifdef DEBUG
+      assert(bstrs[i + k]->_capacity == bstrs[0]->_capacity);
+#endif
+      rows[k] = bstrs[i + k]->_bits;
     }
-    for (int bit = offset; bit != bstr_get_bit_capacity(bstr); bit++) {
-      if (!bstr_get(bstr, bit))
-        return bit;
+    bstr_dispatch_positional_popcnt(rows, batch, bstrs[0]->_capacity, counts);
+  }
+}
+
+/*
+ * The k-way operations walk the bitstrings in tiles. A tile of the result is
+ * built in a stack buffer from the same tile of every input and copied to dst
+ * at the end, so dst may be one of the inputs.
+ */
+#define BSTR_MANY_TILE_WORDS 256U
+
+/* Stack budget for the counter slices of bstr_threshold_many(). */
+#define BSTR_MANY_COUNTER_WORDS 512U
+
+/*
+ * Combines tile [start, start + nwords) of all inputs into acc with OR (and
+ * = false) or AND (and = true). Stops early once acc is saturated.
+ */
+static inline void _bstr_many_tile(unsigned int *acc,
+                                   const bstr_bitstr_t *const *srcs,
+                                   unsigned int n, unsigned int start,
+                                   unsigned int nwords, bool and) {
+  memcpy(acc, &srcs[0]->_bits[start], nwords * sizeof(unsigned int));
+  for (unsigned int i = 1; i < n; i++) {
+    const unsigned int *src = &srcs[i]->_bits[start];
+    /* saturated ends up ~0U when all of acc is 0 (AND) or ~0U (OR). */
+    unsigned int saturated = ~0U;
+    if (and) {
+      for (unsigned int w = 0; w < nwords; w++) {
+        acc[w] &= src[w];
+        saturated &= ~acc[w];
+      }
+    } else {
+      for (unsigned int w = 0; w < nwords; w++) {
+        acc[w] |= src[w];
+        saturated &= acc[w];
+      }
     }
+    if (saturated == ~0U)
+      return;
   }
-  return -1;
 }
 
-int bstr_ctz(const bstr_bitstr_t *const bstr) {
+static void _bstr_many(bstr_bitstr_t *const dst,
+                       const bstr_bitstr_t *const *srcs, unsigned int n,
+                       bool and) {
 #ifdef DEBUG
-  assert(bstr != NULL);
+  assert(dst != NULL);
+  assert(n == 0 || srcs != NULL);
+  for (unsigned int i = 0; i < n; i++)
+    assert(srcs[i]->_capacity == dst->_capacity);
 #endif
-  unsigned int *targetptr = bstr->_bits + bstr->_capacity;
-  int result = 0;
-  for (unsigned int *i = bstr->_bits; i < targetptr; i++) {
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-    assert(!_bstr_is_ptr_out_of_bounds(bstr, i));
+  _bstr_written_all(dst);
+  if (n == 0) {
+    bstr_kernel_set_all(_bstr_view(dst), and);
+    return;
+  }
+  unsigned int acc[BSTR_MANY_TILE_WORDS];
+  for (unsigned int start = 0; start < dst->_capacity;
+       start += BSTR_MANY_TILE_WORDS) {
+    const unsigned int nwords = dst->_capacity - start < BSTR_MANY_TILE_WORDS
+                                    ? dst->_capacity - start
+                                    : BSTR_MANY_TILE_WORDS;
+    _bstr_many_tile(acc, srcs, n, start, nwords, and);
+    memcpy(&dst->_bits[start], acc, nwords * sizeof(unsigned int));
+  }
+}
+
+void bstr_union_many(bstr_bitstr_t *const dst,
+                     const bstr_bitstr_t *const *srcs, unsigned int n) {
+  _bstr_many(dst, srcs, n, false);
+}
+
+void bstr_intersect_many(bstr_bitstr_t *const dst,
+                         const bstr_bitstr_t *const *srcs, unsigned int n) {
+  _bstr_many(dst, srcs, n, true);
+}
+
+static inline void _bstr_csa(unsigned int *h, unsigned int *l, unsigned int a,
+                             unsigned int b, unsigned int c) {
+  const unsigned int u = a ^ b;
+  *h = (a & b) | (u & c);
+  *l = u ^ c;
+}
+
+static const unsigned int _bstr_many_zeros[BSTR_MANY_TILE_WORDS] = {0};
+
+void bstr_threshold_many(bstr_bitstr_t *const dst,
+                         const bstr_bitstr_t *const *srcs, unsigned int n,
+                         unsigned int k) {
+#ifdef DEBUG
+  assert(dst != NULL);
+  assert(n == 0 || srcs != NULL);
+  for (unsigned int i = 0; i < n; i++)
+    assert(srcs[i]->_capacity == dst->_capacity);
 #endif
-    if (*i == 0) {
-      result += sizeof(unsigned int) * CHAR_BIT;
-      continue;
+  _bstr_written_all(dst);
+  if (k == 0 || k > n) {
+    bstr_kernel_set_all(_bstr_view(dst), k == 0);
+    return;
+  }
+  if (k == 1 || k == n) {
+    _bstr_many(dst, srcs, n, k == n);
+    return;
+  }
+  /* Bit sliced counters wide enough for k. A carry out of the top slice means
+   * the count passed 2^nslices > k, over remembers it. */
+  const unsigned int nslices =
+      BSTR_BITS_PER_INT - (unsigned int)__builtin_clz(k);
+  unsigned int tile = BSTR_MANY_COUNTER_WORDS / (nslices + 1U);
+  if (tile > BSTR_MANY_TILE_WORDS)
+    tile = BSTR_MANY_TILE_WORDS;
+  unsigned int counters[BSTR_MANY_COUNTER_WORDS];
+  unsigned int *over = &counters[nslices * tile];
+  for (unsigned int start = 0; start < dst->_capacity; start += tile) {
+    const unsigned int nwords =
+        dst->_capacity - start < tile ? dst->_capacity - start : tile;
+    memset(counters, 0, (nslices + 1U) * tile * sizeof(unsigned int));
+    /* 16 inputs at a time go through a carry save adder tree into a 5 bit
+     * sum, which is added to the counters. Missing inputs of the last group
+     * read zeros. */
+    for (unsigned int g = 0; g < n; g += 16) {
+      const unsigned int *rows[16];
+      for (unsigned int j = 0; j < 16; j++)
+        rows[j] = g + j < n ? &srcs[g + j]->_bits[start] : _bstr_many_zeros;
+      for (unsigned int w = 0; w < nwords; w++) {
+        unsigned int sum[5] = {0, 0, 0, 0, 0};
+        unsigned int twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+        _bstr_csa(&twos_a, &sum[0], rows[0][w], rows[1][w], rows[2][w]);
+        _bstr_csa(&twos_b, &sum[0], sum[0], rows[3][w], rows[4][w]);
+        _bstr_csa(&fours_a, &sum[1], twos_a, twos_b, 0U);
+        _bstr_csa(&twos_a, &sum[0], sum[0], rows[5][w], rows[6][w]);
+        _bstr_csa(&twos_b, &sum[0], sum[0], rows[7][w], rows[8][w]);
+        _bstr_csa(&fours_b, &sum[1], sum[1], twos_a, twos_b);
+        _bstr_csa(&eights_a, &sum[2], fours_a, fours_b, 0U);
+        _bstr_csa(&twos_a, &sum[0], sum[0], rows[9][w], rows[10][w]);
+        _bstr_csa(&twos_b, &sum[0], sum[0], rows[11][w], rows[12][w]);
+        _bstr_csa(&fours_a, &sum[1], sum[1], twos_a, twos_b);
+        _bstr_csa(&twos_a, &sum[0], sum[0], rows[13][w], rows[14][w]);
+        _bstr_csa(&twos_b, &sum[0], sum[0], rows[15][w], 0U);
+        _bstr_csa(&fours_b, &sum[1], sum[1], twos_a, twos_b);
+        _bstr_csa(&eights_b, &sum[2], sum[2], fours_a, fours_b);
+        _bstr_csa(&sum[4], &sum[3], eights_a, eights_b, 0U);
+        /* Ripple carry add of sum into the counters. */
+        unsigned int carry = 0;
+        for (unsigned int s = 0; s < nslices; s++) {
+          unsigned int *slice = &counters[s * tile + w];
+          const unsigned int x = s < 5 ? sum[s] : 0U;
+          unsigned int next;
+          _bstr_csa(&next, slice, *slice, x, carry);
+          carry = next;
+        }
+        for (unsigned int s = nslices; s < 5; s++)
+          carry |= sum[s];
+        over[w] |= carry;
+      }
+    }
+    /* count >= k, compared slice by slice from the top. */
+    for (unsigned int w = 0; w < nwords; w++) {
+      unsigned int greater = over[w];
+      unsigned int equal = ~0U;
+      for (unsigned int s = nslices; s-- > 0;) {
+        const unsigned int slice = counters[s * tile + w];
+        if ((k >> s) & 1U) {
+          equal &= slice;
+        } else {
+          greater |= equal & slice;
+          equal &= ~slice;
+        }
+      }
+      dst->_bits[start + w] = greater | equal;
     }
-    result += __builtin_ctz(*i);
-    return result;
   }
-  return result;
 }
 
-int bstr_clz(const bstr_bitstr_t *const bstr) {
+int bstr_next_set_bit(const bstr_bitstr_t *const bstr, unsigned int offset) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  unsigned int *baseptr = bstr->_bits + bstr->_capacity - 1;
-  int result = 0;
-  for (unsigned int *i = baseptr; i >= bstr->_bits; i--) {
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-    assert(!_bstr_is_ptr_out_of_bounds(bstr, i));
+  return bstr_kernel_next(_bstr_view(bstr), offset, 0U);
+}
+
+int bstr_next_unset_bit(const bstr_bitstr_t *const bstr, unsigned int offset) {
+#ifdef DEBUG
+  assert(bstr != NULL);
 #endif
-    if (*i == 0) {
-      result += sizeof(unsigned int) * CHAR_BIT;
-      continue;
-    } else {
-      return result + __builtin_clz(*i);
-    }
-  }
-  return result;
+  return bstr_kernel_next(_bstr_view(bstr), offset, ~0U);
 }
 
-int bstr_popcnt(const bstr_bitstr_t *const bstr) {
+void bstr_set_range(bstr_bitstr_t *const bstr, unsigned int start,
+                    unsigned int n) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  unsigned int *targetptr = bstr->_bits + bstr->_capacity;
-  int popcnt = 0;
-  for (unsigned int *i = bstr->_bits; i < targetptr; i++) {
-#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
-    assert(!_bstr_is_ptr_out_of_bounds(bstr, i));
+  bstr_kernel_fill_range(_bstr_view(bstr), start, n, true);
+  _bstr_written(bstr, start, n);
+}
+
+void bstr_clr_range(bstr_bitstr_t *const bstr, unsigned int start,
+                    unsigned int n) {
+#ifdef DEBUG
+  assert(bstr != NULL);
 #endif
-    popcnt += __builtin_popcount(*i);
+  bstr_kernel_fill_range(_bstr_view(bstr), start, n, false);
+  _bstr_written(bstr, start, n);
+}
+
+int bstr_find_zero_run(const bstr_bitstr_t *const bstr, unsigned int n,
+                       unsigned int align, unsigned int hint) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert((align & (align - 1)) == 0);
+#endif
+  return bstr_kernel_find_run_from(_bstr_view(bstr), n, align, hint, ~0U);
+}
+
+int bstr_find_one_run(const bstr_bitstr_t *const bstr, unsigned int n,
+                      unsigned int align, unsigned int hint) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert((align & (align - 1)) == 0);
+#endif
+  return bstr_kernel_find_run_from(_bstr_view(bstr), n, align, hint, 0U);
+}
+
+int bstr_alloc_range(bstr_bitstr_t *const bstr, unsigned int n,
+                     unsigned int align, unsigned int hint) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert((align & (align - 1)) == 0);
+#endif
+  const bstr_view_t view = _bstr_view(bstr);
+  const int start = bstr_kernel_find_run_from(view, n, align, hint, ~0U);
+  if (start >= 0) {
+    bstr_kernel_fill_range(view, (unsigned int)start, n, true);
+    _bstr_written(bstr, (unsigned int)start, n);
   }
-  return popcnt;
+  return start;
 }
 
-int bstr_next_set_bit(const bstr_bitstr_t *const bstr, unsigned int offset) {
+void bstr_free_range(bstr_bitstr_t *const bstr, unsigned int start,
+                     unsigned int n) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  bstr_kernel_fill_range(_bstr_view(bstr), start, n, false);
+  _bstr_written(bstr, start, n);
+}
+
+bool bstr_is_empty(const bstr_bitstr_t *const bstr) {
 #ifdef DEBUG
   assert(bstr != NULL);
 #endif
-  const unsigned int cap = bstr_get_bit_capacity(bstr);
-  for (unsigned int i = offset; i < cap; i++) {
-    if (bstr_get(bstr, i))
+  return bstr_kernel_is_empty(_bstr_view(bstr));
+}
+
+bool bstr_equals(const bstr_bitstr_t *const a, const bstr_bitstr_t *const b) {
+#ifdef DEBUG
+  assert(a != NULL);
+  assert(b != NULL);
+#endif
+  return bstr_kernel_equals(_bstr_view(a), _bstr_view(b));
+}
+
+bool bstr_intersects(const bstr_bitstr_t *const a,
+                     const bstr_bitstr_t *const b) {
+#ifdef DEBUG
+  assert(a != NULL);
+  assert(b != NULL);
+#endif
+  return bstr_kernel_intersects(_bstr_view(a), _bstr_view(b));
+}
+
+bool bstr_is_subset(const bstr_bitstr_t *const a,
+                    const bstr_bitstr_t *const b) {
+#ifdef DEBUG
+  assert(a != NULL);
+  assert(b != NULL);
+#endif
+  return bstr_kernel_is_subset(_bstr_view(a), _bstr_view(b));
+}
+
+int bstr_compare(const bstr_bitstr_t *const a, const bstr_bitstr_t *const b) {
+#ifdef DEBUG
+  assert(a != NULL);
+  assert(b != NULL);
+#endif
+  return bstr_kernel_compare(_bstr_view(a), _bstr_view(b));
+}
+
+/* Word i of from ^ to, words of from past its capacity are 0. */
+static inline unsigned int _bstr_diff_word(const bstr_bitstr_t *const from,
+                                           const bstr_bitstr_t *const to,
+                                           unsigned int i) {
+  return (i < from->_capacity ? from->_bits[i] : 0U) ^ to->_bits[i];
+}
+
+/* Index of the first word >= i that differs or the capacity of to. */
+static unsigned int _bstr_diff_next(const bstr_bitstr_t *const from,
+                                    const bstr_bitstr_t *const to,
+                                    unsigned int i) {
+  const unsigned int common =
+      from->_capacity < to->_capacity ? from->_capacity : to->_capacity;
+  if (i < common) {
+    i += bstr_kernel_find_pair(&from->_bits[i], &to->_bits[i], common - i,
+                               BSTR_PAIR_XOR);
+    if (i < common)
       return i;
   }
-  return -1;
+  if (i >= to->_capacity)
+    return to->_capacity;
+  const int bit = bstr_kernel_next(
+      bstr_kernel_view(&to->_bits[i], to->_capacity - i), 0, 0U);
+  return bit < 0 ? to->_capacity
+                 : i + ((unsigned int)bit >> BSTR_BITS_PER_INT_SHIFT);
 }
 
-int bstr_next_unset_bit(const bstr_bitstr_t *const bstr, unsigned int offset) {
+unsigned int *bstr_diff(const bstr_bitstr_t *const from,
+                        const bstr_bitstr_t *const to,
+                        unsigned int *nwords) {
+#ifdef DEBUG
+  assert(from != NULL);
+  assert(to != NULL);
+  assert(nwords != NULL);
+#endif
+  const unsigned int n = to->_capacity;
+  unsigned int size = 16;
+  unsigned int used = 2;
+  unsigned int *patch = (unsigned int *)malloc(size * sizeof(unsigned int));
+  if (patch == NULL)
+    return NULL;
+  patch[0] = from->_capacity;
+  patch[1] = n;
+  for (unsigned int start = _bstr_diff_next(from, to, 0); start < n;) {
+    unsigned int end = start + 1U;
+    for (;;) {
+      while (end < n && _bstr_diff_word(from, to, end) != 0)
+        end++;
+      unsigned int gap = end;
+      while (gap < n && gap - end < BSTR_PATCH_MERGE_WORDS &&
+             _bstr_diff_word(from, to, gap) == 0)
+        gap++;
+      if (gap == n || gap - end == BSTR_PATCH_MERGE_WORDS)
+        break;
+      end = gap;
+    }
+    if (size - used < 2U + (end - start)) {
+      while (size - used < 2U + (end - start))
+        size *= 2U;
+      unsigned int *grown =
+          (unsigned int *)realloc(patch, size * sizeof(unsigned int));
+      if (grown == NULL) {
+        free(patch);
+        return NULL;
+      }
+      patch = grown;
+    }
+    patch[used++] = start;
+    patch[used++] = end - start;
+    for (unsigned int i = start; i < end; i++)
+      patch[used++] = _bstr_diff_word(from, to, i);
+    start = _bstr_diff_next(from, to, end);
+  }
+  *nwords = used;
+  return patch;
+}
+
+bstr_err_t bstr_apply(bstr_bitstr_t *const bstr, const unsigned int *patch,
+                      unsigned int nwords) {
 #ifdef DEBUG
   assert(bstr != NULL);
+  assert(patch != NULL);
 #endif
-  const unsigned int cap = bstr_get_bit_capacity(bstr);
-  for (unsigned int i = offset; i < cap; i++) {
-    if (!bstr_get(bstr, i))
-      return i;
+  if (nwords < 2 || patch[0] != bstr->_capacity || patch[1] == 0)
+    return BSTR_BAD_FORMAT;
+  const unsigned int capacity = patch[1];
+  unsigned int end = 0;
+  for (unsigned int i = 2; i < nwords;) {
+    if (nwords - i < 2U)
+      return BSTR_BAD_FORMAT;
+    const unsigned int start = patch[i];
+    const unsigned int length = patch[i + 1U];
+    if (length == 0 || start < end || start > capacity ||
+        length > capacity - start || length > nwords - i - 2U)
+      return BSTR_BAD_FORMAT;
+    end = start + length;
+    i += 2U + length;
   }
-  return -1;
+
+  if (capacity > bstr->_capacity &&
+      bstr_resize(bstr, capacity) != BSTR_NO_ERROR)
+    return BSTR_MALLOC_FAILED;
+  for (unsigned int i = 2; i < nwords;) {
+    const unsigned int start = patch[i];
+    const unsigned int length = patch[i + 1U];
+    const unsigned int *xor = &patch[i + 2U];
+    for (unsigned int w = 0; w < length; w++)
+      bstr->_bits[start + w] ^= xor[w];
+    _bstr_written(bstr, start << BSTR_BITS_PER_INT_SHIFT,
+                  length << BSTR_BITS_PER_INT_SHIFT);
+    i += 2U + length;
+  }
+  if (capacity < bstr->_capacity &&
+      bstr_resize(bstr, capacity) != BSTR_NO_ERROR)
+    return BSTR_MALLOC_FAILED;
+  return BSTR_NO_ERROR;
+}
+
+uint64_t bstr_hash(const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  uint64_t hash[2];
+  bstr_kernel_hash128(_bstr_view(bstr), hash);
+  return hash[0];
+}
+
+void bstr_hash128(const bstr_bitstr_t *const bstr, uint64_t hash[2]) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(hash != NULL);
+#endif
+  bstr_kernel_hash128(_bstr_view(bstr), hash);
+}
+
+int bstr_find_pattern(const bstr_bitstr_t *const bstr,
+                      const bstr_bitstr_t *const pattern,
+                      unsigned int pattern_bits, unsigned int offset) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(pattern != NULL);
+#endif
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+  assert(pattern_bits <= pattern->_capacity << BSTR_BITS_PER_INT_SHIFT);
+#endif
+  return bstr_kernel_find_pattern(_bstr_view(bstr), pattern->_bits,
+                                  pattern_bits, offset);
+}
+
+unsigned int bstr_find_all_pattern(const bstr_bitstr_t *const bstr,
+                                   const bstr_bitstr_t *const pattern,
+                                   unsigned int pattern_bits,
+                                   unsigned int *matches,
+                                   unsigned int max_matches) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(pattern != NULL);
+  assert(matches != NULL || max_matches == 0);
+#endif
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+  assert(pattern_bits <= pattern->_capacity << BSTR_BITS_PER_INT_SHIFT);
+#endif
+  return bstr_kernel_find_all_pattern(_bstr_view(bstr), pattern->_bits,
+                                      pattern_bits, matches, max_matches);
 }
 
 #ifdef __cplusplus
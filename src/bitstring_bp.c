@@ -0,0 +1,322 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_bp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BSTR_BP_POS_BITS 7U
+
+#define BSTR_BP_HDR_WIDTH(hdr) ((hdr)&0x3FU)
+#define BSTR_BP_HDR_EXCEPTIONS(hdr) (((hdr) >> 6) & 0xFFU)
+#define BSTR_BP_HDR_LENGTH(hdr) ((((hdr) >> 14) & 0x7FU) + 1U)
+#define BSTR_BP_HDR_FLAGS(hdr) (((hdr) >> 21) & 0x3U)
+
+static inline unsigned int _bstr_bp_words(unsigned int bits) {
+  return (bits + BSTR_BITS_PER_INT - 1U) >> BSTR_BITS_PER_INT_SHIFT;
+}
+
+unsigned int bstr_bp_max_words(unsigned int n) {
+  const unsigned int blocks = (n + BSTR_BP_BLOCK - 1U) / BSTR_BP_BLOCK;
+  /* Header, base and padding per block. A block never takes more than its
+   * values at 32 bits each, exceptions included. */
+  return blocks * (_bstr_bp_words(64U) + 2U) + _bstr_bp_words(32U) * n;
+}
+
+#if UINT_MAX == 0xFFFFFFFFU
+/*
+ * Packs 32 values into width words. It is instantiated once per width, so the
+ * loop unrolls into constant shifts without branches.
+ */
+static inline __attribute__((always_inline)) void
+_bstr_bp_pack32(const uint32_t *in, unsigned int *out,
+                const unsigned int width) {
+  const uint64_t mask = width < 32 ? (UINT64_C(1) << width) - 1U : 0xFFFFFFFFU;
+  uint64_t acc = 0;
+  unsigned int filled = 0;
+#pragma GCC unroll 32
+  for (unsigned int k = 0; k < 32; k++) {
+    acc |= (in[k] & mask) << filled;
+    filled += width;
+    if (filled >= 32) {
+      *out++ = (unsigned int)acc;
+      acc >>= 32;
+      filled -= 32;
+    }
+  }
+}
+
+#define BSTR_BP_DEFINE_PACK(width)                                             \
+  static void _bstr_bp_pack_##width(const uint32_t *in, unsigned int *out) {  \
+    for (unsigned int j = 0; j < BSTR_BP_BLOCK / 32U; j++)                     \
+      _bstr_bp_pack32(&in[j * 32U], &out[j * width], width);                  \
+  }
+
+BSTR_BP_DEFINE_PACK(1)
+BSTR_BP_DEFINE_PACK(2)
+BSTR_BP_DEFINE_PACK(3)
+BSTR_BP_DEFINE_PACK(4)
+BSTR_BP_DEFINE_PACK(5)
+BSTR_BP_DEFINE_PACK(6)
+BSTR_BP_DEFINE_PACK(7)
+BSTR_BP_DEFINE_PACK(8)
+BSTR_BP_DEFINE_PACK(9)
+BSTR_BP_DEFINE_PACK(10)
+BSTR_BP_DEFINE_PACK(11)
+BSTR_BP_DEFINE_PACK(12)
+BSTR_BP_DEFINE_PACK(13)
+BSTR_BP_DEFINE_PACK(14)
+BSTR_BP_DEFINE_PACK(15)
+BSTR_BP_DEFINE_PACK(16)
+BSTR_BP_DEFINE_PACK(17)
+BSTR_BP_DEFINE_PACK(18)
+BSTR_BP_DEFINE_PACK(19)
+BSTR_BP_DEFINE_PACK(20)
+BSTR_BP_DEFINE_PACK(21)
+BSTR_BP_DEFINE_PACK(22)
+BSTR_BP_DEFINE_PACK(23)
+BSTR_BP_DEFINE_PACK(24)
+BSTR_BP_DEFINE_PACK(25)
+BSTR_BP_DEFINE_PACK(26)
+BSTR_BP_DEFINE_PACK(27)
+BSTR_BP_DEFINE_PACK(28)
+BSTR_BP_DEFINE_PACK(29)
+BSTR_BP_DEFINE_PACK(30)
+BSTR_BP_DEFINE_PACK(31)
+BSTR_BP_DEFINE_PACK(32)
+
+/* Full blocks, indexed by width - 1. */
+static void (*const _bstr_bp_pack[32])(const uint32_t *, unsigned int *) = {
+    _bstr_bp_pack_1,  _bstr_bp_pack_2,  _bstr_bp_pack_3,  _bstr_bp_pack_4,
+    _bstr_bp_pack_5,  _bstr_bp_pack_6,  _bstr_bp_pack_7,  _bstr_bp_pack_8,
+    _bstr_bp_pack_9,  _bstr_bp_pack_10, _bstr_bp_pack_11, _bstr_bp_pack_12,
+    _bstr_bp_pack_13, _bstr_bp_pack_14, _bstr_bp_pack_15, _bstr_bp_pack_16,
+    _bstr_bp_pack_17, _bstr_bp_pack_18, _bstr_bp_pack_19, _bstr_bp_pack_20,
+    _bstr_bp_pack_21, _bstr_bp_pack_22, _bstr_bp_pack_23, _bstr_bp_pack_24,
+    _bstr_bp_pack_25, _bstr_bp_pack_26, _bstr_bp_pack_27, _bstr_bp_pack_28,
+    _bstr_bp_pack_29, _bstr_bp_pack_30, _bstr_bp_pack_31, _bstr_bp_pack_32};
+#endif
+
+/*
+ * Picks the width that minimizes payload plus exceptions.
+ */
+static unsigned int _bstr_bp_best_width(const uint32_t *vals, unsigned int m,
+                                        unsigned int *exceptions) {
+  *exceptions = 0;
+  uint32_t any = 0;
+  for (unsigned int i = 0; i < m; i++)
+    any |= vals[i];
+  if (any <= 1U)
+    return any;
+  /* hist[w] counts the values that are exactly w bits wide. Four of them, so
+   * that runs of equally wide values don't wait on each other's increments. */
+  unsigned int hists[4][33] = {{0}};
+  for (unsigned int i = 0; i < m; i++)
+    hists[i & 3U][vals[i] != 0 ? 32 - __builtin_clz(vals[i]) : 0]++;
+  const unsigned int width = 32U - __builtin_clz(any);
+  unsigned int best = width;
+  unsigned int best_bits = m * width;
+  unsigned int above = 0;
+  for (unsigned int b = width; b-- > 0;) {
+    above += hists[0][b + 1] + hists[1][b + 1] + hists[2][b + 1] +
+             hists[3][b + 1];
+    const unsigned int bits = m * b + above * (BSTR_BP_POS_BITS + 32U - b);
+    if (bits < best_bits) {
+      best = b;
+      best_bits = bits;
+      *exceptions = above;
+    }
+  }
+  return best;
+}
+
+static unsigned int _bstr_bp_encode_block(const bstr_view_t v,
+                                          unsigned int word, uint32_t *vals,
+                                          unsigned int m, unsigned int flags) {
+  const unsigned int start = word;
+  uint32_t base = 0;
+  if (flags & BSTR_BP_FOR) {
+    base = vals[0];
+    for (unsigned int i = 1; i < m; i++)
+      base = vals[i] < base ? vals[i] : base;
+    for (unsigned int i = 0; i < m; i++)
+      vals[i] -= base;
+  }
+  unsigned int exceptions;
+  const unsigned int width = _bstr_bp_best_width(vals, m, &exceptions);
+
+  bstr_kernel_set_field(v, word << BSTR_BITS_PER_INT_SHIFT, 32,
+                        (uint32_t)width | (uint32_t)exceptions << 6 |
+                            (uint32_t)(m - 1U) << 14 | (uint32_t)flags << 21);
+  word += _bstr_bp_words(32U);
+  if (flags & BSTR_BP_FOR) {
+    bstr_kernel_set_field(v, word << BSTR_BITS_PER_INT_SHIFT, 32, base);
+    word += _bstr_bp_words(32U);
+  }
+  if (width > 0) {
+    const unsigned int nwords = _bstr_bp_words(m * width);
+#if UINT_MAX == 0xFFFFFFFFU
+    if (m == BSTR_BP_BLOCK)
+      _bstr_bp_pack[width - 1U](vals, &v.words[word]);
+    else
+#endif
+    {
+      v.words[word + nwords - 1U] = 0;
+      bstr_kernel_pack_fields(v, word << BSTR_BITS_PER_INT_SHIFT, width, vals,
+                              m);
+    }
+    word += nwords;
+  }
+  if (exceptions > 0) {
+    uint32_t pos[BSTR_BP_BLOCK];
+    uint32_t high[BSTR_BP_BLOCK];
+    unsigned int e = 0;
+    for (unsigned int i = 0; i < m; i++) {
+      pos[e] = i;
+      high[e] = vals[i] >> width;
+      e += high[e] != 0;
+    }
+    const unsigned int pos_bits = exceptions * BSTR_BP_POS_BITS;
+    const unsigned int nwords =
+        _bstr_bp_words(pos_bits + exceptions * (32U - width));
+    v.words[word + nwords - 1U] = 0;
+    bstr_kernel_pack_fields(v, word << BSTR_BITS_PER_INT_SHIFT,
+                            BSTR_BP_POS_BITS, pos, exceptions);
+    bstr_kernel_pack_fields(v, (word << BSTR_BITS_PER_INT_SHIFT) + pos_bits,
+                            32U - width, high, exceptions);
+    word += nwords;
+  }
+  return word - start;
+}
+
+unsigned int bstr_bp_encode(bstr_bitstr_t *const bstr, unsigned int offset,
+                            const uint32_t *in, unsigned int n,
+                            unsigned int flags) {
+#ifdef DEBUG
+  assert(n == 0 || in != NULL);
+  assert((flags & ~(BSTR_BP_DELTA | BSTR_BP_FOR)) == 0);
+  assert(offset <= bstr->_capacity &&
+         bstr->_capacity - offset >= bstr_bp_max_words(n));
+#endif
+  const bstr_view_t v = _bstr_view(bstr);
+  uint32_t vals[BSTR_BP_BLOCK];
+  uint32_t prev = 0;
+  unsigned int word = offset;
+  for (unsigned int first = 0; first < n; first += BSTR_BP_BLOCK) {
+    const unsigned int m =
+        n - first < BSTR_BP_BLOCK ? n - first : BSTR_BP_BLOCK;
+    if (flags & BSTR_BP_DELTA) {
+      for (unsigned int i = 0; i < m; i++) {
+        vals[i] = in[first + i] - prev;
+        prev = in[first + i];
+      }
+    } else {
+      memcpy(vals, &in[first], m * sizeof(uint32_t));
+    }
+    word += _bstr_bp_encode_block(v, word, vals, m, flags);
+  }
+  _bstr_written_words(bstr, offset, word - offset);
+  return word - offset;
+}
+
+/*
+ * Unpacks the payload with the dispatched kernel, which reads one unsigned
+ * int past the last field. The fields that need it at the very end of the
+ * bitstring are read one by one.
+ */
+static void _bstr_bp_unpack(const bstr_view_t v, unsigned int word,
+                            unsigned int width, unsigned int m,
+                            uint32_t *out) {
+  unsigned int safe = m;
+  if (word + _bstr_bp_words(m * width) >= v.nwords)
+    safe = m > 32U ? m - 32U : 0;
+  bstr_dispatch_unpack(&v.words[word], width, 0, safe, out);
+  for (unsigned int i = safe; i < m; i++)
+    out[i] = (uint32_t)bstr_kernel_get_field(
+        v, (word << BSTR_BITS_PER_INT_SHIFT) + i * width, width);
+}
+
+unsigned int bstr_bp_decode(const bstr_bitstr_t *const bstr,
+                            unsigned int offset, uint32_t *out,
+                            unsigned int n) {
+#ifdef DEBUG
+  assert(n == 0 || out != NULL);
+#endif
+  const bstr_view_t v = _bstr_view(bstr);
+  uint32_t prev = 0;
+  unsigned int word = offset;
+  for (unsigned int first = 0; first < n; first += BSTR_BP_BLOCK) {
+    const uint32_t hdr =
+        (uint32_t)bstr_kernel_get_field(v, word << BSTR_BITS_PER_INT_SHIFT, 32);
+    const unsigned int width = BSTR_BP_HDR_WIDTH(hdr);
+    const unsigned int exceptions = BSTR_BP_HDR_EXCEPTIONS(hdr);
+    const unsigned int m = BSTR_BP_HDR_LENGTH(hdr);
+    const unsigned int flags = BSTR_BP_HDR_FLAGS(hdr);
+    uint32_t *vals = &out[first];
+#ifdef DEBUG
+    assert(m == (n - first < BSTR_BP_BLOCK ? n - first : BSTR_BP_BLOCK));
+#endif
+    word += _bstr_bp_words(32U);
+    uint32_t base = 0;
+    if (flags & BSTR_BP_FOR) {
+      base = (uint32_t)bstr_kernel_get_field(v, word << BSTR_BITS_PER_INT_SHIFT,
+                                             32);
+      word += _bstr_bp_words(32U);
+    }
+    if (width > 0) {
+      _bstr_bp_unpack(v, word, width, m, vals);
+      word += _bstr_bp_words(m * width);
+    } else {
+      memset(vals, 0, m * sizeof(uint32_t));
+    }
+    if (exceptions > 0) {
+      const unsigned int bit = word << BSTR_BITS_PER_INT_SHIFT;
+      const unsigned int pos_bits = exceptions * BSTR_BP_POS_BITS;
+      for (unsigned int e = 0; e < exceptions; e++) {
+        const unsigned int i = (unsigned int)bstr_kernel_get_field(
+            v, bit + e * BSTR_BP_POS_BITS, BSTR_BP_POS_BITS);
+        vals[i] |= (uint32_t)bstr_kernel_get_field(
+                       v, bit + pos_bits + e * (32U - width), 32U - width)
+                   << width;
+      }
+      word += _bstr_bp_words(pos_bits + exceptions * (32U - width));
+    }
+    if (flags & BSTR_BP_DELTA) {
+      for (unsigned int i = 0; i < m; i++) {
+        prev += vals[i] + base;
+        vals[i] = prev;
+      }
+    } else if (base != 0) {
+      for (unsigned int i = 0; i < m; i++)
+        vals[i] += base;
+    }
+  }
+  return word - offset;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,145 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_checkpoint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BSTR_CHECKPOINT_HEADER_WORDS 5U
+
+/* The chunk after chunk - 1 that goes into the record or -1. */
+static inline int _bstr_checkpoint_next(const bstr_bitstr_t *const bstr,
+                                        unsigned int chunk,
+                                        unsigned int nchunks) {
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr_dirty_enabled(bstr))
+    return bstr_dirty_next(bstr, chunk);
+#else
+  (void)bstr;
+#endif
+  return chunk < nchunks ? (int)chunk : -1;
+}
+
+static inline unsigned int _bstr_checkpoint_words(unsigned int capacity,
+                                                  unsigned int chunk_words,
+                                                  unsigned int chunk) {
+  const unsigned int first = chunk * chunk_words;
+  return capacity - first < chunk_words ? capacity - first : chunk_words;
+}
+
+bstr_err_t bstr_checkpoint_write(bstr_bitstr_t *const bstr, FILE *out) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(out != NULL);
+#endif
+  const unsigned int nchunks = (bstr->_capacity + BSTR_DIRTY_CHUNK_WORDS - 1U) /
+                               BSTR_DIRTY_CHUNK_WORDS;
+  uint32_t count = 0;
+  for (int c = _bstr_checkpoint_next(bstr, 0, nchunks); c >= 0;
+       c = _bstr_checkpoint_next(bstr, (unsigned int)c + 1U, nchunks))
+    count++;
+  const uint32_t header[BSTR_CHECKPOINT_HEADER_WORDS] = {
+      BSTR_CHECKPOINT_MAGIC, (uint32_t)sizeof(unsigned int), bstr->_capacity,
+      BSTR_DIRTY_CHUNK_WORDS, count};
+  if (fwrite(header, sizeof(uint32_t), BSTR_CHECKPOINT_HEADER_WORDS, out) !=
+      BSTR_CHECKPOINT_HEADER_WORDS)
+    return BSTR_IO_ERROR;
+  for (int c = _bstr_checkpoint_next(bstr, 0, nchunks); c >= 0;
+       c = _bstr_checkpoint_next(bstr, (unsigned int)c + 1U, nchunks)) {
+    const uint32_t index = (uint32_t)c;
+    const unsigned int nwords = _bstr_checkpoint_words(
+        bstr->_capacity, BSTR_DIRTY_CHUNK_WORDS, (unsigned int)c);
+    if (fwrite(&index, sizeof(uint32_t), 1, out) != 1 ||
+        fwrite(&bstr->_bits[(unsigned int)c * BSTR_DIRTY_CHUNK_WORDS],
+               sizeof(unsigned int), nwords, out) != nwords)
+      return BSTR_IO_ERROR;
+  }
+  if (fflush(out) != 0)
+    return BSTR_IO_ERROR;
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  if (bstr_dirty_enabled(bstr))
+    bstr_dirty_clr_all(bstr);
+#endif
+  return BSTR_NO_ERROR;
+}
+
+static inline bstr_err_t _bstr_checkpoint_read_error(FILE *in) {
+  return ferror(in) ? BSTR_IO_ERROR : BSTR_BAD_FORMAT;
+}
+
+bstr_err_t bstr_checkpoint_replay(bstr_bitstr_t *const bstr, FILE *in) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(in != NULL);
+#endif
+  uint32_t header[BSTR_CHECKPOINT_HEADER_WORDS];
+  for (;;) {
+    const size_t got =
+        fread(header, sizeof(uint32_t), BSTR_CHECKPOINT_HEADER_WORDS, in);
+    if (got == 0 && feof(in))
+      return BSTR_NO_ERROR;
+    if (got != BSTR_CHECKPOINT_HEADER_WORDS)
+      return _bstr_checkpoint_read_error(in);
+    const unsigned int capacity = header[2];
+    const unsigned int chunk_words = header[3];
+    if (header[0] != BSTR_CHECKPOINT_MAGIC ||
+        header[1] != sizeof(unsigned int) || capacity == 0 ||
+        chunk_words == 0)
+      return BSTR_BAD_FORMAT;
+    if (bstr_resize(bstr, capacity) != BSTR_NO_ERROR)
+      return BSTR_MALLOC_FAILED;
+    const unsigned int nchunks = (capacity + chunk_words - 1U) / chunk_words;
+    unsigned int *buffer = (unsigned int *)malloc(
+        (chunk_words < capacity ? chunk_words : capacity) *
+        sizeof(unsigned int));
+    if (buffer == NULL)
+      return BSTR_MALLOC_FAILED;
+    for (uint32_t i = 0; i < header[4]; i++) {
+      uint32_t index;
+      if (fread(&index, sizeof(uint32_t), 1, in) != 1) {
+        free(buffer);
+        return _bstr_checkpoint_read_error(in);
+      }
+      if (index >= nchunks) {
+        free(buffer);
+        return BSTR_BAD_FORMAT;
+      }
+      const unsigned int nwords =
+          _bstr_checkpoint_words(capacity, chunk_words, index);
+      if (fread(buffer, sizeof(unsigned int), nwords, in) != nwords) {
+        free(buffer);
+        return _bstr_checkpoint_read_error(in);
+      }
+      /* Keeps the popcount cache and dirty tracking of bstr up to date. */
+      bstr_set_words(bstr, index * chunk_words, buffer, nwords);
+    }
+    free(buffer);
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
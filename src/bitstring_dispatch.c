@@ -0,0 +1,1183 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_dispatch.h"
+#include "string.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) &&         \
+    UINT_MAX == 0xFFFFFFFFU
+#define BSTR_DISPATCH_X86
+#include <immintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct bstr_dispatch_table_t {
+  bstr_backend_t backend;
+  uint64_t (*popcnt)(const unsigned int *words, size_t nwords);
+  size_t (*find)(const unsigned int *words, size_t nwords,
+                 unsigned int invert);
+  size_t (*rfind)(const unsigned int *words, size_t nwords);
+  size_t (*find_pair)(const unsigned int *a, const unsigned int *b,
+                      size_t nwords, bstr_pair_op_t op);
+  void (*hash_stripes)(const unsigned int *words, size_t first,
+                       size_t nstripes, uint64_t acc[4]);
+  size_t (*find_prefix16)(const unsigned int *words, size_t nwords,
+                          unsigned int prefix);
+  void (*unpack)(const unsigned int *words, unsigned int width, size_t first,
+                 size_t n, uint32_t *out);
+  void (*positional_popcnt)(const unsigned int *const *rows, size_t nrows,
+                            size_t nwords, uint32_t *counts);
+  void (*hamming)(const unsigned int *query, const unsigned int *rows,
+                  size_t nrows, size_t nwords, uint32_t *out);
+} bstr_dispatch_table_t;
+
+/*
+ * The content hash. The words are cut into stripes of four 64 bit lanes. Lane k
+ * of stripe j is mixed into the accumulators as
+ *
+ *   key = secret[k] + j * BSTR_HASH_STEP, d' = d ^ key
+ *   acc[k] += lo32(d') * hi32(d'), acc[k ^ 1] += d
+ *
+ * which every backend computes bit for bit identical. The last partial stripe
+ * is zero padded and the number of words is mixed into the result, so the
+ * hash is stable across runs, CPUs and backends and differs for bitstrings of
+ * different capacity.
+ */
+
+#if UINT_MAX == 0xFFFFFFFFU
+#define BSTR_HASH_WORDS_PER_LANE 2
+#else
+#define BSTR_HASH_WORDS_PER_LANE 1
+#endif
+#define BSTR_HASH_STRIPE_WORDS (4 * BSTR_HASH_WORDS_PER_LANE)
+#define BSTR_HASH_STEP 0x9E3779B97F4A7C15ULL
+
+static const uint64_t _bstr_hash_secret[4] = {
+    0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x85EBCA77C2B2AE63ULL,
+    0x27D4EB2F165667C5ULL};
+
+static inline uint64_t _bstr_hash_lane(const unsigned int *stripe, int k) {
+#if BSTR_HASH_WORDS_PER_LANE == 2
+  return (uint64_t)stripe[2 * k] | ((uint64_t)stripe[2 * k + 1] << 32);
+#else
+  return (uint64_t)stripe[k];
+#endif
+}
+
+static inline uint64_t _bstr_hash_fmix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/* stripes points to stripe number first. */
+static void _bstr_scalar_hash_stripes_from(const unsigned int *stripes,
+                                           size_t first, size_t nstripes,
+                                           uint64_t acc[4]) {
+  for (size_t j = first; j < first + nstripes; j++) {
+    const unsigned int *stripe =
+        &stripes[(j - first) * BSTR_HASH_STRIPE_WORDS];
+    for (int k = 0; k < 4; k++) {
+      const uint64_t d = _bstr_hash_lane(stripe, k);
+      const uint64_t dk = d ^ (_bstr_hash_secret[k] + j * BSTR_HASH_STEP);
+      acc[k] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+      acc[k ^ 1] += d;
+    }
+  }
+}
+
+/*
+ * Scalar backend.
+ */
+
+static uint64_t _bstr_scalar_popcnt(const unsigned int *words, size_t nwords) {
+  uint64_t popcnt = 0;
+  for (size_t i = 0; i < nwords; i++)
+    popcnt += (uint64_t)__builtin_popcount(words[i]);
+  return popcnt;
+}
+
+static size_t _bstr_scalar_find(const unsigned int *words, size_t nwords,
+                                unsigned int invert) {
+  for (size_t i = 0; i < nwords; i++)
+    if ((words[i] ^ invert) != 0)
+      return i;
+  return nwords;
+}
+
+static size_t _bstr_scalar_rfind(const unsigned int *words, size_t nwords) {
+  for (size_t i = nwords; i > 0; i--)
+    if (words[i - 1] != 0)
+      return i;
+  return 0;
+}
+
+static size_t _bstr_scalar_find_pair(const unsigned int *a,
+                                     const unsigned int *b, size_t nwords,
+                                     bstr_pair_op_t op) {
+  size_t i = 0;
+  switch (op) {
+  case BSTR_PAIR_AND:
+    while (i < nwords && (a[i] & b[i]) == 0)
+      i++;
+    break;
+  case BSTR_PAIR_ANDNOT:
+    while (i < nwords && (a[i] & ~b[i]) == 0)
+      i++;
+    break;
+  case BSTR_PAIR_XOR:
+    while (i < nwords && a[i] == b[i])
+      i++;
+    break;
+  }
+  return i;
+}
+
+/*
+ * All 16 bit windows starting in one word are compared at once: bit s of cand
+ * survives step j when bit s + j of the text equals bit j of the prefix.
+ */
+static size_t _bstr_scalar_find_prefix16(const unsigned int *words,
+                                         size_t nwords, unsigned int prefix) {
+  unsigned int want[16];
+  for (unsigned int j = 0; j < 16; j++)
+    want[j] = (prefix >> j) & 1U ? 0U : ~0U;
+  for (size_t i = 0; i < nwords; i++) {
+    const unsigned int lo = words[i];
+    const unsigned int hi = words[i + 1];
+    unsigned int cand = lo ^ want[0];
+    for (unsigned int j = 1; j < 16; j++)
+      cand &= ((lo >> j) | (hi << (BSTR_BITS_PER_INT - j))) ^ want[j];
+    if (cand != 0)
+      return i;
+  }
+  return nwords;
+}
+
+static void _bstr_scalar_unpack(const unsigned int *words, unsigned int width,
+                                size_t first, size_t n, uint32_t *out) {
+  const uint32_t mask = width < 32 ? (1U << width) - 1U : ~0U;
+  size_t bit = first * width;
+  for (size_t i = 0; i < n; i++, bit += width) {
+    const unsigned int *word = &words[bit >> BSTR_BITS_PER_INT_SHIFT];
+    const unsigned int off = bit & BSTR_BITS_PER_INT_MASK;
+    const unsigned int hi =
+        off != 0 ? word[1] << (BSTR_BITS_PER_INT - off) : 0U;
+    out[i] = (uint32_t)((word[0] >> off) | hi) & mask;
+  }
+}
+
+/*
+ * Positional popcount. Every 16 rows of a word go through the Harley-Seal
+ * carry save adder tree. Only the sixteens it hands out are expanded into the
+ * per bit counts, the lower slices once at the end.
+ */
+
+static inline void _bstr_scalar_csa(unsigned int *h, unsigned int *l,
+                                    unsigned int a, unsigned int b,
+                                    unsigned int c) {
+  const unsigned int u = a ^ b;
+  *h = (a & b) | (u & c);
+  *l = u ^ c;
+}
+
+static inline void _bstr_scalar_add_bits(uint32_t *counts, unsigned int word,
+                                         unsigned int shift) {
+  for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++)
+    counts[b] += (uint32_t)((word >> b) & 1U) << shift;
+}
+
+static void _bstr_scalar_positional_popcnt_from(const unsigned int *const *rows,
+                                                size_t nrows, size_t first,
+                                                size_t nwords,
+                                                uint32_t *counts) {
+  for (size_t w = first; w < nwords; w++) {
+    uint32_t *c = &counts[w * BSTR_BITS_PER_INT];
+    unsigned int ones = 0, twos = 0, fours = 0, eights = 0;
+    unsigned int sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    size_t r = 0;
+#define BSTR_SCALAR_ROW(n) rows[r + (n)][w]
+    for (; r + 16 <= nrows; r += 16) {
+      _bstr_scalar_csa(&twos_a, &ones, ones, BSTR_SCALAR_ROW(0),
+                       BSTR_SCALAR_ROW(1));
+      _bstr_scalar_csa(&twos_b, &ones, ones, BSTR_SCALAR_ROW(2),
+                       BSTR_SCALAR_ROW(3));
+      _bstr_scalar_csa(&fours_a, &twos, twos, twos_a, twos_b);
+      _bstr_scalar_csa(&twos_a, &ones, ones, BSTR_SCALAR_ROW(4),
+                       BSTR_SCALAR_ROW(5));
+      _bstr_scalar_csa(&twos_b, &ones, ones, BSTR_SCALAR_ROW(6),
+                       BSTR_SCALAR_ROW(7));
+      _bstr_scalar_csa(&fours_b, &twos, twos, twos_a, twos_b);
+      _bstr_scalar_csa(&eights_a, &fours, fours, fours_a, fours_b);
+      _bstr_scalar_csa(&twos_a, &ones, ones, BSTR_SCALAR_ROW(8),
+                       BSTR_SCALAR_ROW(9));
+      _bstr_scalar_csa(&twos_b, &ones, ones, BSTR_SCALAR_ROW(10),
+                       BSTR_SCALAR_ROW(11));
+      _bstr_scalar_csa(&fours_a, &twos, twos, twos_a, twos_b);
+      _bstr_scalar_csa(&twos_a, &ones, ones, BSTR_SCALAR_ROW(12),
+                       BSTR_SCALAR_ROW(13));
+      _bstr_scalar_csa(&twos_b, &ones, ones, BSTR_SCALAR_ROW(14),
+                       BSTR_SCALAR_ROW(15));
+      _bstr_scalar_csa(&fours_b, &twos, twos, twos_a, twos_b);
+      _bstr_scalar_csa(&eights_b, &fours, fours, fours_a, fours_b);
+      _bstr_scalar_csa(&sixteens, &eights, eights, eights_a, eights_b);
+      _bstr_scalar_add_bits(c, sixteens, 4);
+    }
+    /* The last rows ripple through half adders one at a time. */
+    for (; r < nrows; r++) {
+      unsigned int carry = BSTR_SCALAR_ROW(0);
+      _bstr_scalar_csa(&carry, &ones, ones, carry, 0U);
+      _bstr_scalar_csa(&carry, &twos, twos, carry, 0U);
+      _bstr_scalar_csa(&carry, &fours, fours, carry, 0U);
+      _bstr_scalar_csa(&carry, &eights, eights, carry, 0U);
+      _bstr_scalar_add_bits(c, carry, 4);
+    }
+#undef BSTR_SCALAR_ROW
+    _bstr_scalar_add_bits(c, eights, 3);
+    _bstr_scalar_add_bits(c, fours, 2);
+    _bstr_scalar_add_bits(c, twos, 1);
+    _bstr_scalar_add_bits(c, ones, 0);
+  }
+}
+
+static void _bstr_scalar_positional_popcnt(const unsigned int *const *rows,
+                                           size_t nrows, size_t nwords,
+                                           uint32_t *counts) {
+  _bstr_scalar_positional_popcnt_from(rows, nrows, 0, nwords, counts);
+}
+
+static void _bstr_scalar_hamming(const unsigned int *query,
+                                 const unsigned int *rows, size_t nrows,
+                                 size_t nwords, uint32_t *out) {
+  for (size_t r = 0; r < nrows; r++, rows += nwords) {
+    uint32_t distance = 0;
+    for (size_t i = 0; i < nwords; i++)
+      distance += (uint32_t)__builtin_popcount(query[i] ^ rows[i]);
+    out[r] = distance;
+  }
+}
+
+static const bstr_dispatch_table_t _bstr_scalar_table = {
+    .backend = BSTR_BACKEND_SCALAR,
+    .popcnt = _bstr_scalar_popcnt,
+    .find = _bstr_scalar_find,
+    .rfind = _bstr_scalar_rfind,
+    .find_pair = _bstr_scalar_find_pair,
+    .hash_stripes = _bstr_scalar_hash_stripes_from,
+    .find_prefix16 = _bstr_scalar_find_prefix16,
+    .unpack = _bstr_scalar_unpack,
+    .positional_popcnt = _bstr_scalar_positional_popcnt,
+    .hamming = _bstr_scalar_hamming,
+};
+
+#ifdef BSTR_DISPATCH_X86
+
+/*
+ * POPCNT backend, counts two unsigned ints per instruction. The scans are the
+ * scalar ones.
+ */
+
+__attribute__((target("popcnt"))) static uint64_t
+_bstr_popcnt_popcnt(const unsigned int *words, size_t nwords) {
+  uint64_t popcnt = 0;
+  size_t i = 0;
+  for (; i + 2 <= nwords; i += 2) {
+    uint64_t pair;
+    memcpy(&pair, &words[i], sizeof(pair));
+    popcnt += (uint64_t)__builtin_popcountll(pair);
+  }
+  if (i < nwords)
+    popcnt += (uint64_t)__builtin_popcount(words[i]);
+  return popcnt;
+}
+
+__attribute__((target("popcnt"))) static void
+_bstr_popcnt_hamming(const unsigned int *query, const unsigned int *rows,
+                     size_t nrows, size_t nwords, uint32_t *out) {
+  for (size_t r = 0; r < nrows; r++, rows += nwords) {
+    uint32_t distance = 0;
+    size_t i = 0;
+    for (; i + 2 <= nwords; i += 2) {
+      uint64_t q, w;
+      memcpy(&q, &query[i], sizeof(q));
+      memcpy(&w, &rows[i], sizeof(w));
+      distance += (uint32_t)__builtin_popcountll(q ^ w);
+    }
+    if (i < nwords)
+      distance += (uint32_t)__builtin_popcount(query[i] ^ rows[i]);
+    out[r] = distance;
+  }
+}
+
+static const bstr_dispatch_table_t _bstr_popcnt_table = {
+    .backend = BSTR_BACKEND_POPCNT,
+    .popcnt = _bstr_popcnt_popcnt,
+    .find = _bstr_scalar_find,
+    .rfind = _bstr_scalar_rfind,
+    .find_pair = _bstr_scalar_find_pair,
+    .hash_stripes = _bstr_scalar_hash_stripes_from,
+    .find_prefix16 = _bstr_scalar_find_prefix16,
+    .unpack = _bstr_scalar_unpack,
+    .positional_popcnt = _bstr_scalar_positional_popcnt,
+    .hamming = _bstr_popcnt_hamming,
+};
+
+/*
+ * AVX2 backend. popcnt is the Harley-Seal carry save adder tree over 16
+ * vectors, with a nibble lookup (vpshufb) popcount per vector.
+ */
+
+#define BSTR_AVX2_WORDS (sizeof(__m256i) / sizeof(unsigned int))
+
+__attribute__((target("avx2"))) static inline __m256i
+_bstr_avx2_popcnt8(__m256i v) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_mask));
+  const __m256i hi = _mm256_shuffle_epi8(
+      lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+  return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) static inline void
+_bstr_avx2_csa(__m256i *h, __m256i *l, __m256i a, __m256i b, __m256i c) {
+  const __m256i u = _mm256_xor_si256(a, b);
+  *h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  *l = _mm256_xor_si256(u, c);
+}
+
+__attribute__((target("avx2"))) static uint64_t
+_bstr_avx2_popcnt(const unsigned int *words, size_t nwords) {
+  const __m256i *in = (const __m256i *)words;
+  const size_t nvec = nwords / BSTR_AVX2_WORDS;
+  __m256i total = _mm256_setzero_si256();
+  __m256i ones = _mm256_setzero_si256();
+  __m256i twos = _mm256_setzero_si256();
+  __m256i fours = _mm256_setzero_si256();
+  __m256i eights = _mm256_setzero_si256();
+  __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+  size_t i = 0;
+#define BSTR_AVX2_LOAD(n) _mm256_loadu_si256(in + i + (n))
+  for (; i + 16 <= nvec; i += 16) {
+    _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_LOAD(0), BSTR_AVX2_LOAD(1));
+    _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_LOAD(2), BSTR_AVX2_LOAD(3));
+    _bstr_avx2_csa(&fours_a, &twos, twos, twos_a, twos_b);
+    _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_LOAD(4), BSTR_AVX2_LOAD(5));
+    _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_LOAD(6), BSTR_AVX2_LOAD(7));
+    _bstr_avx2_csa(&fours_b, &twos, twos, twos_a, twos_b);
+    _bstr_avx2_csa(&eights_a, &fours, fours, fours_a, fours_b);
+    _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_LOAD(8), BSTR_AVX2_LOAD(9));
+    _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_LOAD(10),
+                   BSTR_AVX2_LOAD(11));
+    _bstr_avx2_csa(&fours_a, &twos, twos, twos_a, twos_b);
+    _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_LOAD(12),
+                   BSTR_AVX2_LOAD(13));
+    _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_LOAD(14),
+                   BSTR_AVX2_LOAD(15));
+    _bstr_avx2_csa(&fours_b, &twos, twos, twos_a, twos_b);
+    _bstr_avx2_csa(&eights_b, &fours, fours, fours_a, fours_b);
+    _bstr_avx2_csa(&sixteens, &eights, eights, eights_a, eights_b);
+    total = _mm256_add_epi64(total, _bstr_avx2_popcnt8(sixteens));
+  }
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total,
+                           _mm256_slli_epi64(_bstr_avx2_popcnt8(eights), 3));
+  total =
+      _mm256_add_epi64(total, _mm256_slli_epi64(_bstr_avx2_popcnt8(fours), 2));
+  total =
+      _mm256_add_epi64(total, _mm256_slli_epi64(_bstr_avx2_popcnt8(twos), 1));
+  total = _mm256_add_epi64(total, _bstr_avx2_popcnt8(ones));
+  for (; i < nvec; i++)
+    total = _mm256_add_epi64(total, _bstr_avx2_popcnt8(BSTR_AVX2_LOAD(0)));
+#undef BSTR_AVX2_LOAD
+  uint64_t popcnt = (uint64_t)_mm256_extract_epi64(total, 0) +
+                    (uint64_t)_mm256_extract_epi64(total, 1) +
+                    (uint64_t)_mm256_extract_epi64(total, 2) +
+                    (uint64_t)_mm256_extract_epi64(total, 3);
+  for (size_t w = nvec * BSTR_AVX2_WORDS; w < nwords; w++)
+    popcnt += (uint64_t)__builtin_popcount(words[w]);
+  return popcnt;
+}
+
+__attribute__((target("avx2"))) static size_t
+_bstr_avx2_find(const unsigned int *words, size_t nwords,
+                unsigned int invert) {
+  const __m256i inv = _mm256_set1_epi32((int)invert);
+  size_t i = 0;
+  for (; i + BSTR_AVX2_WORDS <= nwords; i += BSTR_AVX2_WORDS) {
+    const __m256i v = _mm256_xor_si256(
+        _mm256_loadu_si256((const __m256i *)&words[i]), inv);
+    if (!_mm256_testz_si256(v, v))
+      break;
+  }
+  return i + _bstr_scalar_find(&words[i], nwords - i, invert);
+}
+
+__attribute__((target("avx2"))) static size_t
+_bstr_avx2_rfind(const unsigned int *words, size_t nwords) {
+  size_t i = nwords;
+  for (; i >= BSTR_AVX2_WORDS; i -= BSTR_AVX2_WORDS) {
+    const __m256i v =
+        _mm256_loadu_si256((const __m256i *)&words[i - BSTR_AVX2_WORDS]);
+    if (!_mm256_testz_si256(v, v))
+      break;
+  }
+  return _bstr_scalar_rfind(words, i);
+}
+
+/* vptest sets ZF when a & b == 0 and CF when ~a & b == 0. */
+__attribute__((target("avx2"))) static size_t
+_bstr_avx2_find_pair(const unsigned int *a, const unsigned int *b,
+                     size_t nwords, bstr_pair_op_t op) {
+  size_t i = 0;
+  for (; i + BSTR_AVX2_WORDS <= nwords; i += BSTR_AVX2_WORDS) {
+    const __m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+    const __m256i vb = _mm256_loadu_si256((const __m256i *)&b[i]);
+    int hit;
+    if (op == BSTR_PAIR_AND) {
+      hit = !_mm256_testz_si256(va, vb);
+    } else if (op == BSTR_PAIR_ANDNOT) {
+      hit = !_mm256_testc_si256(vb, va);
+    } else {
+      const __m256i diff = _mm256_xor_si256(va, vb);
+      hit = !_mm256_testz_si256(diff, diff);
+    }
+    if (hit)
+      break;
+  }
+  return i + _bstr_scalar_find_pair(&a[i], &b[i], nwords - i, op);
+}
+
+__attribute__((target("avx2"))) static size_t
+_bstr_avx2_find_prefix16(const unsigned int *words, size_t nwords,
+                         unsigned int prefix) {
+  __m256i want[16];
+  for (int j = 0; j < 16; j++)
+    want[j] = _mm256_set1_epi32((prefix >> j) & 1U ? 0 : -1);
+  size_t i = 0;
+  for (; i + BSTR_AVX2_WORDS <= nwords; i += BSTR_AVX2_WORDS) {
+    const __m256i lo = _mm256_loadu_si256((const __m256i *)&words[i]);
+    const __m256i hi = _mm256_loadu_si256((const __m256i *)&words[i + 1]);
+    __m256i cand = _mm256_xor_si256(lo, want[0]);
+    for (int j = 1; j < 16; j++) {
+      const __m256i text =
+          _mm256_or_si256(_mm256_srl_epi32(lo, _mm_cvtsi32_si128(j)),
+                          _mm256_sll_epi32(hi, _mm_cvtsi32_si128(32 - j)));
+      cand = _mm256_and_si256(cand, _mm256_xor_si256(text, want[j]));
+    }
+    if (!_mm256_testz_si256(cand, cand))
+      break;
+  }
+  return i + _bstr_scalar_find_prefix16(&words[i], nwords - i, prefix);
+}
+
+/* One stripe is exactly one vector, vpmuludq is the lo32 * hi32 product. */
+__attribute__((target("avx2"))) static void
+_bstr_avx2_hash_stripes(const unsigned int *words, size_t first,
+                        size_t nstripes, uint64_t acc[4]) {
+  __m256i vacc = _mm256_loadu_si256((const __m256i *)acc);
+  const __m256i step = _mm256_set1_epi64x((long long)BSTR_HASH_STEP);
+  __m256i key = _mm256_add_epi64(
+      _mm256_loadu_si256((const __m256i *)_bstr_hash_secret),
+      _mm256_set1_epi64x((long long)(first * BSTR_HASH_STEP)));
+  for (size_t j = 0; j < nstripes; j++) {
+    const __m256i d = _mm256_loadu_si256(
+        (const __m256i *)&words[j * BSTR_HASH_STRIPE_WORDS]);
+    const __m256i dk = _mm256_xor_si256(d, key);
+    vacc = _mm256_add_epi64(
+        vacc, _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32)));
+    vacc = _mm256_add_epi64(vacc,
+                            _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+    key = _mm256_add_epi64(key, step);
+  }
+  _mm256_storeu_si256((__m256i *)acc, vacc);
+}
+
+/*
+ * Lane j reads the two words around field first + i + j with a gather each and
+ * funnel shifts them. vpsllvd by 32 gives 0, so a field that does not
+ * straddle needs no special case.
+ */
+__attribute__((target("avx2"))) static void
+_bstr_avx2_unpack(const unsigned int *words, unsigned int width, size_t first,
+                  size_t n, uint32_t *out) {
+  const __m256i lanes = _mm256_mullo_epi32(
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)width));
+  const __m256i mask =
+      _mm256_set1_epi32(width < 32 ? (int)((1U << width) - 1U) : -1);
+  const __m256i thirty_one = _mm256_set1_epi32(31);
+  const __m256i thirty_two = _mm256_set1_epi32(32);
+  size_t i = 0;
+  for (; i + BSTR_AVX2_WORDS <= n; i += BSTR_AVX2_WORDS) {
+    const size_t bit = (first + i) * width;
+    const int *base = (const int *)&words[bit >> 5];
+    const __m256i rel =
+        _mm256_add_epi32(lanes, _mm256_set1_epi32((int)(bit & 31U)));
+    const __m256i idx = _mm256_srli_epi32(rel, 5);
+    const __m256i off = _mm256_and_si256(rel, thirty_one);
+    const __m256i back = _mm256_sub_epi32(thirty_two, off);
+    const __m256i lo = _mm256_i32gather_epi32(base, idx, 4);
+    const __m256i hi = _mm256_i32gather_epi32(base + 1, idx, 4);
+    const __m256i value = _mm256_or_si256(_mm256_srlv_epi32(lo, off),
+                                          _mm256_sllv_epi32(hi, back));
+    _mm256_storeu_si256((__m256i *)&out[i], _mm256_and_si256(value, mask));
+  }
+  _bstr_scalar_unpack(words, width, first + i, n - i, &out[i]);
+}
+
+/*
+ * Eight words per vector. acc[b] lane j counts the sixteens of bit b of word
+ * j, the counts are transposed into counts[] once per vector.
+ */
+__attribute__((target("avx2"))) static inline void
+_bstr_avx2_add_bits(__m256i acc[BSTR_BITS_PER_INT], __m256i word) {
+  const __m256i one = _mm256_set1_epi32(1);
+  for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++)
+    acc[b] = _mm256_add_epi32(
+        acc[b], _mm256_and_si256(
+                    _mm256_srl_epi32(word, _mm_cvtsi32_si128((int)b)), one));
+}
+
+__attribute__((target("avx2"))) static void
+_bstr_avx2_positional_popcnt(const unsigned int *const *rows, size_t nrows,
+                             size_t nwords, uint32_t *counts) {
+  const __m256i one = _mm256_set1_epi32(1);
+  size_t w = 0;
+  for (; w + BSTR_AVX2_WORDS <= nwords; w += BSTR_AVX2_WORDS) {
+    __m256i acc[BSTR_BITS_PER_INT];
+    for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++)
+      acc[b] = _mm256_setzero_si256();
+    __m256i ones = _mm256_setzero_si256();
+    __m256i twos = _mm256_setzero_si256();
+    __m256i fours = _mm256_setzero_si256();
+    __m256i eights = _mm256_setzero_si256();
+    __m256i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    size_t r = 0;
+#define BSTR_AVX2_ROW(n) _mm256_loadu_si256((const __m256i *)&rows[r + (n)][w])
+    for (; r + 16 <= nrows; r += 16) {
+      _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_ROW(0), BSTR_AVX2_ROW(1));
+      _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_ROW(2), BSTR_AVX2_ROW(3));
+      _bstr_avx2_csa(&fours_a, &twos, twos, twos_a, twos_b);
+      _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_ROW(4), BSTR_AVX2_ROW(5));
+      _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_ROW(6), BSTR_AVX2_ROW(7));
+      _bstr_avx2_csa(&fours_b, &twos, twos, twos_a, twos_b);
+      _bstr_avx2_csa(&eights_a, &fours, fours, fours_a, fours_b);
+      _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_ROW(8), BSTR_AVX2_ROW(9));
+      _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_ROW(10),
+                     BSTR_AVX2_ROW(11));
+      _bstr_avx2_csa(&fours_a, &twos, twos, twos_a, twos_b);
+      _bstr_avx2_csa(&twos_a, &ones, ones, BSTR_AVX2_ROW(12),
+                     BSTR_AVX2_ROW(13));
+      _bstr_avx2_csa(&twos_b, &ones, ones, BSTR_AVX2_ROW(14),
+                     BSTR_AVX2_ROW(15));
+      _bstr_avx2_csa(&fours_b, &twos, twos, twos_a, twos_b);
+      _bstr_avx2_csa(&eights_b, &fours, fours, fours_a, fours_b);
+      _bstr_avx2_csa(&sixteens, &eights, eights, eights_a, eights_b);
+      _bstr_avx2_add_bits(acc, sixteens);
+    }
+    const __m256i zero = _mm256_setzero_si256();
+    for (; r < nrows; r++) {
+      __m256i carry = BSTR_AVX2_ROW(0);
+      _bstr_avx2_csa(&carry, &ones, ones, carry, zero);
+      _bstr_avx2_csa(&carry, &twos, twos, carry, zero);
+      _bstr_avx2_csa(&carry, &fours, fours, carry, zero);
+      _bstr_avx2_csa(&carry, &eights, eights, carry, zero);
+      _bstr_avx2_add_bits(acc, carry);
+    }
+#undef BSTR_AVX2_ROW
+    uint32_t total[BSTR_BITS_PER_INT][BSTR_AVX2_WORDS];
+    for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++) {
+      const __m128i shift = _mm_cvtsi32_si128((int)b);
+      __m256i t = _mm256_slli_epi32(acc[b], 4);
+      t = _mm256_add_epi32(
+          t, _mm256_slli_epi32(
+                 _mm256_and_si256(_mm256_srl_epi32(eights, shift), one), 3));
+      t = _mm256_add_epi32(
+          t, _mm256_slli_epi32(
+                 _mm256_and_si256(_mm256_srl_epi32(fours, shift), one), 2));
+      t = _mm256_add_epi32(
+          t, _mm256_slli_epi32(
+                 _mm256_and_si256(_mm256_srl_epi32(twos, shift), one), 1));
+      t = _mm256_add_epi32(
+          t, _mm256_and_si256(_mm256_srl_epi32(ones, shift), one));
+      _mm256_storeu_si256((__m256i *)total[b], t);
+    }
+    for (size_t j = 0; j < BSTR_AVX2_WORDS; j++)
+      for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++)
+        counts[(w + j) * BSTR_BITS_PER_INT + b] += total[b][j];
+  }
+  _bstr_scalar_positional_popcnt_from(rows, nrows, w, nwords, counts);
+}
+
+/*
+ * The nibble lookup counts of up to 31 vectors fit the bytes of one
+ * accumulator, so a row of up to 7936 bits takes one vpsadbw.
+ */
+#define BSTR_AVX2_HAMMING_VECTORS 31U
+
+__attribute__((target("avx2"))) static void
+_bstr_avx2_hamming(const unsigned int *query, const unsigned int *rows,
+                   size_t nrows, size_t nwords, uint32_t *out) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const size_t nvec = nwords / BSTR_AVX2_WORDS;
+  for (size_t r = 0; r < nrows; r++, rows += nwords) {
+    __m256i total = _mm256_setzero_si256();
+    size_t v = 0;
+    while (v < nvec) {
+      const size_t end = nvec - v < BSTR_AVX2_HAMMING_VECTORS
+                             ? nvec
+                             : v + BSTR_AVX2_HAMMING_VECTORS;
+      __m256i bytes = _mm256_setzero_si256();
+      for (; v < end; v++) {
+        const __m256i x = _mm256_xor_si256(
+            _mm256_loadu_si256((const __m256i *)query + v),
+            _mm256_loadu_si256((const __m256i *)rows + v));
+        bytes = _mm256_add_epi8(
+            bytes, _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, low_mask)));
+        bytes = _mm256_add_epi8(
+            bytes,
+            _mm256_shuffle_epi8(
+                lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask)));
+      }
+      total = _mm256_add_epi64(
+          total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(total),
+                                       _mm256_extracti128_si256(total, 1));
+    uint32_t distance = (uint32_t)(_mm_cvtsi128_si32(half) +
+                                   _mm_extract_epi32(half, 2));
+    for (size_t i = nvec * BSTR_AVX2_WORDS; i < nwords; i++)
+      distance += (uint32_t)__builtin_popcount(query[i] ^ rows[i]);
+    out[r] = distance;
+  }
+}
+
+static const bstr_dispatch_table_t _bstr_avx2_table = {
+    .backend = BSTR_BACKEND_AVX2,
+    .popcnt = _bstr_avx2_popcnt,
+    .find = _bstr_avx2_find,
+    .rfind = _bstr_avx2_rfind,
+    .find_pair = _bstr_avx2_find_pair,
+    .hash_stripes = _bstr_avx2_hash_stripes,
+    .find_prefix16 = _bstr_avx2_find_prefix16,
+    .unpack = _bstr_avx2_unpack,
+    .positional_popcnt = _bstr_avx2_positional_popcnt,
+    .hamming = _bstr_avx2_hamming,
+};
+
+/*
+ * AVX-512 backend. The tail is handled with masked loads, so there is no
+ * scalar loop.
+ */
+
+#define BSTR_AVX512_WORDS (sizeof(__m512i) / sizeof(unsigned int))
+#define BSTR_AVX512_TARGET target("avx512f,avx512vpopcntdq,bmi")
+
+__attribute__((BSTR_AVX512_TARGET)) static uint64_t
+_bstr_avx512_popcnt(const unsigned int *words, size_t nwords) {
+  __m512i total = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + BSTR_AVX512_WORDS <= nwords; i += BSTR_AVX512_WORDS)
+    total = _mm512_add_epi64(
+        total, _mm512_popcnt_epi64(_mm512_loadu_si512(&words[i])));
+  if (i < nwords) {
+    const __mmask16 tail = (__mmask16)((1U << (nwords - i)) - 1U);
+    total = _mm512_add_epi64(
+        total, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi32(tail, &words[i])));
+  }
+  return (uint64_t)_mm512_reduce_add_epi64(total);
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static size_t
+_bstr_avx512_find(const unsigned int *words, size_t nwords,
+                  unsigned int invert) {
+  const __m512i inv = _mm512_set1_epi32((int)invert);
+  size_t i = 0;
+  for (; i + BSTR_AVX512_WORDS <= nwords; i += BSTR_AVX512_WORDS) {
+    const __m512i v = _mm512_xor_si512(_mm512_loadu_si512(&words[i]), inv);
+    const __mmask16 hit = _mm512_test_epi32_mask(v, v);
+    if (hit)
+      return i + (size_t)__builtin_ctz(hit);
+  }
+  if (i < nwords) {
+    const __mmask16 tail = (__mmask16)((1U << (nwords - i)) - 1U);
+    const __m512i v =
+        _mm512_xor_si512(_mm512_maskz_loadu_epi32(tail, &words[i]), inv);
+    const __mmask16 hit = _mm512_mask_test_epi32_mask(tail, v, v);
+    if (hit)
+      return i + (size_t)__builtin_ctz(hit);
+  }
+  return nwords;
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static size_t
+_bstr_avx512_rfind(const unsigned int *words, size_t nwords) {
+  size_t i = nwords;
+  for (; i >= BSTR_AVX512_WORDS; i -= BSTR_AVX512_WORDS) {
+    const __m512i v = _mm512_loadu_si512(&words[i - BSTR_AVX512_WORDS]);
+    const __mmask16 hit = _mm512_test_epi32_mask(v, v);
+    if (hit)
+      return i - BSTR_AVX512_WORDS + 32 - (size_t)__builtin_clz(hit);
+  }
+  if (i > 0) {
+    const __mmask16 tail = (__mmask16)((1U << i) - 1U);
+    const __m512i v = _mm512_maskz_loadu_epi32(tail, words);
+    const __mmask16 hit = _mm512_test_epi32_mask(v, v);
+    if (hit)
+      return 32 - (size_t)__builtin_clz(hit);
+  }
+  return 0;
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static inline __mmask16
+_bstr_avx512_pair_mask(__mmask16 lanes, __m512i va, __m512i vb,
+                       bstr_pair_op_t op) {
+  if (op == BSTR_PAIR_AND)
+    return _mm512_mask_test_epi32_mask(lanes, va, vb);
+  if (op == BSTR_PAIR_ANDNOT) {
+    /* vpternlogd 0x30 is a & ~b */
+    const __m512i rest = _mm512_ternarylogic_epi32(va, vb, vb, 0x30);
+    return _mm512_mask_test_epi32_mask(lanes, rest, rest);
+  }
+  return _mm512_mask_cmpneq_epi32_mask(lanes, va, vb);
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static size_t
+_bstr_avx512_find_pair(const unsigned int *a, const unsigned int *b,
+                       size_t nwords, bstr_pair_op_t op) {
+  size_t i = 0;
+  for (; i + BSTR_AVX512_WORDS <= nwords; i += BSTR_AVX512_WORDS) {
+    const __mmask16 hit =
+        _bstr_avx512_pair_mask((__mmask16)0xFFFF, _mm512_loadu_si512(&a[i]),
+                               _mm512_loadu_si512(&b[i]), op);
+    if (hit)
+      return i + (size_t)__builtin_ctz(hit);
+  }
+  if (i < nwords) {
+    const __mmask16 tail = (__mmask16)((1U << (nwords - i)) - 1U);
+    const __mmask16 hit = _bstr_avx512_pair_mask(
+        tail, _mm512_maskz_loadu_epi32(tail, &a[i]),
+        _mm512_maskz_loadu_epi32(tail, &b[i]), op);
+    if (hit)
+      return i + (size_t)__builtin_ctz(hit);
+  }
+  return nwords;
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static size_t
+_bstr_avx512_find_prefix16(const unsigned int *words, size_t nwords,
+                           unsigned int prefix) {
+  __m512i want[16];
+  for (int j = 0; j < 16; j++)
+    want[j] = _mm512_set1_epi32((prefix >> j) & 1U ? 0 : -1);
+  size_t i = 0;
+  for (; i + BSTR_AVX512_WORDS <= nwords; i += BSTR_AVX512_WORDS) {
+    const __m512i lo = _mm512_loadu_si512(&words[i]);
+    const __m512i hi = _mm512_loadu_si512(&words[i + 1]);
+    __m512i cand = _mm512_xor_si512(lo, want[0]);
+    for (int j = 1; j < 16; j++) {
+      /* vpternlogd 0x56 is (a | b) ^ c */
+      const __m512i text = _mm512_ternarylogic_epi32(
+          _mm512_srl_epi32(lo, _mm_cvtsi32_si128(j)),
+          _mm512_sll_epi32(hi, _mm_cvtsi32_si128(32 - j)), want[j], 0x56);
+      cand = _mm512_and_si512(cand, text);
+    }
+    const __mmask16 hit = _mm512_test_epi32_mask(cand, cand);
+    if (hit)
+      return i + (size_t)__builtin_ctz(hit);
+  }
+  return i + _bstr_scalar_find_prefix16(&words[i], nwords - i, prefix);
+}
+
+/*
+ * Two stripes per vector. The accumulators only ever get added to, so the
+ * upper half is folded into the lower one at the end.
+ */
+__attribute__((BSTR_AVX512_TARGET)) static void
+_bstr_avx512_hash_stripes(const unsigned int *words, size_t first,
+                          size_t nstripes, uint64_t acc[4]) {
+  const __m256i secret = _mm256_add_epi64(
+      _mm256_loadu_si256((const __m256i *)_bstr_hash_secret),
+      _mm256_set1_epi64x((long long)(first * BSTR_HASH_STEP)));
+  __m512i vacc = _mm512_zextsi256_si512(_mm256_loadu_si256((__m256i *)acc));
+  __m512i key = _mm512_add_epi64(
+      _mm512_broadcast_i64x4(secret),
+      _mm512_set_epi64((long long)BSTR_HASH_STEP, (long long)BSTR_HASH_STEP,
+                       (long long)BSTR_HASH_STEP, (long long)BSTR_HASH_STEP, 0,
+                       0, 0, 0));
+  const __m512i step = _mm512_set1_epi64((long long)(2 * BSTR_HASH_STEP));
+  size_t j = 0;
+  for (; j + 2 <= nstripes; j += 2) {
+    const __m512i d = _mm512_loadu_si512(&words[j * BSTR_HASH_STRIPE_WORDS]);
+    const __m512i dk = _mm512_xor_si512(d, key);
+    vacc = _mm512_add_epi64(
+        vacc, _mm512_mul_epu32(dk, _mm512_srli_epi64(dk, 32)));
+    vacc = _mm512_add_epi64(vacc,
+                            _mm512_shuffle_epi32(d, _MM_PERM_BADC));
+    key = _mm512_add_epi64(key, step);
+  }
+  _mm256_storeu_si256((__m256i *)acc,
+                      _mm256_add_epi64(_mm512_castsi512_si256(vacc),
+                                       _mm512_extracti64x4_epi64(vacc, 1)));
+  _bstr_scalar_hash_stripes_from(&words[j * BSTR_HASH_STRIPE_WORDS],
+                                 first + j, nstripes - j, acc);
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static void
+_bstr_avx512_unpack(const unsigned int *words, unsigned int width,
+                    size_t first, size_t n, uint32_t *out) {
+  const __m512i lanes = _mm512_mullo_epi32(
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm512_set1_epi32((int)width));
+  const __m512i mask =
+      _mm512_set1_epi32(width < 32 ? (int)((1U << width) - 1U) : -1);
+  const __m512i thirty_one = _mm512_set1_epi32(31);
+  const __m512i thirty_two = _mm512_set1_epi32(32);
+  size_t i = 0;
+  for (; i + BSTR_AVX512_WORDS <= n; i += BSTR_AVX512_WORDS) {
+    const size_t bit = (first + i) * width;
+    const int *base = (const int *)&words[bit >> 5];
+    const __m512i rel =
+        _mm512_add_epi32(lanes, _mm512_set1_epi32((int)(bit & 31U)));
+    const __m512i idx = _mm512_srli_epi32(rel, 5);
+    const __m512i off = _mm512_and_si512(rel, thirty_one);
+    const __m512i back = _mm512_sub_epi32(thirty_two, off);
+    const __m512i lo = _mm512_i32gather_epi32(idx, base, 4);
+    const __m512i hi = _mm512_i32gather_epi32(idx, base + 1, 4);
+    const __m512i value = _mm512_or_si512(_mm512_srlv_epi32(lo, off),
+                                          _mm512_sllv_epi32(hi, back));
+    _mm512_storeu_si512(&out[i], _mm512_and_si512(value, mask));
+  }
+  _bstr_scalar_unpack(words, width, first + i, n - i, &out[i]);
+}
+
+/*
+ * Sixteen words per vector, the carry save adders are single ternary logic
+ * instructions. The last words are read with a masked load.
+ */
+__attribute__((BSTR_AVX512_TARGET)) static inline void
+_bstr_avx512_csa(__m512i *h, __m512i *l, __m512i a, __m512i b, __m512i c) {
+  *h = _mm512_ternarylogic_epi32(a, b, c, 0xE8);
+  *l = _mm512_ternarylogic_epi32(a, b, c, 0x96);
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static inline void
+_bstr_avx512_add_bits(__m512i acc[BSTR_BITS_PER_INT], __m512i word) {
+  const __m512i one = _mm512_set1_epi32(1);
+  for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++)
+    acc[b] = _mm512_add_epi32(
+        acc[b], _mm512_and_si512(
+                    _mm512_srl_epi32(word, _mm_cvtsi32_si128((int)b)), one));
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static void
+_bstr_avx512_positional_popcnt(const unsigned int *const *rows, size_t nrows,
+                               size_t nwords, uint32_t *counts) {
+  const __m512i one = _mm512_set1_epi32(1);
+  for (size_t w = 0; w < nwords; w += BSTR_AVX512_WORDS) {
+    const size_t lanes =
+        nwords - w < BSTR_AVX512_WORDS ? nwords - w : BSTR_AVX512_WORDS;
+    const __mmask16 mask = (__mmask16)((1U << lanes) - 1U);
+    __m512i acc[BSTR_BITS_PER_INT];
+    for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++)
+      acc[b] = _mm512_setzero_si512();
+    __m512i ones = _mm512_setzero_si512();
+    __m512i twos = _mm512_setzero_si512();
+    __m512i fours = _mm512_setzero_si512();
+    __m512i eights = _mm512_setzero_si512();
+    __m512i sixteens, twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+    size_t r = 0;
+#define BSTR_AVX512_ROW(n) _mm512_maskz_loadu_epi32(mask, &rows[r + (n)][w])
+    for (; r + 16 <= nrows; r += 16) {
+      _bstr_avx512_csa(&twos_a, &ones, ones, BSTR_AVX512_ROW(0),
+                       BSTR_AVX512_ROW(1));
+      _bstr_avx512_csa(&twos_b, &ones, ones, BSTR_AVX512_ROW(2),
+                       BSTR_AVX512_ROW(3));
+      _bstr_avx512_csa(&fours_a, &twos, twos, twos_a, twos_b);
+      _bstr_avx512_csa(&twos_a, &ones, ones, BSTR_AVX512_ROW(4),
+                       BSTR_AVX512_ROW(5));
+      _bstr_avx512_csa(&twos_b, &ones, ones, BSTR_AVX512_ROW(6),
+                       BSTR_AVX512_ROW(7));
+      _bstr_avx512_csa(&fours_b, &twos, twos, twos_a, twos_b);
+      _bstr_avx512_csa(&eights_a, &fours, fours, fours_a, fours_b);
+      _bstr_avx512_csa(&twos_a, &ones, ones, BSTR_AVX512_ROW(8),
+                       BSTR_AVX512_ROW(9));
+      _bstr_avx512_csa(&twos_b, &ones, ones, BSTR_AVX512_ROW(10),
+                       BSTR_AVX512_ROW(11));
+      _bstr_avx512_csa(&fours_a, &twos, twos, twos_a, twos_b);
+      _bstr_avx512_csa(&twos_a, &ones, ones, BSTR_AVX512_ROW(12),
+                       BSTR_AVX512_ROW(13));
+      _bstr_avx512_csa(&twos_b, &ones, ones, BSTR_AVX512_ROW(14),
+                       BSTR_AVX512_ROW(15));
+      _bstr_avx512_csa(&fours_b, &twos, twos, twos_a, twos_b);
+      _bstr_avx512_csa(&eights_b, &fours, fours, fours_a, fours_b);
+      _bstr_avx512_csa(&sixteens, &eights, eights, eights_a, eights_b);
+      _bstr_avx512_add_bits(acc, sixteens);
+    }
+    const __m512i zero = _mm512_setzero_si512();
+    for (; r < nrows; r++) {
+      __m512i carry = BSTR_AVX512_ROW(0);
+      _bstr_avx512_csa(&carry, &ones, ones, carry, zero);
+      _bstr_avx512_csa(&carry, &twos, twos, carry, zero);
+      _bstr_avx512_csa(&carry, &fours, fours, carry, zero);
+      _bstr_avx512_csa(&carry, &eights, eights, carry, zero);
+      _bstr_avx512_add_bits(acc, carry);
+    }
+#undef BSTR_AVX512_ROW
+    uint32_t total[BSTR_BITS_PER_INT][BSTR_AVX512_WORDS];
+    for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++) {
+      const __m128i shift = _mm_cvtsi32_si128((int)b);
+      __m512i t = _mm512_slli_epi32(acc[b], 4);
+      t = _mm512_add_epi32(
+          t, _mm512_slli_epi32(
+                 _mm512_and_si512(_mm512_srl_epi32(eights, shift), one), 3));
+      t = _mm512_add_epi32(
+          t, _mm512_slli_epi32(
+                 _mm512_and_si512(_mm512_srl_epi32(fours, shift), one), 2));
+      t = _mm512_add_epi32(
+          t, _mm512_slli_epi32(
+                 _mm512_and_si512(_mm512_srl_epi32(twos, shift), one), 1));
+      t = _mm512_add_epi32(
+          t, _mm512_and_si512(_mm512_srl_epi32(ones, shift), one));
+      _mm512_storeu_si512(total[b], t);
+    }
+    for (size_t j = 0; j < lanes; j++)
+      for (unsigned int b = 0; b < BSTR_BITS_PER_INT; b++)
+        counts[(w + j) * BSTR_BITS_PER_INT + b] += total[b][j];
+  }
+}
+
+__attribute__((BSTR_AVX512_TARGET)) static void
+_bstr_avx512_hamming(const unsigned int *query, const unsigned int *rows,
+                     size_t nrows, size_t nwords, uint32_t *out) {
+  const size_t rest = nwords % BSTR_AVX512_WORDS;
+  const __mmask16 tail = (__mmask16)((1U << rest) - 1U);
+  for (size_t r = 0; r < nrows; r++, rows += nwords) {
+    __m512i total = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + BSTR_AVX512_WORDS <= nwords; i += BSTR_AVX512_WORDS)
+      total = _mm512_add_epi64(
+          total, _mm512_popcnt_epi64(_mm512_xor_si512(
+                     _mm512_loadu_si512(&query[i]),
+                     _mm512_loadu_si512(&rows[i]))));
+    if (rest != 0)
+      total = _mm512_add_epi64(
+          total, _mm512_popcnt_epi64(_mm512_xor_si512(
+                     _mm512_maskz_loadu_epi32(tail, &query[i]),
+                     _mm512_maskz_loadu_epi32(tail, &rows[i]))));
+    out[r] = (uint32_t)_mm512_reduce_add_epi64(total);
+  }
+}
+
+static const bstr_dispatch_table_t _bstr_avx512_table = {
+    .backend = BSTR_BACKEND_AVX512,
+    .popcnt = _bstr_avx512_popcnt,
+    .find = _bstr_avx512_find,
+    .rfind = _bstr_avx512_rfind,
+    .find_pair = _bstr_avx512_find_pair,
+    .hash_stripes = _bstr_avx512_hash_stripes,
+    .find_prefix16 = _bstr_avx512_find_prefix16,
+    .unpack = _bstr_avx512_unpack,
+    .positional_popcnt = _bstr_avx512_positional_popcnt,
+    .hamming = _bstr_avx512_hamming,
+};
+
+#endif /* BSTR_DISPATCH_X86 */
+
+static const bstr_dispatch_table_t *_bstr_table_for(bstr_backend_t backend) {
+  switch (backend) {
+  case BSTR_BACKEND_SCALAR:
+    return &_bstr_scalar_table;
+#ifdef BSTR_DISPATCH_X86
+  case BSTR_BACKEND_POPCNT:
+    return __builtin_cpu_supports("popcnt") ? &_bstr_popcnt_table : NULL;
+  case BSTR_BACKEND_AVX2:
+    return __builtin_cpu_supports("avx2") ? &_bstr_avx2_table : NULL;
+  case BSTR_BACKEND_AVX512:
+    return __builtin_cpu_supports("avx512f") &&
+                   __builtin_cpu_supports("avx512vpopcntdq")
+               ? &_bstr_avx512_table
+               : NULL;
+#endif
+  default:
+    return NULL;
+  }
+}
+
+static const bstr_dispatch_table_t *_bstr_table_best(void) {
+  for (int backend = BSTR_BACKEND_AVX512; backend > BSTR_BACKEND_SCALAR;
+       backend--) {
+    const bstr_dispatch_table_t *table =
+        _bstr_table_for((bstr_backend_t)backend);
+    if (table != NULL)
+      return table;
+  }
+  return &_bstr_scalar_table;
+}
+
+/*
+ * Detection is idempotent, so threads racing on the first call all store the
+ * same pointer.
+ */
+static const bstr_dispatch_table_t *_bstr_table = NULL;
+
+static inline const bstr_dispatch_table_t *_bstr_get_table(void) {
+  const bstr_dispatch_table_t *table =
+      __atomic_load_n(&_bstr_table, __ATOMIC_ACQUIRE);
+  if (__builtin_expect(table == NULL, 0)) {
+    table = _bstr_table_best();
+    __atomic_store_n(&_bstr_table, table, __ATOMIC_RELEASE);
+  }
+  return table;
+}
+
+bstr_backend_t bstr_get_backend(void) { return _bstr_get_table()->backend; }
+
+bstr_err_t bstr_set_backend(bstr_backend_t backend) {
+  const bstr_dispatch_table_t *table = backend == BSTR_BACKEND_AUTO
+                                           ? _bstr_table_best()
+                                           : _bstr_table_for(backend);
+  if (table == NULL)
+    return BSTR_UNSUPPORTED;
+  __atomic_store_n(&_bstr_table, table, __ATOMIC_RELEASE);
+  return BSTR_NO_ERROR;
+}
+
+bool bstr_backend_is_supported(bstr_backend_t backend) {
+  return backend == BSTR_BACKEND_AUTO || _bstr_table_for(backend) != NULL;
+}
+
+const char *bstr_backend_name(bstr_backend_t backend) {
+  switch (backend) {
+  case BSTR_BACKEND_AUTO:
+    return "auto";
+  case BSTR_BACKEND_SCALAR:
+    return "scalar";
+  case BSTR_BACKEND_POPCNT:
+    return "popcnt";
+  case BSTR_BACKEND_AVX2:
+    return "avx2";
+  case BSTR_BACKEND_AVX512:
+    return "avx512";
+  default:
+    return NULL;
+  }
+}
+
+uint64_t bstr_dispatch_popcnt(const unsigned int *words, size_t nwords) {
+  return _bstr_get_table()->popcnt(words, nwords);
+}
+
+size_t bstr_dispatch_find(const unsigned int *words, size_t nwords,
+                          unsigned int invert) {
+  return _bstr_get_table()->find(words, nwords, invert);
+}
+
+size_t bstr_dispatch_rfind(const unsigned int *words, size_t nwords) {
+  return _bstr_get_table()->rfind(words, nwords);
+}
+
+size_t bstr_dispatch_find_pair(const unsigned int *a, const unsigned int *b,
+                               size_t nwords, bstr_pair_op_t op) {
+  return _bstr_get_table()->find_pair(a, b, nwords, op);
+}
+
+size_t bstr_dispatch_find_prefix16(const unsigned int *words, size_t nwords,
+                                   unsigned int prefix) {
+  return _bstr_get_table()->find_prefix16(words, nwords, prefix & 0xFFFFU);
+}
+
+void bstr_dispatch_unpack(const unsigned int *words, unsigned int width,
+                          size_t first, size_t n, uint32_t *out) {
+  _bstr_get_table()->unpack(words, width, first, n, out);
+}
+
+void bstr_dispatch_positional_popcnt(const unsigned int *const *rows,
+                                     size_t nrows, size_t nwords,
+                                     uint32_t *counts) {
+  _bstr_get_table()->positional_popcnt(rows, nrows, nwords, counts);
+}
+
+void bstr_dispatch_hamming(const unsigned int *query,
+                           const unsigned int *rows, size_t nrows,
+                           size_t nwords, uint32_t *out) {
+  _bstr_get_table()->hamming(query, rows, nrows, nwords, out);
+}
+
+void bstr_dispatch_hash128_init(bstr_hash_state_t *state) {
+  for (int k = 0; k < 4; k++)
+    state->acc[k] = 0;
+  state->nwords = 0;
+}
+
+void bstr_dispatch_hash128_update(bstr_hash_state_t *state,
+                                  const unsigned int *words, size_t nwords) {
+  const size_t first = state->nwords / BSTR_HASH_STRIPE_WORDS;
+  const size_t nstripes = nwords / BSTR_HASH_STRIPE_WORDS;
+  _bstr_get_table()->hash_stripes(words, first, nstripes, state->acc);
+  const size_t rest = nwords - nstripes * BSTR_HASH_STRIPE_WORDS;
+  if (rest > 0) {
+    unsigned int tail[BSTR_HASH_STRIPE_WORDS] = {0};
+    memcpy(tail, &words[nstripes * BSTR_HASH_STRIPE_WORDS],
+           rest * sizeof(unsigned int));
+    _bstr_scalar_hash_stripes_from(tail, first + nstripes, 1, state->acc);
+  }
+  state->nwords += nwords;
+}
+
+void bstr_dispatch_hash128_final(const bstr_hash_state_t *state,
+                                 uint64_t hash[2]) {
+  const uint64_t *acc = state->acc;
+  uint64_t h1 = _bstr_hash_fmix((uint64_t)state->nwords * BSTR_HASH_STEP);
+  uint64_t h2 = _bstr_hash_fmix(h1 ^ _bstr_hash_secret[0]);
+  for (int k = 0; k < 4; k++) {
+    h1 = _bstr_hash_fmix(h1 ^ (acc[k] * _bstr_hash_secret[k]));
+    h2 = _bstr_hash_fmix(h2 + (acc[3 - k] ^ _bstr_hash_secret[k]));
+  }
+  hash[0] = h1;
+  hash[1] = h2 ^ h1;
+}
+
+void bstr_dispatch_hash128(const unsigned int *words, size_t nwords,
+                           uint64_t hash[2]) {
+  bstr_hash_state_t state;
+  bstr_dispatch_hash128_init(&state);
+  bstr_dispatch_hash128_update(&state, words, nwords);
+  bstr_dispatch_hash128_final(&state, hash);
+}
+
+#ifdef __cplusplus
+}
+#endif
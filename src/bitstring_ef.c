@@ -0,0 +1,246 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_ef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BSTR_EF_SAMPLE_SHIFT 8U
+
+struct bstr_ef_t {
+  /** Upper bits, value i sets bit (value >> low_bits) + i. */
+  bstr_bitstr_t *high;
+  /** n * low_bits packed lower bits and one spare word. */
+  unsigned int *low;
+  /** Position of one number k * BSTR_EF_SAMPLE in high. */
+  unsigned int *ones;
+  /** Position of zero number k * BSTR_EF_SAMPLE in high. */
+  unsigned int *zeros;
+  unsigned int n;
+  unsigned int nzeros;
+  unsigned int low_bits;
+  unsigned int last;
+};
+
+static inline bstr_view_t _bstr_ef_low_view(const bstr_ef_t *const ef) {
+  return bstr_kernel_view(
+      ef->low, ((ef->n * ef->low_bits) >> BSTR_BITS_PER_INT_SHIFT) + 1U);
+}
+
+static inline unsigned int _bstr_ef_low(const bstr_ef_t *const ef,
+                                        unsigned int index) {
+  if (ef->low_bits == 0)
+    return 0;
+  return (unsigned int)bstr_kernel_get_field(
+      _bstr_ef_low_view(ef), index * ef->low_bits, ef->low_bits);
+}
+
+/* Position of the set bit number rank (from 0) in (word ^ invert), starting
+ * the count at sample, which is such a bit. */
+static unsigned int _bstr_ef_select(const bstr_ef_t *const ef,
+                                    const unsigned int *samples,
+                                    unsigned int rank, unsigned int invert) {
+  const unsigned int *words = ef->high->_bits;
+  const unsigned int pos = samples[rank >> BSTR_EF_SAMPLE_SHIFT];
+  rank &= BSTR_EF_SAMPLE - 1U;
+  unsigned int i = pos >> BSTR_BITS_PER_INT_SHIFT;
+  unsigned int word =
+      (words[i] ^ invert) & (~0U << (pos & BSTR_BITS_PER_INT_MASK));
+  for (unsigned int count; rank >= (count = __builtin_popcount(word));
+       word = words[++i] ^ invert)
+    rank -= count;
+  for (; rank > 0; rank--)
+    word &= word - 1U;
+  return (i << BSTR_BITS_PER_INT_SHIFT) + (unsigned int)__builtin_ctz(word);
+}
+
+bstr_ef_t *bstr_ef_create(const unsigned int *values, unsigned int n) {
+#ifdef DEBUG
+  assert(n == 0 || values != NULL);
+  for (unsigned int i = 1; i < n; i++)
+    assert(values[i - 1] <= values[i]);
+#endif
+  bstr_ef_t *ef = (bstr_ef_t *)calloc(1, sizeof(bstr_ef_t));
+  if (ef == NULL)
+    return NULL;
+  ef->n = n;
+  ef->last = n > 0 ? values[n - 1] : 0;
+  /* floor(log2(universe / n)), at most BSTR_BITS_PER_INT - 1 */
+  const uint64_t universe = (uint64_t)ef->last + 1U;
+  while (ef->low_bits < BSTR_BITS_PER_INT - 1U &&
+         ((uint64_t)n << (ef->low_bits + 1U)) <= universe)
+    ef->low_bits++;
+  ef->nzeros = (ef->last >> ef->low_bits) + 1U;
+
+  const unsigned int high_bits = n + ef->nzeros;
+  const size_t low_words = _bstr_ef_low_view(ef).nwords;
+  ef->high = bstr_create_bitstr(
+      (high_bits + BSTR_BITS_PER_INT - 1U) >> BSTR_BITS_PER_INT_SHIFT);
+  ef->low = (unsigned int *)calloc(low_words, sizeof(unsigned int));
+  ef->ones = (unsigned int *)malloc(
+      (((n + BSTR_EF_SAMPLE - 1U) >> BSTR_EF_SAMPLE_SHIFT) + 1U) *
+      sizeof(unsigned int));
+  ef->zeros = (unsigned int *)malloc(
+      ((ef->nzeros + BSTR_EF_SAMPLE - 1U) >> BSTR_EF_SAMPLE_SHIFT) *
+      sizeof(unsigned int));
+  if (ef->high == NULL || ef->low == NULL || ef->ones == NULL ||
+      ef->zeros == NULL) {
+    bstr_ef_delete(ef);
+    return NULL;
+  }
+
+  const bstr_view_t low = _bstr_ef_low_view(ef);
+  unsigned int zero = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    const unsigned int high = values[i] >> ef->low_bits;
+    /* Zero number z follows the values whose upper part is <= z. */
+    for (; zero < high; zero += BSTR_EF_SAMPLE)
+      ef->zeros[zero >> BSTR_EF_SAMPLE_SHIFT] = zero + i;
+    if ((i & (BSTR_EF_SAMPLE - 1U)) == 0)
+      ef->ones[i >> BSTR_EF_SAMPLE_SHIFT] = high + i;
+    bstr_set(ef->high, high + i);
+    if (ef->low_bits != 0)
+      bstr_kernel_set_field(low, i * ef->low_bits, ef->low_bits, values[i]);
+  }
+  for (; zero < ef->nzeros; zero += BSTR_EF_SAMPLE)
+    ef->zeros[zero >> BSTR_EF_SAMPLE_SHIFT] = zero + n;
+  return ef;
+}
+
+bstr_ef_t *bstr_ef_create_from_bitstr(const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  const unsigned int n = (unsigned int)bstr_popcnt(bstr);
+  unsigned int *values =
+      (unsigned int *)malloc((n + 1U) * sizeof(unsigned int));
+  if (values == NULL)
+    return NULL;
+  unsigned int i = 0;
+  for (int bit = bstr_ffs(bstr); bit >= 0 && i < n;
+       bit = bstr_next_set_bit(bstr, (unsigned int)bit + 1U))
+    values[i++] = (unsigned int)bit;
+  bstr_ef_t *ef = bstr_ef_create(values, n);
+  free(values);
+  return ef;
+}
+
+void bstr_ef_delete(bstr_ef_t *ef) {
+#ifdef DEBUG
+  assert(ef != NULL);
+#endif
+  if (ef->high != NULL)
+    bstr_delete_bitstr(ef->high);
+  free(ef->low);
+  free(ef->ones);
+  free(ef->zeros);
+  free(ef);
+}
+
+unsigned int bstr_ef_count(const bstr_ef_t *const ef) {
+#ifdef DEBUG
+  assert(ef != NULL);
+#endif
+  return ef->n;
+}
+
+size_t bstr_ef_size_in_bits(const bstr_ef_t *const ef) {
+#ifdef DEBUG
+  assert(ef != NULL);
+#endif
+  const size_t words =
+      ef->high->_capacity +
+      ((size_t)ef->n * ef->low_bits >> BSTR_BITS_PER_INT_SHIFT) + 1U +
+      ((ef->n + BSTR_EF_SAMPLE - 1U) >> BSTR_EF_SAMPLE_SHIFT) +
+      ((ef->nzeros + BSTR_EF_SAMPLE - 1U) >> BSTR_EF_SAMPLE_SHIFT);
+  return words * BSTR_BITS_PER_INT;
+}
+
+unsigned int bstr_ef_get(const bstr_ef_t *const ef, unsigned int index) {
+#ifdef DEBUG
+  assert(ef != NULL);
+  assert(index < ef->n);
+#endif
+  const unsigned int high = _bstr_ef_select(ef, ef->ones, index, 0U) - index;
+  return (high << ef->low_bits) | _bstr_ef_low(ef, index);
+}
+
+int bstr_ef_next_geq(const bstr_ef_t *const ef, unsigned int x,
+                     unsigned int *value) {
+#ifdef DEBUG
+  assert(ef != NULL);
+#endif
+  if (ef->n == 0 || x > ef->last)
+    return -1;
+  /* The values with upper part high start right after zero number high - 1,
+   * everything before them is smaller than x. */
+  const unsigned int high = x >> ef->low_bits;
+  bstr_ef_iter_t it = {ef, 0, 0};
+  if (high > 0) {
+    it._pos = _bstr_ef_select(ef, ef->zeros, high - 1U, ~0U) + 1U;
+    it._index = it._pos - high;
+  }
+  for (;;) {
+    const unsigned int index = it._index;
+    unsigned int found;
+    bstr_ef_iter_next(&it, &found);
+    if (found >= x) {
+      if (value != NULL)
+        *value = found;
+      return (int)index;
+    }
+  }
+}
+
+void bstr_ef_iter_init(const bstr_ef_t *const ef, unsigned int index,
+                       bstr_ef_iter_t *it) {
+#ifdef DEBUG
+  assert(ef != NULL);
+  assert(it != NULL);
+#endif
+  it->_ef = ef;
+  it->_index = index;
+  it->_pos = index < ef->n ? _bstr_ef_select(ef, ef->ones, index, 0U) : 0;
+}
+
+bool bstr_ef_iter_next(bstr_ef_iter_t *it, unsigned int *value) {
+#ifdef DEBUG
+  assert(it != NULL);
+  assert(value != NULL);
+#endif
+  const bstr_ef_t *const ef = it->_ef;
+  if (it->_index >= ef->n)
+    return false;
+  const unsigned int pos = (unsigned int)bstr_next_set_bit(ef->high, it->_pos);
+  *value = ((pos - it->_index) << ef->low_bits) | _bstr_ef_low(ef, it->_index);
+  it->_index++;
+  it->_pos = pos + 1U;
+  return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
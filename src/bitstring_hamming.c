@@ -0,0 +1,263 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_hamming.h"
+#include "bitstring_dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Distances computed per call of bstr_dispatch_hamming(), on the stack. */
+#define BSTR_HAMMING_CHUNK 256U
+
+/* count rows of nwords unsigned ints at words, room for capacity rows. */
+struct bstr_hamming_set_t {
+  unsigned int *words;
+  unsigned int nwords;
+  unsigned int count;
+  unsigned int capacity;
+};
+
+bstr_hamming_set_t *bstr_hamming_create(unsigned int nwords,
+                                        unsigned int capacity) {
+#ifdef DEBUG
+  assert(nwords > 0);
+  assert(capacity > 0);
+#endif
+  bstr_hamming_set_t *set =
+      (bstr_hamming_set_t *)malloc(sizeof(bstr_hamming_set_t));
+  if (set == NULL)
+    return NULL;
+  set->words = (unsigned int *)malloc((size_t)capacity * nwords *
+                                      sizeof(unsigned int));
+  if (set->words == NULL) {
+    free(set);
+    return NULL;
+  }
+  set->nwords = nwords;
+  set->count = 0;
+  set->capacity = capacity;
+  return set;
+}
+
+void bstr_hamming_delete(bstr_hamming_set_t *set) {
+#ifdef DEBUG
+  assert(set != NULL);
+#endif
+  free(set->words);
+  free(set);
+}
+
+unsigned int bstr_hamming_count(const bstr_hamming_set_t *const set) {
+#ifdef DEBUG
+  assert(set != NULL);
+#endif
+  return set->count;
+}
+
+unsigned int bstr_hamming_words(const bstr_hamming_set_t *const set) {
+#ifdef DEBUG
+  assert(set != NULL);
+#endif
+  return set->nwords;
+}
+
+bstr_err_t bstr_hamming_add(bstr_hamming_set_t *const set,
+                            const bstr_bitstr_t *const row) {
+#ifdef DEBUG
+  assert(set != NULL);
+  assert(row != NULL);
+  assert(row->_capacity == set->nwords);
+#endif
+  if (set->count == set->capacity) {
+    const unsigned int capacity = set->capacity * 2U;
+    unsigned int *words = (unsigned int *)realloc(
+        set->words, (size_t)capacity * set->nwords * sizeof(unsigned int));
+    if (words == NULL)
+      return BSTR_MALLOC_FAILED;
+    set->words = words;
+    set->capacity = capacity;
+  }
+  memcpy(set->words + (size_t)set->count * set->nwords, row->_bits,
+         set->nwords * sizeof(unsigned int));
+  set->count++;
+  return BSTR_NO_ERROR;
+}
+
+bstr_bitstr_t bstr_hamming_row(bstr_hamming_set_t *const set,
+                               unsigned int index) {
+#ifdef DEBUG
+  assert(set != NULL);
+  assert(index < set->count);
+#endif
+  return bstr_wrap(set->words + (size_t)index * set->nwords, set->nwords);
+}
+
+void bstr_hamming_distances(const bstr_hamming_set_t *const set,
+                            const bstr_bitstr_t *const query,
+                            unsigned int first, unsigned int n,
+                            uint32_t *out) {
+#ifdef DEBUG
+  assert(set != NULL);
+  assert(query != NULL);
+  assert(query->_capacity == set->nwords);
+  assert(n == 0 || out != NULL);
+  assert(first <= set->count && n <= set->count - first);
+#endif
+  bstr_dispatch_hamming(query->_bits,
+                        set->words + (size_t)first * set->nwords, n,
+                        set->nwords, out);
+}
+
+/* Hits are ordered by distance, then by index. */
+static inline bool _bstr_hamming_before(bstr_hamming_hit_t a,
+                                        bstr_hamming_hit_t b) {
+  return a.distance < b.distance ||
+         (a.distance == b.distance && a.index < b.index);
+}
+
+/* Max heap of the n best hits so far, the worst one on top. */
+static void _bstr_hamming_sift_down(bstr_hamming_hit_t *heap, unsigned int n,
+                                    unsigned int i) {
+  const bstr_hamming_hit_t hit = heap[i];
+  for (;;) {
+    unsigned int child = 2U * i + 1U;
+    if (child >= n)
+      break;
+    if (child + 1U < n && _bstr_hamming_before(heap[child], heap[child + 1U]))
+      child++;
+    if (!_bstr_hamming_before(hit, heap[child]))
+      break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = hit;
+}
+
+static void _bstr_hamming_sift_up(bstr_hamming_hit_t *heap, unsigned int i) {
+  const bstr_hamming_hit_t hit = heap[i];
+  while (i > 0) {
+    const unsigned int parent = (i - 1U) / 2U;
+    if (!_bstr_hamming_before(heap[parent], hit))
+      break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = hit;
+}
+
+unsigned int bstr_hamming_topk(const bstr_hamming_set_t *const set,
+                               const bstr_bitstr_t *const *queries,
+                               unsigned int nqueries, unsigned int first,
+                               unsigned int n, unsigned int k,
+                               bstr_hamming_hit_t *hits) {
+#ifdef DEBUG
+  assert(set != NULL);
+  assert(nqueries == 0 || (queries != NULL && hits != NULL));
+  assert(k > 0);
+  assert(first <= set->count && n <= set->count - first);
+  for (unsigned int q = 0; q < nqueries; q++)
+    assert(queries[q]->_capacity == set->nwords);
+#endif
+  const unsigned int nhits = n < k ? n : k;
+  const size_t row_bytes = (size_t)set->nwords * sizeof(unsigned int);
+  const unsigned int tile =
+      row_bytes >= BSTR_HAMMING_TILE_BYTES
+          ? 1U
+          : (unsigned int)(BSTR_HAMMING_TILE_BYTES / row_bytes);
+  uint32_t distances[BSTR_HAMMING_CHUNK];
+  for (unsigned int start = 0; start < n; start += tile) {
+    const unsigned int tile_end = n - start < tile ? n : start + tile;
+    for (unsigned int q = 0; q < nqueries; q++) {
+      bstr_hamming_hit_t *heap = hits + (size_t)q * k;
+      for (unsigned int chunk = start; chunk < tile_end;
+           chunk += BSTR_HAMMING_CHUNK) {
+        const unsigned int rows = tile_end - chunk < BSTR_HAMMING_CHUNK
+                                      ? tile_end - chunk
+                                      : BSTR_HAMMING_CHUNK;
+        bstr_dispatch_hamming(
+            queries[q]->_bits,
+            set->words + (size_t)(first + chunk) * set->nwords, rows,
+            set->nwords, distances);
+        /* Rows come in index order, so a row as far as the worst hit never
+         * makes it into a full heap. */
+        for (unsigned int r = 0; r < rows; r++) {
+          const bstr_hamming_hit_t hit = {first + chunk + r, distances[r]};
+          if (chunk + r < nhits) {
+            heap[chunk + r] = hit;
+            _bstr_hamming_sift_up(heap, chunk + r);
+          } else if (hit.distance < heap[0].distance) {
+            heap[0] = hit;
+            _bstr_hamming_sift_down(heap, nhits, 0);
+          }
+        }
+      }
+    }
+  }
+  /* Heap sort, the worst hit goes to the back. */
+  for (unsigned int q = 0; q < nqueries; q++) {
+    bstr_hamming_hit_t *heap = hits + (size_t)q * k;
+    for (unsigned int end = nhits; end > 1; end--) {
+      const bstr_hamming_hit_t worst = heap[0];
+      heap[0] = heap[end - 1U];
+      heap[end - 1U] = worst;
+      _bstr_hamming_sift_down(heap, end - 1U, 0);
+    }
+  }
+  return nhits;
+}
+
+unsigned int bstr_hamming_topk_merge(bstr_hamming_hit_t *hits,
+                                     unsigned int nhits,
+                                     const bstr_hamming_hit_t *other,
+                                     unsigned int nother, unsigned int k) {
+#ifdef DEBUG
+  assert(hits != NULL);
+  assert(nother == 0 || other != NULL);
+  assert(nhits <= k);
+#endif
+  const unsigned int total = nhits + nother < k ? nhits + nother : k;
+  /* Drop the worst hits of both that do not make it, then merge from the
+   * back so no hit is overwritten before it is read. */
+  unsigned int i = nhits;
+  unsigned int j = nother;
+  for (unsigned int drop = nhits + nother - total; drop > 0; drop--) {
+    if (j == 0 || (i > 0 && _bstr_hamming_before(other[j - 1U], hits[i - 1U])))
+      i--;
+    else
+      j--;
+  }
+  for (unsigned int out = total; out > 0; out--) {
+    if (j == 0 || (i > 0 && _bstr_hamming_before(other[j - 1U], hits[i - 1U])))
+      hits[out - 1U] = hits[--i];
+    else
+      hits[out - 1U] = other[--j];
+  }
+  return total;
+}
+
+#ifdef __cplusplus
+}
+#endif
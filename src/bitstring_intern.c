@@ -0,0 +1,200 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_intern.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BSTR_INTERN_MIN_SLOTS 16U
+
+/*
+ * One allocation per interned bitstring: the entry, directly followed by the
+ * bits. bstr is the first member, so the pointer handed out is the entry.
+ */
+typedef struct _bstr_intern_entry_t {
+  bstr_bitstr_t bstr;
+  uint64_t hash;
+  unsigned int refs;
+} _bstr_intern_entry_t;
+
+/* Open addressing with linear probing, at most half of the slots are used. */
+struct bstr_intern_table_t {
+  _bstr_intern_entry_t **slots;
+  unsigned int mask;
+  unsigned int count;
+};
+
+static inline _bstr_intern_entry_t *
+_bstr_intern_entry(const bstr_bitstr_t *const interned) {
+  return (_bstr_intern_entry_t *)interned;
+}
+
+static bstr_err_t _bstr_intern_alloc_slots(bstr_intern_table_t *table,
+                                           unsigned int nslots) {
+  _bstr_intern_entry_t **slots = (_bstr_intern_entry_t **)calloc(
+      nslots, sizeof(_bstr_intern_entry_t *));
+  if (slots == NULL)
+    return BSTR_MALLOC_FAILED;
+  _bstr_intern_entry_t **old = table->slots;
+  const unsigned int old_nslots = old != NULL ? table->mask + 1 : 0;
+  table->slots = slots;
+  table->mask = nslots - 1;
+  for (unsigned int i = 0; i < old_nslots; i++) {
+    if (old[i] == NULL)
+      continue;
+    unsigned int slot = (unsigned int)old[i]->hash & table->mask;
+    while (slots[slot] != NULL)
+      slot = (slot + 1) & table->mask;
+    slots[slot] = old[i];
+  }
+  free(old);
+  return BSTR_NO_ERROR;
+}
+
+bstr_intern_table_t *bstr_intern_create_table(unsigned int expected) {
+  bstr_intern_table_t *table =
+      (bstr_intern_table_t *)malloc(sizeof(bstr_intern_table_t));
+  if (table == NULL)
+    return NULL;
+  unsigned int nslots = BSTR_INTERN_MIN_SLOTS;
+  while (nslots / 2 < expected && nslots < UINT_MAX / 2 + 1)
+    nslots *= 2;
+  table->slots = NULL;
+  table->count = 0;
+  if (_bstr_intern_alloc_slots(table, nslots) != BSTR_NO_ERROR) {
+    free(table);
+    return NULL;
+  }
+  return table;
+}
+
+void bstr_intern_delete_table(bstr_intern_table_t *table) {
+#ifdef DEBUG
+  assert(table != NULL);
+#endif
+  for (unsigned int i = 0; i <= table->mask; i++)
+    free(table->slots[i]);
+  free(table->slots);
+  free(table);
+}
+
+const bstr_bitstr_t *bstr_intern(bstr_intern_table_t *table,
+                                 const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(table != NULL);
+  assert(bstr != NULL);
+#endif
+  const uint64_t hash = bstr_hash(bstr);
+  unsigned int slot = (unsigned int)hash & table->mask;
+  for (_bstr_intern_entry_t *entry; (entry = table->slots[slot]) != NULL;
+       slot = (slot + 1) & table->mask) {
+    if (entry->hash == hash && bstr_equals(&entry->bstr, bstr)) {
+      entry->refs++;
+      return &entry->bstr;
+    }
+  }
+
+  if ((table->count + 1) * 2 > table->mask + 1) {
+    if (_bstr_intern_alloc_slots(table, (table->mask + 1) * 2) !=
+        BSTR_NO_ERROR)
+      return NULL;
+    slot = (unsigned int)hash & table->mask;
+    while (table->slots[slot] != NULL)
+      slot = (slot + 1) & table->mask;
+  }
+
+  const size_t bytes = bstr->_capacity * sizeof(unsigned int);
+  _bstr_intern_entry_t *entry =
+      (_bstr_intern_entry_t *)malloc(sizeof(_bstr_intern_entry_t) + bytes);
+  if (entry == NULL)
+    return NULL;
+  _bstr_wrap(&entry->bstr, (unsigned int *)(entry + 1), bstr->_capacity);
+  memcpy(entry->bstr._bits, bstr->_bits, bytes);
+  entry->hash = hash;
+  entry->refs = 1;
+  table->slots[slot] = entry;
+  table->count++;
+  return &entry->bstr;
+}
+
+const bstr_bitstr_t *bstr_intern_retain(const bstr_bitstr_t *const interned) {
+#ifdef DEBUG
+  assert(interned != NULL);
+#endif
+  _bstr_intern_entry(interned)->refs++;
+  return interned;
+}
+
+void bstr_intern_release(bstr_intern_table_t *table,
+                         const bstr_bitstr_t *const interned) {
+#ifdef DEBUG
+  assert(table != NULL);
+  assert(interned != NULL);
+#endif
+  _bstr_intern_entry_t *entry = _bstr_intern_entry(interned);
+  if (--entry->refs > 0)
+    return;
+
+  unsigned int hole = (unsigned int)entry->hash & table->mask;
+  while (table->slots[hole] != entry)
+    hole = (hole + 1) & table->mask;
+  /*
+   * Backward shift deletion: move every following entry of the probe run
+   * whose home slot does not lie between the hole and itself into the hole.
+   */
+  for (unsigned int next = (hole + 1) & table->mask;
+       table->slots[next] != NULL; next = (next + 1) & table->mask) {
+    const unsigned int home =
+        (unsigned int)table->slots[next]->hash & table->mask;
+    const bool stays = hole <= next ? (hole < home && home <= next)
+                                    : (hole < home || home <= next);
+    if (stays)
+      continue;
+    table->slots[hole] = table->slots[next];
+    hole = next;
+  }
+  table->slots[hole] = NULL;
+  table->count--;
+  free(entry);
+}
+
+unsigned int bstr_intern_refcount(const bstr_bitstr_t *const interned) {
+#ifdef DEBUG
+  assert(interned != NULL);
+#endif
+  return _bstr_intern_entry(interned)->refs;
+}
+
+unsigned int bstr_intern_count(const bstr_intern_table_t *const table) {
+#ifdef DEBUG
+  assert(table != NULL);
+#endif
+  return table->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,200 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_msb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+/* Byte 0 holds the most significant bits of a word. */
+#define BSTR_MSB_NATIVE_XOR (BSTR_BITS_PER_INT - 1U)
+#else
+/* Byte 0 holds the least significant bits of a word. */
+#define BSTR_MSB_NATIVE_XOR 7U
+#endif
+
+#define BSTR_MSB_BYTES_PER_INT ((unsigned int)sizeof(unsigned int))
+
+/* The native index of MSB first bit, both ways. */
+static inline unsigned int _bstr_msb_native(unsigned int bit) {
+  return bit ^ BSTR_MSB_NATIVE_XOR;
+}
+
+static inline const unsigned char *
+_bstr_msb_bytes(const bstr_bitstr_t *const bstr) {
+  return (const unsigned char *)bstr->_bits;
+}
+
+/* Native index of bit 0 of byte b. */
+static inline unsigned int _bstr_msb_native_byte(unsigned int b) {
+  return _bstr_msb_native(b << 3) & ~7U;
+}
+
+bool bstr_msb_get(const bstr_bitstr_t *const bstr, unsigned int bit) {
+  return bstr_get(bstr, _bstr_msb_native(bit));
+}
+
+void bstr_msb_set(bstr_bitstr_t *const bstr, unsigned int bit) {
+  bstr_set(bstr, _bstr_msb_native(bit));
+}
+
+void bstr_msb_clr(bstr_bitstr_t *const bstr, unsigned int bit) {
+  bstr_clr(bstr, _bstr_msb_native(bit));
+}
+
+uint64_t bstr_msb_get_field(const bstr_bitstr_t *const bstr,
+                            unsigned int offset, unsigned int width) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(width > 0 && width <= 64);
+#endif
+  const unsigned char *bytes = _bstr_msb_bytes(bstr);
+  const unsigned int end = offset + width;
+  BSTR_KERNEL_BOUND_CHECK(_bstr_view(bstr),
+                          (end - 1U) >> BSTR_BITS_PER_INT_SHIFT)
+  const unsigned int last = (end - 1U) >> 3;
+  /* Whole bytes up to the last one, of which only the bits before end are
+   * taken. The bits before offset that fall off the top are not needed. */
+  uint64_t value = 0;
+  for (unsigned int b = offset >> 3; b < last; b++)
+    value = (value << 8) | bytes[b];
+  const unsigned int tail = ((end - 1U) & 7U) + 1U;
+  value = (value << tail) | (uint64_t)(bytes[last] >> (8U - tail));
+  return width < 64 ? value & ((UINT64_C(1) << width) - 1U) : value;
+}
+
+void bstr_msb_set_field(bstr_bitstr_t *const bstr, unsigned int offset,
+                        unsigned int width, uint64_t value) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(width > 0 && width <= 64);
+#endif
+  const unsigned char *bytes = _bstr_msb_bytes(bstr);
+  const unsigned int end = offset + width;
+  BSTR_KERNEL_BOUND_CHECK(_bstr_view(bstr),
+                          (end - 1U) >> BSTR_BITS_PER_INT_SHIFT)
+  /* Byte by byte from the end, where the low bits of value go. */
+  for (unsigned int b = (end - 1U) >> 3;; b--) {
+    const unsigned int lo = b << 3 > offset ? b << 3 : offset;
+    const unsigned int hi = (b << 3) + 8U < end ? (b << 3) + 8U : end;
+    const unsigned int n = hi - lo;
+    const unsigned int shift = (b << 3) + 8U - hi;
+    const unsigned int mask = ((1U << n) - 1U) << shift;
+    const unsigned int bits = (unsigned int)(value >> (end - hi));
+    const unsigned int byte = (bytes[b] & ~mask) | ((bits << shift) & mask);
+    if (byte != bytes[b])
+      bstr_set_field(bstr, _bstr_msb_native_byte(b), 8, byte);
+    if (lo == offset)
+      break;
+  }
+}
+
+/* MSB first index of the first bit in byte b at or after MSB first bit
+ * (b << 3) + from with (byte ^ invert) set, or -1. */
+static inline int _bstr_msb_in_byte(const unsigned char *bytes, unsigned int b,
+                                    unsigned int from, unsigned int invert) {
+  const unsigned int byte = ((bytes[b] ^ invert) & 0xFFU) & (0xFFU >> from);
+  if (byte == 0)
+    return -1;
+  return (int)((b << 3) + (unsigned int)__builtin_clz(byte) -
+               (BSTR_BITS_PER_INT - 8U));
+}
+
+static int _bstr_msb_next(const bstr_bitstr_t *const bstr, unsigned int offset,
+                          bool set) {
+  const unsigned int nbytes = bstr->_capacity * BSTR_MSB_BYTES_PER_INT;
+  const unsigned char *bytes = _bstr_msb_bytes(bstr);
+  const unsigned int invert = set ? 0U : 0xFFU;
+  unsigned int b = offset >> 3;
+  if (b >= nbytes)
+    return -1;
+  int found = _bstr_msb_in_byte(bytes, b, offset & 7U, invert);
+  /* The rest of the word byte by byte, then the word scan finds the next
+   * word with a match and its bytes are looked at in memory order. */
+  while (found < 0 && ++b % BSTR_MSB_BYTES_PER_INT != 0)
+    found = _bstr_msb_in_byte(bytes, b, 0, invert);
+  if (found >= 0 || b >= nbytes)
+    return found;
+  const int native = set ? bstr_next_set_bit(bstr, b << 3)
+                         : bstr_next_unset_bit(bstr, b << 3);
+  if (native < 0)
+    return -1;
+  b = ((unsigned int)native >> BSTR_BITS_PER_INT_SHIFT) *
+      BSTR_MSB_BYTES_PER_INT;
+  for (;; b++) {
+    found = _bstr_msb_in_byte(bytes, b, 0, invert);
+    if (found >= 0)
+      return found;
+  }
+}
+
+int bstr_msb_next_set_bit(const bstr_bitstr_t *const bstr,
+                          unsigned int offset) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  return _bstr_msb_next(bstr, offset, true);
+}
+
+int bstr_msb_next_unset_bit(const bstr_bitstr_t *const bstr,
+                            unsigned int offset) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  return _bstr_msb_next(bstr, offset, false);
+}
+
+int bstr_msb_find_pattern(const bstr_bitstr_t *const bstr, uint64_t pattern,
+                          unsigned int width, unsigned int offset) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(width > 0 && width <= 64);
+#endif
+  const unsigned int nbytes = bstr->_capacity * BSTR_MSB_BYTES_PER_INT;
+  const unsigned char *bytes = _bstr_msb_bytes(bstr);
+  const uint64_t mask =
+      width < 64 ? (UINT64_C(1) << width) - 1U : ~UINT64_C(0);
+  pattern &= mask;
+  /* window holds the 64 bits before byte b. Shifting the byte in shows the
+   * width bits ending at each of its 8 bits, earliest end first. Bits before
+   * offset are in the window, matches starting there are skipped. */
+  uint64_t window = 0;
+  for (unsigned int b = offset >> 3; b < nbytes; b++) {
+    const unsigned int byte = bytes[b];
+    for (unsigned int k = 8; k-- > 0;) {
+      const uint64_t bits = (window << (8U - k)) | (byte >> k);
+      const unsigned int end = (b << 3) + 8U - k;
+      if ((bits & mask) == pattern && end >= offset + width)
+        return (int)(end - width);
+    }
+    window = (window << 8) | byte;
+  }
+  return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,140 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_packed.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * bstr covers exactly the words the elements need. One more word is allocated
+ * behind them, bstr_dispatch_unpack() reads it.
+ */
+struct bstr_packed_array_t {
+  bstr_bitstr_t bstr;
+  unsigned int count;
+  unsigned int width;
+};
+
+bstr_packed_array_t *bstr_packed_create(unsigned int count,
+                                        unsigned int width) {
+#ifdef DEBUG
+  assert(count > 0);
+  assert(width > 0 && width <= 32);
+  assert((uint64_t)count * width <= UINT_MAX);
+#endif
+  const unsigned int nwords = (unsigned int)(((uint64_t)count * width +
+                                              BSTR_BITS_PER_INT - 1U) >>
+                                             BSTR_BITS_PER_INT_SHIFT);
+  bstr_packed_array_t *array =
+      (bstr_packed_array_t *)malloc(sizeof(bstr_packed_array_t));
+  if (array == NULL)
+    return NULL;
+  _bstr_wrap(&array->bstr,
+             (unsigned int *)calloc((size_t)nwords + 1U, sizeof(unsigned int)),
+             nwords);
+  if (array->bstr._bits == NULL) {
+    free(array);
+    return NULL;
+  }
+  array->count = count;
+  array->width = width;
+  return array;
+}
+
+void bstr_packed_delete(bstr_packed_array_t *array) {
+#ifdef DEBUG
+  assert(array != NULL);
+#endif
+  free(array->bstr._bits);
+  free(array);
+}
+
+unsigned int bstr_packed_count(const bstr_packed_array_t *const array) {
+#ifdef DEBUG
+  assert(array != NULL);
+#endif
+  return array->count;
+}
+
+unsigned int bstr_packed_width(const bstr_packed_array_t *const array) {
+#ifdef DEBUG
+  assert(array != NULL);
+#endif
+  return array->width;
+}
+
+const bstr_bitstr_t *
+bstr_packed_bitstr(const bstr_packed_array_t *const array) {
+#ifdef DEBUG
+  assert(array != NULL);
+#endif
+  return &array->bstr;
+}
+
+uint32_t bstr_packed_get(const bstr_packed_array_t *const array,
+                         unsigned int index) {
+#ifdef DEBUG
+  assert(array != NULL);
+  assert(index < array->count);
+#endif
+  return (uint32_t)bstr_kernel_get_field(_bstr_view(&array->bstr),
+                                         index * array->width, array->width);
+}
+
+void bstr_packed_set(bstr_packed_array_t *const array, unsigned int index,
+                     uint32_t value) {
+#ifdef DEBUG
+  assert(array != NULL);
+  assert(index < array->count);
+#endif
+  bstr_kernel_set_field(_bstr_view(&array->bstr), index * array->width,
+                        array->width, value);
+}
+
+void bstr_packed_unpack(const bstr_packed_array_t *const array,
+                        unsigned int first, unsigned int n, uint32_t *out) {
+#ifdef DEBUG
+  assert(array != NULL);
+  assert(n == 0 || out != NULL);
+  assert(first <= array->count && n <= array->count - first);
+#endif
+  bstr_dispatch_unpack(array->bstr._bits, array->width, first, n, out);
+}
+
+void bstr_packed_pack(bstr_packed_array_t *const array, unsigned int first,
+                      unsigned int n, const uint32_t *in) {
+#ifdef DEBUG
+  assert(array != NULL);
+  assert(n == 0 || in != NULL);
+  assert(first <= array->count && n <= array->count - first);
+#endif
+  bstr_kernel_pack_fields(_bstr_view(&array->bstr), first * array->width,
+                          array->width, in, n);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,278 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_sketch.h"
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Keys per batch of the _add_many() functions, prefetched together. */
+#define BSTR_SKETCH_BATCH 16U
+
+#define BSTR_HLL_REGISTER_MASK ((1U << BSTR_HLL_REGISTER_BITS) - 1U)
+
+/* bstr covers the words of the registers. */
+struct bstr_hll_t {
+  bstr_bitstr_t bstr;
+  unsigned int precision;
+};
+
+/* The 64 bit finalizer of MurmurHash3. */
+static inline uint64_t _bstr_sketch_mix(uint64_t key) {
+  key ^= key >> 33;
+  key *= UINT64_C(0xFF51AFD7ED558CCD);
+  key ^= key >> 33;
+  key *= UINT64_C(0xC4CEB9FE1A85EC53);
+  key ^= key >> 33;
+  return key;
+}
+
+/* Maps a key to one of nbits bits without a division. */
+static inline unsigned int _bstr_lc_bit(uint64_t key, uint64_t nbits) {
+  return (unsigned int)(((_bstr_sketch_mix(key) >> 32) * nbits) >> 32);
+}
+
+/* m * ln(m / zeros), the linear counting estimate. */
+static inline double _bstr_lc(double m, double zeros) {
+  return m * log(m / zeros);
+}
+
+void bstr_lc_add(bstr_bitstr_t *const bstr, uint64_t key) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  bstr_set(bstr, _bstr_lc_bit(key, bstr_get_bit_capacity(bstr)));
+}
+
+void bstr_lc_add_many(bstr_bitstr_t *const bstr, const uint64_t *keys,
+                      unsigned int n) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(n == 0 || keys != NULL);
+#endif
+  const uint64_t nbits = bstr_get_bit_capacity(bstr);
+  unsigned int bits[BSTR_SKETCH_BATCH];
+  for (unsigned int i = 0; i < n; i += BSTR_SKETCH_BATCH) {
+    const unsigned int batch =
+        n - i < BSTR_SKETCH_BATCH ? n - i : BSTR_SKETCH_BATCH;
+    for (unsigned int j = 0; j < batch; j++) {
+      bits[j] = _bstr_lc_bit(keys[i + j], nbits);
+      __builtin_prefetch(bstr->_bits + (bits[j] >> BSTR_BITS_PER_INT_SHIFT),
+                         1);
+    }
+    for (unsigned int j = 0; j < batch; j++)
+      bstr_set(bstr, bits[j]);
+  }
+}
+
+double bstr_lc_estimate(const bstr_bitstr_t *const bstr) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+#endif
+  const double m = bstr_get_bit_capacity(bstr);
+  const unsigned int zeros =
+      bstr_get_bit_capacity(bstr) - (unsigned int)bstr_popcnt(bstr);
+  return _bstr_lc(m, zeros == 0 ? 1.0 : zeros);
+}
+
+bstr_hll_t *bstr_hll_create(unsigned int precision) {
+#ifdef DEBUG
+  assert(precision >= BSTR_HLL_MIN_PRECISION &&
+         precision <= BSTR_HLL_MAX_PRECISION);
+#endif
+  const unsigned int nwords =
+      ((1U << precision) + BSTR_HLL_REGISTERS_PER_INT - 1U) /
+      BSTR_HLL_REGISTERS_PER_INT;
+  bstr_hll_t *hll = (bstr_hll_t *)malloc(sizeof(bstr_hll_t));
+  if (hll == NULL)
+    return NULL;
+  _bstr_wrap(&hll->bstr,
+             (unsigned int *)calloc(nwords, sizeof(unsigned int)), nwords);
+  if (hll->bstr._bits == NULL) {
+    free(hll);
+    return NULL;
+  }
+  hll->precision = precision;
+  return hll;
+}
+
+void bstr_hll_delete(bstr_hll_t *hll) {
+#ifdef DEBUG
+  assert(hll != NULL);
+#endif
+  free(hll->bstr._bits);
+  free(hll);
+}
+
+unsigned int bstr_hll_precision(const bstr_hll_t *const hll) {
+#ifdef DEBUG
+  assert(hll != NULL);
+#endif
+  return hll->precision;
+}
+
+const bstr_bitstr_t *bstr_hll_bitstr(const bstr_hll_t *const hll) {
+#ifdef DEBUG
+  assert(hll != NULL);
+#endif
+  return &hll->bstr;
+}
+
+unsigned int bstr_hll_get(const bstr_hll_t *const hll, unsigned int index) {
+#ifdef DEBUG
+  assert(hll != NULL);
+  assert(index < 1U << hll->precision);
+#endif
+  return (hll->bstr._bits[index / BSTR_HLL_REGISTERS_PER_INT] >>
+          (index % BSTR_HLL_REGISTERS_PER_INT * BSTR_HLL_REGISTER_BITS)) &
+         BSTR_HLL_REGISTER_MASK;
+}
+
+/* The register of a key is picked by the top precision bits of its hash, the
+ * rank is 1 + the number of leading zeros of the other bits. At most
+ * 65 - BSTR_HLL_MIN_PRECISION, so it fits a register. */
+static inline unsigned int _bstr_hll_index(const bstr_hll_t *const hll,
+                                           uint64_t hash) {
+  return (unsigned int)(hash >> (64U - hll->precision));
+}
+
+static inline unsigned int _bstr_hll_rank(const bstr_hll_t *const hll,
+                                          uint64_t hash) {
+  const uint64_t rest = hash << hll->precision;
+  return rest == 0 ? 65U - hll->precision
+                   : (unsigned int)__builtin_clzll(rest) + 1U;
+}
+
+static inline void _bstr_hll_put(bstr_hll_t *const hll, unsigned int index,
+                                 unsigned int rank) {
+  unsigned int *word = hll->bstr._bits + index / BSTR_HLL_REGISTERS_PER_INT;
+  const unsigned int shift =
+      index % BSTR_HLL_REGISTERS_PER_INT * BSTR_HLL_REGISTER_BITS;
+  if (rank > ((*word >> shift) & BSTR_HLL_REGISTER_MASK))
+    *word = (*word & ~(BSTR_HLL_REGISTER_MASK << shift)) | (rank << shift);
+}
+
+void bstr_hll_add(bstr_hll_t *const hll, uint64_t key) {
+#ifdef DEBUG
+  assert(hll != NULL);
+#endif
+  const uint64_t hash = _bstr_sketch_mix(key);
+  _bstr_hll_put(hll, _bstr_hll_index(hll, hash), _bstr_hll_rank(hll, hash));
+}
+
+void bstr_hll_add_many(bstr_hll_t *const hll, const uint64_t *keys,
+                       unsigned int n) {
+#ifdef DEBUG
+  assert(hll != NULL);
+  assert(n == 0 || keys != NULL);
+#endif
+  uint64_t hashes[BSTR_SKETCH_BATCH];
+  for (unsigned int i = 0; i < n; i += BSTR_SKETCH_BATCH) {
+    const unsigned int batch =
+        n - i < BSTR_SKETCH_BATCH ? n - i : BSTR_SKETCH_BATCH;
+    for (unsigned int j = 0; j < batch; j++) {
+      hashes[j] = _bstr_sketch_mix(keys[i + j]);
+      __builtin_prefetch(hll->bstr._bits +
+                             _bstr_hll_index(hll, hashes[j]) /
+                                 BSTR_HLL_REGISTERS_PER_INT,
+                         1);
+    }
+    for (unsigned int j = 0; j < batch; j++)
+      _bstr_hll_put(hll, _bstr_hll_index(hll, hashes[j]),
+                    _bstr_hll_rank(hll, hashes[j]));
+  }
+}
+
+void bstr_hll_merge(bstr_hll_t *const dst, const bstr_hll_t *const src) {
+#ifdef DEBUG
+  assert(dst != NULL);
+  assert(src != NULL);
+  assert(dst->precision == src->precision);
+#endif
+  /* Every other register with the 6 bits above it free. Setting the lowest
+   * of those in a and subtracting b leaves it set where a >= b. */
+  unsigned int even = 0;
+  for (unsigned int i = 0; i < BSTR_HLL_REGISTERS_PER_INT; i += 2)
+    even |= BSTR_HLL_REGISTER_MASK << (i * BSTR_HLL_REGISTER_BITS);
+  const unsigned int lowest = (even & ~(even << 1)) << BSTR_HLL_REGISTER_BITS;
+  unsigned int *a = dst->bstr._bits;
+  const unsigned int *b = src->bstr._bits;
+  const unsigned int nwords = dst->bstr._capacity;
+  /* Plain word operations, so the compiler vectorizes the loop. */
+  for (unsigned int i = 0; i < nwords; i++) {
+    unsigned int result = 0;
+    for (unsigned int odd = 0; odd < 2; odd++) {
+      const unsigned int shift = odd * BSTR_HLL_REGISTER_BITS;
+      const unsigned int x = (a[i] >> shift) & even;
+      const unsigned int y = (b[i] >> shift) & even;
+      const unsigned int ge =
+          (((x | lowest) - y) & lowest) >> BSTR_HLL_REGISTER_BITS;
+      const unsigned int keep = (ge << BSTR_HLL_REGISTER_BITS) - ge;
+      result |= ((x & keep) | (y & ~keep)) << shift;
+    }
+    a[i] = result;
+  }
+}
+
+double bstr_hll_estimate(const bstr_hll_t *const hll) {
+#ifdef DEBUG
+  assert(hll != NULL);
+#endif
+  const unsigned int m = 1U << hll->precision;
+  unsigned int histogram[BSTR_HLL_REGISTER_MASK + 1U] = {0};
+  for (unsigned int i = 0; i < m; i += BSTR_HLL_REGISTERS_PER_INT) {
+    unsigned int word = hll->bstr._bits[i / BSTR_HLL_REGISTERS_PER_INT];
+    const unsigned int end = m - i < BSTR_HLL_REGISTERS_PER_INT
+                                 ? m - i
+                                 : BSTR_HLL_REGISTERS_PER_INT;
+    for (unsigned int j = 0; j < end; j++) {
+      histogram[word & BSTR_HLL_REGISTER_MASK]++;
+      word >>= BSTR_HLL_REGISTER_BITS;
+    }
+  }
+  /* sum of 2^-register, from the highest rank down. */
+  double sum = 0.0;
+  for (unsigned int rank = BSTR_HLL_REGISTER_MASK + 1U; rank-- > 0;)
+    sum = (sum + histogram[rank]) * 0.5;
+  sum *= 2.0;
+  double alpha;
+  if (m == 16)
+    alpha = 0.673;
+  else if (m == 32)
+    alpha = 0.697;
+  else if (m == 64)
+    alpha = 0.709;
+  else
+    alpha = 0.7213 / (1.0 + 1.079 / m);
+  const double estimate = alpha * m * m / sum;
+  if (estimate <= 2.5 * m && histogram[0] != 0)
+    return _bstr_lc(m, histogram[0]);
+  return estimate;
+}
+
+#ifdef __cplusplus
+}
+#endif
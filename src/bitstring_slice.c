@@ -0,0 +1,379 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_slice.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The words the slice overlaps. The kernels take the slice's bit offset. */
+static inline bstr_view_t _bstr_slice_view(const bstr_slice_t slice) {
+  return bstr_kernel_view(
+      (unsigned int *)slice.words,
+      (slice.offset + slice.nbits + BSTR_BITS_PER_INT - 1U) >>
+          BSTR_BITS_PER_INT_SHIFT);
+}
+
+/* A kernel search result as an index inside slice or -1. */
+static inline int _bstr_slice_index(const bstr_slice_t slice, int bit) {
+  return bit >= 0 && (unsigned int)bit - slice.offset < slice.nbits
+             ? bit - (int)slice.offset
+             : -1;
+}
+
+/* (a op b) of two words or fields. */
+static inline uint64_t _bstr_slice_pair_op(uint64_t a, uint64_t b,
+                                           bstr_pair_op_t op) {
+  return op == BSTR_PAIR_AND      ? a & b
+         : op == BSTR_PAIR_ANDNOT ? a & ~b
+                                  : a ^ b;
+}
+
+/* Index of the first of the first n bits of a and b for which (a op b) is
+ * set, or n. */
+static unsigned int _bstr_slice_find_pair(const bstr_slice_t a,
+                                          const bstr_slice_t b,
+                                          unsigned int n, bstr_pair_op_t op) {
+  unsigned int i = 0;
+  /* With the same offset the whole words in between go to the kernel. */
+  if (a.offset == b.offset && n >= 2U * BSTR_BITS_PER_INT) {
+    const unsigned int head = BSTR_BITS_PER_INT - a.offset;
+    const uint64_t first = _bstr_slice_pair_op(
+        bstr_kernel_get_field(_bstr_slice_view(a), a.offset, head),
+        bstr_kernel_get_field(_bstr_slice_view(b), b.offset, head), op);
+    if (first != 0)
+      return (unsigned int)__builtin_ctzll(first);
+    const unsigned int nwords = (n - head) >> BSTR_BITS_PER_INT_SHIFT;
+    const unsigned int j =
+        bstr_kernel_find_pair(a.words + 1, b.words + 1, nwords, op);
+    if (j < nwords)
+      return head + (j << BSTR_BITS_PER_INT_SHIFT) +
+             (unsigned int)__builtin_ctzll(
+                 _bstr_slice_pair_op(a.words[j + 1], b.words[j + 1], op));
+    i = head + (nwords << BSTR_BITS_PER_INT_SHIFT);
+  }
+  for (; i < n; i += 64U) {
+    const unsigned int width = n - i < 64U ? n - i : 64U;
+    const uint64_t bits =
+        _bstr_slice_pair_op(bstr_slice_get_field(a, i, width),
+                            bstr_slice_get_field(b, i, width), op);
+    if (bits != 0)
+      return i + (unsigned int)__builtin_ctzll(bits);
+  }
+  return n;
+}
+
+bstr_slice_t bstr_slice(const unsigned int *words, unsigned int offset,
+                        unsigned int nbits) {
+#ifdef DEBUG
+  assert(words != NULL);
+#endif
+  bstr_slice_t slice;
+  slice.words = words + (offset >> BSTR_BITS_PER_INT_SHIFT);
+  slice.offset = offset & BSTR_BITS_PER_INT_MASK;
+  slice.nbits = nbits;
+  return slice;
+}
+
+bstr_slice_t bstr_slice_of(const bstr_bitstr_t *const bstr, unsigned int start,
+                           unsigned int n) {
+#ifdef DEBUG
+  assert(bstr != NULL);
+  assert(start + n <= bstr->_capacity << BSTR_BITS_PER_INT_SHIFT);
+#endif
+  return bstr_slice(bstr->_bits, start, n);
+}
+
+bstr_slice_t bstr_slice_sub(bstr_slice_t slice, unsigned int start,
+                            unsigned int n) {
+#ifdef DEBUG
+  assert(start + n <= slice.nbits);
+#endif
+  return bstr_slice(slice.words, slice.offset + start, n);
+}
+
+unsigned int bstr_slice_bits(bstr_slice_t slice) { return slice.nbits; }
+
+bool bstr_slice_get(bstr_slice_t slice, unsigned int bit) {
+#ifdef DEBUG
+  assert(bit < slice.nbits);
+#endif
+  return bstr_kernel_get(_bstr_slice_view(slice), slice.offset + bit);
+}
+
+uint64_t bstr_slice_get_field(bstr_slice_t slice, unsigned int offset,
+                              unsigned int width) {
+#ifdef DEBUG
+  assert(width > 0 && width <= 64);
+  assert(offset + width <= slice.nbits);
+#endif
+  return bstr_kernel_get_field(_bstr_slice_view(slice), slice.offset + offset,
+                               width);
+}
+
+int bstr_slice_popcnt(bstr_slice_t slice) {
+  return bstr_kernel_popcnt_range(_bstr_slice_view(slice), slice.offset,
+                                  slice.nbits);
+}
+
+int bstr_slice_ffs(bstr_slice_t slice) {
+  return bstr_slice_next_set_bit(slice, 0);
+}
+
+int bstr_slice_ffus(bstr_slice_t slice) {
+  return bstr_slice_next_unset_bit(slice, 0);
+}
+
+int bstr_slice_next_set_bit(bstr_slice_t slice, unsigned int offset) {
+  if (offset >= slice.nbits)
+    return -1;
+  return _bstr_slice_index(
+      slice,
+      bstr_kernel_next(_bstr_slice_view(slice), slice.offset + offset, 0U));
+}
+
+int bstr_slice_next_unset_bit(bstr_slice_t slice, unsigned int offset) {
+  if (offset >= slice.nbits)
+    return -1;
+  return _bstr_slice_index(
+      slice,
+      bstr_kernel_next(_bstr_slice_view(slice), slice.offset + offset, ~0U));
+}
+
+bool bstr_slice_is_empty(bstr_slice_t slice) {
+  return bstr_slice_ffs(slice) < 0;
+}
+
+bool bstr_slice_equals(bstr_slice_t a, bstr_slice_t b) {
+  return a.nbits == b.nbits &&
+         _bstr_slice_find_pair(a, b, a.nbits, BSTR_PAIR_XOR) == a.nbits;
+}
+
+int bstr_slice_ctz(bstr_slice_t slice) {
+  const int first = bstr_slice_ffs(slice);
+  return first < 0 ? (int)slice.nbits : first;
+}
+
+int bstr_slice_clz(bstr_slice_t slice) {
+  if (slice.nbits == 0)
+    return 0;
+  const unsigned int end = slice.offset + slice.nbits;
+  const unsigned int last = (end - 1U) >> BSTR_BITS_PER_INT_SHIFT;
+  const unsigned int top = (end - 1U) & BSTR_BITS_PER_INT_MASK;
+  /* The bits of the last word, the whole words below it, then the bits of
+   * the first word when the slice starts inside it. */
+  unsigned int word =
+      slice.words[last] & (~0U >> (BSTR_BITS_PER_INT_MASK - top));
+  if (last == 0)
+    word &= ~0U << slice.offset;
+  if (word != 0)
+    return (int)top - (int)BSTR_BITS_PER_INT_MASK + __builtin_clz(word);
+  if (last == 0)
+    return (int)slice.nbits;
+  const unsigned int first = slice.offset != 0 ? 1U : 0U;
+  const unsigned int zeros = top + 1U;
+  const int middle = bstr_kernel_clz(
+      bstr_kernel_view((unsigned int *)slice.words + first, last - first));
+  if ((unsigned int)middle < (last - first) << BSTR_BITS_PER_INT_SHIFT)
+    return (int)zeros + middle;
+  word = slice.words[0] & (~0U << slice.offset);
+  if (first != 0 && word != 0)
+    return (int)(zeros + ((last - 1U) << BSTR_BITS_PER_INT_SHIFT)) +
+           __builtin_clz(word);
+  return (int)slice.nbits;
+}
+
+int bstr_slice_popcnt_range(bstr_slice_t slice, unsigned int start,
+                            unsigned int n) {
+#ifdef DEBUG
+  assert(start + n <= slice.nbits);
+#endif
+  return bstr_kernel_popcnt_range(_bstr_slice_view(slice),
+                                  slice.offset + start, n);
+}
+
+bool bstr_slice_intersects(bstr_slice_t a, bstr_slice_t b) {
+  const unsigned int n = a.nbits < b.nbits ? a.nbits : b.nbits;
+  return _bstr_slice_find_pair(a, b, n, BSTR_PAIR_AND) < n;
+}
+
+bool bstr_slice_is_subset(bstr_slice_t a, bstr_slice_t b) {
+  const unsigned int n = a.nbits < b.nbits ? a.nbits : b.nbits;
+  if (_bstr_slice_find_pair(a, b, n, BSTR_PAIR_ANDNOT) < n)
+    return false;
+  return bstr_slice_is_empty(bstr_slice_sub(a, n, a.nbits - n));
+}
+
+int bstr_slice_compare(bstr_slice_t a, bstr_slice_t b) {
+  const unsigned int n = a.nbits < b.nbits ? a.nbits : b.nbits;
+  const unsigned int i = _bstr_slice_find_pair(a, b, n, BSTR_PAIR_XOR);
+  if (i < n)
+    return bstr_slice_get(a, i) ? 1 : -1;
+  return (a.nbits > b.nbits) - (a.nbits < b.nbits);
+}
+
+uint64_t bstr_slice_hash(bstr_slice_t slice) {
+  uint64_t hash[2];
+  bstr_slice_hash128(slice, hash);
+  return hash[0];
+}
+
+void bstr_slice_hash128(bstr_slice_t slice, uint64_t hash[2]) {
+#ifdef DEBUG
+  assert(hash != NULL);
+#endif
+  const unsigned int nwords =
+      (slice.nbits + BSTR_BITS_PER_INT_MASK) >> BSTR_BITS_PER_INT_SHIFT;
+  bstr_hash_state_t state;
+  bstr_dispatch_hash128_init(&state);
+  unsigned int w = 0;
+  if (slice.offset == 0) {
+    /* Whole blocks of whole words are hashed in place. */
+    w = (slice.nbits >> BSTR_BITS_PER_INT_SHIFT) /
+        BSTR_DISPATCH_HASH_BLOCK_WORDS * BSTR_DISPATCH_HASH_BLOCK_WORDS;
+    bstr_dispatch_hash128_update(&state, slice.words, w);
+  }
+  /* The rest is shifted down to bit 0 a block at a time. */
+  unsigned int block[BSTR_DISPATCH_HASH_BLOCK_WORDS];
+  while (w < nwords) {
+    unsigned int n = 0;
+    for (; n < BSTR_DISPATCH_HASH_BLOCK_WORDS && w + n < nwords; n++) {
+      const unsigned int bit = (w + n) << BSTR_BITS_PER_INT_SHIFT;
+      const unsigned int width = slice.nbits - bit < BSTR_BITS_PER_INT
+                                     ? slice.nbits - bit
+                                     : BSTR_BITS_PER_INT;
+      block[n] = (unsigned int)bstr_slice_get_field(slice, bit, width);
+    }
+    bstr_dispatch_hash128_update(&state, block, n);
+    w += n;
+  }
+  bstr_dispatch_hash128_final(&state, hash);
+}
+
+int bstr_slice_find_pattern(bstr_slice_t slice,
+                            const bstr_bitstr_t *const pattern,
+                            unsigned int pattern_bits, unsigned int offset) {
+#ifdef DEBUG
+  assert(pattern != NULL);
+#endif
+#ifdef CONFIG_BITSTRING_ENABLE_BOUND_CHECKS
+  assert(pattern_bits <= pattern->_capacity << BSTR_BITS_PER_INT_SHIFT);
+#endif
+  if (pattern_bits == 0 || pattern_bits > slice.nbits ||
+      offset > slice.nbits - pattern_bits)
+    return -1;
+  /* Occurrences in the words after the slice only come after all inside. */
+  const int found =
+      bstr_kernel_find_pattern(_bstr_slice_view(slice), pattern->_bits,
+                               pattern_bits, slice.offset + offset);
+  if (found < 0 ||
+      (unsigned int)found - slice.offset > slice.nbits - pattern_bits)
+    return -1;
+  return found - (int)slice.offset;
+}
+
+/* bstr_kernel_find_run() on the bits [from, limit) of a slice, aligned from
+ * bit 0 of the slice. */
+static int _bstr_slice_find_run(const bstr_slice_t slice, unsigned int n,
+                                unsigned int align, unsigned int from,
+                                unsigned int limit, unsigned int invert) {
+  const bstr_view_t v = _bstr_slice_view(slice);
+  const unsigned int mask = align > 1 ? align - 1 : 0;
+  if (n == 0 || n > slice.nbits)
+    return -1;
+  if (limit > slice.nbits - n + 1)
+    limit = slice.nbits - n + 1;
+  if (from >= limit)
+    return -1;
+  from += slice.offset;
+  limit += slice.offset;
+  if ((slice.offset & mask) == 0)
+    return _bstr_slice_index(
+        slice, bstr_kernel_find_run(v, n, align, from, limit, invert));
+  /* The kernel aligns from bit 0 of the word. Find any run, move up to the
+   * alignment of the slice and check whether it still holds there. */
+  while (from < limit) {
+    const int found = bstr_kernel_find_run(v, n, 1, from, limit, invert);
+    if (found < 0)
+      return -1;
+    const unsigned int start =
+        (((unsigned int)found - slice.offset + mask) & ~mask) + slice.offset;
+    if (start >= limit)
+      return -1;
+    if (bstr_kernel_find_run(v, n, 1, start, start + 1, invert) ==
+        (int)start)
+      return (int)(start - slice.offset);
+    from = start + 1;
+  }
+  return -1;
+}
+
+static int _bstr_slice_find_run_from(const bstr_slice_t slice,
+                                     unsigned int n, unsigned int align,
+                                     unsigned int hint, unsigned int invert) {
+  const int found =
+      _bstr_slice_find_run(slice, n, align, hint, UINT_MAX, invert);
+  if (found >= 0 || hint == 0)
+    return found;
+  return _bstr_slice_find_run(slice, n, align, 0, hint, invert);
+}
+
+int bstr_slice_find_zero_run(bstr_slice_t slice, unsigned int n,
+                             unsigned int align, unsigned int hint) {
+#ifdef DEBUG
+  assert((align & (align - 1)) == 0);
+#endif
+  return _bstr_slice_find_run_from(slice, n, align, hint, ~0U);
+}
+
+int bstr_slice_find_one_run(bstr_slice_t slice, unsigned int n,
+                            unsigned int align, unsigned int hint) {
+#ifdef DEBUG
+  assert((align & (align - 1)) == 0);
+#endif
+  return _bstr_slice_find_run_from(slice, n, align, hint, 0U);
+}
+
+size_t bstr_slice_to_string_size(bstr_slice_t slice) {
+  return (size_t)slice.nbits + 1;
+}
+
+void bstr_slice_to_string(bstr_slice_t slice, char *const str) {
+#ifdef DEBUG
+  assert(str != NULL);
+#endif
+  char *out = str;
+  for (unsigned int i = 0; i < slice.nbits; i += 64U) {
+    const unsigned int width = slice.nbits - i < 64U ? slice.nbits - i : 64U;
+    const uint64_t bits = bstr_slice_get_field(slice, i, width);
+    for (unsigned int bit = 0; bit < width; bit++)
+      *out++ = ((bits >> bit) & 1U) ? '1' : '0';
+  }
+  *out = '\0';
+}
+
+#ifdef __cplusplus
+}
+#endif
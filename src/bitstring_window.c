@@ -0,0 +1,163 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Slice i uses words [i * slice_capacity, (i + 1) * slice_capacity) of ring. */
+struct bstr_window_t {
+  bstr_bitstr_t *ring;
+  /** One header per slice, pointing into ring. */
+  bstr_bitstr_t *slices;
+  /** The same headers as a pointer array for bstr_union_many(). */
+  const bstr_bitstr_t **slice_ptrs;
+  /** Set bits per slice. */
+  uint64_t *counts;
+  uint64_t total;
+  unsigned int ticks;
+  /** Slice of the current tick. */
+  unsigned int head;
+};
+
+bstr_window_t *bstr_window_create(unsigned int ticks,
+                                  unsigned int slice_capacity) {
+#ifdef DEBUG
+  assert(ticks > 0 && slice_capacity > 0);
+#endif
+  bstr_window_t *win = (bstr_window_t *)calloc(1, sizeof(bstr_window_t));
+  if (win == NULL)
+    return NULL;
+  win->ticks = ticks;
+  win->slices = (bstr_bitstr_t *)malloc(ticks * sizeof(bstr_bitstr_t));
+  win->slice_ptrs =
+      (const bstr_bitstr_t **)malloc(ticks * sizeof(bstr_bitstr_t *));
+  win->counts = (uint64_t *)calloc(ticks, sizeof(uint64_t));
+  if (win->slices == NULL || win->slice_ptrs == NULL || win->counts == NULL ||
+      (uint64_t)ticks * slice_capacity > UINT_MAX ||
+      (win->ring = bstr_create_bitstr(ticks * slice_capacity)) == NULL) {
+    bstr_window_delete(win);
+    return NULL;
+  }
+  for (unsigned int i = 0; i < ticks; i++) {
+    _bstr_wrap(&win->slices[i], win->ring->_bits + (size_t)i * slice_capacity,
+               slice_capacity);
+    win->slice_ptrs[i] = &win->slices[i];
+  }
+  return win;
+}
+
+void bstr_window_delete(bstr_window_t *win) {
+#ifdef DEBUG
+  assert(win != NULL);
+#endif
+  if (win->ring != NULL)
+    bstr_delete_bitstr(win->ring);
+  free(win->slices);
+  free(win->slice_ptrs);
+  free(win->counts);
+  free(win);
+}
+
+unsigned int bstr_window_ticks(const bstr_window_t *const win) {
+  return win->ticks;
+}
+
+const bstr_bitstr_t *bstr_window_slice(const bstr_window_t *const win,
+                                       unsigned int age) {
+#ifdef DEBUG
+  assert(age < win->ticks);
+#endif
+  const unsigned int i =
+      age <= win->head ? win->head - age : win->head + win->ticks - age;
+  return &win->slices[i];
+}
+
+void bstr_window_set(bstr_window_t *const win, unsigned int bit) {
+  bstr_bitstr_t *slice = &win->slices[win->head];
+  if (!bstr_get(slice, bit)) {
+    bstr_set(slice, bit);
+    win->counts[win->head]++;
+    win->total++;
+  }
+}
+
+bool bstr_window_get(const bstr_window_t *const win, unsigned int bit) {
+  for (unsigned int i = 0; i < win->ticks; i++)
+    if (bstr_get(&win->slices[i], bit))
+      return true;
+  return false;
+}
+
+bool bstr_window_test_and_set(bstr_window_t *const win, unsigned int bit) {
+  /* The current slice is the most likely hit, look there first. */
+  if (bstr_get(&win->slices[win->head], bit))
+    return true;
+  const bool seen = bstr_window_get(win, bit);
+  bstr_window_set(win, bit);
+  return seen;
+}
+
+unsigned int bstr_window_count(const bstr_window_t *const win,
+                               unsigned int bit) {
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < win->ticks; i++)
+    count += bstr_get(&win->slices[i], bit) ? 1U : 0U;
+  return count;
+}
+
+uint64_t bstr_window_popcnt(const bstr_window_t *const win) {
+  return win->total;
+}
+
+void bstr_window_advance(bstr_window_t *const win, unsigned int ticks) {
+  if (ticks >= win->ticks) {
+    bstr_set_all(win->ring, false);
+    for (unsigned int i = 0; i < win->ticks; i++)
+      win->counts[i] = 0;
+    win->total = 0;
+    win->head = (unsigned int)(((uint64_t)win->head + ticks) % win->ticks);
+    return;
+  }
+  for (unsigned int t = 0; t < ticks; t++) {
+    win->head = win->head + 1U == win->ticks ? 0 : win->head + 1U;
+    /* Only slices that saw a bit need the memset. */
+    if (win->counts[win->head] != 0) {
+      bstr_set_all(&win->slices[win->head], false);
+      win->total -= win->counts[win->head];
+      win->counts[win->head] = 0;
+    }
+  }
+}
+
+void bstr_window_union(const bstr_window_t *const win,
+                       bstr_bitstr_t *const dst) {
+  bstr_union_many(dst, win->slice_ptrs, win->ticks);
+}
+
+#ifdef __cplusplus
+}
+#endif
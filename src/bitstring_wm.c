@@ -0,0 +1,302 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_wm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BSTR_WM_BLOCK_SHIFT 3U
+#define BSTR_WM_BLOCK_BITS (BSTR_WM_BLOCK_WORDS * BSTR_BITS_PER_INT)
+
+typedef struct _bstr_wm_level_t {
+  bstr_bitstr_t *bits;
+  /** Set bits before each block, one entry more than there are blocks. */
+  unsigned int *ranks;
+  /** How many bits of this level are unset. */
+  unsigned int zeros;
+} _bstr_wm_level_t;
+
+/* levels[0] holds the most significant bit of the symbols. */
+struct bstr_wm_t {
+  _bstr_wm_level_t *levels;
+  unsigned int nlevels;
+  unsigned int n;
+  unsigned int nblocks;
+};
+
+static unsigned int _bstr_wm_rank1(const _bstr_wm_level_t *level,
+                                   unsigned int index) {
+  const unsigned int *words = level->bits->_bits;
+  const unsigned int end = index >> BSTR_BITS_PER_INT_SHIFT;
+  unsigned int rank = level->ranks[index / BSTR_WM_BLOCK_BITS];
+  for (unsigned int i = (index / BSTR_WM_BLOCK_BITS) << BSTR_WM_BLOCK_SHIFT;
+       i < end; i++)
+    rank += (unsigned int)__builtin_popcount(words[i]);
+  if ((index & BSTR_BITS_PER_INT_MASK) != 0)
+    rank += (unsigned int)__builtin_popcount(
+        words[end] & ~(~0U << (index & BSTR_BITS_PER_INT_MASK)));
+  return rank;
+}
+
+/* Set bits (invert is 0) or unset bits (invert is ~0U) before block. */
+static inline unsigned int _bstr_wm_block_rank(const _bstr_wm_level_t *level,
+                                               unsigned int block,
+                                               unsigned int invert) {
+  return invert != 0 ? block * BSTR_WM_BLOCK_BITS - level->ranks[block]
+                     : level->ranks[block];
+}
+
+/* Index of the set bit number k (from 0) in (word ^ invert). */
+static unsigned int _bstr_wm_select(const bstr_wm_t *const wm,
+                                    const _bstr_wm_level_t *level,
+                                    unsigned int k, unsigned int invert) {
+  unsigned int lo = 0;
+  unsigned int hi = wm->nblocks;
+  /* The last block that starts with at most k such bits before it. */
+  while (hi - lo > 1) {
+    const unsigned int mid = lo + (hi - lo) / 2;
+    if (_bstr_wm_block_rank(level, mid, invert) <= k)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  k -= _bstr_wm_block_rank(level, lo, invert);
+  const unsigned int *words = level->bits->_bits;
+  unsigned int i = lo << BSTR_WM_BLOCK_SHIFT;
+  unsigned int word = words[i] ^ invert;
+  for (unsigned int count; k >= (count = __builtin_popcount(word));
+       word = words[++i] ^ invert)
+    k -= count;
+  for (; k > 0; k--)
+    word &= word - 1U;
+  return (i << BSTR_BITS_PER_INT_SHIFT) + (unsigned int)__builtin_ctz(word);
+}
+
+static inline unsigned int _bstr_wm_bit(const bstr_wm_t *const wm,
+                                        unsigned int symbol,
+                                        unsigned int depth) {
+  return (symbol >> (wm->nlevels - 1U - depth)) & 1U;
+}
+
+/* Follows index one level down along bit. */
+static inline unsigned int _bstr_wm_down(const _bstr_wm_level_t *level,
+                                         unsigned int index, unsigned int bit) {
+  const unsigned int ones = _bstr_wm_rank1(level, index);
+  return bit != 0 ? level->zeros + ones : index - ones;
+}
+
+bstr_wm_t *bstr_wm_create(const unsigned int *values, unsigned int n) {
+#ifdef DEBUG
+  assert(n == 0 || values != NULL);
+#endif
+  unsigned int max = 0;
+  for (unsigned int i = 0; i < n; i++)
+    max = values[i] > max ? values[i] : max;
+  bstr_wm_t *wm = (bstr_wm_t *)malloc(sizeof(bstr_wm_t));
+  if (wm == NULL)
+    return NULL;
+  wm->n = n;
+  wm->nlevels =
+      max != 0 ? (unsigned int)(BSTR_BITS_PER_INT - __builtin_clz(max)) : 0;
+  const unsigned int nwords =
+      n != 0 ? (n + BSTR_BITS_PER_INT - 1U) >> BSTR_BITS_PER_INT_SHIFT : 1U;
+  wm->nblocks = (nwords + BSTR_WM_BLOCK_WORDS - 1U) >> BSTR_WM_BLOCK_SHIFT;
+  wm->levels = (_bstr_wm_level_t *)calloc(wm->nlevels + 1U,
+                                          sizeof(_bstr_wm_level_t));
+  /* The symbols in the order of the current level and of the next one. */
+  unsigned int *cur = (unsigned int *)malloc((n + 1U) * sizeof(unsigned int));
+  unsigned int *next = (unsigned int *)malloc((n + 1U) * sizeof(unsigned int));
+  bool failed = wm->levels == NULL || cur == NULL || next == NULL;
+  for (unsigned int d = 0; !failed && d < wm->nlevels; d++) {
+    _bstr_wm_level_t *level = &wm->levels[d];
+    level->bits = bstr_create_bitstr(nwords);
+    level->ranks =
+        (unsigned int *)malloc((wm->nblocks + 1U) * sizeof(unsigned int));
+    failed = level->bits == NULL || level->ranks == NULL;
+  }
+  if (failed) {
+    free(cur);
+    free(next);
+    if (wm->levels == NULL)
+      wm->nlevels = 0;
+    bstr_wm_delete(wm);
+    return NULL;
+  }
+
+  if (n != 0)
+    memcpy(cur, values, n * sizeof(unsigned int));
+  for (unsigned int d = 0; d < wm->nlevels; d++) {
+    _bstr_wm_level_t *level = &wm->levels[d];
+    unsigned int *words = level->bits->_bits;
+    const unsigned int shift = wm->nlevels - 1U - d;
+    for (unsigned int i = 0; i < n; i++)
+      words[i >> BSTR_BITS_PER_INT_SHIFT] |=
+          ((cur[i] >> shift) & 1U) << (i & BSTR_BITS_PER_INT_MASK);
+    /* Rank blocks, then a stable partition by the bit: zeros first. */
+    unsigned int ones = 0;
+    for (unsigned int i = 0; i < nwords; i++) {
+      if ((i & (BSTR_WM_BLOCK_WORDS - 1U)) == 0)
+        level->ranks[i >> BSTR_WM_BLOCK_SHIFT] = ones;
+      ones += (unsigned int)__builtin_popcount(words[i]);
+    }
+    level->ranks[wm->nblocks] = ones;
+    level->zeros = n - ones;
+    unsigned int zero = 0;
+    unsigned int one = level->zeros;
+    for (unsigned int i = 0; i < n; i++) {
+      if ((cur[i] >> shift) & 1U)
+        next[one++] = cur[i];
+      else
+        next[zero++] = cur[i];
+    }
+    unsigned int *swap = cur;
+    cur = next;
+    next = swap;
+  }
+  free(cur);
+  free(next);
+  return wm;
+}
+
+void bstr_wm_delete(bstr_wm_t *wm) {
+#ifdef DEBUG
+  assert(wm != NULL);
+#endif
+  for (unsigned int d = 0; d < wm->nlevels; d++) {
+    if (wm->levels[d].bits != NULL)
+      bstr_delete_bitstr(wm->levels[d].bits);
+    free(wm->levels[d].ranks);
+  }
+  free(wm->levels);
+  free(wm);
+}
+
+unsigned int bstr_wm_count(const bstr_wm_t *const wm) {
+#ifdef DEBUG
+  assert(wm != NULL);
+#endif
+  return wm->n;
+}
+
+size_t bstr_wm_size_in_bits(const bstr_wm_t *const wm) {
+#ifdef DEBUG
+  assert(wm != NULL);
+#endif
+  const size_t words = wm->nlevels != 0 ? wm->levels[0].bits->_capacity : 0;
+  return (size_t)wm->nlevels * (words + wm->nblocks + 1U) * BSTR_BITS_PER_INT;
+}
+
+unsigned int bstr_wm_get(const bstr_wm_t *const wm, unsigned int index) {
+#ifdef DEBUG
+  assert(wm != NULL);
+  assert(index < wm->n);
+#endif
+  unsigned int symbol = 0;
+  for (unsigned int d = 0; d < wm->nlevels; d++) {
+    const _bstr_wm_level_t *level = &wm->levels[d];
+    const unsigned int bit = bstr_get(level->bits, index);
+    symbol = (symbol << 1) | bit;
+    index = _bstr_wm_down(level, index, bit);
+  }
+  return symbol;
+}
+
+unsigned int bstr_wm_rank(const bstr_wm_t *const wm, unsigned int symbol,
+                          unsigned int index) {
+#ifdef DEBUG
+  assert(wm != NULL);
+  assert(index <= wm->n);
+#endif
+  if (wm->nlevels < BSTR_BITS_PER_INT && (symbol >> wm->nlevels) != 0)
+    return 0;
+  /* [start, index) are the occurrences of the prefix of symbol so far. */
+  unsigned int start = 0;
+  for (unsigned int d = 0; d < wm->nlevels; d++) {
+    const unsigned int bit = _bstr_wm_bit(wm, symbol, d);
+    start = _bstr_wm_down(&wm->levels[d], start, bit);
+    index = _bstr_wm_down(&wm->levels[d], index, bit);
+  }
+  return index - start;
+}
+
+int bstr_wm_select(const bstr_wm_t *const wm, unsigned int symbol,
+                   unsigned int k) {
+#ifdef DEBUG
+  assert(wm != NULL);
+#endif
+  if (wm->nlevels < BSTR_BITS_PER_INT && (symbol >> wm->nlevels) != 0)
+    return -1;
+  unsigned int start = 0;
+  unsigned int end = wm->n;
+  for (unsigned int d = 0; d < wm->nlevels; d++) {
+    const unsigned int bit = _bstr_wm_bit(wm, symbol, d);
+    start = _bstr_wm_down(&wm->levels[d], start, bit);
+    end = _bstr_wm_down(&wm->levels[d], end, bit);
+  }
+  if (k >= end - start)
+    return -1;
+  /* Walk the occurrence back up to the top level. */
+  unsigned int index = start + k;
+  for (unsigned int d = wm->nlevels; d-- > 0;) {
+    const _bstr_wm_level_t *level = &wm->levels[d];
+    if (_bstr_wm_bit(wm, symbol, d) != 0)
+      index = _bstr_wm_select(wm, level, index - level->zeros, 0U);
+    else
+      index = _bstr_wm_select(wm, level, index, ~0U);
+  }
+  return (int)index;
+}
+
+unsigned int bstr_wm_quantile(const bstr_wm_t *const wm, unsigned int from,
+                              unsigned int to, unsigned int k) {
+#ifdef DEBUG
+  assert(wm != NULL);
+  assert(from < to && to <= wm->n);
+  assert(k < to - from);
+#endif
+  unsigned int symbol = 0;
+  for (unsigned int d = 0; d < wm->nlevels; d++) {
+    const _bstr_wm_level_t *level = &wm->levels[d];
+    const unsigned int from_ones = _bstr_wm_rank1(level, from);
+    const unsigned int to_ones = _bstr_wm_rank1(level, to);
+    const unsigned int zeros = (to - from) - (to_ones - from_ones);
+    if (k < zeros) {
+      symbol <<= 1;
+      from -= from_ones;
+      to -= to_ones;
+    } else {
+      symbol = (symbol << 1) | 1U;
+      k -= zeros;
+      from = level->zeros + from_ones;
+      to = level->zeros + to_ones;
+    }
+  }
+  return symbol;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -79,6 +79,39 @@ void test_bstr_resize_with_smaller_size(void) {
   bstr_delete_bitstr(shrink);
 }
 
+/* Across BSTR_HUGE_PAGE_MIN_BYTES both ways, so with
+ * CONFIG_BITSTRING_HUGE_PAGES the words move between malloc() and mappings. */
+void test_bstr_resize_huge(void) {
+  const unsigned int huge =
+      BSTR_HUGE_PAGE_MIN_BYTES / sizeof(unsigned int) + 1000U;
+  bstr_bitstr_t *bstr = bstr_create_bitstr(64);
+  TEST_ASSERT_NOT_NULL(bstr);
+  bstr_set(bstr, 5);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(bstr, huge));
+#if defined(CONFIG_BITSTRING_HUGE_PAGES) && defined(__linux__)
+  TEST_ASSERT_EQUAL_UINT64(0, (uintptr_t)bstr->_bits % BSTR_HUGE_PAGE_SIZE);
+#endif
+  TEST_ASSERT_EQUAL_INT(1, bstr_popcnt(bstr));
+  const unsigned int last = huge * BSTR_BITS_PER_INT - 1U;
+  bstr_set(bstr, last);
+  /* Shrink within the last huge page, then grow again: the words that were
+   * cut off must come back zero. */
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(bstr, huge - 10U));
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(bstr, huge * 2U));
+  TEST_ASSERT_EQUAL_INT(1, bstr_popcnt(bstr));
+  TEST_ASSERT_FALSE(bstr_get(bstr, last));
+  bstr_set(bstr, huge * 2U * BSTR_BITS_PER_INT - 1U);
+  TEST_ASSERT_EQUAL_INT(2, bstr_popcnt(bstr));
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(bstr, 64));
+  TEST_ASSERT_EQUAL_INT(1, bstr_popcnt(bstr));
+  TEST_ASSERT_TRUE(bstr_get(bstr, 5));
+  bstr_delete_bitstr(bstr);
+  bstr = bstr_create_bitstr(huge);
+  TEST_ASSERT_NOT_NULL(bstr);
+  TEST_ASSERT_TRUE(bstr_is_empty(bstr));
+  bstr_delete_bitstr(bstr);
+}
+
 void test_bstr_get_capacity(void) {
   for (unsigned int i = 1; i < TEST_BSTR_MAX_TEST_CAPACITY; i++) {
     bstr_bitstr_t *test = bstr_create_bitstr(i);
@@ -108,6 +141,20 @@ void test_bstr_to_string_size(void) {
   }
 }
 
+void test_bstr_to_string(void) {
+  bstr_bitstr_t *test = bstr_create_bitstr(2);
+  TEST_ASSERT_NOT_NULL(test);
+  bstr_set(test, 0);
+  bstr_set(test, 63);
+  char str[2 * sizeof(unsigned int) * CHAR_BIT + 1] = {0};
+  bstr_to_string(test, str);
+  TEST_ASSERT_EQUAL_UINT(bstr_to_string_size(test) - 1, strlen(str));
+  TEST_ASSERT_EQUAL_INT('1', str[0]);
+  TEST_ASSERT_EQUAL_INT('0', str[1]);
+  TEST_ASSERT_EQUAL_INT('1', str[63]);
+  bstr_delete_bitstr(test);
+}
+
 void test_bstr_set_linear(void) {
   for (unsigned int i = 1; i < TEST_BSTR_MAX_TEST_CAPACITY; i++) {
     bstr_bitstr_t *test = bstr_create_bitstr(i);
@@ -259,6 +306,95 @@ void test_bstr_popcnt(void) {
   }
 }
 
+static int test_bstr_count(const bstr_bitstr_t *const bstr, unsigned int start,
+                           unsigned int n) {
+  int count = 0;
+  for (unsigned int i = start; i < start + n; i++)
+    count += bstr_get(bstr, i) ? 1 : 0;
+  return count;
+}
+
+void test_bstr_popcnt_range(void) {
+  bstr_bitstr_t *test = bstr_create_bitstr(100);
+  TEST_ASSERT_NOT_NULL(test);
+  srand(7);
+  for (unsigned int i = 0; i < 1500; i++)
+    bstr_set(test, (unsigned int)rand() % bstr_get_bit_capacity(test));
+  for (unsigned int i = 0; i < 300; i++) {
+    const unsigned int start =
+        (unsigned int)rand() % bstr_get_bit_capacity(test);
+    const unsigned int n =
+        (unsigned int)rand() % (bstr_get_bit_capacity(test) - start + 1U);
+    TEST_ASSERT_EQUAL_INT(test_bstr_count(test, start, n),
+                          bstr_popcnt_range(test, start, n));
+  }
+  TEST_ASSERT_EQUAL_INT(
+      bstr_popcnt(test),
+      bstr_popcnt_range(test, 0, bstr_get_bit_capacity(test)));
+  bstr_delete_bitstr(test);
+}
+
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+/* Every kind of write against a brute force count. */
+void test_bstr_popcnt_cache(void) {
+  bstr_bitstr_t *test = bstr_create_bitstr(70);
+  bstr_bitstr_t *other = bstr_create_bitstr(70);
+  const bstr_bitstr_t *srcs[2] = {test, other};
+  TEST_ASSERT_NOT_NULL(test);
+  TEST_ASSERT_NOT_NULL(other);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_popcnt_cache_enable(test));
+  TEST_ASSERT_EQUAL_INT(0, bstr_popcnt(test));
+  srand(11);
+  for (unsigned int i = 0; i < 2000; i++) {
+    const unsigned int bits = bstr_get_bit_capacity(test);
+    const unsigned int bit = (unsigned int)rand() % bits;
+    const unsigned int op = (unsigned int)rand() % 16;
+    if (op < 6) {
+      bstr_set(test, bit);
+    } else if (op < 10) {
+      bstr_clr(test, bit);
+    } else if (op < 13) {
+      const unsigned int width = 1U + (unsigned int)rand() % 64;
+      if (bit + width <= bits)
+        bstr_set_field(test, bit, width,
+                       ((uint64_t)rand() << 32) ^ (uint64_t)rand());
+    } else if (op == 13) {
+      const unsigned int n = (unsigned int)rand() % (bits - bit + 1U);
+      if (rand() % 2)
+        bstr_set_range(test, bit, n);
+      else
+        bstr_clr_range(test, bit, n);
+    } else if (op == 14 && i % 50 == 0) {
+      bstr_set(other, bit);
+      bstr_union_many(test, srcs, 2);
+    } else if (i % 100 == 0) {
+      TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR,
+                            bstr_resize(test, 40U + (unsigned int)rand() % 60));
+      bstr_set_all(other, false);
+      TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR,
+                            bstr_resize(other, bstr_get_capacity(test)));
+    }
+    if (i % 7 == 0) {
+      const unsigned int start =
+          (unsigned int)rand() % bstr_get_bit_capacity(test);
+      const unsigned int n =
+          (unsigned int)rand() % (bstr_get_bit_capacity(test) - start + 1U);
+      TEST_ASSERT_EQUAL_INT(test_bstr_count(test, start, n),
+                            bstr_popcnt_range(test, start, n));
+    }
+    TEST_ASSERT_EQUAL_INT(
+        test_bstr_count(test, 0, bstr_get_bit_capacity(test)),
+        bstr_popcnt(test));
+  }
+  bstr_set_all(test, true);
+  TEST_ASSERT_EQUAL_INT(bstr_get_bit_capacity(test), bstr_popcnt(test));
+  bstr_popcnt_cache_disable(test);
+  TEST_ASSERT_EQUAL_INT(bstr_get_bit_capacity(test), bstr_popcnt(test));
+  bstr_delete_bitstr(other);
+  bstr_delete_bitstr(test);
+}
+#endif
+
 void test_bstr_ffus(void) {
   for (unsigned int i = 1; i < TEST_BSTR_MAX_TEST_CAPACITY; i++) {
     bstr_bitstr_t *test = bstr_create_bitstr(i);
@@ -314,15 +450,402 @@ void test_bstr_next_unset_bit(void) {
   }
 }
 
+void test_bstr_predicates(void) {
+  for (unsigned int i = 1; i < TEST_BSTR_MAX_TEST_CAPACITY; i++) {
+    bstr_bitstr_t *a = bstr_create_bitstr(i);
+    bstr_bitstr_t *b = bstr_create_bitstr(i);
+    const unsigned int last = bstr_get_bit_capacity(a) - 1;
+    TEST_ASSERT_TRUE(bstr_is_empty(a));
+    TEST_ASSERT_TRUE(bstr_equals(a, b));
+    TEST_ASSERT_TRUE(bstr_is_subset(a, b));
+    TEST_ASSERT_FALSE(bstr_intersects(a, b));
+    TEST_ASSERT_EQUAL_INT(0, bstr_compare(a, b));
+
+    bstr_set(a, last);
+    TEST_ASSERT_FALSE(bstr_is_empty(a));
+    TEST_ASSERT_FALSE(bstr_equals(a, b));
+    TEST_ASSERT_FALSE(bstr_is_subset(a, b));
+    TEST_ASSERT_TRUE(bstr_is_subset(b, a));
+    TEST_ASSERT_TRUE(bstr_compare(a, b) > 0);
+    TEST_ASSERT_TRUE(bstr_compare(b, a) < 0);
+
+    bstr_set(b, last);
+    bstr_set(b, 0);
+    TEST_ASSERT_TRUE(bstr_intersects(a, b));
+    TEST_ASSERT_TRUE(bstr_is_subset(a, b));
+    TEST_ASSERT_FALSE(bstr_is_subset(b, a));
+    TEST_ASSERT_TRUE(bstr_compare(a, b) < 0);
+
+    bstr_clr(b, last);
+    TEST_ASSERT_FALSE(bstr_intersects(a, b));
+    bstr_delete_bitstr(a);
+    bstr_delete_bitstr(b);
+  }
+}
+
+void test_bstr_predicates_different_capacity(void) {
+  bstr_bitstr_t *small = bstr_create_bitstr(1);
+  bstr_bitstr_t *big = bstr_create_bitstr(TEST_BSTR_MAX_TEST_CAPACITY);
+  TEST_ASSERT_FALSE(bstr_equals(small, big));
+  TEST_ASSERT_TRUE(bstr_compare(small, big) < 0);
+  TEST_ASSERT_TRUE(bstr_is_subset(big, small));
+  bstr_set(big, bstr_get_bit_capacity(big) - 1);
+  TEST_ASSERT_FALSE(bstr_is_subset(big, small));
+  TEST_ASSERT_TRUE(bstr_is_subset(small, big));
+  TEST_ASSERT_FALSE(bstr_intersects(small, big));
+  bstr_set(small, 3);
+  bstr_set(big, 3);
+  TEST_ASSERT_TRUE(bstr_intersects(big, small));
+  bstr_delete_bitstr(small);
+  bstr_delete_bitstr(big);
+}
+
+static bool test_bstr_matches_at(const bstr_bitstr_t *bstr,
+                                 const bstr_bitstr_t *pattern,
+                                 unsigned int pattern_bits, unsigned int at) {
+  for (unsigned int j = 0; j < pattern_bits; j++)
+    if (bstr_get(bstr, at + j) != bstr_get(pattern, j))
+      return false;
+  return true;
+}
+
+void test_bstr_find_pattern(void) {
+  static const unsigned int lengths[] = {1, 3, 8, 31, 32, 33, 64, 100, 300};
+  static unsigned int matches[2048];
+  bstr_bitstr_t *bstr = bstr_create_bitstr(TEST_BSTR_MAX_TEST_CAPACITY);
+  bstr_bitstr_t *pattern = bstr_create_bitstr(16);
+  const unsigned int nbits = bstr_get_bit_capacity(bstr);
+  srand(7);
+  for (unsigned int i = 0; i < nbits; i++)
+    if (rand() % 4 == 0)
+      bstr_set(bstr, i);
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+    const unsigned int k = lengths[l];
+    /* Take the pattern from the text, so there is at least one match. */
+    const unsigned int from = (unsigned int)rand() % (nbits - k);
+    bstr_set_all(pattern, false);
+    for (unsigned int j = 0; j < k; j++)
+      if (bstr_get(bstr, from + j))
+        bstr_set(pattern, j);
+
+    unsigned int expected = 0;
+    int previous = -1;
+    for (unsigned int at = 0; at + k <= nbits; at++) {
+      if (!test_bstr_matches_at(bstr, pattern, k, at))
+        continue;
+      TEST_ASSERT_EQUAL_INT(at, bstr_find_pattern(bstr, pattern, k,
+                                                  (unsigned int)previous + 1));
+      previous = (int)at;
+      expected++;
+    }
+    TEST_ASSERT_EQUAL_INT(-1, bstr_find_pattern(bstr, pattern, k,
+                                                (unsigned int)previous + 1));
+    TEST_ASSERT_TRUE(expected > 0);
+    const unsigned int count = bstr_find_all_pattern(
+        bstr, pattern, k, matches, sizeof(matches) / sizeof(matches[0]));
+    TEST_ASSERT_EQUAL_UINT(expected, count);
+    for (unsigned int m = 0; m < count && m < 2048; m++)
+      TEST_ASSERT_TRUE(test_bstr_matches_at(bstr, pattern, k, matches[m]));
+    TEST_ASSERT_EQUAL_INT(matches[0], bstr_find_pattern(bstr, pattern, k, 0));
+    TEST_ASSERT_EQUAL_UINT(count,
+                           bstr_find_all_pattern(bstr, pattern, k, NULL, 0));
+  }
+  /* No match past the end, the last possible start is nbits - k. */
+  bstr_set_all(bstr, true);
+  bstr_set_all(pattern, true);
+  TEST_ASSERT_EQUAL_INT(nbits - 5, bstr_find_pattern(bstr, pattern, 5,
+                                                     nbits - 5));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_find_pattern(bstr, pattern, 5, nbits - 4));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_find_pattern(bstr, pattern, 0, 0));
+  bstr_delete_bitstr(bstr);
+  bstr_delete_bitstr(pattern);
+}
+
+static int test_bstr_find_run_reference(const bstr_bitstr_t *bstr,
+                                        unsigned int n, unsigned int align,
+                                        unsigned int hint, bool on) {
+  const unsigned int nbits = bstr_get_bit_capacity(bstr);
+  const unsigned int step = align > 1 ? align : 1;
+  for (unsigned int pass = 0; pass < 2; pass++) {
+    for (unsigned int at = 0; at + n <= nbits; at += step) {
+      if ((pass == 0) != (at >= hint))
+        continue;
+      unsigned int j = 0;
+      while (j < n && bstr_get(bstr, at + j) == on)
+        j++;
+      if (j == n)
+        return (int)at;
+    }
+  }
+  return -1;
+}
+
+void test_bstr_find_run(void) {
+  static const unsigned int lengths[] = {1, 2, 5, 31, 32, 33, 70, 200};
+  static const unsigned int aligns[] = {0, 1, 4, 32, 64};
+  bstr_bitstr_t *bstr = bstr_create_bitstr(TEST_BSTR_MAX_TEST_CAPACITY);
+  const unsigned int nbits = bstr_get_bit_capacity(bstr);
+  srand(11);
+  /* Long stretches of either kind with short noise in between. */
+  for (unsigned int i = 0; i < nbits;) {
+    const unsigned int len = (unsigned int)rand() % 300 + 1;
+    const bool on = rand() % 2 == 0;
+    for (unsigned int j = 0; j < len && i < nbits; j++, i++)
+      if (on != (rand() % 50 == 0))
+        bstr_set(bstr, i);
+  }
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+    for (size_t a = 0; a < sizeof(aligns) / sizeof(aligns[0]); a++) {
+      const unsigned int n = lengths[l];
+      const unsigned int align = aligns[a];
+      const unsigned int hint = (unsigned int)rand() % nbits;
+      TEST_ASSERT_EQUAL_INT(
+          test_bstr_find_run_reference(bstr, n, align, hint, false),
+          bstr_find_zero_run(bstr, n, align, hint));
+      TEST_ASSERT_EQUAL_INT(
+          test_bstr_find_run_reference(bstr, n, align, hint, true),
+          bstr_find_one_run(bstr, n, align, hint));
+      TEST_ASSERT_EQUAL_INT(
+          test_bstr_find_run_reference(bstr, n, align, 0, false),
+          bstr_find_zero_run(bstr, n, align, 0));
+    }
+  }
+  bstr_set_all(bstr, true);
+  TEST_ASSERT_EQUAL_INT(-1, bstr_find_zero_run(bstr, 1, 0, 0));
+  TEST_ASSERT_EQUAL_INT(0, bstr_find_one_run(bstr, nbits, 0, 0));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_find_one_run(bstr, nbits + 1, 0, 0));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_find_one_run(bstr, 0, 0, 0));
+  bstr_delete_bitstr(bstr);
+}
+
+void test_bstr_alloc_range(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(8);
+  const unsigned int nbits = bstr_get_bit_capacity(bstr);
+  bstr_set_range(bstr, 3, 70);
+  for (unsigned int i = 0; i < nbits; i++)
+    TEST_ASSERT_EQUAL(i >= 3 && i < 73, bstr_get(bstr, i));
+  bstr_clr_range(bstr, 5, 2);
+  TEST_ASSERT_FALSE(bstr_get(bstr, 5));
+  TEST_ASSERT_FALSE(bstr_get(bstr, 6));
+  TEST_ASSERT_EQUAL_UINT(68, bstr_popcnt(bstr));
+  bstr_clr_range(bstr, 0, nbits);
+  TEST_ASSERT_TRUE(bstr_is_empty(bstr));
+
+  /* Fill the bitmap with aligned blocks, the hint is the end of the last. */
+  unsigned int hint = 0;
+  for (unsigned int block = 0; block < nbits / 16; block++) {
+    const int start = bstr_alloc_range(bstr, 10, 16, hint);
+    TEST_ASSERT_EQUAL_INT(block * 16, start);
+    hint = (unsigned int)start + 10;
+  }
+  TEST_ASSERT_EQUAL_INT(-1, bstr_alloc_range(bstr, 10, 16, hint));
+  TEST_ASSERT_EQUAL_UINT(nbits / 16 * 10, bstr_popcnt(bstr));
+  /* Unaligned requests fill the gaps, wrapping around from the hint. */
+  TEST_ASSERT_EQUAL_INT(10, bstr_alloc_range(bstr, 6, 0, nbits - 1));
+  bstr_free_range(bstr, 32, 10);
+  TEST_ASSERT_EQUAL_INT(26, bstr_alloc_range(bstr, 22, 0, 20));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_alloc_range(bstr, 7, 0, 0));
+  bstr_delete_bitstr(bstr);
+}
+
+void test_bstr_fields(void) {
+  static const unsigned int widths[] = {1, 3, 5, 12, 31, 32, 33, 47, 63, 64};
+  bstr_bitstr_t *bstr = bstr_create_bitstr(8);
+  bstr_bitstr_t *copy = bstr_create_bitstr(8);
+  const unsigned int nbits = bstr_get_bit_capacity(bstr);
+  srand(13);
+  for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+    const unsigned int width = widths[w];
+    for (unsigned int offset = 0; offset + width <= nbits; offset += 7) {
+      for (unsigned int i = 0; i < nbits; i++)
+        if (rand() % 2)
+          bstr_set(bstr, i);
+        else
+          bstr_clr(bstr, i);
+      uint64_t expected = 0;
+      for (unsigned int j = 0; j < width; j++)
+        expected |= (uint64_t)bstr_get(bstr, offset + j) << j;
+      TEST_ASSERT_EQUAL_UINT64(expected, bstr_get_field(bstr, offset, width));
+
+      /* Only the field changes, the bits around it are kept. */
+      const uint64_t value = ((uint64_t)rand() << 40) ^
+                             ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+      memcpy(copy->_bits, bstr->_bits, 8 * sizeof(unsigned int));
+      bstr_set_field(bstr, offset, width, value);
+      for (unsigned int i = 0; i < nbits; i++) {
+        const bool want = i >= offset && i < offset + width
+                              ? (value >> (i - offset)) & 1U
+                              : bstr_get(copy, i);
+        TEST_ASSERT_EQUAL(want, bstr_get(bstr, i));
+      }
+      const uint64_t mask =
+          width < 64 ? (UINT64_C(1) << width) - 1 : ~UINT64_C(0);
+      TEST_ASSERT_EQUAL_UINT64(value & mask,
+                               bstr_get_field(bstr, offset, width));
+    }
+  }
+  bstr_delete_bitstr(bstr);
+  bstr_delete_bitstr(copy);
+}
+
+void test_bstr_positional_popcnt(void) {
+  /* 300 rows, more than one batch, row r has every bit i with i % (r + 1) ==
+   * 0 set plus a random word. */
+  enum { rows = 300, words = 13 };
+  bstr_bitstr_t *bstrs[rows];
+  static uint32_t expected[words * 32];
+  static uint32_t counts[words * 32];
+  memset(expected, 0, sizeof(expected));
+  srand(17);
+  for (unsigned int r = 0; r < rows; r++) {
+    bstrs[r] = bstr_create_bitstr(words);
+    for (unsigned int i = 0; i < words * 32; i += r + 1)
+      bstr_set(bstrs[r], i);
+    bstrs[r]->_bits[r % words] ^= ((unsigned int)rand() << 16) ^ rand();
+    for (unsigned int i = 0; i < words * 32; i++)
+      expected[i] += bstr_get(bstrs[r], i);
+  }
+  bstr_positional_popcnt((const bstr_bitstr_t *const *)bstrs, rows, counts);
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, counts, words * 32);
+
+  /* Streaming in uneven batches gives the same counts. */
+  memset(counts, 0, sizeof(counts));
+  for (unsigned int r = 0, batch = 1; r < rows; r += batch, batch += 7) {
+    const unsigned int n = rows - r < batch ? rows - r : batch;
+    bstr_positional_popcnt_add((const bstr_bitstr_t *const *)&bstrs[r], n,
+                               counts);
+  }
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, counts, words * 32);
+  bstr_positional_popcnt_add(NULL, 0, counts);
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, counts, words * 32);
+  for (unsigned int r = 0; r < rows; r++)
+    bstr_delete_bitstr(bstrs[r]);
+}
+
+static void test_bstr_diff_check(bstr_bitstr_t *from,
+                                 const bstr_bitstr_t *to) {
+  unsigned int nwords = 0;
+  unsigned int *patch = bstr_diff(from, to, &nwords);
+  TEST_ASSERT_NOT_NULL(patch);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_apply(from, patch, nwords));
+  TEST_ASSERT_TRUE(bstr_equals(from, to));
+  free(patch);
+}
+
+void test_bstr_diff(void) {
+  bstr_bitstr_t *from = bstr_create_bitstr(1000);
+  bstr_bitstr_t *to = bstr_create_bitstr(1000);
+  unsigned int nwords = 0;
+  srand(5);
+  for (unsigned int i = 0; i < 3000; i++)
+    bstr_set(from, (unsigned int)rand() % bstr_get_bit_capacity(from));
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(to, 1000));
+  for (unsigned int i = 0; i < bstr_get_bit_capacity(from); i++)
+    if (bstr_get(from, i))
+      bstr_set(to, i);
+
+  unsigned int *patch = bstr_diff(from, to, &nwords);
+  TEST_ASSERT_EQUAL_UINT(2, nwords);
+  free(patch);
+  /* Word 0 and the field in words 2 and 3 share a run across word 1, word
+   * 937 gets its own. */
+  bstr_set(to, 30000);
+  bstr_set(to, 0);
+  bstr_clr(from, 0);
+  bstr_set_field(to, 64, 40, ~UINT64_C(0));
+  bstr_set_field(from, 64, 40, 0);
+  patch = bstr_diff(from, to, &nwords);
+  TEST_ASSERT_EQUAL_UINT(2 + (2 + 4) + (2 + 1), nwords);
+  TEST_ASSERT_EQUAL_INT(BSTR_BAD_FORMAT, bstr_apply(from, patch, nwords - 1));
+  free(patch);
+  test_bstr_diff_check(from, to);
+
+  for (unsigned int i = 0; i < 500; i++)
+    bstr_set(to, (unsigned int)rand() % bstr_get_bit_capacity(to));
+  test_bstr_diff_check(from, to);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(to, 1100));
+  bstr_set(to, 1050 * 32 + 3);
+  test_bstr_diff_check(from, to);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(to, 30));
+  test_bstr_diff_check(from, to);
+
+  patch = bstr_diff(from, to, &nwords);
+  patch[0] = 31;
+  TEST_ASSERT_EQUAL_INT(BSTR_BAD_FORMAT, bstr_apply(from, patch, nwords));
+  free(patch);
+  bstr_delete_bitstr(to);
+  bstr_delete_bitstr(from);
+}
+
+void test_bstr_many(void) {
+  /* 600 words span three tiles, 37 inputs two full groups of 16. Input r has
+   * a bit set with probability 1/2 and the first tile all set in input 5 or
+   * all clear in input 6, which ends the tile early. */
+  enum { rows = 37, words = 600 };
+  bstr_bitstr_t *bstrs[rows];
+  bstr_bitstr_t *dst = bstr_create_bitstr(words);
+  static unsigned int counts[words * 32];
+  memset(counts, 0, sizeof(counts));
+  srand(19);
+  for (unsigned int r = 0; r < rows; r++) {
+    bstrs[r] = bstr_create_bitstr(words);
+    for (unsigned int w = 0; w < words; w++)
+      bstrs[r]->_bits[w] = ((unsigned int)rand() << 16) ^ (unsigned int)rand();
+    for (unsigned int w = 0; w < 256 && (r == 5 || r == 6); w++)
+      bstrs[r]->_bits[w] = r == 5 ? ~0U : 0U;
+    for (unsigned int i = 0; i < words * 32; i++)
+      counts[i] += bstr_get(bstrs[r], i);
+  }
+  const bstr_bitstr_t *const *srcs = (const bstr_bitstr_t *const *)bstrs;
+  static const unsigned int ks[] = {0, 1, 2, 3, 15, 18, 19, 33, 36, 37, 38};
+  for (size_t j = 0; j < sizeof(ks) / sizeof(ks[0]); j++) {
+    bstr_threshold_many(dst, srcs, rows, ks[j]);
+    for (unsigned int i = 0; i < words * 32; i++)
+      TEST_ASSERT_EQUAL(counts[i] >= ks[j], bstr_get(dst, i));
+  }
+  /* A full group of 16 and one input in the second group. */
+  bstr_threshold_many(dst, srcs, 17, 16);
+  for (unsigned int i = 0; i < words * 32; i++) {
+    unsigned int count = 0;
+    for (unsigned int r = 0; r < 17; r++)
+      count += bstr_get(bstrs[r], i);
+    TEST_ASSERT_EQUAL(count >= 16, bstr_get(dst, i));
+  }
+
+  bstr_union_many(dst, srcs, rows);
+  for (unsigned int i = 0; i < words * 32; i++)
+    TEST_ASSERT_EQUAL(counts[i] > 0, bstr_get(dst, i));
+  bstr_intersect_many(dst, srcs, rows);
+  for (unsigned int i = 0; i < words * 32; i++)
+    TEST_ASSERT_EQUAL(counts[i] == rows, bstr_get(dst, i));
+  bstr_union_many(dst, NULL, 0);
+  TEST_ASSERT_TRUE(bstr_is_empty(dst));
+  bstr_intersect_many(dst, NULL, 0);
+  TEST_ASSERT_EQUAL_INT(words * 32, bstr_popcnt(dst));
+
+  /* dst may be an input. */
+  bstr_set_all(dst, false);
+  bstr_set(dst, 4000);
+  bstr_delete_bitstr(bstrs[0]);
+  bstrs[0] = dst;
+  bstr_intersect_many(dst, srcs, 2);
+  TEST_ASSERT_EQUAL_INT(bstr_get(bstrs[1], 4000), bstr_popcnt(dst));
+  for (unsigned int r = 1; r < rows; r++)
+    bstr_delete_bitstr(bstrs[r]);
+  bstr_delete_bitstr(dst);
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_bstr_create_and_delete_bitstr);
   RUN_TEST(test_bstr_resize);
   RUN_TEST(test_bstr_resize_with_same_size);
   RUN_TEST(test_bstr_resize_with_smaller_size);
+  RUN_TEST(test_bstr_resize_huge);
   RUN_TEST(test_bstr_get_capacity);
   RUN_TEST(test_bstr_get_bit_capacity);
   RUN_TEST(test_bstr_to_string_size);
+  RUN_TEST(test_bstr_to_string);
   RUN_TEST(test_bstr_set_linear);
   RUN_TEST(test_bstr_set_even);
   RUN_TEST(test_bstr_set_uneven);
@@ -332,9 +855,22 @@ int main(void) {
   RUN_TEST(test_bstr_ctz);
   RUN_TEST(test_bstr_clz);
   RUN_TEST(test_bstr_popcnt);
+  RUN_TEST(test_bstr_popcnt_range);
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  RUN_TEST(test_bstr_popcnt_cache);
+#endif
   RUN_TEST(test_bstr_ffus);
   RUN_TEST(test_bstr_next_set_bit);
   RUN_TEST(test_bstr_next_unset_bit);
+  RUN_TEST(test_bstr_predicates);
+  RUN_TEST(test_bstr_predicates_different_capacity);
+  RUN_TEST(test_bstr_find_pattern);
+  RUN_TEST(test_bstr_find_run);
+  RUN_TEST(test_bstr_alloc_range);
+  RUN_TEST(test_bstr_fields);
+  RUN_TEST(test_bstr_positional_popcnt);
+  RUN_TEST(test_bstr_many);
+  RUN_TEST(test_bstr_diff);
   UNITY_END();
 }
 
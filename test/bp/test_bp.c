@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_bp.h"
+#include "unity.h"
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_BP_COUNT 1000U
+
+static const bstr_backend_t test_backends[] = {
+    BSTR_BACKEND_SCALAR, BSTR_BACKEND_POPCNT, BSTR_BACKEND_AVX2,
+    BSTR_BACKEND_AVX512};
+
+static const unsigned int test_flags[] = {0, BSTR_BP_DELTA, BSTR_BP_FOR,
+                                          BSTR_BP_DELTA | BSTR_BP_FOR};
+
+static uint32_t test_values[TEST_BP_COUNT];
+static uint32_t test_out[TEST_BP_COUNT];
+
+static uint32_t test_random(void) {
+  return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+/*
+ * Encodes n values at offset into a bitstring of exactly the maximum size, so
+ * the last block touches the end, and checks they decode.
+ */
+static unsigned int test_round_trip(unsigned int offset, unsigned int n,
+                                    unsigned int flags) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(offset + bstr_bp_max_words(n));
+  TEST_ASSERT_NOT_NULL(bstr);
+  const unsigned int words =
+      bstr_bp_encode(bstr, offset, test_values, n, flags);
+  TEST_ASSERT_LESS_OR_EQUAL(bstr_bp_max_words(n), words);
+  TEST_ASSERT_EQUAL_UINT(words, bstr_bp_decode(bstr, offset, test_out, n));
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(test_values, test_out, n);
+  bstr_delete_bitstr(bstr);
+  return words;
+}
+
+void test_bstr_bp_round_trip(void) {
+  for (size_t b = 0; b < sizeof(test_backends) / sizeof(test_backends[0]);
+       b++) {
+    if (bstr_set_backend(test_backends[b]) != BSTR_NO_ERROR)
+      continue;
+    for (unsigned int width = 0; width <= 32; width++) {
+      srand(width);
+      for (unsigned int i = 0; i < TEST_BP_COUNT; i++)
+        test_values[i] = width > 0 ? test_random() >> (32 - width) : 0;
+      for (size_t f = 0; f < sizeof(test_flags) / sizeof(test_flags[0]); f++) {
+        test_round_trip(0, TEST_BP_COUNT, test_flags[f]);
+        test_round_trip(3, 129, test_flags[f]);
+        test_round_trip(1, 5, test_flags[f]);
+      }
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_AUTO));
+  TEST_ASSERT_EQUAL_UINT(0, test_round_trip(0, 0, 0));
+}
+
+void test_bstr_bp_exceptions(void) {
+  /* 4 bit values with a few outliers take about 4 bits each. */
+  srand(1);
+  for (unsigned int i = 0; i < TEST_BP_COUNT; i++)
+    test_values[i] = i % 50 == 7 ? test_random() | 0x80000000U
+                                 : test_random() & 0xFU;
+  const unsigned int words = test_round_trip(0, TEST_BP_COUNT, 0);
+  TEST_ASSERT_LESS_THAN(TEST_BP_COUNT * 6 / 32, words);
+  /* Every value an outlier but one. */
+  for (unsigned int i = 0; i < TEST_BP_COUNT; i++)
+    test_values[i] = i == 300 ? 1 : 0xFFFFFFFFU;
+  test_round_trip(0, TEST_BP_COUNT, 0);
+}
+
+void test_bstr_bp_delta(void) {
+  /* Sorted ids with small gaps and a large start. */
+  uint32_t id = 3000000000U;
+  srand(2);
+  for (unsigned int i = 0; i < TEST_BP_COUNT; i++) {
+    id += (uint32_t)rand() % 64U;
+    test_values[i] = id;
+  }
+  const unsigned int plain = test_round_trip(0, TEST_BP_COUNT, 0);
+  const unsigned int delta = test_round_trip(0, TEST_BP_COUNT, BSTR_BP_DELTA);
+  /* 8 blocks of 32 bit values plus a header each, 6 bit gaps with the first
+   * id as an exception. */
+  TEST_ASSERT_EQUAL_UINT(8 + TEST_BP_COUNT, plain);
+  TEST_ASSERT_LESS_OR_EQUAL(8 * 2 + TEST_BP_COUNT * 6 / 32, delta);
+  /* Clustered values far from 0. */
+  for (unsigned int i = 0; i < TEST_BP_COUNT; i++)
+    test_values[i] = 0x70000000U + (test_random() & 0xFFU);
+  TEST_ASSERT_LESS_OR_EQUAL(8 * 2 + TEST_BP_COUNT * 8 / 32,
+                            test_round_trip(0, TEST_BP_COUNT, BSTR_BP_FOR));
+  /* Decreasing input wraps. */
+  for (unsigned int i = 0; i < TEST_BP_COUNT; i++)
+    test_values[i] = TEST_BP_COUNT - i;
+  test_round_trip(0, TEST_BP_COUNT, BSTR_BP_DELTA);
+  test_round_trip(0, TEST_BP_COUNT, BSTR_BP_DELTA | BSTR_BP_FOR);
+}
+
+void test_bstr_bp_stream(void) {
+  /* Two calls back to back decode on their own. */
+  srand(3);
+  for (unsigned int i = 0; i < TEST_BP_COUNT; i++)
+    test_values[i] = test_random() & 0x3FFU;
+  bstr_bitstr_t *bstr = bstr_create_bitstr(bstr_bp_max_words(300) +
+                                           bstr_bp_max_words(700));
+  const unsigned int first = bstr_bp_encode(bstr, 0, test_values, 300, 0);
+  const unsigned int second = bstr_bp_encode(bstr, first, &test_values[300],
+                                             700, BSTR_BP_DELTA);
+  TEST_ASSERT_EQUAL_UINT(second,
+                         bstr_bp_decode(bstr, first, &test_out[300], 700));
+  TEST_ASSERT_EQUAL_UINT(first, bstr_bp_decode(bstr, 0, test_out, 300));
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(test_values, test_out, TEST_BP_COUNT);
+  bstr_delete_bitstr(bstr);
+}
+
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+/* Encoding goes past bstr_set(), the cache has to see it anyway. */
+void test_bstr_bp_popcnt_cache(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(bstr_bp_max_words(10) + 100U);
+  TEST_ASSERT_NOT_NULL(bstr);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_popcnt_cache_enable(bstr));
+  TEST_ASSERT_EQUAL_INT(0, bstr_popcnt(bstr));
+  for (unsigned int i = 0; i < 10; i++)
+    test_values[i] = test_random();
+  const unsigned int words = bstr_bp_encode(bstr, 50, test_values, 10, 0);
+  const int cached = bstr_popcnt(bstr);
+  const int cached_range = bstr_popcnt_range(bstr, 50U * BSTR_BITS_PER_INT,
+                                             words * BSTR_BITS_PER_INT);
+  bstr_popcnt_cache_disable(bstr);
+  TEST_ASSERT_NOT_EQUAL(0, bstr_popcnt(bstr));
+  TEST_ASSERT_EQUAL_INT(bstr_popcnt(bstr), cached);
+  TEST_ASSERT_EQUAL_INT(cached, cached_range);
+  bstr_delete_bitstr(bstr);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_bp_round_trip);
+  RUN_TEST(test_bstr_bp_exceptions);
+  RUN_TEST(test_bstr_bp_delta);
+  RUN_TEST(test_bstr_bp_stream);
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  RUN_TEST(test_bstr_bp_popcnt_cache);
+#endif
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
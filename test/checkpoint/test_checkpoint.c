@@ -0,0 +1,193 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_bp.h"
+#include "bitstring_checkpoint.h"
+#include "unity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_CHECKPOINT_CAPACITY (BSTR_DIRTY_CHUNK_WORDS * 5U + 7U)
+
+static long test_checkpoint_size(FILE *file) {
+  fseek(file, 0, SEEK_END);
+  return ftell(file);
+}
+
+void test_bstr_checkpoint_round_trip(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(TEST_CHECKPOINT_CAPACITY);
+  bstr_bitstr_t *copy = bstr_create_bitstr(1);
+  FILE *file = tmpfile();
+  TEST_ASSERT_NOT_NULL(bstr);
+  TEST_ASSERT_NOT_NULL(copy);
+  TEST_ASSERT_NOT_NULL(file);
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_dirty_enable(bstr));
+#endif
+  srand(3);
+  for (unsigned int i = 0; i < 1000; i++)
+    bstr_set(bstr, (unsigned int)rand() % bstr_get_bit_capacity(bstr));
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_write(bstr, file));
+  const long full = test_checkpoint_size(file);
+
+  bstr_set(bstr, 5);
+  bstr_clr_range(bstr, 3U * BSTR_DIRTY_CHUNK_BITS - 10U, 20U);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_write(bstr, file));
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  /* Chunks 0, 2 and 3. */
+  TEST_ASSERT_EQUAL_INT(full + 5 * 4 + 3 * (4 + BSTR_DIRTY_CHUNK_WORDS *
+                                                    sizeof(unsigned int)),
+                        test_checkpoint_size(file));
+#else
+  TEST_ASSERT_EQUAL_INT(2 * full, test_checkpoint_size(file));
+#endif
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_resize(bstr, 9));
+  bstr_set(bstr, 100);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_write(bstr, file));
+
+  rewind(file);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_replay(copy, file));
+  TEST_ASSERT_EQUAL_UINT(9, bstr_get_capacity(copy));
+  TEST_ASSERT_TRUE(bstr_equals(bstr, copy));
+  fclose(file);
+  bstr_delete_bitstr(copy);
+  bstr_delete_bitstr(bstr);
+}
+
+/* Blocks encoded after a checkpoint are in the next one. */
+void test_bstr_checkpoint_bp(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(TEST_CHECKPOINT_CAPACITY);
+  bstr_bitstr_t *copy = bstr_create_bitstr(1);
+  FILE *file = tmpfile();
+  TEST_ASSERT_NOT_NULL(bstr);
+  TEST_ASSERT_NOT_NULL(copy);
+  TEST_ASSERT_NOT_NULL(file);
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_dirty_enable(bstr));
+#endif
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_write(bstr, file));
+  uint32_t values[10];
+  for (unsigned int i = 0; i < 10; i++)
+    values[i] = i * 1000003U;
+  const unsigned int offset = 4U * BSTR_DIRTY_CHUNK_WORDS + 5U;
+  bstr_bp_encode(bstr, offset, values, 10, 0);
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  TEST_ASSERT_EQUAL_INT(4, bstr_dirty_next(bstr, 0));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_dirty_next(bstr, 5));
+#endif
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_write(bstr, file));
+  rewind(file);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_replay(copy, file));
+  TEST_ASSERT_TRUE(bstr_equals(bstr, copy));
+  uint32_t out[10];
+  bstr_bp_decode(copy, offset, out, 10);
+  for (unsigned int i = 0; i < 10; i++)
+    TEST_ASSERT_EQUAL_UINT32(values[i], out[i]);
+  fclose(file);
+  bstr_delete_bitstr(copy);
+  bstr_delete_bitstr(bstr);
+}
+
+void test_bstr_checkpoint_broken(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(TEST_CHECKPOINT_CAPACITY);
+  FILE *file = tmpfile();
+  TEST_ASSERT_NOT_NULL(file);
+  bstr_set(bstr, 1);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_checkpoint_write(bstr, file));
+  const long size = test_checkpoint_size(file);
+  FILE *cut = tmpfile();
+  TEST_ASSERT_NOT_NULL(cut);
+  rewind(file);
+  for (long i = 0; i < size - 1; i++)
+    fputc(fgetc(file), cut);
+  rewind(cut);
+  TEST_ASSERT_EQUAL_INT(BSTR_BAD_FORMAT, bstr_checkpoint_replay(bstr, cut));
+  fclose(cut);
+
+  rewind(file);
+  fputc(0, file);
+  rewind(file);
+  TEST_ASSERT_EQUAL_INT(BSTR_BAD_FORMAT, bstr_checkpoint_replay(bstr, file));
+  fclose(file);
+  bstr_delete_bitstr(bstr);
+}
+
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+void test_bstr_dirty(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(TEST_CHECKPOINT_CAPACITY);
+  const unsigned int words[3] = {1, 2, 3};
+  TEST_ASSERT_FALSE(bstr_dirty_enabled(bstr));
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_dirty_enable(bstr));
+  TEST_ASSERT_TRUE(bstr_dirty_enabled(bstr));
+  TEST_ASSERT_EQUAL_UINT(6, bstr_dirty_chunks(bstr));
+  TEST_ASSERT_EQUAL_INT(0, bstr_dirty_next(bstr, 0));
+  TEST_ASSERT_EQUAL_INT(5, bstr_dirty_next(bstr, 5));
+  bstr_dirty_clr(bstr, 1);
+  TEST_ASSERT_EQUAL_INT(2, bstr_dirty_next(bstr, 1));
+  bstr_dirty_clr_all(bstr);
+  TEST_ASSERT_EQUAL_INT(-1, bstr_dirty_next(bstr, 0));
+
+  bstr_set_field(bstr, BSTR_DIRTY_CHUNK_BITS - 4U, 8, 0xFF);
+  TEST_ASSERT_EQUAL_INT(0, bstr_dirty_next(bstr, 0));
+  TEST_ASSERT_EQUAL_INT(1, bstr_dirty_next(bstr, 1));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_dirty_next(bstr, 2));
+  bstr_dirty_clr_all(bstr);
+  bstr_set_words(bstr, 4U * BSTR_DIRTY_CHUNK_WORDS, words, 3);
+  TEST_ASSERT_EQUAL_INT(4, bstr_dirty_next(bstr, 0));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_dirty_next(bstr, 5));
+  bstr_dirty_clr_all(bstr);
+  bstr_set_all(bstr, false);
+  for (unsigned int c = 0; c < bstr_dirty_chunks(bstr); c++)
+    TEST_ASSERT_EQUAL_INT((int)c, bstr_dirty_next(bstr, c));
+
+  bstr_dirty_clr_all(bstr);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR,
+                        bstr_resize(bstr, BSTR_DIRTY_CHUNK_WORDS + 1U));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_dirty_next(bstr, 0));
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR,
+                        bstr_resize(bstr, BSTR_DIRTY_CHUNK_WORDS * 3U));
+  TEST_ASSERT_EQUAL_INT(1, bstr_dirty_next(bstr, 0));
+  TEST_ASSERT_EQUAL_INT(2, bstr_dirty_next(bstr, 2));
+  bstr_dirty_disable(bstr);
+  TEST_ASSERT_FALSE(bstr_dirty_enabled(bstr));
+  bstr_delete_bitstr(bstr);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_checkpoint_round_trip);
+  RUN_TEST(test_bstr_checkpoint_bp);
+  RUN_TEST(test_bstr_checkpoint_broken);
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  RUN_TEST(test_bstr_dirty);
+#endif
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
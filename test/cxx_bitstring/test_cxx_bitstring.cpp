@@ -0,0 +1,314 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring.hpp"
+#include "bitstring_checkpoint.h"
+#include "bitstring_static.h"
+#include "unity.h"
+
+BSTR_STATIC_DECLARE_ALL(4);
+
+constexpr bstr::static_bitstring<2> make_constexpr_bits() {
+  bstr::static_bitstring<2> bits{};
+  bits.set(3);
+  bits.set(40);
+  bits.set(63);
+  bits.clr(63);
+  return bits;
+}
+
+// Everything on static_bitstring is usable in constant expressions.
+static_assert(make_constexpr_bits().get(40));
+static_assert(!make_constexpr_bits().get(63));
+static_assert(make_constexpr_bits().popcnt() == 2);
+static_assert(make_constexpr_bits().ffs() == 3);
+static_assert(make_constexpr_bits().ffus() == 0);
+static_assert(make_constexpr_bits().clz() == 64 - 41);
+static_assert(make_constexpr_bits().next_set_bit(4) == 40);
+static_assert(bstr::static_bitstring<2>::bit_capacity() ==
+              2 * sizeof(unsigned int) * CHAR_BIT);
+static_assert(sizeof(bstr::static_bitstring<4>) == sizeof(bstr_static_t(4)));
+
+#define TEST_CXX_WORDS 64
+
+void test_cxx_static_set_get_clr(void) {
+  bstr::static_bitstring<TEST_CXX_WORDS> test{};
+  for (unsigned int i = 0; i != test.bit_capacity(); i++) {
+    test.set(i);
+    TEST_ASSERT_TRUE(test.get(i));
+    TEST_ASSERT_EQUAL_INT(i + 1, test.popcnt());
+  }
+  for (unsigned int i = 0; i != test.bit_capacity(); i++) {
+    test.clr(i);
+    TEST_ASSERT_FALSE(test.get(i));
+  }
+  TEST_ASSERT_EQUAL_INT(0, test.popcnt());
+}
+
+void test_cxx_static_scans(void) {
+  bstr::static_bitstring<TEST_CXX_WORDS> test{};
+  TEST_ASSERT_EQUAL_INT(-1, test.ffs());
+  TEST_ASSERT_EQUAL_INT(test.bit_capacity(), test.ctz());
+  TEST_ASSERT_EQUAL_INT(test.bit_capacity(), test.clz());
+  for (unsigned int i = 0; i != test.bit_capacity(); i++) {
+    test.set(i);
+    TEST_ASSERT_EQUAL_INT(i, test.ffs());
+    TEST_ASSERT_EQUAL_INT(i, test.ctz());
+    TEST_ASSERT_EQUAL_INT(test.bit_capacity() - i - 1, test.clz());
+    test.clr(i);
+  }
+  test.set_all(true);
+  TEST_ASSERT_EQUAL_INT(test.bit_capacity(), test.popcnt());
+  TEST_ASSERT_EQUAL_INT(-1, test.ffus());
+  for (int i = test.bit_capacity() - 1; i >= 0; i--) {
+    test.clr(i);
+    TEST_ASSERT_EQUAL_INT(i, test.ffus());
+    TEST_ASSERT_EQUAL_INT(i, test.next_unset_bit(0));
+    test.set(i);
+  }
+}
+
+void test_cxx_static_iterate(void) {
+  bstr::static_bitstring<TEST_CXX_WORDS> test{};
+  for (unsigned int i = 0; i < test.bit_capacity(); i += 3)
+    test.set(i);
+  unsigned int expected = 0;
+  int visited = 0;
+  for (unsigned int bit : test) {
+    TEST_ASSERT_EQUAL_INT(expected, bit);
+    expected += 3;
+    visited++;
+  }
+  TEST_ASSERT_EQUAL_INT(test.popcnt(), visited);
+
+  bstr::static_bitstring<TEST_CXX_WORDS> empty{};
+  TEST_ASSERT_TRUE(empty.begin() == empty.end());
+}
+
+void test_cxx_static_operators(void) {
+  bstr::static_bitstring<2> a{};
+  bstr::static_bitstring<2> b{};
+  a.set(1);
+  a.set(2);
+  b.set(2);
+  b.set(33);
+  TEST_ASSERT_EQUAL_INT(1, (a & b).popcnt());
+  TEST_ASSERT_EQUAL_INT(3, (a | b).popcnt());
+  TEST_ASSERT_EQUAL_INT(2, (a ^ b).popcnt());
+  TEST_ASSERT_EQUAL_INT(62, (~a).popcnt());
+  TEST_ASSERT_TRUE(a != b);
+  b = a;
+  TEST_ASSERT_TRUE(a == b);
+}
+
+void test_cxx_static_c_interop(void) {
+  bstr::static_bitstring<TEST_CXX_WORDS> test{};
+  test.set(5);
+  test.set(1000);
+  bstr_bitstr_t view = test.c_bitstr();
+  TEST_ASSERT_EQUAL_INT(TEST_CXX_WORDS, bstr_get_capacity(&view));
+  TEST_ASSERT_EQUAL_INT(2, bstr_popcnt(&view));
+  bstr_set(&view, 7);
+  TEST_ASSERT_TRUE(test.get(7));
+
+  bstr_static_t(4) c = bstrs_initialize;
+  bstrs_set(4, &c, 100);
+  bstr::static_bitstring<4> &wrapped = bstr::static_bitstring<4>::from_c(c);
+  TEST_ASSERT_TRUE(wrapped.get(100));
+  wrapped.set(101);
+  TEST_ASSERT_TRUE(bstrs_get(4, &c, 101));
+}
+
+void test_cxx_bitstring(void) {
+  bstr::bitstring test(TEST_CXX_WORDS);
+  TEST_ASSERT_EQUAL_INT(TEST_CXX_WORDS, test.capacity());
+  TEST_ASSERT_EQUAL_INT(0, test.popcnt());
+  for (unsigned int i = 0; i < test.bit_capacity(); i += 2)
+    test.set(i);
+  TEST_ASSERT_EQUAL_INT(test.bit_capacity() / 2, test.popcnt());
+  TEST_ASSERT_EQUAL_INT(1, test.ffus());
+  test.clr(0);
+  TEST_ASSERT_EQUAL_INT(2, test.ffs());
+  TEST_ASSERT_EQUAL_INT(4, test.next_set_bit(3));
+
+  unsigned int expected = 2;
+  for (unsigned int bit : test) {
+    TEST_ASSERT_EQUAL_INT(expected, bit);
+    expected += 2;
+  }
+  TEST_ASSERT_EQUAL_INT(test.bit_capacity(), expected);
+
+  bstr::bitstring copy(test);
+  TEST_ASSERT_EQUAL_INT(test.popcnt(), copy.popcnt());
+  copy.set_all(false);
+  TEST_ASSERT_EQUAL_INT(0, copy.popcnt());
+  TEST_ASSERT_NOT_EQUAL(0, test.popcnt());
+
+  bstr::bitstring moved(std::move(copy));
+  moved.resize(TEST_CXX_WORDS * 2);
+  TEST_ASSERT_EQUAL_INT(TEST_CXX_WORDS * 2, moved.capacity());
+
+  bstr_bitstr_t *raw = moved.release();
+  bstr::bitstring adopted = bstr::bitstring::adopt(raw);
+  TEST_ASSERT_EQUAL_PTR(raw, adopted.native());
+}
+
+static void fill_pattern(bstr::bitstring &b, unsigned int step) {
+  for (unsigned int i = 0; i < b.bit_capacity(); i += step)
+    b.set(i);
+}
+
+void test_cxx_expr_assign(void) {
+  // More than one expr::block_words to cover the blocked sinks.
+  const unsigned int words = 300;
+  bstr::bitstring a(words), b(words), c(words), d(words);
+  fill_pattern(a, 2);
+  fill_pattern(b, 3);
+  fill_pattern(c, 5);
+  fill_pattern(d, 7);
+
+  bstr::bitstring result = (a & b) | (c & ~d);
+  TEST_ASSERT_EQUAL_INT(words, result.capacity());
+  int expected = 0;
+  for (unsigned int i = 0; i < result.bit_capacity(); i++) {
+    bool bit = (a.get(i) && b.get(i)) || (c.get(i) && !d.get(i));
+    TEST_ASSERT_EQUAL_INT(bit, result.get(i));
+    expected += bit;
+  }
+  TEST_ASSERT_EQUAL_INT(expected, result.popcnt());
+  TEST_ASSERT_EQUAL_INT(expected, bstr::popcount((a & b) | (c & ~d)));
+
+  // Assigning into an operand is fine, every word is read before it is
+  // written.
+  a = a ^ b;
+  for (unsigned int i = 0; i < a.bit_capacity(); i++)
+    TEST_ASSERT_EQUAL_INT((i % 2 == 0) != (i % 3 == 0), a.get(i));
+
+  bstr::bitstring small(1);
+  small = b & c;
+  TEST_ASSERT_EQUAL_INT(words, small.capacity());
+  TEST_ASSERT_EQUAL_INT(bstr::popcount(b & c), small.popcnt());
+
+  bstr_bitstr_t *raw = bstr_create_bitstr(words);
+  bstr::assign(raw, bstr::ref(b.native()) | c);
+  TEST_ASSERT_EQUAL_INT(bstr::popcount(b | c), bstr_popcnt(raw));
+  bstr_delete_bitstr(raw);
+}
+
+void test_cxx_expr_sinks(void) {
+  const unsigned int words = 300;
+  bstr::bitstring a(words), b(words);
+  TEST_ASSERT_FALSE(bstr::any(a | b));
+  TEST_ASSERT_TRUE(bstr::any(~a));
+  a.set(words * bstr::bits_per_int - 1);
+  b.set(words * bstr::bits_per_int - 1);
+  b.set(17);
+  TEST_ASSERT_TRUE(bstr::any(a & b));
+  TEST_ASSERT_EQUAL_INT(1, bstr::popcount(a ^ b));
+
+  unsigned int seen[4] = {0};
+  int count = 0;
+  bstr::for_each_set(a | b, [&](unsigned int bit) { seen[count++] = bit; });
+  TEST_ASSERT_EQUAL_INT(2, count);
+  TEST_ASSERT_EQUAL_INT(17, seen[0]);
+  TEST_ASSERT_EQUAL_INT(words * bstr::bits_per_int - 1, seen[1]);
+}
+
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+void test_cxx_popcnt_cache(void) {
+  bstr::bitstring b(4), c(4);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_popcnt_cache_enable(b.native()));
+  b.set(3);
+  b.set(70);
+  TEST_ASSERT_EQUAL_INT(2, b.popcnt());
+  b.clr(3);
+  b.set(3);
+  TEST_ASSERT_EQUAL_INT(2, b.popcnt());
+  c.set(100);
+  b = b | c;
+  TEST_ASSERT_EQUAL_INT(3, b.popcnt());
+  bstr::assign(b.native(), b ^ c);
+  TEST_ASSERT_EQUAL_INT(2, b.popcnt());
+  TEST_ASSERT_EQUAL_INT(2, bstr_popcnt_range(b.native(), 0, 128));
+  bstr_popcnt_cache_disable(b.native());
+  TEST_ASSERT_EQUAL_INT(2, b.popcnt());
+}
+#endif
+
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+/* Appends a checkpoint of b and checks that replaying the file from the
+ * start restores it. */
+static void checkpoint_roundtrip(bstr::bitstring &b, FILE *file) {
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR,
+                        bstr_checkpoint_write(b.native(), file));
+  bstr::bitstring copy(1);
+  rewind(file);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR,
+                        bstr_checkpoint_replay(copy.native(), file));
+  TEST_ASSERT_TRUE(bstr_equals(b.native(), copy.native()));
+  fseek(file, 0, SEEK_END);
+}
+
+void test_cxx_checkpoint(void) {
+  const unsigned int words = 8 * BSTR_DIRTY_CHUNK_WORDS;
+  bstr::bitstring b(words), c(words);
+  FILE *file = tmpfile();
+  TEST_ASSERT_NOT_NULL(file);
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_dirty_enable(b.native()));
+  checkpoint_roundtrip(b, file);
+  b.set(3);
+  TEST_ASSERT_EQUAL_INT(0, bstr_dirty_next(b.native(), 0));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_dirty_next(b.native(), 1));
+  checkpoint_roundtrip(b, file);
+  c.set(5 * BSTR_DIRTY_CHUNK_BITS + 1);
+  b = b | c;
+  TEST_ASSERT_EQUAL_INT(5, bstr_dirty_next(b.native(), 5));
+  checkpoint_roundtrip(b, file);
+  b.clr(3);
+  checkpoint_roundtrip(b, file);
+  bstr::assign(b.native(), b ^ c);
+  TEST_ASSERT_EQUAL_INT(0, b.popcnt());
+  checkpoint_roundtrip(b, file);
+  fclose(file);
+}
+#endif
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cxx_static_set_get_clr);
+  RUN_TEST(test_cxx_static_scans);
+  RUN_TEST(test_cxx_static_iterate);
+  RUN_TEST(test_cxx_static_operators);
+  RUN_TEST(test_cxx_static_c_interop);
+  RUN_TEST(test_cxx_bitstring);
+  RUN_TEST(test_cxx_expr_assign);
+  RUN_TEST(test_cxx_expr_sinks);
+#ifdef CONFIG_BITSTRING_POPCNT_CACHE
+  RUN_TEST(test_cxx_popcnt_cache);
+#endif
+#ifdef CONFIG_BITSTRING_DIRTY_TRACKING
+  RUN_TEST(test_cxx_checkpoint);
+#endif
+  UNITY_END();
+}
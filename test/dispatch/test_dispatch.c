@@ -0,0 +1,343 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring.h"
+#include "bitstring_dispatch.h"
+#include "stdlib.h"
+#include "unity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_DISPATCH_MAX_WORDS 300
+#define TEST_DISPATCH_MAX_OFFSET 17
+
+static const bstr_backend_t test_backends[] = {
+    BSTR_BACKEND_SCALAR, BSTR_BACKEND_POPCNT, BSTR_BACKEND_AVX2,
+    BSTR_BACKEND_AVX512};
+
+static unsigned int test_words[TEST_DISPATCH_MAX_OFFSET +
+                               TEST_DISPATCH_MAX_WORDS];
+static unsigned int test_other[TEST_DISPATCH_MAX_WORDS];
+static uint32_t test_fields[TEST_DISPATCH_MAX_WORDS * 32];
+
+static uint64_t test_ref_popcnt(const unsigned int *words, size_t nwords) {
+  uint64_t popcnt = 0;
+  for (size_t i = 0; i < nwords; i++)
+    for (unsigned int bit = 0; bit < BSTR_BITS_PER_INT; bit++)
+      popcnt += (words[i] >> bit) & 1U;
+  return popcnt;
+}
+
+static size_t test_ref_find(const unsigned int *words, size_t nwords,
+                            unsigned int invert) {
+  size_t i = 0;
+  while (i < nwords && (words[i] ^ invert) == 0)
+    i++;
+  return i;
+}
+
+static size_t test_ref_rfind(const unsigned int *words, size_t nwords) {
+  size_t i = nwords;
+  while (i > 0 && words[i - 1] == 0)
+    i--;
+  return i;
+}
+
+static size_t test_ref_find_pair(const unsigned int *a, const unsigned int *b,
+                                 size_t nwords, bstr_pair_op_t op) {
+  size_t i = 0;
+  for (; i < nwords; i++) {
+    const unsigned int word = op == BSTR_PAIR_AND      ? a[i] & b[i]
+                              : op == BSTR_PAIR_ANDNOT ? a[i] & ~b[i]
+                                                       : a[i] ^ b[i];
+    if (word != 0)
+      break;
+  }
+  return i;
+}
+
+static size_t test_ref_find_prefix16(const unsigned int *words,
+                                     size_t nwords, unsigned int prefix) {
+  for (size_t i = 0; i < nwords; i++) {
+    const uint64_t window = words[i] | ((uint64_t)words[i + 1] << 32);
+    for (unsigned int s = 0; s < 32; s++)
+      if (((window >> s) & 0xFFFFU) == prefix)
+        return i;
+  }
+  return nwords;
+}
+
+/* Fill with random words, then clear or set runs so the scans have to skip
+ * over whole vectors. */
+static uint32_t test_ref_field(const unsigned int *words, unsigned int width,
+                               size_t index) {
+  uint32_t value = 0;
+  for (unsigned int j = 0; j < width; j++) {
+    const size_t bit = index * width + j;
+    value |= (uint32_t)((words[bit / 32] >> (bit % 32)) & 1U) << j;
+  }
+  return value;
+}
+
+static void test_fill(unsigned int *words, size_t nwords, unsigned int seed) {
+  srand(seed);
+  for (size_t i = 0; i < nwords; i++)
+    words[i] = ((unsigned int)rand() << 16) ^ (unsigned int)rand();
+  if (nwords == 0)
+    return;
+  const unsigned int fill = (seed & 1) ? ~0U : 0U;
+  const size_t from = (size_t)rand() % nwords;
+  const size_t to = from + (size_t)rand() % (nwords - from + 1);
+  for (size_t i = from; i < to; i++)
+    words[i] = fill;
+}
+
+static void test_against_reference(void) {
+  for (size_t nwords = 0; nwords < TEST_DISPATCH_MAX_WORDS; nwords++) {
+    const size_t offset = nwords % TEST_DISPATCH_MAX_OFFSET;
+    unsigned int *words = &test_words[offset];
+    test_fill(words, nwords, (unsigned int)nwords);
+    TEST_ASSERT_EQUAL_UINT64(test_ref_popcnt(words, nwords),
+                             bstr_dispatch_popcnt(words, nwords));
+    TEST_ASSERT_EQUAL_size_t(test_ref_find(words, nwords, 0U),
+                             bstr_dispatch_find(words, nwords, 0U));
+    TEST_ASSERT_EQUAL_size_t(test_ref_find(words, nwords, ~0U),
+                             bstr_dispatch_find(words, nwords, ~0U));
+    TEST_ASSERT_EQUAL_size_t(test_ref_rfind(words, nwords),
+                             bstr_dispatch_rfind(words, nwords));
+
+    /* b is a copy of a with one word changed, a superset and a complement */
+    memcpy(test_other, words, nwords * sizeof(unsigned int));
+    if (nwords > 0)
+      test_other[nwords / 2 + nwords / 4] ^= 1U << (nwords % 32);
+    for (int op = BSTR_PAIR_AND; op <= BSTR_PAIR_XOR; op++)
+      TEST_ASSERT_EQUAL_size_t(
+          test_ref_find_pair(words, test_other, nwords, (bstr_pair_op_t)op),
+          bstr_dispatch_find_pair(words, test_other, nwords,
+                                  (bstr_pair_op_t)op));
+    for (size_t i = 0; i < nwords; i++)
+      test_other[i] = ~words[i];
+    TEST_ASSERT_EQUAL_size_t(
+        nwords, bstr_dispatch_find_pair(words, test_other, nwords,
+                                        BSTR_PAIR_AND));
+    if (nwords > 0)
+      test_other[nwords - 1] |= 1U;
+    for (int op = BSTR_PAIR_AND; op <= BSTR_PAIR_XOR; op++)
+      TEST_ASSERT_EQUAL_size_t(
+          test_ref_find_pair(words, test_other, nwords, (bstr_pair_op_t)op),
+          bstr_dispatch_find_pair(words, test_other, nwords,
+                                  (bstr_pair_op_t)op));
+
+    if (nwords > 0) {
+      /* Plant the prefix at a random bit, a random prefix rarely matches. */
+      const unsigned int prefix = (unsigned int)rand() & 0xFFFFU;
+      const unsigned int at = (unsigned int)(rand() % (int)(nwords * 32));
+      TEST_ASSERT_EQUAL_size_t(
+          test_ref_find_prefix16(words, nwords - 1, prefix),
+          bstr_dispatch_find_prefix16(words, nwords - 1, prefix));
+      for (unsigned int j = 0; j < 16 && at + j < nwords * 32; j++) {
+        const unsigned int bit = 1U << ((at + j) % 32);
+        if ((prefix >> j) & 1U)
+          words[(at + j) / 32] |= bit;
+        else
+          words[(at + j) / 32] &= ~bit;
+      }
+      TEST_ASSERT_EQUAL_size_t(
+          test_ref_find_prefix16(words, nwords - 1, prefix),
+          bstr_dispatch_find_prefix16(words, nwords - 1, prefix));
+    }
+
+    if (nwords > 1) {
+      /* The last word is the one after the last field. */
+      const unsigned int width = (unsigned int)nwords % 32 + 1U;
+      const size_t first = nwords % 5;
+      const size_t fields = (nwords - 1) * 32 / width;
+      if (fields > first) {
+        bstr_dispatch_unpack(words, width, first, fields - first, test_fields);
+        for (size_t i = first; i < fields; i++)
+          TEST_ASSERT_EQUAL_UINT32(test_ref_field(words, width, i),
+                                   test_fields[i - first]);
+      }
+    }
+
+    {
+      /* Rows overlap, row r starts r words further in. The counts start at
+       * 7 and get added to. */
+      const unsigned int *rows[40];
+      const size_t nrows = nwords % 37;
+      for (size_t r = 0; r < nrows; r++)
+        rows[r] = &test_words[r % TEST_DISPATCH_MAX_OFFSET];
+      for (size_t i = 0; i < nwords * 32; i++)
+        test_fields[i] = 7;
+      bstr_dispatch_positional_popcnt(rows, nrows, nwords, test_fields);
+      for (size_t i = 0; i < nwords * 32; i++) {
+        uint32_t expected = 7;
+        for (size_t r = 0; r < nrows; r++)
+          expected += (rows[r][i / 32] >> (i % 32)) & 1U;
+        TEST_ASSERT_EQUAL_UINT32(expected, test_fields[i]);
+      }
+    }
+
+    {
+      /* Rows back to back from the start of test_words. */
+      size_t nrows = nwords == 0 ? 3
+                                 : sizeof(test_words) /
+                                       sizeof(test_words[0]) / nwords;
+      nrows = nrows < 8 ? nrows : 8;
+      test_fill(test_other, nwords, (unsigned int)nwords + 1U);
+      bstr_dispatch_hamming(test_other, test_words, nrows, nwords,
+                            test_fields);
+      for (size_t r = 0; r < nrows; r++) {
+        uint32_t expected = 0;
+        for (size_t i = 0; i < nwords; i++)
+          expected += (uint32_t)__builtin_popcount(
+              test_other[i] ^ test_words[r * nwords + i]);
+        TEST_ASSERT_EQUAL_UINT32(expected, test_fields[r]);
+      }
+    }
+
+    memset(words, 0, nwords * sizeof(unsigned int));
+    TEST_ASSERT_EQUAL_UINT64(0, bstr_dispatch_popcnt(words, nwords));
+    TEST_ASSERT_EQUAL_size_t(nwords, bstr_dispatch_find(words, nwords, 0U));
+    TEST_ASSERT_EQUAL_size_t(0, bstr_dispatch_rfind(words, nwords));
+    if (nwords > 0) {
+      words[nwords - 1] = 1U;
+      TEST_ASSERT_EQUAL_size_t(nwords - 1,
+                               bstr_dispatch_find(words, nwords, 0U));
+      TEST_ASSERT_EQUAL_size_t(nwords, bstr_dispatch_rfind(words, nwords));
+      words[nwords - 1] = 0U;
+      words[0] = 1U;
+      TEST_ASSERT_EQUAL_size_t(1, bstr_dispatch_rfind(words, nwords));
+    }
+  }
+}
+
+void test_bstr_backend_names(void) {
+  TEST_ASSERT_EQUAL_STRING("auto", bstr_backend_name(BSTR_BACKEND_AUTO));
+  TEST_ASSERT_EQUAL_STRING("scalar", bstr_backend_name(BSTR_BACKEND_SCALAR));
+  TEST_ASSERT_EQUAL_STRING("avx512", bstr_backend_name(BSTR_BACKEND_AVX512));
+  TEST_ASSERT_NULL(bstr_backend_name((bstr_backend_t)42));
+}
+
+void test_bstr_set_backend(void) {
+  TEST_ASSERT_TRUE(bstr_backend_is_supported(BSTR_BACKEND_SCALAR));
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_SCALAR));
+  TEST_ASSERT_EQUAL_INT(BSTR_BACKEND_SCALAR, bstr_get_backend());
+  TEST_ASSERT_EQUAL_INT(BSTR_UNSUPPORTED, bstr_set_backend((bstr_backend_t)42));
+  TEST_ASSERT_EQUAL_INT(BSTR_BACKEND_SCALAR, bstr_get_backend());
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_AUTO));
+  TEST_ASSERT_NOT_EQUAL(BSTR_BACKEND_AUTO, bstr_get_backend());
+  TEST_ASSERT_TRUE(bstr_backend_is_supported(bstr_get_backend()));
+}
+
+void test_bstr_dispatch_backends(void) {
+  for (size_t i = 0; i < sizeof(test_backends) / sizeof(test_backends[0]);
+       i++) {
+    if (!bstr_backend_is_supported(test_backends[i])) {
+      TEST_ASSERT_EQUAL_INT(BSTR_UNSUPPORTED,
+                            bstr_set_backend(test_backends[i]));
+      continue;
+    }
+    TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(test_backends[i]));
+    test_against_reference();
+  }
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_AUTO));
+}
+
+void test_bstr_dispatch_hash(void) {
+  static uint64_t expected[TEST_DISPATCH_MAX_WORDS][2];
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_SCALAR));
+  for (size_t nwords = 0; nwords < TEST_DISPATCH_MAX_WORDS; nwords++) {
+    test_fill(test_words, nwords, (unsigned int)nwords);
+    bstr_dispatch_hash128(test_words, nwords, expected[nwords]);
+  }
+  for (size_t i = 0; i < sizeof(test_backends) / sizeof(test_backends[0]);
+       i++) {
+    if (bstr_set_backend(test_backends[i]) != BSTR_NO_ERROR)
+      continue;
+    for (size_t nwords = 0; nwords < TEST_DISPATCH_MAX_WORDS; nwords++) {
+      unsigned int *words = &test_words[nwords % TEST_DISPATCH_MAX_OFFSET];
+      uint64_t hash[2];
+      test_fill(words, nwords, (unsigned int)nwords);
+      bstr_dispatch_hash128(words, nwords, hash);
+      TEST_ASSERT_EQUAL_UINT64(expected[nwords][0], hash[0]);
+      TEST_ASSERT_EQUAL_UINT64(expected[nwords][1], hash[1]);
+      /* Block by block gives the same hash. */
+      bstr_hash_state_t state;
+      bstr_dispatch_hash128_init(&state);
+      for (size_t w = 0; w < nwords; w += BSTR_DISPATCH_HASH_BLOCK_WORDS)
+        bstr_dispatch_hash128_update(
+            &state, &words[w],
+            nwords - w < BSTR_DISPATCH_HASH_BLOCK_WORDS
+                ? nwords - w
+                : BSTR_DISPATCH_HASH_BLOCK_WORDS);
+      bstr_dispatch_hash128_final(&state, hash);
+      TEST_ASSERT_EQUAL_UINT64(expected[nwords][0], hash[0]);
+      TEST_ASSERT_EQUAL_UINT64(expected[nwords][1], hash[1]);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_AUTO));
+}
+
+void test_bstr_dispatch_through_front_end(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(TEST_DISPATCH_MAX_WORDS);
+  TEST_ASSERT_NOT_NULL(bstr);
+  const int nbits = (int)bstr_get_bit_capacity(bstr);
+  for (size_t i = 0; i < sizeof(test_backends) / sizeof(test_backends[0]);
+       i++) {
+    if (bstr_set_backend(test_backends[i]) != BSTR_NO_ERROR)
+      continue;
+    bstr_set_all(bstr, false);
+    TEST_ASSERT_EQUAL_INT(-1, bstr_ffs(bstr));
+    TEST_ASSERT_EQUAL_INT(nbits, bstr_clz(bstr));
+    bstr_set(bstr, 1000);
+    bstr_set(bstr, 5000);
+    TEST_ASSERT_EQUAL_INT(2, bstr_popcnt(bstr));
+    TEST_ASSERT_EQUAL_INT(1000, bstr_ffs(bstr));
+    TEST_ASSERT_EQUAL_INT(5000, bstr_next_set_bit(bstr, 1001));
+    TEST_ASSERT_EQUAL_INT(nbits - 5001, bstr_clz(bstr));
+    bstr_set_all(bstr, true);
+    bstr_clr(bstr, 7000);
+    TEST_ASSERT_EQUAL_INT(nbits - 1, bstr_popcnt(bstr));
+    TEST_ASSERT_EQUAL_INT(7000, bstr_ffus(bstr));
+  }
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_AUTO));
+  bstr_delete_bitstr(bstr);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_backend_names);
+  RUN_TEST(test_bstr_set_backend);
+  RUN_TEST(test_bstr_dispatch_backends);
+  RUN_TEST(test_bstr_dispatch_hash);
+  RUN_TEST(test_bstr_dispatch_through_front_end);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
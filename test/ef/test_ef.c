@@ -0,0 +1,159 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_ef.h"
+#include "unity.h"
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_EF_MAX_VALUES 5000U
+
+static unsigned int test_ef_values[TEST_EF_MAX_VALUES];
+
+/* Checks every operation of a list of the first n test_ef_values. */
+static void test_ef_check(unsigned int n) {
+  bstr_ef_t *ef = bstr_ef_create(test_ef_values, n);
+  TEST_ASSERT_NOT_NULL(ef);
+  TEST_ASSERT_EQUAL_UINT(n, bstr_ef_count(ef));
+  for (unsigned int i = 0; i < n; i++)
+    TEST_ASSERT_EQUAL_UINT(test_ef_values[i], bstr_ef_get(ef, i));
+
+  bstr_ef_iter_t it;
+  unsigned int value;
+  bstr_ef_iter_init(ef, 0, &it);
+  for (unsigned int i = 0; i < n; i++) {
+    TEST_ASSERT_TRUE(bstr_ef_iter_next(&it, &value));
+    TEST_ASSERT_EQUAL_UINT(test_ef_values[i], value);
+  }
+  TEST_ASSERT_FALSE(bstr_ef_iter_next(&it, &value));
+
+  /* Probe the values, their neighbours and random points. */
+  for (unsigned int probe = 0; probe < 3 * n + 50; probe++) {
+    unsigned int x;
+    if (probe < 3 * n)
+      x = test_ef_values[probe / 3] + probe % 3 - 1U;
+    else
+      x = (unsigned int)rand() * 2654435761U;
+    unsigned int expected = 0;
+    for (unsigned int end = n; expected < end;) {
+      const unsigned int mid = expected + (end - expected) / 2;
+      if (test_ef_values[mid] < x)
+        expected = mid + 1;
+      else
+        end = mid;
+    }
+    value = 0;
+    const int index = bstr_ef_next_geq(ef, x, &value);
+    if (expected == n) {
+      TEST_ASSERT_EQUAL_INT(-1, index);
+      continue;
+    }
+    TEST_ASSERT_EQUAL_INT(expected, index);
+    TEST_ASSERT_EQUAL_UINT(test_ef_values[expected], value);
+    bstr_ef_iter_init(ef, (unsigned int)index, &it);
+    TEST_ASSERT_TRUE(bstr_ef_iter_next(&it, &value));
+    TEST_ASSERT_EQUAL_UINT(test_ef_values[expected], value);
+  }
+  bstr_ef_delete(ef);
+}
+
+void test_bstr_ef_empty_and_single(void) {
+  test_ef_check(0);
+  test_ef_values[0] = 0;
+  test_ef_check(1);
+  test_ef_values[0] = UINT_MAX;
+  test_ef_check(1);
+}
+
+void test_bstr_ef_distributions(void) {
+  static const unsigned int max_gaps[] = {1, 2, 3, 10, 1000, 100000};
+  srand(3);
+  for (size_t g = 0; g < sizeof(max_gaps) / sizeof(max_gaps[0]); g++) {
+    unsigned int value = (unsigned int)rand() % 100;
+    for (unsigned int i = 0; i < TEST_EF_MAX_VALUES; i++) {
+      test_ef_values[i] = value;
+      /* A gap of 0 repeats the value. */
+      value += (unsigned int)rand() % max_gaps[g];
+    }
+    test_ef_check(TEST_EF_MAX_VALUES);
+    test_ef_check(TEST_EF_MAX_VALUES / 7);
+  }
+}
+
+void test_bstr_ef_full_range(void) {
+  for (unsigned int i = 0; i < TEST_EF_MAX_VALUES; i++)
+    test_ef_values[i] = UINT_MAX / TEST_EF_MAX_VALUES * i;
+  test_ef_values[TEST_EF_MAX_VALUES - 1] = UINT_MAX;
+  test_ef_check(TEST_EF_MAX_VALUES);
+  test_ef_check(2);
+}
+
+void test_bstr_ef_size(void) {
+  /* Uniform gaps of about 1000: 2 + log2(1000) bits per value plus samples,
+   * against 32 bits for a plain array. */
+  unsigned int value = 0;
+  srand(4);
+  for (unsigned int i = 0; i < TEST_EF_MAX_VALUES; i++) {
+    test_ef_values[i] = value;
+    value += (unsigned int)rand() % 2000;
+  }
+  bstr_ef_t *ef = bstr_ef_create(test_ef_values, TEST_EF_MAX_VALUES);
+  TEST_ASSERT_TRUE(bstr_ef_size_in_bits(ef) < 13U * TEST_EF_MAX_VALUES);
+  bstr_ef_delete(ef);
+}
+
+void test_bstr_ef_create_from_bitstr(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(100);
+  bstr_ef_t *ef = bstr_ef_create_from_bitstr(bstr);
+  TEST_ASSERT_EQUAL_UINT(0, bstr_ef_count(ef));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_ef_next_geq(ef, 0, NULL));
+  bstr_ef_delete(ef);
+  for (unsigned int bit = 5; bit < bstr_get_bit_capacity(bstr); bit += 37)
+    bstr_set(bstr, bit);
+  ef = bstr_ef_create_from_bitstr(bstr);
+  TEST_ASSERT_EQUAL_UINT(bstr_popcnt(bstr), bstr_ef_count(ef));
+  for (unsigned int i = 0; i < bstr_ef_count(ef); i++)
+    TEST_ASSERT_EQUAL_UINT(5 + 37 * i, bstr_ef_get(ef, i));
+  TEST_ASSERT_EQUAL_INT(2, bstr_ef_next_geq(ef, 43, NULL));
+  bstr_ef_delete(ef);
+  bstr_delete_bitstr(bstr);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_ef_empty_and_single);
+  RUN_TEST(test_bstr_ef_distributions);
+  RUN_TEST(test_bstr_ef_full_range);
+  RUN_TEST(test_bstr_ef_size);
+  RUN_TEST(test_bstr_ef_create_from_bitstr);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
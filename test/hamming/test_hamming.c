@@ -0,0 +1,184 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_hamming.h"
+#include "unity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_HAMMING_WORDS 8U
+#define TEST_HAMMING_ROWS 3000U
+#define TEST_HAMMING_QUERIES 5U
+#define TEST_HAMMING_K 10U
+#define TEST_HAMMING_BITS (TEST_HAMMING_WORDS * BSTR_BITS_PER_INT)
+
+static unsigned int test_seed = 1;
+
+static unsigned int test_rand(void) {
+  test_seed = test_seed * 1103515245U + 12345U;
+  return test_seed;
+}
+
+/* Rows with few set bits, so many distances tie. */
+static bstr_hamming_set_t *test_create_set(void) {
+  bstr_hamming_set_t *set = bstr_hamming_create(TEST_HAMMING_WORDS, 1);
+  TEST_ASSERT_NOT_NULL(set);
+  bstr_bitstr_t *row = bstr_create_bitstr(TEST_HAMMING_WORDS);
+  TEST_ASSERT_NOT_NULL(row);
+  for (unsigned int r = 0; r < TEST_HAMMING_ROWS; r++) {
+    bstr_set_all(row, false);
+    for (unsigned int b = 0; b < 6; b++)
+      bstr_set(row, test_rand() % TEST_HAMMING_BITS);
+    TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_hamming_add(set, row));
+  }
+  bstr_delete_bitstr(row);
+  return set;
+}
+
+/* The k best of n rows from first, by sorting all of them. */
+static void test_reference(bstr_hamming_set_t *set,
+                           const bstr_bitstr_t *query, unsigned int first,
+                           unsigned int n, bstr_hamming_hit_t *expected) {
+  static bstr_hamming_hit_t all[TEST_HAMMING_ROWS];
+  for (unsigned int r = 0; r < n; r++) {
+    bstr_bitstr_t row = bstr_hamming_row(set, first + r);
+    unsigned int distance = 0;
+    for (unsigned int b = 0; b < TEST_HAMMING_BITS; b++)
+      distance += bstr_get(&row, b) != bstr_get(query, b);
+    all[r].index = first + r;
+    all[r].distance = distance;
+  }
+  /* Insertion sort is stable, so ties stay in index order. */
+  for (unsigned int i = 1; i < n; i++) {
+    const bstr_hamming_hit_t hit = all[i];
+    unsigned int j = i;
+    for (; j > 0 && all[j - 1].distance > hit.distance; j--)
+      all[j] = all[j - 1];
+    all[j] = hit;
+  }
+  for (unsigned int i = 0; i < n && i < TEST_HAMMING_K; i++)
+    expected[i] = all[i];
+}
+
+static void test_assert_hits(const bstr_hamming_hit_t *expected,
+                             const bstr_hamming_hit_t *hits, unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    TEST_ASSERT_EQUAL_UINT(expected[i].index, hits[i].index);
+    TEST_ASSERT_EQUAL_UINT(expected[i].distance, hits[i].distance);
+  }
+}
+
+void test_bstr_hamming_set(void) {
+  bstr_hamming_set_t *set = test_create_set();
+  TEST_ASSERT_EQUAL_UINT(TEST_HAMMING_ROWS, bstr_hamming_count(set));
+  TEST_ASSERT_EQUAL_UINT(TEST_HAMMING_WORDS, bstr_hamming_words(set));
+  bstr_bitstr_t row = bstr_hamming_row(set, 17);
+  bstr_set_all(&row, true);
+  uint32_t distances[3];
+  bstr_hamming_distances(set, &row, 16, 3, distances);
+  TEST_ASSERT_EQUAL_UINT32(0, distances[1]);
+  bstr_bitstr_t before = bstr_hamming_row(set, 16);
+  TEST_ASSERT_EQUAL_UINT32(
+      TEST_HAMMING_BITS - bstr_popcnt(&before),
+      distances[0]);
+  bstr_hamming_delete(set);
+}
+
+void test_bstr_hamming_topk(void) {
+  bstr_hamming_set_t *set = test_create_set();
+  bstr_bitstr_t *queries[TEST_HAMMING_QUERIES];
+  for (unsigned int q = 0; q < TEST_HAMMING_QUERIES; q++) {
+    queries[q] = bstr_create_bitstr(TEST_HAMMING_WORDS);
+    TEST_ASSERT_NOT_NULL(queries[q]);
+    /* Query 0 is a row itself, the others are random. */
+    bstr_bitstr_t row = bstr_hamming_row(set, 1234);
+    if (q == 0)
+      bstr_set_words(queries[q], 0, row._bits, TEST_HAMMING_WORDS);
+    for (unsigned int b = 0; q != 0 && b < 6; b++)
+      bstr_set(queries[q], test_rand() % TEST_HAMMING_BITS);
+  }
+  static bstr_hamming_hit_t hits[TEST_HAMMING_QUERIES * TEST_HAMMING_K];
+  bstr_hamming_hit_t expected[TEST_HAMMING_K];
+  TEST_ASSERT_EQUAL_UINT(
+      TEST_HAMMING_K,
+      bstr_hamming_topk(set, (const bstr_bitstr_t *const *)queries,
+                        TEST_HAMMING_QUERIES, 0, TEST_HAMMING_ROWS,
+                        TEST_HAMMING_K, hits));
+  TEST_ASSERT_EQUAL_UINT(0, hits[0].distance);
+  for (unsigned int q = 0; q < TEST_HAMMING_QUERIES; q++) {
+    test_reference(set, queries[q], 0, TEST_HAMMING_ROWS, expected);
+    test_assert_hits(expected, hits + q * TEST_HAMMING_K, TEST_HAMMING_K);
+  }
+  /* Fewer rows than k. */
+  TEST_ASSERT_EQUAL_UINT(
+      4, bstr_hamming_topk(set, (const bstr_bitstr_t *const *)queries, 1, 100,
+                           4, TEST_HAMMING_K, hits));
+  test_reference(set, queries[0], 100, 4, expected);
+  test_assert_hits(expected, hits, 4);
+  for (unsigned int q = 0; q < TEST_HAMMING_QUERIES; q++)
+    bstr_delete_bitstr(queries[q]);
+  bstr_hamming_delete(set);
+}
+
+/* Searching three ranges and merging their hits gives the same result. */
+void test_bstr_hamming_topk_merge(void) {
+  bstr_hamming_set_t *set = test_create_set();
+  bstr_bitstr_t *query = bstr_create_bitstr(TEST_HAMMING_WORDS);
+  TEST_ASSERT_NOT_NULL(query);
+  bstr_set_range(query, 0, 5);
+  const bstr_bitstr_t *queries[1] = {query};
+  bstr_hamming_hit_t all[TEST_HAMMING_K];
+  bstr_hamming_hit_t hits[TEST_HAMMING_K];
+  bstr_hamming_hit_t part[TEST_HAMMING_K];
+  TEST_ASSERT_EQUAL_UINT(TEST_HAMMING_K,
+                         bstr_hamming_topk(set, queries, 1, 0,
+                                           TEST_HAMMING_ROWS, TEST_HAMMING_K,
+                                           all));
+  const unsigned int bounds[] = {0, 1000, 1003, TEST_HAMMING_ROWS};
+  unsigned int nhits = 0;
+  for (unsigned int i = 0; i < 3; i++) {
+    const unsigned int npart =
+        bstr_hamming_topk(set, queries, 1, bounds[i],
+                          bounds[i + 1] - bounds[i], TEST_HAMMING_K, part);
+    nhits = bstr_hamming_topk_merge(hits, nhits, part, npart, TEST_HAMMING_K);
+  }
+  TEST_ASSERT_EQUAL_UINT(TEST_HAMMING_K, nhits);
+  test_assert_hits(all, hits, TEST_HAMMING_K);
+  bstr_delete_bitstr(query);
+  bstr_hamming_delete(set);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_hamming_set);
+  RUN_TEST(test_bstr_hamming_topk);
+  RUN_TEST(test_bstr_hamming_topk_merge);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
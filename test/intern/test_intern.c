@@ -0,0 +1,173 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_intern.h"
+#include "bitstring_static.h"
+#include "unity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_INTERN_MAX_TEST_CAPACITY 64
+#define TEST_INTERN_STRESS_KEYS 2000
+
+BSTR_STATIC_DECLARE_ALL(8);
+
+void test_bstr_hash(void) {
+  for (unsigned int i = 1; i < TEST_INTERN_MAX_TEST_CAPACITY; i++) {
+    bstr_bitstr_t *a = bstr_create_bitstr(i);
+    bstr_bitstr_t *b = bstr_create_bitstr(i);
+    bstr_bitstr_t *longer = bstr_create_bitstr(i + 1);
+    TEST_ASSERT_EQUAL_UINT64(bstr_hash(a), bstr_hash(b));
+    TEST_ASSERT_NOT_EQUAL(bstr_hash(a), bstr_hash(longer));
+    for (unsigned int bit = 0; bit < bstr_get_bit_capacity(a); bit += 7) {
+      bstr_set(a, bit);
+      TEST_ASSERT_NOT_EQUAL(bstr_hash(a), bstr_hash(b));
+      bstr_set(b, bit);
+      TEST_ASSERT_EQUAL_UINT64(bstr_hash(a), bstr_hash(b));
+    }
+    uint64_t hash[2];
+    bstr_hash128(a, hash);
+    TEST_ASSERT_EQUAL_UINT64(bstr_hash(a), hash[0]);
+    bstr_delete_bitstr(a);
+    bstr_delete_bitstr(b);
+    bstr_delete_bitstr(longer);
+  }
+}
+
+void test_bstr_hash_is_stable(void) {
+  /* Stored hashes stay valid, the value must never change. */
+  bstr_static_t(8) s = bstrs_initialize;
+  bstr_bitstr_t *d = bstr_create_bitstr(8);
+  for (unsigned int bit = 0; bit < bstrs_get_bit_capacity(8); bit += 3) {
+    bstrs_set(8, &s, bit);
+    bstr_set(d, bit);
+  }
+  TEST_ASSERT_EQUAL_UINT64(bstr_hash(d), bstrs_hash(8, &s));
+  TEST_ASSERT_EQUAL_UINT64(0x90BADD4298E1D000ULL, bstr_hash(d));
+  bstr_delete_bitstr(d);
+}
+
+void test_bstr_intern(void) {
+  bstr_intern_table_t *table = bstr_intern_create_table(0);
+  TEST_ASSERT_NOT_NULL(table);
+  bstr_bitstr_t *a = bstr_create_bitstr(4);
+  bstr_bitstr_t *b = bstr_create_bitstr(4);
+  bstr_set(a, 42);
+  bstr_set(b, 42);
+
+  const bstr_bitstr_t *ia = bstr_intern(table, a);
+  const bstr_bitstr_t *ib = bstr_intern(table, b);
+  TEST_ASSERT_NOT_NULL(ia);
+  TEST_ASSERT_TRUE(ia == ib);
+  TEST_ASSERT_TRUE(ia != a);
+  TEST_ASSERT_TRUE(bstr_equals(ia, a));
+  TEST_ASSERT_EQUAL_UINT(2, bstr_intern_refcount(ia));
+  TEST_ASSERT_EQUAL_UINT(1, bstr_intern_count(table));
+
+  bstr_set(b, 43);
+  const bstr_bitstr_t *ic = bstr_intern(table, b);
+  TEST_ASSERT_TRUE(ic != ia);
+  TEST_ASSERT_EQUAL_UINT(2, bstr_intern_count(table));
+  TEST_ASSERT_FALSE(bstr_get(ia, 43));
+
+  TEST_ASSERT_TRUE(bstr_intern_retain(ic) == ic);
+  TEST_ASSERT_EQUAL_UINT(2, bstr_intern_refcount(ic));
+  bstr_intern_release(table, ic);
+  bstr_intern_release(table, ic);
+  TEST_ASSERT_EQUAL_UINT(1, bstr_intern_count(table));
+  bstr_intern_release(table, ia);
+  TEST_ASSERT_EQUAL_UINT(1, bstr_intern_refcount(ia));
+  bstr_intern_release(table, ib);
+  TEST_ASSERT_EQUAL_UINT(0, bstr_intern_count(table));
+
+  bstr_delete_bitstr(a);
+  bstr_delete_bitstr(b);
+  bstr_intern_delete_table(table);
+}
+
+void test_bstr_intern_capacity_matters(void) {
+  bstr_intern_table_t *table = bstr_intern_create_table(2);
+  bstr_bitstr_t *small = bstr_create_bitstr(1);
+  bstr_bitstr_t *big = bstr_create_bitstr(2);
+  const bstr_bitstr_t *is = bstr_intern(table, small);
+  const bstr_bitstr_t *ib = bstr_intern(table, big);
+  TEST_ASSERT_TRUE(is != ib);
+  TEST_ASSERT_EQUAL_UINT(1, bstr_get_capacity(is));
+  TEST_ASSERT_EQUAL_UINT(2, bstr_get_capacity(ib));
+  bstr_delete_bitstr(small);
+  bstr_delete_bitstr(big);
+  bstr_intern_delete_table(table);
+}
+
+void test_bstr_intern_stress(void) {
+  static const bstr_bitstr_t *interned[TEST_INTERN_STRESS_KEYS];
+  bstr_intern_table_t *table = bstr_intern_create_table(0);
+  bstr_bitstr_t *key = bstr_create_bitstr(2);
+  for (unsigned int round = 0; round < 2; round++) {
+    for (unsigned int i = 0; i < TEST_INTERN_STRESS_KEYS; i++) {
+      key->_bits[0] = i;
+      key->_bits[1] = i * 2654435761U;
+      const bstr_bitstr_t *got = bstr_intern(table, key);
+      TEST_ASSERT_NOT_NULL(got);
+      if (round == 0)
+        interned[i] = got;
+      TEST_ASSERT_TRUE(interned[i] == got);
+    }
+    TEST_ASSERT_EQUAL_UINT(TEST_INTERN_STRESS_KEYS, bstr_intern_count(table));
+  }
+  /* Drop every third key completely, the rest must still be found. */
+  for (unsigned int i = 0; i < TEST_INTERN_STRESS_KEYS; i += 3) {
+    bstr_intern_release(table, interned[i]);
+    bstr_intern_release(table, interned[i]);
+  }
+  for (unsigned int i = 0; i < TEST_INTERN_STRESS_KEYS; i++) {
+    if (i % 3 == 0)
+      continue;
+    key->_bits[0] = i;
+    key->_bits[1] = i * 2654435761U;
+    TEST_ASSERT_TRUE(interned[i] == bstr_intern(table, key));
+    TEST_ASSERT_EQUAL_UINT(3, bstr_intern_refcount(interned[i]));
+  }
+  const unsigned int dropped = (TEST_INTERN_STRESS_KEYS + 2) / 3;
+  TEST_ASSERT_EQUAL_UINT(TEST_INTERN_STRESS_KEYS - dropped,
+                         bstr_intern_count(table));
+  bstr_delete_bitstr(key);
+  bstr_intern_delete_table(table);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_hash);
+  RUN_TEST(test_bstr_hash_is_stable);
+  RUN_TEST(test_bstr_intern);
+  RUN_TEST(test_bstr_intern_capacity_matters);
+  RUN_TEST(test_bstr_intern_stress);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,213 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_msb.h"
+#include "unity.h"
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_MSB_WORDS 40U
+#define TEST_MSB_BYTES (TEST_MSB_WORDS * sizeof(unsigned int))
+#define TEST_MSB_BITS (TEST_MSB_WORDS * BSTR_BITS_PER_INT)
+
+static unsigned int test_words[TEST_MSB_WORDS];
+
+/* The MSB first reference: bit i of a byte stream. */
+static bool test_bit(unsigned int bit) {
+  const unsigned char *bytes = (const unsigned char *)test_words;
+  return (bytes[bit >> 3] >> (7U - (bit & 7U))) & 1U;
+}
+
+static uint64_t test_field(unsigned int offset, unsigned int width) {
+  uint64_t value = 0;
+  for (unsigned int i = 0; i < width; i++)
+    value = (value << 1) | (test_bit(offset + i) ? 1U : 0U);
+  return value;
+}
+
+static void test_fill(unsigned int seed) {
+  for (unsigned int i = 0; i < TEST_MSB_WORDS; i++) {
+    seed = seed * 1103515245U + 12345U;
+    test_words[i] = seed;
+  }
+}
+
+void test_bstr_msb_get_set(void) {
+  memset(test_words, 0, sizeof(test_words));
+  bstr_bitstr_t bstr = bstr_wrap(test_words, TEST_MSB_WORDS);
+  const unsigned char *bytes = (const unsigned char *)test_words;
+  bstr_msb_set(&bstr, 0);
+  TEST_ASSERT_EQUAL_UINT(0x80U, bytes[0]);
+  bstr_msb_set(&bstr, 15);
+  TEST_ASSERT_EQUAL_UINT(0x01U, bytes[1]);
+  bstr_msb_set(&bstr, TEST_MSB_BITS - 1U);
+  TEST_ASSERT_EQUAL_UINT(0x01U, bytes[TEST_MSB_BYTES - 1U]);
+  TEST_ASSERT_TRUE(bstr_msb_get(&bstr, 0));
+  TEST_ASSERT_FALSE(bstr_msb_get(&bstr, 7));
+  TEST_ASSERT_TRUE(bstr_msb_get(&bstr, 15));
+  bstr_msb_clr(&bstr, 0);
+  TEST_ASSERT_EQUAL_UINT(0U, bytes[0]);
+  test_fill(7);
+  for (unsigned int i = 0; i < TEST_MSB_BITS; i++)
+    TEST_ASSERT_EQUAL(test_bit(i), bstr_msb_get(&bstr, i));
+}
+
+void test_bstr_msb_get_field(void) {
+  test_fill(11);
+  bstr_bitstr_t bstr = bstr_wrap(test_words, TEST_MSB_WORDS);
+  const unsigned int widths[] = {1, 3, 8, 12, 16, 31, 32, 33, 57, 63, 64};
+  for (unsigned int w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+    for (unsigned int offset = 0; offset + widths[w] <= 200; offset++)
+      TEST_ASSERT_EQUAL_UINT64(test_field(offset, widths[w]),
+                               bstr_msb_get_field(&bstr, offset, widths[w]));
+  /* An IPv4 style header: version and header length share the first byte. */
+  memset(test_words, 0, sizeof(test_words));
+  unsigned char *bytes = (unsigned char *)test_words;
+  bytes[0] = 0x45;
+  bytes[2] = 0x05;
+  bytes[3] = 0xDC;
+  TEST_ASSERT_EQUAL_UINT64(4, bstr_msb_get_field(&bstr, 0, 4));
+  TEST_ASSERT_EQUAL_UINT64(5, bstr_msb_get_field(&bstr, 4, 4));
+  TEST_ASSERT_EQUAL_UINT64(1500, bstr_msb_get_field(&bstr, 16, 16));
+}
+
+void test_bstr_msb_set_field(void) {
+  bstr_bitstr_t bstr = bstr_wrap(test_words, TEST_MSB_WORDS);
+  const unsigned int widths[] = {1, 5, 8, 13, 32, 40, 64};
+  for (unsigned int w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+    for (unsigned int offset = 0; offset < 80; offset += 3) {
+      test_fill(offset + w);
+      unsigned int expected[TEST_MSB_WORDS];
+      const uint64_t value = UINT64_C(0xA5C3F00F96E1B42D) * (offset + 1U);
+      /* The reference write, bit by bit. */
+      memcpy(expected, test_words, sizeof(test_words));
+      for (unsigned int i = 0; i < widths[w]; i++) {
+        const unsigned int bit = offset + i;
+        unsigned char *byte = (unsigned char *)expected + (bit >> 3);
+        const unsigned char mask = (unsigned char)(0x80U >> (bit & 7U));
+        if ((value >> (widths[w] - 1U - i)) & 1U)
+          *byte |= mask;
+        else
+          *byte &= (unsigned char)~mask;
+      }
+      bstr_msb_set_field(&bstr, offset, widths[w], value);
+      TEST_ASSERT_EQUAL_MEMORY(expected, test_words, sizeof(test_words));
+    }
+  }
+}
+
+void test_bstr_msb_next(void) {
+  bstr_bitstr_t bstr = bstr_wrap(test_words, TEST_MSB_WORDS);
+  memset(test_words, 0, sizeof(test_words));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_msb_next_set_bit(&bstr, 0));
+  TEST_ASSERT_EQUAL_INT(0, bstr_msb_next_unset_bit(&bstr, 0));
+  const unsigned int bits[] = {3, 9, 31, 32, 100, 600, TEST_MSB_BITS - 1U};
+  for (unsigned int i = 0; i < sizeof(bits) / sizeof(bits[0]); i++)
+    bstr_msb_set(&bstr, bits[i]);
+  unsigned int bit = 0;
+  for (unsigned int i = 0; i < sizeof(bits) / sizeof(bits[0]); i++) {
+    const int next = bstr_msb_next_set_bit(&bstr, bit);
+    TEST_ASSERT_EQUAL_INT((int)bits[i], next);
+    bit = (unsigned int)next + 1U;
+  }
+  TEST_ASSERT_EQUAL_INT(-1, bstr_msb_next_set_bit(&bstr, TEST_MSB_BITS));
+  /* Against the reference from every offset, both ways. */
+  test_fill(3);
+  for (unsigned int w = 5; w < 30; w++)
+    test_words[w] = w % 2 == 0 ? 0U : ~0U;
+  for (unsigned int offset = 0; offset < TEST_MSB_BITS; offset++) {
+    int set = -1;
+    int unset = -1;
+    for (unsigned int i = offset; i < TEST_MSB_BITS; i++) {
+      if (set < 0 && test_bit(i))
+        set = (int)i;
+      if (unset < 0 && !test_bit(i))
+        unset = (int)i;
+    }
+    TEST_ASSERT_EQUAL_INT(set, bstr_msb_next_set_bit(&bstr, offset));
+    TEST_ASSERT_EQUAL_INT(unset, bstr_msb_next_unset_bit(&bstr, offset));
+  }
+}
+
+/* The reference search, field by field. */
+static int test_find(uint64_t pattern, unsigned int width,
+                     unsigned int offset) {
+  for (unsigned int i = offset; i + width <= TEST_MSB_BITS; i++)
+    if (test_field(i, width) == pattern)
+      return (int)i;
+  return -1;
+}
+
+void test_bstr_msb_find_pattern(void) {
+  bstr_bitstr_t bstr = bstr_wrap(test_words, TEST_MSB_WORDS);
+  /* The CCSDS attached sync marker at an odd bit offset. */
+  memset(test_words, 0, sizeof(test_words));
+  bstr_msb_set_field(&bstr, 333, 32, 0x1ACFFC1DU);
+  TEST_ASSERT_EQUAL_INT(333, bstr_msb_find_pattern(&bstr, 0x1ACFFC1DU, 32, 0));
+  TEST_ASSERT_EQUAL_INT(333,
+                        bstr_msb_find_pattern(&bstr, 0x1ACFFC1DU, 32, 333));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_msb_find_pattern(&bstr, 0x1ACFFC1DU, 32, 334));
+  /* Bits above width are ignored. */
+  TEST_ASSERT_EQUAL_INT(333, bstr_msb_find_pattern(&bstr, ~UINT64_C(0xE5), 8,
+                                                   0));
+  /* A match ending in the last bit. */
+  bstr_msb_set_field(&bstr, TEST_MSB_BITS - 64U, 64,
+                     UINT64_C(0xF0E1D2C3B4A59687));
+  TEST_ASSERT_EQUAL_INT((int)(TEST_MSB_BITS - 64U),
+                        bstr_msb_find_pattern(&bstr,
+                                              UINT64_C(0xF0E1D2C3B4A59687),
+                                              64, 400));
+  /* Against the reference on random data, overlapping matches included. */
+  test_fill(19);
+  for (unsigned int w = 10; w < 20; w++)
+    test_words[w] = 0xAAAAAAAAU;
+  const unsigned int widths[] = {1, 3, 7, 8, 9, 16, 24, 33, 63, 64};
+  for (unsigned int w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+    for (unsigned int offset = 0; offset < TEST_MSB_BITS; offset += 37) {
+      const uint64_t pattern =
+          test_field((offset * 7U) % (TEST_MSB_BITS - 64U), widths[w]);
+      TEST_ASSERT_EQUAL_INT(
+          test_find(pattern, widths[w], offset),
+          bstr_msb_find_pattern(&bstr, pattern, widths[w], offset));
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(-1, bstr_msb_find_pattern(&bstr, 1, 1, TEST_MSB_BITS));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_msb_get_set);
+  RUN_TEST(test_bstr_msb_get_field);
+  RUN_TEST(test_bstr_msb_set_field);
+  RUN_TEST(test_bstr_msb_next);
+  RUN_TEST(test_bstr_msb_find_pattern);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
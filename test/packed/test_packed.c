@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_packed.h"
+#include "unity.h"
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_PACKED_COUNT 1000U
+
+static const bstr_backend_t test_backends[] = {
+    BSTR_BACKEND_SCALAR, BSTR_BACKEND_POPCNT, BSTR_BACKEND_AVX2,
+    BSTR_BACKEND_AVX512};
+
+static uint32_t test_values[TEST_PACKED_COUNT];
+static uint32_t test_out[TEST_PACKED_COUNT];
+
+static uint32_t test_mask(unsigned int width) {
+  return width < 32 ? (1U << width) - 1U : ~0U;
+}
+
+void test_bstr_packed_get_set(void) {
+  for (unsigned int width = 1; width <= 32; width++) {
+    bstr_packed_array_t *array = bstr_packed_create(TEST_PACKED_COUNT, width);
+    TEST_ASSERT_NOT_NULL(array);
+    TEST_ASSERT_EQUAL_UINT(TEST_PACKED_COUNT, bstr_packed_count(array));
+    TEST_ASSERT_EQUAL_UINT(width, bstr_packed_width(array));
+    TEST_ASSERT_EQUAL_UINT((TEST_PACKED_COUNT * width + 31) / 32,
+                           bstr_get_capacity(bstr_packed_bitstr(array)));
+    srand(width);
+    for (unsigned int i = 0; i < TEST_PACKED_COUNT; i++) {
+      test_values[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+      bstr_packed_set(array, i, test_values[i]);
+    }
+    for (unsigned int i = 0; i < TEST_PACKED_COUNT; i++)
+      TEST_ASSERT_EQUAL_UINT32(test_values[i] & test_mask(width),
+                               bstr_packed_get(array, i));
+    bstr_packed_delete(array);
+  }
+}
+
+void test_bstr_packed_bulk(void) {
+  for (size_t b = 0; b < sizeof(test_backends) / sizeof(test_backends[0]);
+       b++) {
+    if (bstr_set_backend(test_backends[b]) != BSTR_NO_ERROR)
+      continue;
+    for (unsigned int width = 1; width <= 32; width++) {
+      bstr_packed_array_t *array =
+          bstr_packed_create(TEST_PACKED_COUNT, width);
+      srand(width);
+      for (unsigned int i = 0; i < TEST_PACKED_COUNT; i++)
+        test_values[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+      bstr_packed_pack(array, 0, TEST_PACKED_COUNT, test_values);
+      /* Ranges at every alignment, short ones end in the scalar tail. */
+      for (unsigned int first = 0; first < 40; first += 3) {
+        const unsigned int n = TEST_PACKED_COUNT - first - first % 17;
+        bstr_packed_unpack(array, first, n, test_out);
+        for (unsigned int i = 0; i < n; i++)
+          TEST_ASSERT_EQUAL_UINT32(test_values[first + i] & test_mask(width),
+                                   test_out[i]);
+      }
+      /* Overwrite a range in the middle, the neighbours stay. */
+      for (unsigned int i = 0; i < 100; i++)
+        test_values[300 + i] = ~test_values[300 + i];
+      bstr_packed_pack(array, 300, 100, &test_values[300]);
+      bstr_packed_pack(array, 7, 0, test_values);
+      for (unsigned int i = 0; i < TEST_PACKED_COUNT; i++)
+        TEST_ASSERT_EQUAL_UINT32(test_values[i] & test_mask(width),
+                                 bstr_packed_get(array, i));
+      /* Bits past the last element stay 0. */
+      const bstr_bitstr_t *bstr = bstr_packed_bitstr(array);
+      for (unsigned int bit = TEST_PACKED_COUNT * width;
+           bit < bstr_get_bit_capacity(bstr); bit++)
+        TEST_ASSERT_FALSE(bstr_get(bstr, bit));
+      bstr_packed_delete(array);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(BSTR_NO_ERROR, bstr_set_backend(BSTR_BACKEND_AUTO));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_packed_get_set);
+  RUN_TEST(test_bstr_packed_bulk);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_sketch.h"
+#include "unity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Relative error of an estimate of n. */
+static double test_error(double estimate, unsigned int n) {
+  return (estimate > n ? estimate - n : n - estimate) / n;
+}
+
+void test_bstr_lc(void) {
+  bstr_bitstr_t *bstr = bstr_create_bitstr(2048);
+  TEST_ASSERT_NOT_NULL(bstr);
+  TEST_ASSERT_DOUBLE_WITHIN(0.0, 0.0, bstr_lc_estimate(bstr));
+  for (uint64_t key = 0; key < 20000; key++)
+    bstr_lc_add(bstr, key);
+  /* Adding keys again does not change anything. */
+  const int popcnt = bstr_popcnt(bstr);
+  for (uint64_t key = 0; key < 20000; key += 7)
+    bstr_lc_add(bstr, key);
+  TEST_ASSERT_EQUAL_INT(popcnt, bstr_popcnt(bstr));
+  TEST_ASSERT_LESS_THAN(0.03, test_error(bstr_lc_estimate(bstr), 20000));
+  bstr_delete_bitstr(bstr);
+}
+
+void test_bstr_lc_add_many(void) {
+  bstr_bitstr_t *one = bstr_create_bitstr(100);
+  bstr_bitstr_t *many = bstr_create_bitstr(100);
+  TEST_ASSERT_NOT_NULL(one);
+  TEST_ASSERT_NOT_NULL(many);
+  uint64_t keys[1000];
+  for (unsigned int i = 0; i < 1000; i++) {
+    keys[i] = (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+    bstr_lc_add(one, keys[i]);
+  }
+  bstr_lc_add_many(many, keys, 1000);
+  TEST_ASSERT_TRUE(bstr_equals(one, many));
+  /* Full sketches give the largest estimate instead of infinity. */
+  bstr_set_all(many, true);
+  TEST_ASSERT_GREATER_THAN(bstr_lc_estimate(one), bstr_lc_estimate(many));
+  bstr_delete_bitstr(one);
+  bstr_delete_bitstr(many);
+}
+
+void test_bstr_hll_estimate(void) {
+  bstr_hll_t *hll = bstr_hll_create(14);
+  TEST_ASSERT_NOT_NULL(hll);
+  TEST_ASSERT_EQUAL_UINT(14, bstr_hll_precision(hll));
+  TEST_ASSERT_DOUBLE_WITHIN(0.0, 0.0, bstr_hll_estimate(hll));
+  unsigned int n = 0;
+  const unsigned int checks[] = {100, 1000, 10000, 100000, 1000000};
+  for (unsigned int c = 0; c < sizeof(checks) / sizeof(checks[0]); c++) {
+    for (; n < checks[c]; n++)
+      bstr_hll_add(hll, n);
+    TEST_ASSERT_LESS_THAN(0.03, test_error(bstr_hll_estimate(hll), n));
+  }
+  /* Duplicates change nothing. */
+  const double estimate = bstr_hll_estimate(hll);
+  for (unsigned int i = 0; i < 1000; i++)
+    bstr_hll_add(hll, i);
+  TEST_ASSERT_DOUBLE_WITHIN(0.0, estimate, bstr_hll_estimate(hll));
+  bstr_hll_delete(hll);
+}
+
+void test_bstr_hll_add_many(void) {
+  bstr_hll_t *one = bstr_hll_create(BSTR_HLL_MIN_PRECISION);
+  bstr_hll_t *many = bstr_hll_create(BSTR_HLL_MIN_PRECISION);
+  TEST_ASSERT_NOT_NULL(one);
+  TEST_ASSERT_NOT_NULL(many);
+  uint64_t keys[1000];
+  for (unsigned int i = 0; i < 1000; i++) {
+    keys[i] = i;
+    bstr_hll_add(one, keys[i]);
+  }
+  bstr_hll_add_many(many, keys, 1000);
+  TEST_ASSERT_TRUE(bstr_equals(bstr_hll_bitstr(one), bstr_hll_bitstr(many)));
+  for (unsigned int i = 0; i < 1U << BSTR_HLL_MIN_PRECISION; i++) {
+    TEST_ASSERT_GREATER_THAN(0, bstr_hll_get(one, i));
+    TEST_ASSERT_LESS_THAN(66 - BSTR_HLL_MIN_PRECISION, bstr_hll_get(one, i));
+  }
+  bstr_hll_delete(one);
+  bstr_hll_delete(many);
+}
+
+void test_bstr_hll_merge(void) {
+  bstr_hll_t *a = bstr_hll_create(10);
+  bstr_hll_t *b = bstr_hll_create(10);
+  bstr_hll_t *all = bstr_hll_create(10);
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_NOT_NULL(all);
+  for (uint64_t key = 0; key < 30000; key++) {
+    if (key < 20000)
+      bstr_hll_add(a, key);
+    if (key >= 10000)
+      bstr_hll_add(b, key);
+    bstr_hll_add(all, key);
+  }
+  unsigned int expected[1024];
+  for (unsigned int i = 0; i < 1024; i++) {
+    const unsigned int x = bstr_hll_get(a, i);
+    const unsigned int y = bstr_hll_get(b, i);
+    expected[i] = x > y ? x : y;
+  }
+  bstr_hll_merge(a, b);
+  for (unsigned int i = 0; i < 1024; i++)
+    TEST_ASSERT_EQUAL_UINT(expected[i], bstr_hll_get(a, i));
+  TEST_ASSERT_TRUE(bstr_equals(bstr_hll_bitstr(a), bstr_hll_bitstr(all)));
+  bstr_hll_delete(a);
+  bstr_hll_delete(b);
+  bstr_hll_delete(all);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_lc);
+  RUN_TEST(test_bstr_lc_add_many);
+  RUN_TEST(test_bstr_hll_estimate);
+  RUN_TEST(test_bstr_hll_add_many);
+  RUN_TEST(test_bstr_hll_merge);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
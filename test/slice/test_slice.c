@@ -0,0 +1,295 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_slice.h"
+#include "unity.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_SLICE_WORDS 40U
+#define TEST_SLICE_BITS (TEST_SLICE_WORDS * BSTR_BITS_PER_INT)
+
+static unsigned int test_words[TEST_SLICE_WORDS];
+
+static bool test_bit(unsigned int bit) {
+  return (test_words[bit / BSTR_BITS_PER_INT] >> (bit % BSTR_BITS_PER_INT)) &
+         1U;
+}
+
+/* The bits of a slice from bit 0 of copy, the rest of copy cleared. */
+static unsigned int test_copy(bstr_slice_t slice, unsigned int *copy) {
+  const unsigned int nwords = (bstr_slice_bits(slice) + 31U) / 32U;
+  memset(copy, 0, (nwords + 1U) * sizeof(unsigned int));
+  for (unsigned int i = 0; i < bstr_slice_bits(slice); i++)
+    if (bstr_slice_get(slice, i))
+      copy[i / 32U] |= 1U << (i % 32U);
+  return nwords;
+}
+
+/* Every query of a slice against the bits of test_words. */
+static void test_slice_check(bstr_slice_t slice, unsigned int offset,
+                             unsigned int nbits) {
+  TEST_ASSERT_EQUAL_UINT(nbits, bstr_slice_bits(slice));
+  int popcnt = 0;
+  int first_set = -1;
+  int first_unset = -1;
+  for (unsigned int i = 0; i < nbits; i++) {
+    const bool bit = test_bit(offset + i);
+    TEST_ASSERT_EQUAL(bit, bstr_slice_get(slice, i));
+    popcnt += bit ? 1 : 0;
+    if (bit && first_set < 0)
+      first_set = (int)i;
+    if (!bit && first_unset < 0)
+      first_unset = (int)i;
+  }
+  TEST_ASSERT_EQUAL_INT(popcnt, bstr_slice_popcnt(slice));
+  TEST_ASSERT_EQUAL_INT(first_set, bstr_slice_ffs(slice));
+  TEST_ASSERT_EQUAL_INT(first_unset, bstr_slice_ffus(slice));
+  TEST_ASSERT_EQUAL(popcnt == 0, bstr_slice_is_empty(slice));
+  int last_set = -1;
+  for (unsigned int i = 0; i < nbits; i++)
+    if (test_bit(offset + i))
+      last_set = (int)i;
+  TEST_ASSERT_EQUAL_INT(first_set < 0 ? (int)nbits : first_set,
+                        bstr_slice_ctz(slice));
+  TEST_ASSERT_EQUAL_INT((int)nbits - 1 - last_set, bstr_slice_clz(slice));
+  int range = 0;
+  for (unsigned int i = nbits / 3; i < 2 * (nbits / 3); i++)
+    range += test_bit(offset + i) ? 1 : 0;
+  TEST_ASSERT_EQUAL_INT(range,
+                        bstr_slice_popcnt_range(slice, nbits / 3, nbits / 3));
+  static char str[TEST_SLICE_BITS + 1U];
+  TEST_ASSERT_EQUAL_size_t(nbits + 1U, bstr_slice_to_string_size(slice));
+  bstr_slice_to_string(slice, str);
+  TEST_ASSERT_EQUAL_size_t(nbits, strlen(str));
+  for (unsigned int i = 0; i < nbits; i++)
+    TEST_ASSERT_EQUAL_INT(test_bit(offset + i) ? '1' : '0', str[i]);
+  /* The hash of the same bits in a bitstring of their own. */
+  static unsigned int copy[TEST_SLICE_WORDS + 1U];
+  const bstr_bitstr_t own = bstr_wrap_const(copy, test_copy(slice, copy));
+  uint64_t hash[2];
+  uint64_t expected[2];
+  bstr_slice_hash128(slice, hash);
+  bstr_hash128(&own, expected);
+  TEST_ASSERT_EQUAL_UINT64(expected[0], hash[0]);
+  TEST_ASSERT_EQUAL_UINT64(expected[1], hash[1]);
+  TEST_ASSERT_EQUAL_UINT64(expected[0], bstr_slice_hash(slice));
+  if (nbits > 2) {
+    const unsigned int from = nbits / 2;
+    int next = -1;
+    for (unsigned int i = from; i < nbits && next < 0; i++)
+      if (test_bit(offset + i))
+        next = (int)i;
+    TEST_ASSERT_EQUAL_INT(next, bstr_slice_next_set_bit(slice, from));
+  }
+  if (nbits >= 40) {
+    uint64_t field = 0;
+    for (unsigned int i = 0; i < 37; i++)
+      field |= (uint64_t)test_bit(offset + 3 + i) << i;
+    TEST_ASSERT_EQUAL_UINT64(field, bstr_slice_get_field(slice, 3, 37));
+  }
+}
+
+void test_bstr_slice_random(void) {
+  srand(9);
+  for (unsigned int i = 0; i < TEST_SLICE_WORDS; i++)
+    test_words[i] = (unsigned int)rand() ^ ((unsigned int)rand() << 16);
+  test_words[3] = 0;
+  test_words[4] = 0;
+  test_words[20] = ~0U;
+  test_words[21] = ~0U;
+  for (unsigned int round = 0; round < 400; round++) {
+    const unsigned int offset = (unsigned int)rand() % TEST_SLICE_BITS;
+    const unsigned int nbits =
+        round % 4 == 0 ? (unsigned int)rand() % 80
+                       : (unsigned int)rand() % (TEST_SLICE_BITS - offset + 1U);
+    if (offset + nbits > TEST_SLICE_BITS)
+      continue;
+    test_slice_check(bstr_slice(test_words, offset, nbits), offset, nbits);
+  }
+  /* All zeros and all ones, cut inside words. */
+  test_slice_check(bstr_slice(test_words, 3 * 32 + 5, 50), 3 * 32 + 5, 50);
+  test_slice_check(bstr_slice(test_words, 20 * 32 + 7, 50), 20 * 32 + 7, 50);
+}
+
+void test_bstr_slice_sub(void) {
+  bstr_bitstr_t bstr = bstr_wrap(test_words, TEST_SLICE_WORDS);
+  TEST_ASSERT_EQUAL_UINT(TEST_SLICE_WORDS, bstr_get_capacity(&bstr));
+  const bstr_slice_t all = bstr_slice_of(&bstr, 0, TEST_SLICE_BITS);
+  TEST_ASSERT_EQUAL_INT(bstr_popcnt(&bstr), bstr_slice_popcnt(all));
+  const bstr_slice_t outer = bstr_slice_sub(all, 77, 900);
+  const bstr_slice_t inner = bstr_slice_sub(outer, 301, 200);
+  test_slice_check(outer, 77, 900);
+  test_slice_check(inner, 77 + 301, 200);
+  TEST_ASSERT_TRUE(bstr_slice_equals(inner, bstr_slice_of(&bstr, 378, 200)));
+  TEST_ASSERT_FALSE(bstr_slice_equals(inner, bstr_slice_of(&bstr, 378, 199)));
+
+  /* The same bits at a different offset. */
+  static unsigned int shifted[TEST_SLICE_WORDS + 1U];
+  for (unsigned int i = 0; i < TEST_SLICE_BITS; i++)
+    if (test_bit(i))
+      shifted[(i + 13) / 32] |= 1U << ((i + 13) % 32);
+  TEST_ASSERT_TRUE(
+      bstr_slice_equals(bstr_slice(shifted, 13 + 378, 200), inner));
+  TEST_ASSERT_TRUE(bstr_slice_equals(bstr_slice(shifted, 13, TEST_SLICE_BITS),
+                                     all));
+  shifted[10] ^= 1U << 4;
+  TEST_ASSERT_FALSE(bstr_slice_equals(bstr_slice(shifted, 13, TEST_SLICE_BITS),
+                                      all));
+  TEST_ASSERT_TRUE(bstr_slice_equals(bstr_slice(shifted, 13 + 378, 200),
+                                     inner));
+}
+
+/* a and b against a bit by bit reference. */
+static void test_slice_pair(bstr_slice_t a, bstr_slice_t b) {
+  const unsigned int na = bstr_slice_bits(a);
+  const unsigned int nb = bstr_slice_bits(b);
+  const unsigned int n = na < nb ? na : nb;
+  bool intersects = false;
+  bool subset = true;
+  int compare = (na > nb) - (na < nb);
+  for (unsigned int i = 0; i < na; i++) {
+    const bool x = bstr_slice_get(a, i);
+    const bool y = i < nb && bstr_slice_get(b, i);
+    intersects |= x && y;
+    subset &= !x || y;
+  }
+  for (unsigned int i = 0; i < n; i++) {
+    if (bstr_slice_get(a, i) != bstr_slice_get(b, i)) {
+      compare = bstr_slice_get(a, i) ? 1 : -1;
+      break;
+    }
+  }
+  TEST_ASSERT_EQUAL(intersects, bstr_slice_intersects(a, b));
+  TEST_ASSERT_EQUAL(subset, bstr_slice_is_subset(a, b));
+  const int result = bstr_slice_compare(a, b);
+  TEST_ASSERT_EQUAL_INT(compare, (result > 0) - (result < 0));
+}
+
+void test_bstr_slice_pair(void) {
+  srand(17);
+  for (unsigned int i = 0; i < TEST_SLICE_WORDS; i++)
+    test_words[i] = (unsigned int)rand() & (unsigned int)rand();
+  static unsigned int other[TEST_SLICE_WORDS];
+  for (unsigned int i = 0; i < TEST_SLICE_WORDS; i++)
+    other[i] = test_words[i] | ((unsigned int)rand() & (unsigned int)rand());
+  test_words[30] = 0;
+  other[30] = ~0U;
+  for (unsigned int round = 0; round < 300; round++) {
+    const unsigned int offset = (unsigned int)rand() % (TEST_SLICE_BITS / 2);
+    const unsigned int nbits = (unsigned int)rand() % (TEST_SLICE_BITS / 2);
+    /* Round 0 mod 3 keeps the offset for the word by word path. */
+    const unsigned int shift = round % 3 == 0 ? 0U : (unsigned int)rand() % 40;
+    const bstr_slice_t a = bstr_slice(test_words, offset, nbits);
+    const bstr_slice_t b = bstr_slice(other, offset + shift, nbits);
+    test_slice_pair(a, b);
+    test_slice_pair(b, a);
+    test_slice_pair(a, bstr_slice(test_words, offset + shift, nbits));
+    test_slice_pair(a, bstr_slice_sub(b, 0, nbits / 2));
+    test_slice_pair(bstr_slice_sub(a, 0, nbits / 2), b);
+    TEST_ASSERT_EQUAL_INT(0, bstr_slice_compare(a, a));
+    TEST_ASSERT_TRUE(bstr_slice_is_subset(a, bstr_slice(other, offset, nbits)));
+  }
+}
+
+/* The first run of n bits equal to set in [from, limit) of a slice, aligned
+ * from its bit 0. */
+static int test_run(bstr_slice_t slice, unsigned int n, unsigned int align,
+                    unsigned int from, unsigned int limit, bool set) {
+  const unsigned int step = align > 1 ? align : 1;
+  for (unsigned int s = (from + step - 1) / step * step;
+       s < limit && s + n <= bstr_slice_bits(slice); s += step) {
+    unsigned int len = 0;
+    while (len < n && bstr_slice_get(slice, s + len) == set)
+      len++;
+    if (len == n)
+      return (int)s;
+  }
+  return -1;
+}
+
+void test_bstr_slice_find(void) {
+  srand(23);
+  for (unsigned int i = 0; i < TEST_SLICE_WORDS; i++)
+    test_words[i] = (unsigned int)rand() ^ ((unsigned int)rand() << 16);
+  test_words[6] = 0;
+  test_words[7] = 0x0000FFF0U;
+  test_words[25] = ~0U;
+  test_words[26] = 0xFFFFF00FU;
+  const unsigned int aligns[] = {0, 1, 2, 8, 64};
+  const unsigned int lengths[] = {1, 5, 12, 31, 33, 70};
+  for (unsigned int round = 0; round < 60; round++) {
+    const unsigned int offset = (unsigned int)rand() % 200;
+    const unsigned int nbits =
+        (unsigned int)rand() % (TEST_SLICE_BITS - offset + 1U);
+    const bstr_slice_t slice = bstr_slice(test_words, offset, nbits);
+    /* Patterns cut from the slice, so most of them are found. */
+    const unsigned int k = 1U + (unsigned int)rand() % 40U;
+    if (k <= nbits) {
+      static unsigned int pattern[3];
+      const unsigned int at = (unsigned int)rand() % (nbits - k + 1U);
+      test_copy(bstr_slice_sub(slice, at, k), pattern);
+      const bstr_bitstr_t p = bstr_wrap_const(pattern, 2);
+      const unsigned int from = (unsigned int)rand() % (nbits - k + 1U);
+      int expected = -1;
+      for (unsigned int s = from; s + k <= nbits && expected < 0; s++)
+        if (bstr_slice_equals(bstr_slice_sub(slice, s, k),
+                              bstr_slice(pattern, 0, k)))
+          expected = (int)s;
+      TEST_ASSERT_EQUAL_INT(expected,
+                            bstr_slice_find_pattern(slice, &p, k, from));
+    }
+    for (unsigned int a = 0; a < sizeof(aligns) / sizeof(aligns[0]); a++) {
+      for (unsigned int l = 0; l < sizeof(lengths) / sizeof(lengths[0]);
+           l++) {
+        const unsigned int n = lengths[l];
+        const unsigned int hint = nbits > 0 ? (unsigned int)rand() % nbits : 0;
+        for (int set = 0; set < 2; set++) {
+          int expected = test_run(slice, n, aligns[a], hint, nbits, set);
+          if (expected < 0)
+            expected = test_run(slice, n, aligns[a], 0, hint, set);
+          TEST_ASSERT_EQUAL_INT(
+              expected,
+              set ? bstr_slice_find_one_run(slice, n, aligns[a], hint)
+                  : bstr_slice_find_zero_run(slice, n, aligns[a], hint));
+        }
+      }
+    }
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_slice_random);
+  RUN_TEST(test_bstr_slice_sub);
+  RUN_TEST(test_bstr_slice_pair);
+  RUN_TEST(test_bstr_slice_find);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -32,6 +32,7 @@ BSTR_STATIC_DECLARE_SIZED_BITSTRING_STRUCT(64);
 BSTR_STATIC_DECLARE_BOUND_CHECK(64);
 BSTR_STATIC_DECLARE__GET_INT_FOR_BIT_INDEX(64);
 BSTR_STATIC_DECLARE_GET(64);
+BSTR_STATIC_DECLARE_FIELDS(64);
 BSTR_STATIC_DECLARE_TO_STRING(64);
 BSTR_STATIC_DECLARE_BINDUMP(64);
 BSTR_STATIC_DECLARE_SET(64);
@@ -42,8 +43,13 @@ BSTR_STATIC_DECLARE_FFUS(64);
 BSTR_STATIC_DECLARE_CTZ(64);
 BSTR_STATIC_DECLARE_CLZ(64);
 BSTR_STATIC_DECLARE_POPCNT(64);
+BSTR_STATIC_DECLARE_POSITIONAL_POPCNT(64);
 BSTR_STATIC_DECLARE_NEXT_SET_BIT(64);
 BSTR_STATIC_DECLARE_NEXT_UNSET_BIT(64);
+BSTR_STATIC_DECLARE_IS_EMPTY(64);
+BSTR_STATIC_DECLARE_PREDICATES(64);
+BSTR_STATIC_DECLARE_FIND_PATTERN(64);
+BSTR_STATIC_DECLARE_RANGES(64);
 
 void bitdump(const bstr_bitstr64_t *const bstr) {
   char bdump[BSTR_BINDUMP_SIZE] = {0};
@@ -78,6 +84,18 @@ void test_bstrs_to_string_size(void) {
                         bstrs_to_string_size(64));
 }
 
+void test_bstrs_to_string(void) {
+  bstr_static_t(64) test = bstrs_initialize;
+  bstrs_set(64, &test, 1);
+  char str[bstrs_to_string_size(64)];
+  str[0] = '\0';
+  bstrs_to_string(64, &test, str);
+  TEST_ASSERT_EQUAL_UINT(bstrs_to_string_size(64) - 1, strlen(str));
+  TEST_ASSERT_EQUAL_INT('0', str[0]);
+  TEST_ASSERT_EQUAL_INT('1', str[1]);
+  TEST_ASSERT_EQUAL_INT('0', str[2]);
+}
+
 void test_bstrs_set(void) {
   bstr_static_t(64) test = bstrs_initialize;
   for (int i = 0; i != bstrs_get_bit_capacity(64); i++) {
@@ -207,12 +225,100 @@ void test_bstrs_next_unset_bit(void) {
   }
 }
 
+void test_bstrs_predicates(void) {
+  bstr_static_t(64) a = bstrs_initialize;
+  bstr_static_t(64) b = bstrs_initialize;
+  TEST_ASSERT_TRUE(bstrs_is_empty(64, &a));
+  TEST_ASSERT_TRUE(bstrs_equals(64, &a, &b));
+  TEST_ASSERT_EQUAL_INT(0, bstrs_compare(64, &a, &b));
+  bstrs_set(64, &a, 2000);
+  TEST_ASSERT_FALSE(bstrs_is_empty(64, &a));
+  TEST_ASSERT_FALSE(bstrs_equals(64, &a, &b));
+  TEST_ASSERT_FALSE(bstrs_is_subset(64, &a, &b));
+  TEST_ASSERT_TRUE(bstrs_is_subset(64, &b, &a));
+  TEST_ASSERT_FALSE(bstrs_intersects(64, &a, &b));
+  TEST_ASSERT_TRUE(bstrs_compare(64, &a, &b) > 0);
+  bstrs_set(64, &b, 2000);
+  bstrs_set(64, &b, 5);
+  TEST_ASSERT_TRUE(bstrs_intersects(64, &a, &b));
+  TEST_ASSERT_TRUE(bstrs_is_subset(64, &a, &b));
+  TEST_ASSERT_TRUE(bstrs_compare(64, &a, &b) < 0);
+}
+
+void test_bstrs_find_pattern(void) {
+  bstr_static_t(64) test = bstrs_initialize;
+  const unsigned int sync[2] = {0xDEADBEEFU, 0x5U};
+  unsigned int matches[4];
+  for (unsigned int j = 0; j < 35; j++) {
+    if ((sync[j / 32] >> (j % 32)) & 1U) {
+      bstrs_set(64, &test, 77 + j);
+      bstrs_set(64, &test, 1500 + j);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(77, bstrs_find_pattern(64, &test, sync, 35, 0));
+  TEST_ASSERT_EQUAL_INT(1500, bstrs_find_pattern(64, &test, sync, 35, 78));
+  TEST_ASSERT_EQUAL_INT(-1, bstrs_find_pattern(64, &test, sync, 35, 1501));
+  TEST_ASSERT_EQUAL_UINT(2, bstrs_find_all_pattern(64, &test, sync, 35,
+                                                   matches, 4));
+  TEST_ASSERT_EQUAL_UINT(77, matches[0]);
+  TEST_ASSERT_EQUAL_UINT(1500, matches[1]);
+}
+
+void test_bstrs_alloc_range(void) {
+  bstr_static_t(64) test = bstrs_initialize;
+  bstrs_set_range(64, &test, 0, 100);
+  TEST_ASSERT_EQUAL_UINT(100, bstrs_popcnt(64, &test));
+  TEST_ASSERT_EQUAL_INT(0, bstrs_find_one_run(64, &test, 100, 0, 50));
+  TEST_ASSERT_EQUAL_INT(100, bstrs_find_zero_run(64, &test, 300, 0, 0));
+  TEST_ASSERT_EQUAL_INT(128, bstrs_alloc_range(64, &test, 300, 64, 0));
+  TEST_ASSERT_EQUAL_INT(100, bstrs_alloc_range(64, &test, 28, 0, 0));
+  TEST_ASSERT_EQUAL_INT(428, bstrs_find_zero_run(64, &test, 1, 0, 0));
+  bstrs_free_range(64, &test, 128, 300);
+  bstrs_clr_range(64, &test, 0, 10);
+  TEST_ASSERT_EQUAL_UINT(118, bstrs_popcnt(64, &test));
+  TEST_ASSERT_EQUAL_INT(128, bstrs_find_zero_run(64, &test, 300, 0, 20));
+}
+
+void test_bstrs_fields(void) {
+  bstr_static_t(64) test = bstrs_initialize;
+  /* 5 bit counters back to back, every 32nd straddles a word boundary. */
+  for (unsigned int i = 0; i < 400; i++)
+    bstrs_set_field(64, &test, i * 5, 5, i % 29);
+  for (unsigned int i = 0; i < 400; i++)
+    TEST_ASSERT_EQUAL_UINT64(i % 29, bstrs_get_field(64, &test, i * 5, 5));
+  bstrs_set_field(64, &test, 60, 64, 0xFEDCBA9876543210ULL);
+  TEST_ASSERT_EQUAL_UINT64(0xFEDCBA9876543210ULL,
+                           bstrs_get_field(64, &test, 60, 64));
+  TEST_ASSERT_EQUAL_UINT64(11, bstrs_get_field(64, &test, 55, 5));
+  TEST_ASSERT_EQUAL_UINT64(25, bstrs_get_field(64, &test, 125, 5));
+}
+
+void test_bstrs_positional_popcnt(void) {
+  static bstr_static_t(64) rows[20];
+  const bstr_static_t(64) *ptrs[20];
+  static uint32_t counts[64 * 32];
+  for (unsigned int r = 0; r < 20; r++) {
+    bstrs_set_all(64, &rows[r], true);
+    for (unsigned int i = r; i < 64 * 32; i += 20)
+      bstrs_clr(64, &rows[r], i);
+    ptrs[r] = &rows[r];
+  }
+  /* Every bit is cleared in exactly one of them. */
+  bstrs_positional_popcnt(64, ptrs, 20, counts);
+  for (unsigned int i = 0; i < 64 * 32; i++)
+    TEST_ASSERT_EQUAL_UINT32(19, counts[i]);
+  bstrs_positional_popcnt_add(64, ptrs, 3, counts);
+  TEST_ASSERT_EQUAL_UINT32(21, counts[0]);
+  TEST_ASSERT_EQUAL_UINT32(22, counts[3]);
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_bstrs_create);
   RUN_TEST(test_bstrs_get_capacity);
   RUN_TEST(test_bstrs_get_bit_capacity);
   RUN_TEST(test_bstrs_to_string_size);
+  RUN_TEST(test_bstrs_to_string);
   RUN_TEST(test_bstrs_set);
   RUN_TEST(test_bstrs_set_all);
   RUN_TEST(test_bstrs_clr);
@@ -223,6 +329,11 @@ int main(void) {
   RUN_TEST(test_bstrs_clz);
   RUN_TEST(test_bstrs_next_set_bit);
   RUN_TEST(test_bstrs_next_unset_bit);
+  RUN_TEST(test_bstrs_predicates);
+  RUN_TEST(test_bstrs_find_pattern);
+  RUN_TEST(test_bstrs_alloc_range);
+  RUN_TEST(test_bstrs_fields);
+  RUN_TEST(test_bstrs_positional_popcnt);
   UNITY_END();
 }
 
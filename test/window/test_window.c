@@ -0,0 +1,126 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_window.h"
+#include "unity.h"
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_WINDOW_TICKS 5U
+#define TEST_WINDOW_CAPACITY 3U
+#define TEST_WINDOW_BITS (TEST_WINDOW_CAPACITY * BSTR_BITS_PER_INT)
+
+void test_bstr_window_dedup(void) {
+  bstr_window_t *win =
+      bstr_window_create(TEST_WINDOW_TICKS, TEST_WINDOW_CAPACITY);
+  TEST_ASSERT_NOT_NULL(win);
+  TEST_ASSERT_EQUAL_UINT(TEST_WINDOW_TICKS, bstr_window_ticks(win));
+  TEST_ASSERT_FALSE(bstr_window_test_and_set(win, 17));
+  TEST_ASSERT_TRUE(bstr_window_test_and_set(win, 17));
+  TEST_ASSERT_EQUAL_UINT64(1, bstr_window_popcnt(win));
+
+  /* Seen until it falls out of the window. */
+  for (unsigned int t = 1; t < TEST_WINDOW_TICKS; t++) {
+    bstr_window_advance(win, 1);
+    TEST_ASSERT_TRUE(bstr_window_get(win, 17));
+  }
+  bstr_window_advance(win, 1);
+  TEST_ASSERT_FALSE(bstr_window_get(win, 17));
+  TEST_ASSERT_EQUAL_UINT64(0, bstr_window_popcnt(win));
+
+  bstr_window_set(win, 0);
+  bstr_window_set(win, TEST_WINDOW_BITS - 1U);
+  bstr_window_advance(win, 2);
+  bstr_window_set(win, 0);
+  TEST_ASSERT_EQUAL_UINT(2, bstr_window_count(win, 0));
+  TEST_ASSERT_EQUAL_UINT(1, bstr_window_count(win, TEST_WINDOW_BITS - 1U));
+  TEST_ASSERT_TRUE(bstr_get(bstr_window_slice(win, 0), 0));
+  TEST_ASSERT_FALSE(bstr_get(bstr_window_slice(win, 1), 0));
+  TEST_ASSERT_TRUE(bstr_get(bstr_window_slice(win, 2), 0));
+  bstr_window_advance(win, 1000);
+  TEST_ASSERT_EQUAL_UINT64(0, bstr_window_popcnt(win));
+  TEST_ASSERT_EQUAL_UINT(0, bstr_window_count(win, 0));
+  bstr_window_delete(win);
+}
+
+/* Compares against a brute force history of the last ticks. */
+void test_bstr_window_random(void) {
+  static bool history[TEST_WINDOW_TICKS][TEST_WINDOW_BITS];
+  bstr_window_t *win =
+      bstr_window_create(TEST_WINDOW_TICKS, TEST_WINDOW_CAPACITY);
+  bstr_bitstr_t *all = bstr_create_bitstr(TEST_WINDOW_CAPACITY);
+  unsigned int head = 0;
+  srand(42);
+  for (unsigned int round = 0; round < 400; round++) {
+    const unsigned int op = (unsigned int)rand() % 8;
+    const unsigned int bit = (unsigned int)rand() % TEST_WINDOW_BITS;
+    if (op == 0) {
+      const unsigned int ticks = (unsigned int)rand() % 7;
+      for (unsigned int t = 0; t < ticks; t++) {
+        head = (head + 1U) % TEST_WINDOW_TICKS;
+        for (unsigned int i = 0; i < TEST_WINDOW_BITS; i++)
+          history[head][i] = false;
+      }
+      bstr_window_advance(win, ticks);
+    } else {
+      unsigned int count = 0;
+      for (unsigned int t = 0; t < TEST_WINDOW_TICKS; t++)
+        count += history[t][bit] ? 1U : 0U;
+      TEST_ASSERT_EQUAL_UINT(count, bstr_window_count(win, bit));
+      TEST_ASSERT_EQUAL(count != 0, bstr_window_test_and_set(win, bit));
+      history[head][bit] = true;
+    }
+
+    uint64_t total = 0;
+    for (unsigned int t = 0; t < TEST_WINDOW_TICKS; t++)
+      for (unsigned int i = 0; i < TEST_WINDOW_BITS; i++)
+        total += history[t][i] ? 1U : 0U;
+    TEST_ASSERT_EQUAL_UINT64(total, bstr_window_popcnt(win));
+  }
+
+  bstr_window_union(win, all);
+  for (unsigned int i = 0; i < TEST_WINDOW_BITS; i++) {
+    bool any = false;
+    for (unsigned int t = 0; t < TEST_WINDOW_TICKS; t++)
+      any = any || history[t][i];
+    TEST_ASSERT_EQUAL(any, bstr_get(all, i));
+  }
+  bstr_delete_bitstr(all);
+  bstr_window_delete(win);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_window_dedup);
+  RUN_TEST(test_bstr_window_random);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2021 Stefan Luecke <git@aberrational.org>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitstring_wm.h"
+#include "unity.h"
+
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TEST_WM_MAX_VALUES 3000U
+
+static unsigned int test_wm_values[TEST_WM_MAX_VALUES];
+
+static int test_wm_compare(const void *a, const void *b) {
+  const unsigned int x = *(const unsigned int *)a;
+  const unsigned int y = *(const unsigned int *)b;
+  return (x > y) - (x < y);
+}
+
+/* Checks every operation on the first n test_wm_values against brute force. */
+static void test_wm_check(unsigned int n, unsigned int sigma) {
+  static unsigned int sorted[TEST_WM_MAX_VALUES];
+  bstr_wm_t *wm = bstr_wm_create(test_wm_values, n);
+  TEST_ASSERT_NOT_NULL(wm);
+  TEST_ASSERT_EQUAL_UINT(n, bstr_wm_count(wm));
+  for (unsigned int i = 0; i < n; i++)
+    TEST_ASSERT_EQUAL_UINT(test_wm_values[i], bstr_wm_get(wm, i));
+
+  for (unsigned int s = 0; s < 6; s++) {
+    const unsigned int symbol =
+        s < 5 ? test_wm_values[(unsigned int)rand() % n] : sigma + 1U;
+    unsigned int rank = 0;
+    for (unsigned int i = 0; i <= n; i++) {
+      if (i % 7 == 0 || i == n)
+        TEST_ASSERT_EQUAL_UINT(rank, bstr_wm_rank(wm, symbol, i));
+      if (i < n && test_wm_values[i] == symbol) {
+        TEST_ASSERT_EQUAL_INT(i, bstr_wm_select(wm, symbol, rank));
+        rank++;
+      }
+    }
+    TEST_ASSERT_EQUAL_INT(-1, bstr_wm_select(wm, symbol, rank));
+  }
+
+  for (unsigned int q = 0; q < 20; q++) {
+    const unsigned int from = (unsigned int)rand() % n;
+    const unsigned int to = from + 1U + (unsigned int)rand() % (n - from);
+    const unsigned int k = (unsigned int)rand() % (to - from);
+    memcpy(sorted, &test_wm_values[from], (to - from) * sizeof(unsigned int));
+    qsort(sorted, to - from, sizeof(unsigned int), test_wm_compare);
+    TEST_ASSERT_EQUAL_UINT(sorted[k], bstr_wm_quantile(wm, from, to, k));
+  }
+  bstr_wm_delete(wm);
+}
+
+void test_bstr_wm_alphabets(void) {
+  static const unsigned int sigmas[] = {1, 2, 3, 16, 100, 70000, UINT_MAX};
+  srand(9);
+  for (size_t s = 0; s < sizeof(sigmas) / sizeof(sigmas[0]); s++) {
+    for (unsigned int i = 0; i < TEST_WM_MAX_VALUES; i++)
+      test_wm_values[i] = (unsigned int)rand() % sigmas[s];
+    test_wm_check(TEST_WM_MAX_VALUES, sigmas[s]);
+    test_wm_check(1, sigmas[s]);
+    test_wm_check(300, sigmas[s]);
+  }
+}
+
+void test_bstr_wm_extremes(void) {
+  for (unsigned int i = 0; i < TEST_WM_MAX_VALUES; i++)
+    test_wm_values[i] = i % 3 == 0 ? UINT_MAX : i;
+  test_wm_check(TEST_WM_MAX_VALUES, UINT_MAX);
+  bstr_wm_t *empty = bstr_wm_create(NULL, 0);
+  TEST_ASSERT_EQUAL_UINT(0, bstr_wm_count(empty));
+  TEST_ASSERT_EQUAL_UINT(0, bstr_wm_rank(empty, 0, 0));
+  TEST_ASSERT_EQUAL_INT(-1, bstr_wm_select(empty, 0, 0));
+  bstr_wm_delete(empty);
+}
+
+void test_bstr_wm_size(void) {
+  /* 16 distinct symbols take 4 levels, not 16 bitmaps. */
+  for (unsigned int i = 0; i < TEST_WM_MAX_VALUES; i++)
+    test_wm_values[i] = i & 15U;
+  bstr_wm_t *wm = bstr_wm_create(test_wm_values, TEST_WM_MAX_VALUES);
+  TEST_ASSERT_TRUE(bstr_wm_size_in_bits(wm) < 5U * TEST_WM_MAX_VALUES);
+  TEST_ASSERT_EQUAL_UINT(7, bstr_wm_quantile(wm, 0, 16, 7));
+  TEST_ASSERT_EQUAL_INT(16 * 9 + 5, bstr_wm_select(wm, 5, 9));
+  bstr_wm_delete(wm);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bstr_wm_alphabets);
+  RUN_TEST(test_bstr_wm_extremes);
+  RUN_TEST(test_bstr_wm_size);
+  UNITY_END();
+}
+
+#ifdef __cplusplus
+}
+#endif